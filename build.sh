@@ -15,6 +15,7 @@ check_package "cmake"
 check_package "make"
 check_package "libdrm-dev"
 check_package "libgtk-4-dev"
+check_package "libxml2-utils" # xmllint, used by glib-compile-resources
 
 # Build the project
 cd build
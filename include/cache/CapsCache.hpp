@@ -0,0 +1,334 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <d3d9caps.h>
+
+/**
+ * DirectX version reported by libdsetup (4.09.00.0904, DirectX 9.0c).
+ * Part of the cache key, so a runtime upgrade never reads old results.
+ */
+#define ODX_DIRECTX_VERSION  0x00040009
+#define ODX_DIRECTX_REVISION 0x00000384
+
+/**
+ * Bump whenever libd3d9 reports different caps, formats or modes
+ * for the same driver and CPU.
+ */
+#define ODX_CAPS_REVISION 11
+
+/**
+ * Device capabilities database of libd3d9 (libdsetup only takes the
+ * version constants above).
+ *
+ * One file per (DRM driver, driver version, CPU feature set) under
+ * $XDG_CACHE_HOME/opendx/caps/. It is a fixed-size table mapped
+ * MAP_SHARED: the first process to probe something writes it in
+ * place and every later CheckDeviceFormat & co. is a lookup in the
+ * mapping. Slots are published with a release store so concurrent
+ * processes never see half-written entries.
+ *
+ * When no file can be created the same table lives in anonymous
+ * memory, so results are still computed once per process.
+ */
+class CapsCache {
+	public:enum Kind : uint32_t {
+		KIND_FORMAT = 1,      //CheckDeviceFormat
+		KIND_MULTISAMPLE = 2, //CheckDeviceMultiSampleType
+	};
+
+	public:static constexpr const uint32_t maxModes = 256;
+	public:static constexpr const uint32_t slots = 4096; //power of two
+	public:static constexpr const uint32_t maxProbe = 32;
+
+	private:enum State : uint32_t {
+		EMPTY = 0,
+		WRITING = 1,
+		READY = 2
+	};
+
+	public:struct Entry {
+		uint32_t state;
+		uint32_t kind;
+		uint32_t args[5];
+		int32_t result;
+		uint32_t value;
+	};
+
+	private:struct Header {
+		char magic[8];
+		uint32_t revision;
+		uint32_t directx;
+		uint32_t capsSize;
+		uint32_t cpu;
+		char driver[32];
+		int32_t version[3];
+		uint32_t capsState[4]; //by D3DDEVTYPE (HAL, REF, SW)
+		uint32_t modesState;
+		uint32_t modeCount;
+		uint32_t modesOutputs; //D3DCaps::outputs() the modes were probed with
+	};
+
+	private:struct Layout {
+		Header header;
+		D3DCAPS9 caps[4];
+		D3DDISPLAYMODE modes[maxModes];
+		Entry entries[slots];
+	};
+
+	private:Layout* data = NULL;
+	private:bool shared = false;
+
+	/**
+	 * Feature bits of the running CPU that change what the runtime
+	 * can do (e.g. F16C for half float formats).
+	 */
+	public:static uint32_t cpuFeatures() {
+		uint32_t bits = 0;
+
+		#if defined(__x86_64__)
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("sse4.1")) bits |= 1 << 0;
+			if (__builtin_cpu_supports("sse4.2")) bits |= 1 << 1;
+			if (__builtin_cpu_supports("avx")) bits |= 1 << 2;
+			if (__builtin_cpu_supports("avx2")) bits |= 1 << 3;
+			if (__builtin_cpu_supports("fma")) bits |= 1 << 4;
+			if (__builtin_cpu_supports("f16c")) bits |= 1 << 5;
+			if (__builtin_cpu_supports("avx512f")) bits |= 1 << 6;
+		#endif
+
+		return bits;
+	}
+
+	/**
+	 * $XDG_CACHE_HOME/opendx/caps, or ~/.cache/opendx/caps.
+	 */
+	public:static std::string directory() {
+		const char* xdg = getenv("XDG_CACHE_HOME");
+		const char* home = getenv("HOME");
+
+		if (xdg != NULL && xdg[0] == '/') return std::string(xdg) + "/opendx/caps";
+		if (home != NULL) return std::string(home) + "/.cache/opendx/caps";
+		return "";
+	}
+
+	/**
+	 * e.g. i915-1.6.0-0000003f.bin
+	 */
+	public:static std::string fileName(const std::string& driver, const int version[3], uint32_t cpu) {
+		char name[96];
+		snprintf(name, sizeof(name), "%.32s-%d.%d.%d-%08x.bin", driver.c_str(), version[0], version[1], version[2], cpu);
+		return name;
+	}
+
+	public:CapsCache(const std::string& driver, const int version[3]) {
+		uint32_t cpu = CapsCache::cpuFeatures();
+		Header expected = {};
+
+		memcpy(expected.magic, "ODXCAPS", 8);
+		expected.revision = ODX_CAPS_REVISION;
+		expected.directx = ODX_DIRECTX_VERSION;
+		expected.capsSize = sizeof(D3DCAPS9);
+		expected.cpu = cpu;
+		strncpy(expected.driver, driver.c_str(), sizeof(expected.driver) - 1);
+		memcpy(expected.version, version, sizeof(expected.version));
+
+		std::string dir = CapsCache::directory();
+		if (!dir.empty()) {
+			this->data = CapsCache::map(dir, dir + "/" + CapsCache::fileName(driver, version, cpu), expected);
+			this->shared = this->data != NULL;
+		}
+
+		if (this->data == NULL) {
+			void* memory = mmap(NULL, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (memory == MAP_FAILED) return;
+
+			this->data = (Layout*) memory;
+			this->data->header = expected;
+		}
+	}
+
+	public:~CapsCache() {
+		if (this->data != NULL) munmap(this->data, sizeof(Layout));
+	}
+
+	public:bool isShared() const {
+		return this->shared;
+	}
+
+	/**
+	 * Open (or create) the database file. A file written by another
+	 * revision is replaced through rename(), so processes that still
+	 * map the old one keep a consistent view.
+	 */
+	private:static Layout* map(const std::string& dir, const std::string& path, const Header& expected) {
+		std::error_code ec;
+		std::filesystem::create_directories(dir, ec);
+
+		for (int attempt = 0; attempt < 2; attempt++) {
+			int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+
+			if (fd >= 0) {
+				struct stat st;
+				Layout* layout = NULL;
+
+				if (fstat(fd, &st) == 0 && st.st_size == (off_t) sizeof(Layout)) {
+					void* memory = mmap(NULL, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+					if (memory != MAP_FAILED) layout = (Layout*) memory;
+				}
+				close(fd);
+
+				if (layout != NULL && memcmp(&layout->header, &expected, offsetof(Header, capsState)) == 0) {
+					return layout;
+				}
+				if (layout != NULL) munmap(layout, sizeof(Layout));
+			}
+
+			//missing or stale: build a fresh one next to it and swap it in
+			std::string temp = path + "." + std::to_string(getpid());
+			fd = open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+			if (fd < 0) return NULL;
+
+			bool ok = ftruncate(fd, sizeof(Layout)) == 0 && pwrite(fd, &expected, sizeof(Header), 0) == (ssize_t) sizeof(Header);
+			close(fd);
+
+			if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+				unlink(temp.c_str());
+				return NULL;
+			}
+		}
+
+		return NULL;
+	}
+
+	private:static uint32_t load(const uint32_t& word) {
+		return std::atomic_ref<uint32_t>(const_cast<uint32_t&>(word)).load(std::memory_order_acquire);
+	}
+
+	private:static void publish(uint32_t& word, uint32_t value) {
+		std::atomic_ref<uint32_t>(word).store(value, std::memory_order_release);
+	}
+
+	private:static bool claim(uint32_t& word) {
+		uint32_t empty = EMPTY;
+		return std::atomic_ref<uint32_t>(word).compare_exchange_strong(empty, WRITING, std::memory_order_acquire);
+	}
+
+	/**
+	 * GetDeviceCaps result for "type", or NULL when not probed yet.
+	 */
+	public:const D3DCAPS9* getCaps(D3DDEVTYPE type) const {
+		if (this->data == NULL || type < D3DDEVTYPE_HAL || type > D3DDEVTYPE_SW) return NULL;
+
+		return CapsCache::load(this->data->header.capsState[type]) == READY ? &this->data->caps[type] : NULL;
+	}
+
+	public:void putCaps(D3DDEVTYPE type, const D3DCAPS9& caps) {
+		if (this->data == NULL || type < D3DDEVTYPE_HAL || type > D3DDEVTYPE_SW) return;
+		if (!CapsCache::claim(this->data->header.capsState[type])) return;
+
+		this->data->caps[type] = caps;
+		CapsCache::publish(this->data->header.capsState[type], READY);
+	}
+
+	/**
+	 * Adapter mode list probed with the same connected "outputs".
+	 * Returns false when not probed yet, or probed with another
+	 * monitor, or rewritten while copying it.
+	 */
+	public:bool getModes(std::vector<D3DDISPLAYMODE>& modes, uint32_t outputs) const {
+		if (this->data == NULL) return false;
+
+		const Header& header = this->data->header;
+		if (CapsCache::load(header.modesState) != READY || CapsCache::load(header.modesOutputs) != outputs) return false;
+
+		uint32_t count = std::min(header.modeCount, maxModes);
+		modes.assign(this->data->modes, this->data->modes + count);
+
+		return CapsCache::load(header.modesState) == READY && CapsCache::load(header.modesOutputs) == outputs;
+	}
+
+	/**
+	 * Store the mode list, replacing one probed with other outputs.
+	 */
+	public:void putModes(const std::vector<D3DDISPLAYMODE>& modes, uint32_t outputs) {
+		if (this->data == NULL) return;
+
+		Header& header = this->data->header;
+		uint32_t ready = READY;
+		if (!CapsCache::claim(header.modesState)) {
+			if (CapsCache::load(header.modesOutputs) == outputs) return;
+			if (!std::atomic_ref<uint32_t>(header.modesState).compare_exchange_strong(ready, WRITING, std::memory_order_acquire)) return;
+		}
+
+		uint32_t count = std::min<size_t>(modes.size(), maxModes);
+		std::copy(modes.begin(), modes.begin() + count, this->data->modes);
+		header.modeCount = count;
+		CapsCache::publish(header.modesOutputs, outputs);
+		CapsCache::publish(header.modesState, READY);
+	}
+
+	private:static uint32_t hash(uint32_t kind, const uint32_t args[5]) {
+		uint32_t h = 2166136261u ^ kind;
+		for (int i = 0; i < 5; i++) {
+			h = (h ^ args[i]) * 16777619u;
+			h ^= h >> 15;
+		}
+		return h;
+	}
+
+	/**
+	 * Look up a query result. "args" are the call's parameters.
+	 */
+	public:bool get(uint32_t kind, const uint32_t args[5], int32_t& result, uint32_t& value) const {
+		if (this->data == NULL) return false;
+
+		uint32_t h = CapsCache::hash(kind, args);
+		for (uint32_t probe = 0; probe < maxProbe; probe++) {
+			const Entry& entry = this->data->entries[(h + probe) & (slots - 1)];
+			uint32_t state = CapsCache::load(entry.state);
+
+			if (state == EMPTY) return false;
+			if (state == READY && entry.kind == kind && memcmp(entry.args, args, sizeof(entry.args)) == 0) {
+				result = entry.result;
+				value = entry.value;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/**
+	 * Store a query result. Silently dropped when its probe
+	 * sequence is full; the caller computes it again next time.
+	 */
+	public:void put(uint32_t kind, const uint32_t args[5], int32_t result, uint32_t value) {
+		if (this->data == NULL) return;
+
+		uint32_t h = CapsCache::hash(kind, args);
+		for (uint32_t probe = 0; probe < maxProbe; probe++) {
+			Entry& entry = this->data->entries[(h + probe) & (slots - 1)];
+			if (!CapsCache::claim(entry.state)) continue;
+
+			entry.kind = kind;
+			memcpy(entry.args, args, sizeof(entry.args));
+			entry.result = result;
+			entry.value = value;
+			CapsCache::publish(entry.state, READY);
+			return;
+		}
+	}
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #define DEBUG true
+#define OPENDX_VERSION "1.0.0"
 
 //PREPROCESSING ONLY!!!
 #define PROJECT_SOURCE_DIR "/home/eduardo/Documentos/proj/OpenDX/"
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <d3d9types.h>
+
+/**
+ * Memory layout of D3DFORMATs: what libd3d9 needs to size surfaces
+ * and what libd3dx9 needs to read files into them.
+ */
+class PixelFormat {
+	/**
+	 * Bits per pixel, or per 4x4 block for DXTn. 0 when unknown.
+	 */
+	public:static constexpr UINT bits(D3DFORMAT format) {
+		switch (format) {
+			case D3DFMT_A32B32G32R32F:
+				return 128;
+
+			case D3DFMT_A16B16G16R16: case D3DFMT_A16B16G16R16F: case D3DFMT_G32R32F:
+			case D3DFMT_Q16W16V16U16:
+				return 64;
+
+			case D3DFMT_A8R8G8B8: case D3DFMT_X8R8G8B8: case D3DFMT_A8B8G8R8: case D3DFMT_X8B8G8R8:
+			case D3DFMT_A2B10G10R10: case D3DFMT_A2R10G10B10: case D3DFMT_G16R16: case D3DFMT_G16R16F:
+			case D3DFMT_R32F: case D3DFMT_X8L8V8U8: case D3DFMT_Q8W8V8U8: case D3DFMT_V16U16:
+			case D3DFMT_A2W10V10U10: case D3DFMT_D32: case D3DFMT_D24S8: case D3DFMT_D24X8:
+			case D3DFMT_D24X4S4: case D3DFMT_D32F_LOCKABLE: case D3DFMT_D24FS8: case D3DFMT_INDEX32:
+				return 32;
+
+			case D3DFMT_R8G8B8:
+				return 24;
+
+			case D3DFMT_R5G6B5: case D3DFMT_X1R5G5B5: case D3DFMT_A1R5G5B5: case D3DFMT_A4R4G4B4:
+			case D3DFMT_A8R3G3B2: case D3DFMT_X4R4G4B4: case D3DFMT_A8P8: case D3DFMT_A8L8:
+			case D3DFMT_V8U8: case D3DFMT_L6V5U5: case D3DFMT_L16: case D3DFMT_R16F:
+			case D3DFMT_D16: case D3DFMT_D16_LOCKABLE: case D3DFMT_D15S1: case D3DFMT_INDEX16:
+			case D3DFMT_UYVY: case D3DFMT_YUY2: case D3DFMT_R8G8_B8G8: case D3DFMT_G8R8_G8B8:
+				return 16;
+
+			case D3DFMT_R3G3B2: case D3DFMT_A8: case D3DFMT_P8: case D3DFMT_L8: case D3DFMT_A4L4:
+				return 8;
+
+			case D3DFMT_DXT1:
+				return 64;
+
+			case D3DFMT_DXT2: case D3DFMT_DXT3: case D3DFMT_DXT4: case D3DFMT_DXT5:
+				return 128;
+
+			default:
+				return 0;
+		}
+	}
+
+	public:static constexpr bool isCompressed(D3DFORMAT format) {
+		return format == D3DFMT_DXT1 || format == D3DFMT_DXT2 || format == D3DFMT_DXT3
+			|| format == D3DFMT_DXT4 || format == D3DFMT_DXT5;
+	}
+
+	public:static constexpr bool isDepth(D3DFORMAT format) {
+		return (format >= D3DFMT_D16_LOCKABLE && format <= D3DFMT_D16) || format == D3DFMT_D32F_LOCKABLE
+			|| format == D3DFMT_D24FS8;
+	}
+
+	/**
+	 * Bytes per row (per row of blocks for DXTn), without padding.
+	 */
+	public:static constexpr UINT pitch(D3DFORMAT format, UINT width) {
+		if (PixelFormat::isCompressed(format)) return ((width + 3) / 4) * (PixelFormat::bits(format) / 8);
+		return (width * PixelFormat::bits(format) + 7) / 8;
+	}
+
+	/**
+	 * Rows (of blocks for DXTn) in a surface.
+	 */
+	public:static constexpr UINT rows(D3DFORMAT format, UINT height) {
+		return PixelFormat::isCompressed(format) ? (height + 3) / 4 : height;
+	}
+
+	public:static constexpr size_t size(D3DFORMAT format, UINT width, UINT height) {
+		return (size_t) PixelFormat::pitch(format, width) * PixelFormat::rows(format, height);
+	}
+
+	/**
+	 * Mip levels of a full chain down to 1x1.
+	 */
+	public:static constexpr UINT levels(UINT width, UINT height) {
+		UINT count = 1;
+		while (width > 1 || height > 1) {
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+			count++;
+		}
+		return count;
+	}
+
+	public:static constexpr UINT mipSize(UINT size, UINT level) {
+		return (size >> level) > 0 ? size >> level : 1;
+	}
+};
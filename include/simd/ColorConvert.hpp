@@ -0,0 +1,376 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+#include <d3d9types.h>
+#include <simd/Lanes.hpp>
+
+#if defined(__x86_64__)
+	#include <immintrin.h>
+#endif
+
+/**
+ * Pixel conversion kernels used by the D3DX texture loader.
+ *
+ * Decoded images are kept as 32-bit A8R8G8B8 (bytes B, G, R, A in
+ * memory) until they are packed into the destination format. SSE2
+ * is always available on x86_64; the byte shuffles additionally use
+ * SSSE3 when the CPU has it. Each kernel has a scalar path that also
+ * handles the tail.
+ */
+namespace ColorConvert {
+	inline bool hasSSSE3() {
+		#if defined(__x86_64__)
+			static const bool ssse3 = __builtin_cpu_supports("ssse3");
+			return ssse3;
+		#else
+			return false;
+		#endif
+	}
+
+	//--- into A8R8G8B8
+
+	#if defined(__x86_64__)
+	__attribute__((target("ssse3")))
+	inline size_t swizzle32SSSE3(uint32_t* dst, const uint32_t* src, size_t n, bool swapRB, bool opaque) {
+		const __m128i order = swapRB ? _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+			: _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+		const __m128i alpha = _mm_set1_epi32(opaque ? (int) 0xFF000000 : 0);
+
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			__m128i pixels = _mm_loadu_si128((const __m128i*) (src + i));
+			_mm_storeu_si128((__m128i*) (dst + i), _mm_or_si128(_mm_shuffle_epi8(pixels, order), alpha));
+		}
+		return i;
+	}
+
+	/**
+	 * 4 pixels from 12 bytes; the 16-byte load is why callers stop
+	 * 6 pixels before the end.
+	 */
+	__attribute__((target("ssse3")))
+	inline size_t expand24SSSE3(uint32_t* dst, const uint8_t* src, size_t n, bool swapRB) {
+		const __m128i order = swapRB ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+			: _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m128i alpha = _mm_set1_epi32((int) 0xFF000000);
+
+		size_t i = 0;
+		for (; i + 6 <= n; i += 4) {
+			__m128i bytes = _mm_loadu_si128((const __m128i*) (src + i * 3));
+			_mm_storeu_si128((__m128i*) (dst + i), _mm_or_si128(_mm_shuffle_epi8(bytes, order), alpha));
+		}
+		return i;
+	}
+	#endif
+
+	/**
+	 * 32-bit pixels, with R and B exchanged (RGBA byte order) and/or
+	 * alpha forced to 0xFF. "dst" may be "src".
+	 */
+	inline void swizzle32(uint32_t* dst, const uint32_t* src, size_t n, bool swapRB, bool opaque) {
+		size_t i = 0;
+
+		#if defined(__x86_64__)
+			if (hasSSSE3()) i = swizzle32SSSE3(dst, src, n, swapRB, opaque);
+		#endif
+
+		for (; i < n; i++) {
+			uint32_t p = src[i];
+			if (swapRB) p = (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+			dst[i] = opaque ? p | 0xFF000000 : p;
+		}
+	}
+
+	/**
+	 * 24-bit pixels (B, G, R bytes, or R, G, B when "swapRB").
+	 */
+	inline void expand24(uint32_t* dst, const uint8_t* src, size_t n, bool swapRB) {
+		size_t i = 0;
+
+		#if defined(__x86_64__)
+			if (hasSSSE3()) i = expand24SSSE3(dst, src, n, swapRB);
+		#endif
+
+		for (; i < n; i++) {
+			const uint8_t* p = src + i * 3;
+			uint32_t r = swapRB ? p[0] : p[2], b = swapRB ? p[2] : p[0];
+			dst[i] = 0xFF000000 | (r << 16) | ((uint32_t) p[1] << 8) | b;
+		}
+	}
+
+	/**
+	 * 8-bit indices into a 256-entry A8R8G8B8 palette.
+	 */
+	inline void expand8(uint32_t* dst, const uint8_t* src, size_t n, const uint32_t* palette) {
+		for (size_t i = 0; i < n; i++) dst[i] = palette[src[i]];
+	}
+
+	/**
+	 * R5G6B5, each channel widened by repeating its top bits.
+	 */
+	inline void expand565(uint32_t* dst, const uint16_t* src, size_t n) {
+		size_t i = 0;
+
+		#if defined(__x86_64__)
+			//4 pixels per step: channels moved to their bytes, then top bits copied down
+			const __m128i maskR = _mm_set1_epi32(0xF800), maskG = _mm_set1_epi32(0x07E0), maskB = _mm_set1_epi32(0x001F);
+			const __m128i alpha = _mm_set1_epi32((int) 0xFF000000);
+			for (; i + 4 <= n; i += 4) {
+				__m128i p = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*) (src + i)), _mm_setzero_si128());
+				__m128i r = _mm_slli_epi32(_mm_and_si128(p, maskR), 8);
+				__m128i g = _mm_slli_epi32(_mm_and_si128(p, maskG), 5);
+				__m128i b = _mm_slli_epi32(_mm_and_si128(p, maskB), 3);
+				r = _mm_or_si128(r, _mm_and_si128(_mm_srli_epi32(r, 5), _mm_set1_epi32(0x070000)));
+				g = _mm_or_si128(g, _mm_and_si128(_mm_srli_epi32(g, 6), _mm_set1_epi32(0x000300)));
+				b = _mm_or_si128(b, _mm_srli_epi32(b, 5));
+				_mm_storeu_si128((__m128i*) (dst + i), _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, alpha)));
+			}
+		#endif
+
+		for (; i < n; i++) {
+			uint32_t r = src[i] >> 11, g = src[i] >> 5 & 63, b = src[i] & 31;
+			dst[i] = 0xFF000000 | (r << 3 | r >> 2) << 16 | (g << 2 | g >> 4) << 8 | (b << 3 | b >> 2);
+		}
+	}
+
+	/**
+	 * Pixels equal to "key" become transparent black.
+	 */
+	inline void colorKey(uint32_t* pixels, size_t n, uint32_t key) {
+		size_t i = 0;
+
+		#if defined(__x86_64__)
+			const __m128i keys = _mm_set1_epi32((int) key);
+			for (; i + 4 <= n; i += 4) {
+				__m128i p = _mm_loadu_si128((const __m128i*) (pixels + i));
+				_mm_storeu_si128((__m128i*) (pixels + i), _mm_andnot_si128(_mm_cmpeq_epi32(p, keys), p));
+			}
+		#endif
+
+		for (; i < n; i++) {
+			if (pixels[i] == key) pixels[i] = 0;
+		}
+	}
+
+	//--- mipmaps
+
+	/**
+	 * 2x2 box filter: destination rows [rowBegin, rowEnd) of the
+	 * level below a "width" x "height" image. Edges of odd or 1-pixel
+	 * sizes repeat the last row/column.
+	 */
+	inline void halve(uint32_t* dst, const uint32_t* src, UINT width, UINT height, UINT rowBegin, UINT rowEnd) {
+		UINT halfWidth = std::max(width / 2, 1u);
+
+		for (UINT y = rowBegin; y < rowEnd; y++) {
+			const uint32_t* row0 = src + (size_t) std::min(y * 2, height - 1) * width;
+			const uint32_t* row1 = src + (size_t) std::min(y * 2 + 1, height - 1) * width;
+			uint32_t* out = dst + (size_t) y * halfWidth;
+			UINT x = 0;
+
+			#if defined(__x86_64__)
+				//4 output pixels per step; channels summed in 16 bits
+				const __m128i zero = _mm_setzero_si128(), round = _mm_set1_epi16(2);
+				for (; width >= 2 && x + 4 <= width / 2; x += 4) {
+					__m128i a0 = _mm_loadu_si128((const __m128i*) (row0 + x * 2));
+					__m128i a1 = _mm_loadu_si128((const __m128i*) (row0 + x * 2 + 4));
+					__m128i b0 = _mm_loadu_si128((const __m128i*) (row1 + x * 2));
+					__m128i b1 = _mm_loadu_si128((const __m128i*) (row1 + x * 2 + 4));
+
+					__m128i lo0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+					__m128i hi0 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+					__m128i lo1 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+					__m128i hi1 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+					__m128i sum0 = _mm_add_epi16(_mm_unpacklo_epi64(lo0, hi0), _mm_unpackhi_epi64(lo0, hi0));
+					__m128i sum1 = _mm_add_epi16(_mm_unpacklo_epi64(lo1, hi1), _mm_unpackhi_epi64(lo1, hi1));
+					sum0 = _mm_srli_epi16(_mm_add_epi16(sum0, round), 2);
+					sum1 = _mm_srli_epi16(_mm_add_epi16(sum1, round), 2);
+					_mm_storeu_si128((__m128i*) (out + x), _mm_packus_epi16(sum0, sum1));
+				}
+			#endif
+
+			for (; x < halfWidth; x++) {
+				UINT x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+				uint32_t p[4] = {row0[x0], row0[x1], row1[x0], row1[x1]};
+				uint32_t result = 0;
+
+				for (int shift = 0; shift < 32; shift += 8) {
+					uint32_t sum = 2;
+					for (uint32_t q : p) sum += (q >> shift) & 0xFF;
+					result |= (sum >> 2) << shift;
+				}
+				out[x] = result;
+			}
+		}
+	}
+
+	//--- out of A8R8G8B8
+
+	/**
+	 * Whether pack() can write "format".
+	 */
+	constexpr bool canPack(D3DFORMAT format) {
+		switch (format) {
+			case D3DFMT_A8R8G8B8: case D3DFMT_X8R8G8B8: case D3DFMT_A8B8G8R8: case D3DFMT_X8B8G8R8:
+			case D3DFMT_R8G8B8: case D3DFMT_R5G6B5: case D3DFMT_X1R5G5B5: case D3DFMT_A1R5G5B5:
+			case D3DFMT_A4R4G4B4: case D3DFMT_X4R4G4B4: case D3DFMT_A8: case D3DFMT_L8: case D3DFMT_A8L8:
+			case D3DFMT_R16F: case D3DFMT_G16R16F: case D3DFMT_A16B16G16R16F:
+			case D3DFMT_R32F: case D3DFMT_G32R32F: case D3DFMT_A32B32G32R32F:
+				return true;
+
+			default:
+				return false;
+		}
+	}
+
+	#if defined(__x86_64__)
+	/**
+	 * Narrows 32-bit lanes that fit in 16 bits: sign-extending the
+	 * low half first keeps packs_epi32 from saturating.
+	 */
+	inline __m128i narrow16(__m128i a, __m128i b) {
+		a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+		b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+		return _mm_packs_epi32(a, b);
+	}
+	#endif
+
+	/**
+	 * Float and half formats: "channels" of red, green, blue, alpha
+	 * per pixel, each byte mapped to 0..1
+	 */
+	template<typename T>
+	inline void packFloat(T* dst, const uint32_t* src, size_t n, int channels) {
+		static const struct Table {
+			float floats[256];
+			uint16_t halves[256];
+
+			Table() {
+				for (int i = 0; i < 256; i++) this->floats[i] = i / 255.0f;
+				for (int i = 0; i < 256; i += 8) Lanes::storeHalf(this->halves + i, this->floats + i);
+			}
+		} table;
+		const T* values = std::is_same_v<T, float> ? (const T*) table.floats : (const T*) table.halves;
+
+		for (size_t i = 0; i < n; i++) {
+			const uint32_t p = src[i];
+			const uint8_t rgba[4] = {(uint8_t) (p >> 16), (uint8_t) (p >> 8), (uint8_t) p, (uint8_t) (p >> 24)};
+			for (int c = 0; c < channels; c++) dst[i * channels + c] = values[rgba[c]];
+		}
+	}
+
+	/**
+	 * Writes one row of "n" pixels in "format". False if canPack()
+	 * is false.
+	 */
+	inline bool pack(void* dst, D3DFORMAT format, const uint32_t* src, size_t n) {
+		uint8_t* bytes = (uint8_t*) dst;
+		uint16_t* words = (uint16_t*) dst;
+		size_t i = 0;
+
+		switch (format) {
+			case D3DFMT_A8R8G8B8:
+				memcpy(dst, src, n * 4);
+				return true;
+
+			case D3DFMT_X8R8G8B8:
+				swizzle32((uint32_t*) dst, src, n, false, true);
+				return true;
+
+			case D3DFMT_A8B8G8R8:
+				swizzle32((uint32_t*) dst, src, n, true, false);
+				return true;
+
+			case D3DFMT_X8B8G8R8:
+				swizzle32((uint32_t*) dst, src, n, true, true);
+				return true;
+
+			case D3DFMT_R8G8B8:
+				for (; i < n; i++) {
+					bytes[i * 3] = src[i];
+					bytes[i * 3 + 1] = src[i] >> 8;
+					bytes[i * 3 + 2] = src[i] >> 16;
+				}
+				return true;
+
+			case D3DFMT_R5G6B5:
+				#if defined(__x86_64__)
+					for (; i + 8 <= n; i += 8) {
+						__m128i p[2] = {_mm_loadu_si128((const __m128i*) (src + i)), _mm_loadu_si128((const __m128i*) (src + i + 4))};
+						for (__m128i& q : p) {
+							q = _mm_or_si128(_mm_or_si128(
+								_mm_and_si128(_mm_srli_epi32(q, 8), _mm_set1_epi32(0xF800)),
+								_mm_and_si128(_mm_srli_epi32(q, 5), _mm_set1_epi32(0x07E0))),
+								_mm_and_si128(_mm_srli_epi32(q, 3), _mm_set1_epi32(0x001F)));
+						}
+						_mm_storeu_si128((__m128i*) (words + i), narrow16(p[0], p[1]));
+					}
+				#endif
+				for (; i < n; i++) {
+					words[i] = ((src[i] >> 8) & 0xF800) | ((src[i] >> 5) & 0x07E0) | ((src[i] >> 3) & 0x001F);
+				}
+				return true;
+
+			case D3DFMT_X1R5G5B5: case D3DFMT_A1R5G5B5: {
+				uint32_t alpha = format == D3DFMT_X1R5G5B5 ? 0x8000 : 0;
+				#if defined(__x86_64__)
+					for (; i + 8 <= n; i += 8) {
+						__m128i p[2] = {_mm_loadu_si128((const __m128i*) (src + i)), _mm_loadu_si128((const __m128i*) (src + i + 4))};
+						for (__m128i& q : p) {
+							q = _mm_or_si128(_mm_or_si128(_mm_or_si128(
+								_mm_and_si128(_mm_srli_epi32(q, 16), _mm_set1_epi32(0x8000)),
+								_mm_and_si128(_mm_srli_epi32(q, 9), _mm_set1_epi32(0x7C00))),
+								_mm_or_si128(_mm_and_si128(_mm_srli_epi32(q, 6), _mm_set1_epi32(0x03E0)),
+								_mm_and_si128(_mm_srli_epi32(q, 3), _mm_set1_epi32(0x001F)))), _mm_set1_epi32(alpha));
+						}
+						_mm_storeu_si128((__m128i*) (words + i), narrow16(p[0], p[1]));
+					}
+				#endif
+				for (; i < n; i++) {
+					words[i] = ((src[i] >> 16) & 0x8000) | ((src[i] >> 9) & 0x7C00) | ((src[i] >> 6) & 0x03E0)
+						| ((src[i] >> 3) & 0x001F) | alpha;
+				}
+				return true;
+			}
+
+			case D3DFMT_A4R4G4B4: case D3DFMT_X4R4G4B4: {
+				uint16_t alpha = format == D3DFMT_X4R4G4B4 ? 0xF000 : 0;
+				for (; i < n; i++) {
+					words[i] = ((src[i] >> 16) & 0xF000) | ((src[i] >> 12) & 0x0F00) | ((src[i] >> 8) & 0x00F0)
+						| ((src[i] >> 4) & 0x000F) | alpha;
+				}
+				return true;
+			}
+
+			case D3DFMT_A8:
+				for (; i < n; i++) bytes[i] = src[i] >> 24;
+				return true;
+
+			case D3DFMT_L8: case D3DFMT_A8L8:
+				for (; i < n; i++) {
+					//Rec. 601 luma in 8.8 fixed point
+					uint32_t r = (src[i] >> 16) & 0xFF, g = (src[i] >> 8) & 0xFF, b = src[i] & 0xFF;
+					uint8_t luma = (r * 77 + g * 150 + b * 29 + 128) >> 8;
+
+					if (format == D3DFMT_L8) bytes[i] = luma;
+					else words[i] = (uint16_t) ((src[i] >> 16) & 0xFF00) | luma;
+				}
+				return true;
+
+			case D3DFMT_R16F: packFloat((uint16_t*) dst, src, n, 1); return true;
+			case D3DFMT_G16R16F: packFloat((uint16_t*) dst, src, n, 2); return true;
+			case D3DFMT_A16B16G16R16F: packFloat((uint16_t*) dst, src, n, 4); return true;
+			case D3DFMT_R32F: packFloat((float*) dst, src, n, 1); return true;
+			case D3DFMT_G32R32F: packFloat((float*) dst, src, n, 2); return true;
+			case D3DFMT_A32B32G32R32F: packFloat((float*) dst, src, n, 4); return true;
+
+			default:
+				return false;
+		}
+	}
+}
@@ -0,0 +1,300 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Eight-lane vectors for the rasterizer's pixel and setup loops.
+ *
+ * These are GCC vector extensions, so the same source compiles to
+ * one AVX2 register in functions built with target("avx2") and to
+ * two SSE registers elsewhere. Every helper is always_inline: it
+ * takes on the target of the loop that calls it and never passes
+ * 256-bit vectors across a call.
+ */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+namespace Lanes {
+	typedef float f32x8 __attribute__((vector_size(32)));
+	typedef int32_t i32x8 __attribute__((vector_size(32)));
+	typedef uint32_t u32x8 __attribute__((vector_size(32)));
+	typedef uint16_t u16x8 __attribute__((vector_size(16)));
+
+	#define ODX_LANE inline __attribute__((always_inline))
+
+	ODX_LANE f32x8 splat(float v) {
+		return f32x8{} + v;
+	}
+
+	ODX_LANE i32x8 splat(int32_t v) {
+		return i32x8{} + v;
+	}
+
+	ODX_LANE u32x8 splat(uint32_t v) {
+		return u32x8{} + v;
+	}
+
+	ODX_LANE f32x8 load(const float* p) {
+		f32x8 r;
+		memcpy(&r, p, sizeof(r));
+		return r;
+	}
+
+	ODX_LANE void store(float* p, f32x8 v) {
+		memcpy(p, &v, sizeof(v));
+	}
+
+	ODX_LANE f32x8 min(f32x8 a, f32x8 b) {
+		return a < b ? a : b;
+	}
+
+	ODX_LANE f32x8 max(f32x8 a, f32x8 b) {
+		return a > b ? a : b;
+	}
+
+	ODX_LANE f32x8 clamp01(f32x8 v) {
+		return min(max(v, splat(0.0f)), splat(1.0f));
+	}
+
+	ODX_LANE i32x8 min(i32x8 a, i32x8 b) {
+		return a < b ? a : b;
+	}
+
+	ODX_LANE i32x8 max(i32x8 a, i32x8 b) {
+		return a > b ? a : b;
+	}
+
+	ODX_LANE f32x8 abs(f32x8 v) {
+		return v < 0.0f ? -v : v;
+	}
+
+	/**
+	 * Lane-wise "mask ? a : b" for a comparison result.
+	 */
+	ODX_LANE f32x8 select(i32x8 mask, f32x8 a, f32x8 b) {
+		return mask ? a : b;
+	}
+
+	ODX_LANE i32x8 select(i32x8 mask, i32x8 a, i32x8 b) {
+		return mask ? a : b;
+	}
+
+	ODX_LANE u32x8 select(i32x8 mask, u32x8 a, u32x8 b) {
+		return (u32x8) mask ? a : b;
+	}
+
+	ODX_LANE i32x8 toInt(f32x8 v) {
+		return __builtin_convertvector(v, i32x8);
+	}
+
+	ODX_LANE f32x8 toFloat(i32x8 v) {
+		return __builtin_convertvector(v, f32x8);
+	}
+
+	/**
+	 * Round to nearest; lanes must fit in an int32.
+	 */
+	ODX_LANE i32x8 round(f32x8 v) {
+		return toInt(v + select(v < 0.0f, splat(-0.5f), splat(0.5f)));
+	}
+
+	ODX_LANE i32x8 floor(f32x8 v) {
+		i32x8 i = toInt(v);
+		return i - (toFloat(i) > v ? splat(1) : splat(0));
+	}
+
+	ODX_LANE i32x8 ceil(f32x8 v) {
+		i32x8 i = toInt(v);
+		return i + (toFloat(i) < v ? splat(1) : splat(0));
+	}
+
+	/**
+	 * 0..1 floats to 0..255 bytes (rounded).
+	 */
+	ODX_LANE u32x8 toUnorm8(f32x8 v) {
+		return (u32x8) toInt(clamp01(v) * 255.0f + 0.5f);
+	}
+
+	ODX_LANE f32x8 fromUnorm8(u32x8 v) {
+		return toFloat((i32x8) (v & 0xFF)) * (1.0f / 255.0f);
+	}
+
+	/**
+	 * Bit i set when lane i of a comparison result is true.
+	 */
+	ODX_LANE uint32_t bits(i32x8 mask) {
+		uint32_t r = 0;
+		for (int i = 0; i < 8; i++) r |= (mask[i] != 0) << i;
+		return r;
+	}
+
+	ODX_LANE i32x8 fromBits(uint32_t bits) {
+		const i32x8 lane = {1, 2, 4, 8, 16, 32, 64, 128};
+		return ((i32x8{} + (int32_t) bits) & lane) != 0;
+	}
+
+	/**
+	 * IEEE half floats (low 16 bits of each lane) to floats and back,
+	 * rounding to nearest even. Integer only, so no F16C is needed.
+	 */
+	ODX_LANE f32x8 fromHalf(u32x8 h) {
+		const u32x8 sign = (h & 0x8000) << 16;
+		const u32x8 rest = (h & 0x7FFF) << 13;
+
+		//rescaling the exponent also normalizes denormals
+		f32x8 f = (f32x8) rest * 0x1p112f;
+		f = select((i32x8) rest >= (int32_t) (0x7C00 << 13), (f32x8) (rest | 0x7F800000), f);
+		return (f32x8) ((u32x8) f | sign);
+	}
+
+	ODX_LANE u32x8 toHalf(f32x8 f) {
+		const u32x8 bits = (u32x8) f;
+		const u32x8 sign = bits & 0x80000000;
+		const u32x8 u = bits ^ sign;
+
+		//too large: infinity, or a quiet NaN
+		const u32x8 huge = select((i32x8) u > (int32_t) 0x7F800000, splat(0x7E00u), splat(0x7C00u));
+
+		//denormals: adding 0.5 makes the FPU round the mantissa into place
+		const u32x8 magic = (u32x8) splat(0.5f);
+		const u32x8 small = (u32x8) ((f32x8) u + (f32x8) magic) - magic;
+
+		const u32x8 odd = (u >> 13) & 1;
+		const u32x8 normal = (u + ((uint32_t) (15 - 127) << 23) + 0xFFF + odd) >> 13;
+
+		u32x8 r = select((i32x8) u < (int32_t) (113 << 23), small, normal);
+		r = select((i32x8) u >= (int32_t) ((127 + 16) << 23), huge, r);
+		return r | sign >> 16;
+	}
+
+	/**
+	 * Eight packed halves at "p" to floats, and back
+	 */
+	ODX_LANE f32x8 loadHalf(const uint16_t* p) {
+		u16x8 h;
+		memcpy(&h, p, sizeof(h));
+		return fromHalf(__builtin_convertvector(h, u32x8));
+	}
+
+	ODX_LANE void storeHalf(uint16_t* p, f32x8 v) {
+		const u16x8 h = __builtin_convertvector(toHalf(v), u16x8);
+		memcpy(p, &h, sizeof(h));
+	}
+
+	/**
+	 * storeHalf() of the eight floats at "src", for callers outside
+	 * the vector loops: only pointers cross the call.
+	 */
+	ODX_LANE void storeHalf(uint16_t* p, const float* src) {
+		storeHalf(p, load(src));
+	}
+
+	#if defined(__x86_64__)
+	/**
+	 * loadHalf() and storeHalf() as one F16C instruction each, same
+	 * rounding. Only for functions built with target("avx2,f16c"):
+	 * the builtins would not inline through the generic helpers in
+	 * between, so these are written as asm.
+	 */
+	ODX_LANE f32x8 loadHalfF16C(const uint16_t* p) {
+		u16x8 h;
+		f32x8 r;
+		memcpy(&h, p, sizeof(h));
+		asm("vcvtph2ps %1, %0" : "=x" (r) : "x" (h));
+		return r;
+	}
+
+	ODX_LANE void storeHalfF16C(uint16_t* p, f32x8 v) {
+		u16x8 h;
+		asm("vcvtps2ph $0, %1, %0" : "=x" (h) : "x" (v)); //round to nearest even
+		memcpy(p, &h, sizeof(h));
+	}
+	#endif
+
+	/**
+	 * 2^v, accurate to about 1e-7 relative; lanes below -126 give 0.
+	 */
+	ODX_LANE f32x8 exp2(f32x8 v) {
+		v = min(max(v, splat(-127.0f)), splat(127.0f));
+		const i32x8 i = round(v);
+		const f32x8 f = (v - toFloat(i)) * 0.69314718f;
+
+		//e^f for |f| <= ln(2) / 2
+		f32x8 p = 1.0f + f * (1.0f + f * (0.5f + f * (1.0f / 6 + f * (1.0f / 24 + f * (1.0f / 120 + f * (1.0f / 720))))));
+		const f32x8 scale = (f32x8) ((i + 127) << 23);
+		return select(i > -127, p * scale, splat(0.0f));
+	}
+
+	/**
+	 * log2(v) for positive, finite lanes.
+	 */
+	ODX_LANE f32x8 log2(f32x8 v) {
+		const i32x8 bits = (i32x8) v;
+		i32x8 e = ((bits >> 23) & 0xFF) - 127;
+		f32x8 m = (f32x8) ((bits & 0x7FFFFF) | 0x3F800000);
+
+		//mantissa in [sqrt(1/2), sqrt(2)) so the series below converges fast
+		const i32x8 high = m > 1.41421356f;
+		m = select(high, m * 0.5f, m);
+		e += high & 1;
+
+		//log(m) = 2 atanh(s), s = (m - 1) / (m + 1)
+		const f32x8 s = (m - 1.0f) / (m + 1.0f), s2 = s * s;
+		const f32x8 atanh = s * (1.0f + s2 * (1.0f / 3 + s2 * (1.0f / 5 + s2 * (1.0f / 7))));
+		return toFloat(e) + atanh * 2.88539008f;
+	}
+
+	/**
+	 * v^y for y > 0; lanes <= 0 give 0.
+	 */
+	ODX_LANE f32x8 pow(f32x8 v, float y) {
+		return select(v > 0.0f, exp2(log2(max(v, splat(0x1p-126f))) * y), splat(0.0f));
+	}
+
+	ODX_LANE f32x8 sqrt(f32x8 v) {
+		f32x8 r;
+		for (int i = 0; i < 8; i++) r[i] = __builtin_sqrtf(v[i]);
+		return r;
+	}
+
+	/**
+	 * sRGB bytes to linear, built once at startup for fromSrgb8()
+	 */
+	struct SrgbTable {
+		float linear[256];
+
+		SrgbTable() {
+			for (int i = 0; i < 256; i++) {
+				const double c = i / 255.0;
+				this->linear[i] = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+			}
+		}
+	};
+	inline const SrgbTable SRGB;
+
+	/**
+	 * The low byte of each lane, sRGB encoded, to linear 0..1
+	 */
+	ODX_LANE f32x8 fromSrgb8(u32x8 v) {
+		f32x8 r;
+		for (int i = 0; i < 8; i++) r[i] = SRGB.linear[v[i] & 0xFF];
+		return r;
+	}
+
+	/**
+	 * Linear to sRGB, clamped to 0..1. The curve is fitted on three
+	 * square roots, within a quarter of an 8-bit step of the exact
+	 * 1.055 x^(1 / 2.4) - 0.055.
+	 */
+	ODX_LANE f32x8 toSrgb(f32x8 v) {
+		v = clamp01(v);
+		const f32x8 s = sqrt(v), t = sqrt(s), u = sqrt(t);
+		const f32x8 curve = 0.662002687f * s + 0.684122060f * t - 0.323583601f * u - 0.0225411470f * v;
+		return select(v <= 0.0031308f, v * 12.92f, min(curve, splat(1.0f)));
+	}
+
+	#undef ODX_LANE
+}
+
+#pragma GCC diagnostic pop
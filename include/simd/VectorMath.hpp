@@ -0,0 +1,297 @@
+#pragma once
+#include <cstddef>
+#include <cmath>
+
+#include <d3d9types.h>
+
+#if defined(__x86_64__)
+	#include <immintrin.h>
+#endif
+
+/**
+ * Matrix and vector kernels shared by libd3dx9 (D3DX math) and
+ * libd3d9 (the device's transform stage).
+ *
+ * Matrices are D3DMATRIX: row-major, transforming row vectors
+ * (v * M). Every kernel has a scalar path that is usable in
+ * constant expressions; at run time the SSE or AVX2+FMA path is
+ * picked once from the CPU's features.
+ */
+namespace VectorMath {
+	/**
+	 * How transform() reads and writes each vector.
+	 */
+	enum Mode {
+		POINT,   //xyz, w = 1 -> xyzw
+		COORD,   //xyz, w = 1 -> xyz / w
+		NORMAL,  //xyz, w = 0 -> xyz
+		VECTOR4  //xyzw -> xyzw
+	};
+
+	inline bool hasAVX2() {
+		#if defined(__x86_64__)
+			//every AVX2 CPU has F16C too; AVX2 kernels may use it
+			static const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+			return avx2;
+		#else
+			return false;
+		#endif
+	}
+
+	//--- matrix * matrix
+
+	constexpr void multiplyScalar(D3DMATRIX& out, const D3DMATRIX& a, const D3DMATRIX& b) {
+		D3DMATRIX r = {};
+
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++) {
+				r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+			}
+		}
+
+		out = r;
+	}
+
+	#if defined(__x86_64__)
+	/**
+	 * Row i of the product is sum(a[i][k] * row k of b).
+	 * "out" may alias "a" or "b".
+	 */
+	inline void multiplySSE(float* out, const float* a, const float* b) {
+		__m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + 4), b2 = _mm_loadu_ps(b + 8), b3 = _mm_loadu_ps(b + 12);
+		__m128 r[4];
+
+		for (int i = 0; i < 4; i++) {
+			__m128 acc = _mm_mul_ps(_mm_set1_ps(a[i * 4]), b0);
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(a[i * 4 + 1]), b1));
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(a[i * 4 + 2]), b2));
+			r[i] = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(a[i * 4 + 3]), b3));
+		}
+
+		for (int i = 0; i < 4; i++) {
+			_mm_storeu_ps(out + i * 4, r[i]);
+		}
+	}
+
+	/**
+	 * Two rows per 256-bit register.
+	 */
+	__attribute__((target("avx2,fma")))
+	inline void multiplyAVX2(float* out, const float* a, const float* b) {
+		__m256 b0 = _mm256_broadcast_ps((const __m128*) b);
+		__m256 b1 = _mm256_broadcast_ps((const __m128*) (b + 4));
+		__m256 b2 = _mm256_broadcast_ps((const __m128*) (b + 8));
+		__m256 b3 = _mm256_broadcast_ps((const __m128*) (b + 12));
+		__m256 r[2];
+
+		for (int i = 0; i < 2; i++) {
+			const float* lo = a + i * 8;
+			const float* hi = lo + 4;
+			__m256 acc = _mm256_mul_ps(_mm256_set_m128(_mm_set1_ps(hi[0]), _mm_set1_ps(lo[0])), b0);
+			acc = _mm256_fmadd_ps(_mm256_set_m128(_mm_set1_ps(hi[1]), _mm_set1_ps(lo[1])), b1, acc);
+			acc = _mm256_fmadd_ps(_mm256_set_m128(_mm_set1_ps(hi[2]), _mm_set1_ps(lo[2])), b2, acc);
+			r[i] = _mm256_fmadd_ps(_mm256_set_m128(_mm_set1_ps(hi[3]), _mm_set1_ps(lo[3])), b3, acc);
+		}
+
+		_mm256_storeu_ps(out, r[0]);
+		_mm256_storeu_ps(out + 8, r[1]);
+	}
+	#endif
+
+	constexpr void multiply(D3DMATRIX& out, const D3DMATRIX& a, const D3DMATRIX& b) {
+		if consteval {
+			multiplyScalar(out, a, b);
+		} else {
+			#if defined(__x86_64__)
+				if (hasAVX2()) multiplyAVX2(&out.m[0][0], &a.m[0][0], &b.m[0][0]);
+				else multiplySSE(&out.m[0][0], &a.m[0][0], &b.m[0][0]);
+			#else
+				multiplyScalar(out, a, b);
+			#endif
+		}
+	}
+
+	//--- inverse
+
+	constexpr float determinant(const D3DMATRIX& m) {
+		const float c5 = m.m[2][2] * m.m[3][3] - m.m[3][2] * m.m[2][3];
+		const float c4 = m.m[2][1] * m.m[3][3] - m.m[3][1] * m.m[2][3];
+		const float c3 = m.m[2][1] * m.m[3][2] - m.m[3][1] * m.m[2][2];
+		const float c2 = m.m[2][0] * m.m[3][3] - m.m[3][0] * m.m[2][3];
+		const float c1 = m.m[2][0] * m.m[3][2] - m.m[3][0] * m.m[2][2];
+		const float c0 = m.m[2][0] * m.m[3][1] - m.m[3][0] * m.m[2][1];
+
+		return (m.m[0][0] * m.m[1][1] - m.m[1][0] * m.m[0][1]) * c5
+			- (m.m[0][0] * m.m[1][2] - m.m[1][0] * m.m[0][2]) * c4
+			+ (m.m[0][0] * m.m[1][3] - m.m[1][0] * m.m[0][3]) * c3
+			+ (m.m[0][1] * m.m[1][2] - m.m[1][1] * m.m[0][2]) * c2
+			- (m.m[0][1] * m.m[1][3] - m.m[1][1] * m.m[0][3]) * c1
+			+ (m.m[0][2] * m.m[1][3] - m.m[1][2] * m.m[0][3]) * c0;
+	}
+
+	/**
+	 * Cofactor expansion through 2x2 sub-determinants.
+	 * Returns false (and leaves "out" untouched) when "m" is singular.
+	 */
+	constexpr bool inverse(D3DMATRIX& out, float* determinant, const D3DMATRIX& m) {
+		const float s0 = m.m[0][0] * m.m[1][1] - m.m[1][0] * m.m[0][1];
+		const float s1 = m.m[0][0] * m.m[1][2] - m.m[1][0] * m.m[0][2];
+		const float s2 = m.m[0][0] * m.m[1][3] - m.m[1][0] * m.m[0][3];
+		const float s3 = m.m[0][1] * m.m[1][2] - m.m[1][1] * m.m[0][2];
+		const float s4 = m.m[0][1] * m.m[1][3] - m.m[1][1] * m.m[0][3];
+		const float s5 = m.m[0][2] * m.m[1][3] - m.m[1][2] * m.m[0][3];
+
+		const float c5 = m.m[2][2] * m.m[3][3] - m.m[3][2] * m.m[2][3];
+		const float c4 = m.m[2][1] * m.m[3][3] - m.m[3][1] * m.m[2][3];
+		const float c3 = m.m[2][1] * m.m[3][2] - m.m[3][1] * m.m[2][2];
+		const float c2 = m.m[2][0] * m.m[3][3] - m.m[3][0] * m.m[2][3];
+		const float c1 = m.m[2][0] * m.m[3][2] - m.m[3][0] * m.m[2][2];
+		const float c0 = m.m[2][0] * m.m[3][1] - m.m[3][0] * m.m[2][1];
+
+		const float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+		if (determinant != nullptr) *determinant = det;
+		if (det == 0.0f) return false;
+
+		const float k = 1.0f / det;
+		D3DMATRIX r = {};
+
+		r.m[0][0] = ( m.m[1][1] * c5 - m.m[1][2] * c4 + m.m[1][3] * c3) * k;
+		r.m[0][1] = (-m.m[0][1] * c5 + m.m[0][2] * c4 - m.m[0][3] * c3) * k;
+		r.m[0][2] = ( m.m[3][1] * s5 - m.m[3][2] * s4 + m.m[3][3] * s3) * k;
+		r.m[0][3] = (-m.m[2][1] * s5 + m.m[2][2] * s4 - m.m[2][3] * s3) * k;
+
+		r.m[1][0] = (-m.m[1][0] * c5 + m.m[1][2] * c2 - m.m[1][3] * c1) * k;
+		r.m[1][1] = ( m.m[0][0] * c5 - m.m[0][2] * c2 + m.m[0][3] * c1) * k;
+		r.m[1][2] = (-m.m[3][0] * s5 + m.m[3][2] * s2 - m.m[3][3] * s1) * k;
+		r.m[1][3] = ( m.m[2][0] * s5 - m.m[2][2] * s2 + m.m[2][3] * s1) * k;
+
+		r.m[2][0] = ( m.m[1][0] * c4 - m.m[1][1] * c2 + m.m[1][3] * c0) * k;
+		r.m[2][1] = (-m.m[0][0] * c4 + m.m[0][1] * c2 - m.m[0][3] * c0) * k;
+		r.m[2][2] = ( m.m[3][0] * s4 - m.m[3][1] * s2 + m.m[3][3] * s0) * k;
+		r.m[2][3] = (-m.m[2][0] * s4 + m.m[2][1] * s2 - m.m[2][3] * s0) * k;
+
+		r.m[3][0] = (-m.m[1][0] * c3 + m.m[1][1] * c1 - m.m[1][2] * c0) * k;
+		r.m[3][1] = ( m.m[0][0] * c3 - m.m[0][1] * c1 + m.m[0][2] * c0) * k;
+		r.m[3][2] = (-m.m[3][0] * s3 + m.m[3][1] * s1 - m.m[3][2] * s0) * k;
+		r.m[3][3] = ( m.m[2][0] * s3 - m.m[2][1] * s1 + m.m[2][2] * s0) * k;
+
+		out = r;
+		return true;
+	}
+
+	//--- vector * matrix
+
+	/**
+	 * One vector. "in" holds 3 floats (4 for VECTOR4); "out" receives
+	 * 4 floats for POINT and VECTOR4, 3 otherwise.
+	 */
+	template<Mode mode>
+	constexpr void transformOne(float* out, const float* in, const D3DMATRIX& m) {
+		const float w = mode == VECTOR4 ? in[3] : (mode == NORMAL ? 0.0f : 1.0f);
+		float r[4] = {};
+
+		for (int j = 0; j < 4; j++) {
+			r[j] = in[0] * m.m[0][j] + in[1] * m.m[1][j] + in[2] * m.m[2][j] + w * m.m[3][j];
+		}
+
+		if constexpr (mode == COORD) {
+			const float k = 1.0f / r[3];
+			r[0] *= k;
+			r[1] *= k;
+			r[2] *= k;
+		}
+
+		for (int j = 0; j < ((mode == POINT || mode == VECTOR4) ? 4 : 3); j++) {
+			out[j] = r[j];
+		}
+	}
+
+	template<Mode mode>
+	inline void transformScalar(char* out, size_t outStride, const char* in, size_t inStride, const D3DMATRIX& m, size_t n) {
+		for (size_t i = 0; i < n; i++, in += inStride, out += outStride) {
+			transformOne<mode>((float*) out, (const float*) in, m);
+		}
+	}
+
+	#if defined(__x86_64__)
+	template<Mode mode>
+	inline void storeSSE(char* out, __m128 v) {
+		if constexpr (mode == COORD) {
+			v = _mm_div_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)));
+		}
+
+		if constexpr (mode == POINT || mode == VECTOR4) {
+			_mm_storeu_ps((float*) out, v);
+		} else {
+			_mm_storel_pi((__m64*) out, v);
+			_mm_store_ss((float*) out + 2, _mm_movehl_ps(v, v));
+		}
+	}
+
+	/**
+	 * Components are loaded one by one (broadcast) rather than as a
+	 * vector: the last xyz of an array may end on the final 12 bytes.
+	 */
+	template<Mode mode>
+	inline void transformSSE(char* out, size_t outStride, const char* in, size_t inStride, const D3DMATRIX& m, size_t n) {
+		const float* f = &m.m[0][0];
+		__m128 r0 = _mm_loadu_ps(f), r1 = _mm_loadu_ps(f + 4), r2 = _mm_loadu_ps(f + 8), r3 = _mm_loadu_ps(f + 12);
+
+		for (size_t i = 0; i < n; i++, in += inStride, out += outStride) {
+			const float* v = (const float*) in;
+			__m128 acc = _mm_mul_ps(_mm_set1_ps(v[0]), r0);
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(v[1]), r1));
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(v[2]), r2));
+
+			if constexpr (mode == VECTOR4) acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(v[3]), r3));
+			else if constexpr (mode != NORMAL) acc = _mm_add_ps(acc, r3);
+
+			storeSSE<mode>(out, acc);
+		}
+	}
+
+	/**
+	 * Two vectors per iteration, one per 128-bit lane.
+	 */
+	template<Mode mode>
+	__attribute__((target("avx2,fma")))
+	inline void transformAVX2(char* out, size_t outStride, const char* in, size_t inStride, const D3DMATRIX& m, size_t n) {
+		const float* f = &m.m[0][0];
+		__m256 r0 = _mm256_broadcast_ps((const __m128*) f);
+		__m256 r1 = _mm256_broadcast_ps((const __m128*) (f + 4));
+		__m256 r2 = _mm256_broadcast_ps((const __m128*) (f + 8));
+		__m256 r3 = _mm256_broadcast_ps((const __m128*) (f + 12));
+		size_t i = 0;
+
+		for (; i + 2 <= n; i += 2, in += 2 * inStride, out += 2 * outStride) {
+			const float* a = (const float*) in;
+			const float* b = (const float*) (in + inStride);
+
+			__m256 acc = _mm256_mul_ps(_mm256_set_m128(_mm_broadcast_ss(b), _mm_broadcast_ss(a)), r0);
+			acc = _mm256_fmadd_ps(_mm256_set_m128(_mm_broadcast_ss(b + 1), _mm_broadcast_ss(a + 1)), r1, acc);
+			acc = _mm256_fmadd_ps(_mm256_set_m128(_mm_broadcast_ss(b + 2), _mm_broadcast_ss(a + 2)), r2, acc);
+
+			if constexpr (mode == VECTOR4) acc = _mm256_fmadd_ps(_mm256_set_m128(_mm_broadcast_ss(b + 3), _mm_broadcast_ss(a + 3)), r3, acc);
+			else if constexpr (mode != NORMAL) acc = _mm256_add_ps(acc, r3);
+
+			storeSSE<mode>(out, _mm256_castps256_ps128(acc));
+			storeSSE<mode>(out + outStride, _mm256_extractf128_ps(acc, 1));
+		}
+
+		if (i < n) transformSSE<mode>(out, outStride, in, inStride, m, n - i);
+	}
+	#endif
+
+	/**
+	 * Strided array transform. Strides are in bytes; "out" may be "in".
+	 */
+	template<Mode mode>
+	inline void transform(void* out, size_t outStride, const void* in, size_t inStride, const D3DMATRIX& m, size_t n) {
+		#if defined(__x86_64__)
+			if (hasAVX2()) transformAVX2<mode>((char*) out, outStride, (const char*) in, inStride, m, n);
+			else transformSSE<mode>((char*) out, outStride, (const char*) in, inStride, m, n);
+		#else
+			transformScalar<mode>((char*) out, outStride, (const char*) in, inStride, m, n);
+		#endif
+	}
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Worker threads shared by libd3d9 and libd3dx9.
+ *
+ * parallelFor() splits a range into chunks, runs them on the
+ * workers and on the calling thread, and returns when all are done.
+ * submit() queues background work (texture streaming) that nobody
+ * waits for.
+ */
+class WorkerPool {
+	private:std::vector<std::thread> threads;
+	private:std::mutex mutex;
+	private:std::condition_variable wake;
+	private:std::deque<std::function<void()>> queue;
+	private:bool stopping = false;
+
+	/**
+	 * One per process: the calling thread is the last core.
+	 */
+	public:static WorkerPool& shared() {
+		static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+		return pool;
+	}
+
+	public:WorkerPool(unsigned count) {
+		for (unsigned i = 0; i < count; i++) {
+			this->threads.emplace_back([this]() { this->run(); });
+		}
+	}
+
+	public:~WorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->stopping = true;
+		}
+		this->wake.notify_all();
+
+		for (std::thread& thread : this->threads) thread.join();
+	}
+
+	public:size_t size() const {
+		return this->threads.size();
+	}
+
+	private:void run() {
+		for (;;) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->wake.wait(lock, [this]() { return this->stopping || !this->queue.empty(); });
+				if (this->queue.empty()) return;
+
+				task = std::move(this->queue.front());
+				this->queue.pop_front();
+			}
+			task();
+		}
+	}
+
+	public:void submit(std::function<void()> task) {
+		if (this->threads.empty()) {
+			task();
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->queue.push_back(std::move(task));
+		}
+		this->wake.notify_one();
+	}
+
+	/**
+	 * body(begin, end) for [0, count) in chunks of "grain".
+	 */
+	public:template<typename Body>
+	void parallelFor(size_t count, size_t grain, const Body& body) {
+		grain = std::max<size_t>(grain, 1);
+		size_t chunks = (count + grain - 1) / grain;
+
+		if (chunks <= 1 || this->threads.empty()) {
+			if (count > 0) body(0, count);
+			return;
+		}
+
+		//helpers may start after we return: they only keep "job" alive
+		struct Job {
+			std::atomic<size_t> next{0};
+			std::atomic<size_t> done{0};
+			std::mutex mutex;
+			std::condition_variable finished;
+		};
+		std::shared_ptr<Job> job = std::make_shared<Job>();
+
+		auto work = [job, chunks, count, grain, &body]() {
+			for (size_t chunk; (chunk = job->next.fetch_add(1)) < chunks;) {
+				body(chunk * grain, std::min(count, (chunk + 1) * grain));
+
+				if (job->done.fetch_add(1) + 1 == chunks) {
+					std::lock_guard<std::mutex> lock(job->mutex);
+					job->finished.notify_all();
+				}
+			}
+		};
+
+		size_t helpers = std::min(this->threads.size(), chunks - 1);
+		for (size_t i = 0; i < helpers; i++) this->submit(work);
+		work();
+
+		std::unique_lock<std::mutex> lock(job->mutex);
+		job->finished.wait(lock, [&]() { return job->done.load() == chunks; });
+	}
+};
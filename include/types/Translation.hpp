@@ -12,6 +12,7 @@ typedef struct {
 	char* tab_display;
 	char* tab_sound;
 	char* tab_input;
+	char* tab_files;
 
 	//Buttons
 	char* btn_help;
@@ -58,8 +59,30 @@ typedef struct {
 	char* display_features_ddAccel;
 	char* display_features_d3dAccel;
 	char* display_features_agpAccel;
+	char* display_features_d3dTest; //button "Test Direct3D"
 	char* display_notes_label; //section Notes
 
+	//Tab Input
+	char* input_devices_label; //section Input Devices
+	char* input_device_name;
+	char* input_device_path;
+	char* input_device_bus;
+	char* input_device_pollingRate;
+	char* input_latency_label; //section Input Latency
+	char* input_latency_start;
+	char* input_latency_stop;
+
+	//Tab DirectX Files
+	char* files_label; //section DirectX Files
+	char* files_name;
+	char* files_version;
+	char* files_size;
+	char* files_hash;
+	char* files_buildId;
+	char* files_path;
+	char* files_missing;
+	char* files_saved; //"Saved to %s"
+
 	//Tab Sound
 	char* sound_device_label; //section Device
 	char* sound_device_name;
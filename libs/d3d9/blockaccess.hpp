@@ -0,0 +1,79 @@
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <simd/Lanes.hpp>
+#include "rasterizer.hpp"
+
+/**
+ * Reads and writes of one 4x2 pixel block of a Surface, shared by the
+ * pixel kernels. Lanes are two 2x2 quads:
+ * x = 0 1 0 1 2 3 2 3, y = 0 0 1 1 0 0 1 1.
+ */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+#define ODX_BLOCK inline __attribute__((always_inline))
+
+inline constexpr int LANE_X[8] = {0, 1, 0, 1, 2, 3, 2, 3};
+inline constexpr int LANE_Y[8] = {0, 0, 1, 1, 0, 0, 1, 1};
+
+/**
+ * The block's pixels; lanes outside the surface repeat its last
+ * row or column.
+ */
+template<typename T>
+ODX_BLOCK void gather(const Surface& surface, int bx, int by, T* out) {
+	const BYTE* row0 = surface.bits + (size_t) by * surface.pitch;
+	const BYTE* row1 = by + 1 < (int) surface.height ? row0 + surface.pitch : row0;
+
+	if (bx + 4 <= (int) surface.width) {
+		const T* a = (const T*) row0 + bx;
+		const T* b = (const T*) row1 + bx;
+		out[0] = a[0]; out[1] = a[1]; out[2] = b[0]; out[3] = b[1];
+		out[4] = a[2]; out[5] = a[3]; out[6] = b[2]; out[7] = b[3];
+		return;
+	}
+
+	for (int i = 0; i < 8; i++) {
+		const T* row = (const T*) (LANE_Y[i] ? row1 : row0);
+		out[i] = row[std::min(bx + LANE_X[i], (int) surface.width - 1)];
+	}
+}
+
+/**
+ * Stores the "mask" lanes. A full mask means the whole block is
+ * inside the clip rectangle, hence inside the surface.
+ */
+template<typename T>
+ODX_BLOCK void scatter(const Surface& surface, int bx, int by, const T* in, uint32_t mask) {
+	T* a = (T*) (surface.bits + (size_t) by * surface.pitch) + bx;
+	T* b = (T*) ((BYTE*) a + surface.pitch);
+
+	if (mask == 0xFF) {
+		a[0] = in[0]; a[1] = in[1]; a[2] = in[4]; a[3] = in[5];
+		b[0] = in[2]; b[1] = in[3]; b[2] = in[6]; b[3] = in[7];
+		return;
+	}
+
+	for (int i = 0; i < 8; i++) {
+		if (mask & (1 << i)) (LANE_Y[i] ? b : a)[LANE_X[i]] = in[i];
+	}
+}
+
+ODX_BLOCK Lanes::u32x8 load32(const Surface& surface, int bx, int by) {
+	Lanes::u32x8 r;
+	uint32_t lanes[8];
+	gather(surface, bx, by, lanes);
+	memcpy(&r, lanes, sizeof(r));
+	return r;
+}
+
+ODX_BLOCK void store32(const Surface& surface, int bx, int by, Lanes::u32x8 pixels, uint32_t mask) {
+	uint32_t lanes[8];
+	memcpy(lanes, &pixels, sizeof(lanes));
+	scatter(surface, bx, by, lanes, mask);
+}
+
+#undef ODX_BLOCK
+
+#pragma GCC diagnostic pop
@@ -2,7 +2,10 @@
 #include "d3d9helper.hpp"
 #include "d3d9.hpp"
 #include "d3dobject.hpp"
+#include "d3dcaps.hpp"
+#include "direct3ddevice9.hpp"
 #include <iostream>
+#include <new>
 #include <winbase.h>
 #include <drm/drm.h>
 #include <fcntl.h>
@@ -63,7 +66,7 @@ IDirect3D9::IDirect3D9 (UINT SDKVersion) {
 		deviceType = D3DDEVTYPE::D3DDEVTYPE_HAL;
 	}
 
-	IDirect3DDevice9* device;
+	IDirect3DDevice9* device = NULL;
 	this->CreateDevice(
 		D3DADAPTER_DEFAULT,
 		deviceType,
@@ -93,9 +96,153 @@ HRESULT IDirect3D9::CreateDevice(
 		D3DPRESENT_PARAMETERS *pPresentationParameters,
 		IDirect3DDevice9      **ppReturnedDeviceInterface
 	) {
+		if (ppReturnedDeviceInterface == NULL)
+			return D3DERR_INVALIDCALL;
+
+		*ppReturnedDeviceInterface = NULL;
+		if (Adapter != D3DADAPTER_DEFAULT || pPresentationParameters == NULL)
+			return D3DERR_INVALIDCALL;
+
+		D3DPRESENT_PARAMETERS& presentation = *pPresentationParameters;
+		HWND window = presentation.hDeviceWindow != NULL ? presentation.hDeviceWindow : hFocusWindow;
+		if (window == NULL)
+			return D3DERR_INVALIDCALL;
+
+		//a zero back buffer size takes the size of the window
+		if (presentation.BackBufferWidth == 0 || presentation.BackBufferHeight == 0) {
+			int width = gtk_widget_get_width(window), height = gtk_widget_get_height(window);
+			if (width <= 0 || height <= 0)
+				gtk_window_get_default_size(GTK_WINDOW(window), &width, &height);
+			if (width <= 0 || height <= 0) {
+				width = 640;
+				height = 480;
+			}
+
+			if (presentation.BackBufferWidth == 0) presentation.BackBufferWidth = width;
+			if (presentation.BackBufferHeight == 0) presentation.BackBufferHeight = height;
+		}
+		if (presentation.BackBufferFormat == D3DFMT_UNKNOWN)
+			presentation.BackBufferFormat = D3DFMT_X8R8G8B8;
+		if (presentation.BackBufferCount == 0)
+			presentation.BackBufferCount = 1;
+
+		if (FAILED(this->CheckDeviceFormat(Adapter, DeviceType, D3DFMT_X8R8G8B8, D3DUSAGE_RENDERTARGET, D3DRTYPE_SURFACE, presentation.BackBufferFormat)))
+			return D3DERR_INVALIDCALL;
+		if (presentation.EnableAutoDepthStencil && FAILED(this->CheckDeviceFormat(Adapter, DeviceType, D3DFMT_X8R8G8B8, D3DUSAGE_DEPTHSTENCIL, D3DRTYPE_SURFACE, presentation.AutoDepthStencilFormat)))
+			return D3DERR_INVALIDCALL;
+		if (presentation.MultiSampleType != D3DMULTISAMPLE_NONE)
+			return D3DERR_INVALIDCALL;
+
+		//exactly one vertex processing mode, though all of them run on the CPU
+		const DWORD processing = BehaviorFlags & (D3DCREATE_SOFTWARE_VERTEXPROCESSING | D3DCREATE_HARDWARE_VERTEXPROCESSING | D3DCREATE_MIXED_VERTEXPROCESSING);
+		if (processing == 0 || (processing & (processing - 1)) != 0)
+			return D3DERR_INVALIDCALL;
+
+		*ppReturnedDeviceInterface = new (std::nothrow) Direct3DDevice9(this, DeviceType, hFocusWindow != NULL ? hFocusWindow : window, BehaviorFlags, &presentation);
+		return *ppReturnedDeviceInterface != NULL ? D3D_OK : E_OUTOFMEMORY;
+}
+
+UINT IDirect3D9::GetAdapterCount() {
+	return 1;
+}
+
+
+UINT IDirect3D9::GetAdapterModeCount(UINT Adapter, D3DFORMAT Format) {
+	if (Adapter != D3DADAPTER_DEFAULT || !D3DCaps::isDisplayFormat(Format))
 		return 0;
+
+	return D3DCaps::modes().size();
+}
+
+
+/**
+ * Every mode is available in every display format; they are
+ * stored once and only the format is filled in here.
+ */
+HRESULT IDirect3D9::EnumAdapterModes(UINT Adapter, D3DFORMAT Format, UINT Mode, D3DDISPLAYMODE* pMode) {
+	if (Adapter != D3DADAPTER_DEFAULT || pMode == NULL)
+		return D3DERR_INVALIDCALL;
+	if (!D3DCaps::isDisplayFormat(Format) || Mode >= D3DCaps::modes().size())
+		return D3DERR_INVALIDCALL;
+
+	*pMode = D3DCaps::modes()[Mode];
+	pMode->Format = Format;
+	return D3D_OK;
+}
+
+
+/**
+ * Games call this hundreds of times at startup; after the first run
+ * on a machine every call is a lookup in the shared caps cache.
+ */
+HRESULT IDirect3D9::CheckDeviceFormat(
+		UINT            Adapter,
+		D3DDEVTYPE      DeviceType,
+		D3DFORMAT       AdapterFormat,
+		DWORD           Usage,
+		D3DRESOURCETYPE RType,
+		D3DFORMAT       CheckFormat
+	) {
+		if (Adapter != D3DADAPTER_DEFAULT)
+			return D3DERR_INVALIDCALL;
+
+		const uint32_t args[5] = {(uint32_t) DeviceType, (uint32_t) AdapterFormat, (uint32_t) Usage, (uint32_t) RType, (uint32_t) CheckFormat};
+		int32_t result;
+		uint32_t value;
+
+		if (D3DCaps::cache().get(CapsCache::KIND_FORMAT, args, result, value))
+			return result;
+
+		result = D3DCaps::probeFormat(DeviceType, AdapterFormat, Usage, RType, CheckFormat);
+		D3DCaps::cache().put(CapsCache::KIND_FORMAT, args, result, 0);
+		return result;
 }
 
+
+HRESULT IDirect3D9::CheckDeviceMultiSampleType(
+		UINT                Adapter,
+		D3DDEVTYPE          DeviceType,
+		D3DFORMAT           SurfaceFormat,
+		BOOL                Windowed,
+		D3DMULTISAMPLE_TYPE MultiSampleType,
+		DWORD*              pQualityLevels
+	) {
+		if (Adapter != D3DADAPTER_DEFAULT)
+			return D3DERR_INVALIDCALL;
+
+		const uint32_t args[5] = {(uint32_t) DeviceType, (uint32_t) SurfaceFormat, (uint32_t) Windowed, (uint32_t) MultiSampleType, 0};
+		int32_t result;
+		uint32_t value;
+
+		if (!D3DCaps::cache().get(CapsCache::KIND_MULTISAMPLE, args, result, value)) {
+			DWORD levels = 0;
+			result = D3DCaps::probeMultiSample(DeviceType, SurfaceFormat, Windowed, MultiSampleType, &levels);
+			value = levels;
+			D3DCaps::cache().put(CapsCache::KIND_MULTISAMPLE, args, result, value);
+		}
+
+		if (pQualityLevels != NULL)
+			*pQualityLevels = value;
+		return result;
+}
+
+
+HRESULT IDirect3D9::GetDeviceCaps(UINT Adapter, D3DDEVTYPE DeviceType, D3DCAPS9* pCaps) {
+	if (Adapter != D3DADAPTER_DEFAULT || pCaps == NULL)
+		return D3DERR_INVALIDCALL;
+
+	const D3DCAPS9* cached = D3DCaps::cache().getCaps(DeviceType);
+	if (cached != NULL) {
+		*pCaps = *cached;
+		return D3D_OK;
+	}
+
+	D3DCaps::probeCaps(DeviceType, pCaps);
+	D3DCaps::cache().putCaps(DeviceType, *pCaps);
+	return D3D_OK;
+}
+
+
 ULONG IDirect3D9::Release() {
 	return 0;
 }
@@ -0,0 +1,373 @@
+#include <config.hpp>
+#include "d3dcaps.hpp"
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <fcntl.h>
+#include <format/PixelFormat.hpp>
+#include <unistd.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+/**
+ * Keyed by the DRM driver of the default adapter, "none" when
+ * there is no usable /dev/dri/card0.
+ */
+CapsCache& D3DCaps::cache() {
+	static CapsCache* cache = []() {
+		std::string driver = "none";
+		int version[3] = {0, 0, 0};
+		int fd = open("/dev/dri/card0", O_RDWR | O_CLOEXEC);
+
+		if (fd >= 0) {
+			drmVersion* drm = drmGetVersion(fd);
+			if (drm != NULL) {
+				driver = drm->name;
+				version[0] = drm->version_major;
+				version[1] = drm->version_minor;
+				version[2] = drm->version_patchlevel;
+				drmFreeVersion(drm);
+			}
+			close(fd);
+		}
+
+		CapsCache* r = new CapsCache(driver, version);
+
+		#ifdef DEBUG
+			std::cout << "libd3d9.so: caps cache for " << driver << (r->isShared() ? "" : " (not persistent)") << std::endl;
+		#endif
+
+		return r;
+	}();
+
+	return *cache;
+}
+
+/**
+ * Capabilities of the software device. Every device type reports
+ * the same ones: there is no hardware path yet.
+ */
+void D3DCaps::probeCaps(D3DDEVTYPE DeviceType, D3DCAPS9* pCaps) {
+	D3DCAPS9 c = {};
+
+	c.DeviceType = DeviceType;
+	c.AdapterOrdinal = D3DADAPTER_DEFAULT;
+	c.Caps2 = D3DCAPS2_DYNAMICTEXTURES;
+	c.Caps3 = D3DCAPS3_COPY_TO_VIDMEM | D3DCAPS3_COPY_TO_SYSTEMMEM;
+	c.PresentationIntervals = D3DPRESENT_INTERVAL_IMMEDIATE | D3DPRESENT_INTERVAL_ONE;
+	c.CursorCaps = D3DCURSORCAPS_COLOR;
+	c.DevCaps = D3DDEVCAPS_EXECUTESYSTEMMEMORY | D3DDEVCAPS_TLVERTEXSYSTEMMEMORY | D3DDEVCAPS_TEXTURESYSTEMMEMORY
+		| D3DDEVCAPS_DRAWPRIMTLVERTEX | D3DDEVCAPS_CANRENDERAFTERFLIP | D3DDEVCAPS_DRAWPRIMITIVES2 | D3DDEVCAPS_DRAWPRIMITIVES2EX
+		| D3DDEVCAPS_RTPATCHES | D3DDEVCAPS_RTPATCHHANDLEZERO | D3DDEVCAPS_NPATCHES;
+	c.MaxNpatchTessellationLevel = 64;
+
+	c.PrimitiveMiscCaps = D3DPMISCCAPS_MASKZ | D3DPMISCCAPS_CULLNONE | D3DPMISCCAPS_CULLCW | D3DPMISCCAPS_CULLCCW
+		| D3DPMISCCAPS_COLORWRITEENABLE | D3DPMISCCAPS_CLIPTLVERTS | D3DPMISCCAPS_BLENDOP | D3DPMISCCAPS_INDEPENDENTWRITEMASKS
+		| D3DPMISCCAPS_MRTINDEPENDENTBITDEPTHS | D3DPMISCCAPS_MRTPOSTPIXELSHADERBLENDING | D3DPMISCCAPS_TSSARGTEMP
+		| D3DPMISCCAPS_PERSTAGECONSTANT;
+	c.RasterCaps = D3DPRASTERCAPS_ZTEST | D3DPRASTERCAPS_FOGVERTEX | D3DPRASTERCAPS_FOGTABLE | D3DPRASTERCAPS_MIPMAPLODBIAS
+		| D3DPRASTERCAPS_COLORPERSPECTIVE | D3DPRASTERCAPS_SCISSORTEST | D3DPRASTERCAPS_DEPTHBIAS | D3DPRASTERCAPS_SLOPESCALEDEPTHBIAS
+		| D3DPRASTERCAPS_FOGRANGE | D3DPRASTERCAPS_WFOG | D3DPRASTERCAPS_ZFOG | D3DPRASTERCAPS_ANISOTROPY;
+	c.ZCmpCaps = c.AlphaCmpCaps = D3DPCMPCAPS_NEVER | D3DPCMPCAPS_LESS | D3DPCMPCAPS_EQUAL | D3DPCMPCAPS_LESSEQUAL
+		| D3DPCMPCAPS_GREATER | D3DPCMPCAPS_NOTEQUAL | D3DPCMPCAPS_GREATEREQUAL | D3DPCMPCAPS_ALWAYS;
+	c.SrcBlendCaps = c.DestBlendCaps = D3DPBLENDCAPS_ZERO | D3DPBLENDCAPS_ONE | D3DPBLENDCAPS_SRCCOLOR | D3DPBLENDCAPS_INVSRCCOLOR
+		| D3DPBLENDCAPS_SRCALPHA | D3DPBLENDCAPS_INVSRCALPHA | D3DPBLENDCAPS_DESTALPHA | D3DPBLENDCAPS_INVDESTALPHA
+		| D3DPBLENDCAPS_DESTCOLOR | D3DPBLENDCAPS_INVDESTCOLOR | D3DPBLENDCAPS_SRCALPHASAT;
+	c.ShadeCaps = D3DPSHADECAPS_COLORGOURAUDRGB | D3DPSHADECAPS_SPECULARGOURAUDRGB | D3DPSHADECAPS_ALPHAGOURAUDBLEND | D3DPSHADECAPS_FOGGOURAUD;
+	c.TextureCaps = D3DPTEXTURECAPS_PERSPECTIVE | D3DPTEXTURECAPS_ALPHA | D3DPTEXTURECAPS_MIPMAP | D3DPTEXTURECAPS_PROJECTED
+		| D3DPTEXTURECAPS_CUBEMAP | D3DPTEXTURECAPS_MIPCUBEMAP | D3DPTEXTURECAPS_VOLUMEMAP | D3DPTEXTURECAPS_MIPVOLUMEMAP;
+	c.TextureFilterCaps = D3DPTFILTERCAPS_MINFPOINT | D3DPTFILTERCAPS_MINFLINEAR | D3DPTFILTERCAPS_MIPFPOINT
+		| D3DPTFILTERCAPS_MIPFLINEAR | D3DPTFILTERCAPS_MAGFPOINT | D3DPTFILTERCAPS_MAGFLINEAR | D3DPTFILTERCAPS_MINFANISOTROPIC;
+	c.TextureAddressCaps = D3DPTADDRESSCAPS_WRAP | D3DPTADDRESSCAPS_MIRROR | D3DPTADDRESSCAPS_CLAMP
+		| D3DPTADDRESSCAPS_BORDER | D3DPTADDRESSCAPS_INDEPENDENTUV | D3DPTADDRESSCAPS_MIRRORONCE;
+	c.CubeTextureFilterCaps = c.VolumeTextureFilterCaps = c.TextureFilterCaps;
+	c.VolumeTextureAddressCaps = c.TextureAddressCaps;
+	c.LineCaps = D3DLINECAPS_TEXTURE | D3DLINECAPS_ZTEST | D3DLINECAPS_BLEND | D3DLINECAPS_ALPHACMP | D3DLINECAPS_FOG;
+
+	c.MaxTextureWidth = c.MaxTextureHeight = 4096;
+	c.MaxTextureRepeat = 8192;
+	c.MaxTextureAspectRatio = 4096;
+	c.MaxVolumeExtent = 512;
+	c.MaxAnisotropy = 16;
+	c.MaxVertexW = 1e10f;
+
+	c.StencilCaps = D3DSTENCILCAPS_KEEP | D3DSTENCILCAPS_ZERO | D3DSTENCILCAPS_REPLACE | D3DSTENCILCAPS_INCRSAT
+		| D3DSTENCILCAPS_DECRSAT | D3DSTENCILCAPS_INVERT | D3DSTENCILCAPS_INCR | D3DSTENCILCAPS_DECR | D3DSTENCILCAPS_TWOSIDED;
+	c.FVFCaps = 8 | D3DFVFCAPS_PSIZE;
+	c.TextureOpCaps = D3DTEXOPCAPS_DISABLE | D3DTEXOPCAPS_SELECTARG1 | D3DTEXOPCAPS_SELECTARG2 | D3DTEXOPCAPS_MODULATE
+		| D3DTEXOPCAPS_MODULATE2X | D3DTEXOPCAPS_MODULATE4X | D3DTEXOPCAPS_ADD | D3DTEXOPCAPS_ADDSIGNED
+		| D3DTEXOPCAPS_ADDSIGNED2X | D3DTEXOPCAPS_SUBTRACT | D3DTEXOPCAPS_ADDSMOOTH | D3DTEXOPCAPS_BLENDDIFFUSEALPHA
+		| D3DTEXOPCAPS_BLENDTEXTUREALPHA | D3DTEXOPCAPS_BLENDFACTORALPHA | D3DTEXOPCAPS_BLENDTEXTUREALPHAPM
+		| D3DTEXOPCAPS_BLENDCURRENTALPHA | D3DTEXOPCAPS_MODULATEALPHA_ADDCOLOR | D3DTEXOPCAPS_MODULATECOLOR_ADDALPHA
+		| D3DTEXOPCAPS_MODULATEINVALPHA_ADDCOLOR | D3DTEXOPCAPS_MODULATEINVCOLOR_ADDALPHA | D3DTEXOPCAPS_DOTPRODUCT3
+		| D3DTEXOPCAPS_MULTIPLYADD | D3DTEXOPCAPS_LERP;
+	c.MaxTextureBlendStages = 8;
+	c.MaxSimultaneousTextures = 8;
+
+	c.VertexProcessingCaps = D3DVTXPCAPS_TEXGEN | D3DVTXPCAPS_MATERIALSOURCE7 | D3DVTXPCAPS_DIRECTIONALLIGHTS
+		| D3DVTXPCAPS_POSITIONALLIGHTS | D3DVTXPCAPS_LOCALVIEWER;
+	c.MaxActiveLights = 8;
+	c.MaxUserClipPlanes = 6;
+	c.MaxVertexBlendMatrices = 4;
+	c.MaxVertexBlendMatrixIndex = 255;
+
+	c.MaxPointSize = 64;
+	c.MaxPrimitiveCount = 0xFFFFF;
+	c.MaxVertexIndex = 0xFFFFFF;
+	c.MaxStreams = 16;
+	c.MaxStreamStride = 255;
+
+	//fixed function only
+	c.VertexShaderVersion = 0;
+	c.PixelShaderVersion = 0;
+
+	c.NumberOfAdaptersInGroup = 1;
+	c.DeclTypes = D3DDTCAPS_UBYTE4 | D3DDTCAPS_UBYTE4N | D3DDTCAPS_SHORT2N | D3DDTCAPS_SHORT4N;
+	c.NumSimultaneousRTs = 4;
+	c.StretchRectFilterCaps = D3DPTFILTERCAPS_MINFPOINT | D3DPTFILTERCAPS_MINFLINEAR | D3DPTFILTERCAPS_MAGFPOINT | D3DPTFILTERCAPS_MAGFLINEAR;
+
+	*pCaps = c;
+}
+
+/**
+ * Modes of every connected connector. drmModeGetConnector makes the
+ * kernel probe the outputs (EDID reads over DDC), which is the slow
+ * part worth caching.
+ */
+std::vector<D3DDISPLAYMODE> D3DCaps::probeModes() {
+	std::vector<D3DDISPLAYMODE> modes;
+	int fd = open("/dev/dri/card0", O_RDWR | O_CLOEXEC);
+	drmModeRes* resources = fd >= 0 ? drmModeGetResources(fd) : NULL;
+
+	if (resources != NULL) {
+		for (int i = 0; i < resources->count_connectors; i++) {
+			drmModeConnector* connector = drmModeGetConnector(fd, resources->connectors[i]);
+			if (connector == NULL) continue;
+
+			if (connector->connection == DRM_MODE_CONNECTED) {
+				for (int m = 0; m < connector->count_modes; m++) {
+					const drmModeModeInfo& mode = connector->modes[m];
+					modes.push_back({mode.hdisplay, mode.vdisplay, mode.vrefresh, D3DFMT_X8R8G8B8});
+				}
+			}
+
+			drmModeFreeConnector(connector);
+		}
+
+		drmModeFreeResources(resources);
+	}
+	if (fd >= 0) close(fd);
+
+	//no KMS access (render node only, or a container): windowed sizes
+	if (modes.empty()) {
+		const UINT fallback[][2] = {{640, 480}, {800, 600}, {1024, 768}, {1280, 720}, {1280, 1024}, {1920, 1080}};
+		for (const auto& size : fallback) {
+			modes.push_back({size[0], size[1], 60, D3DFMT_X8R8G8B8});
+		}
+	}
+
+	std::sort(modes.begin(), modes.end(), [](const D3DDISPLAYMODE& a, const D3DDISPLAYMODE& b) {
+		if (a.Width != b.Width) return a.Width < b.Width;
+		if (a.Height != b.Height) return a.Height < b.Height;
+		return a.RefreshRate < b.RefreshRate;
+	});
+	modes.erase(std::unique(modes.begin(), modes.end(), [](const D3DDISPLAYMODE& a, const D3DDISPLAYMODE& b) {
+		return a.Width == b.Width && a.Height == b.Height && a.RefreshRate == b.RefreshRate;
+	}), modes.end());
+
+	return modes;
+}
+
+/**
+ * Hash of the connectors of card0 with their status and EDID, from
+ * what the kernel already has in sysfs (no DDC probe). Changes when
+ * a monitor is plugged, unplugged or swapped.
+ */
+uint32_t D3DCaps::outputs() {
+	std::vector<std::filesystem::path> connectors;
+	std::error_code ec;
+
+	for (const auto& entry : std::filesystem::directory_iterator("/sys/class/drm", ec)) {
+		if (entry.path().filename().string().starts_with("card0-")) connectors.push_back(entry.path());
+	}
+	std::sort(connectors.begin(), connectors.end());
+
+	uint32_t h = 2166136261u;
+	auto mix = [&h](const std::string& bytes) {
+		for (unsigned char c : bytes) h = (h ^ c) * 16777619u;
+		h = (h ^ 0xFF) * 16777619u;
+	};
+
+	for (const auto& connector : connectors) {
+		mix(connector.filename().string());
+
+		for (const char* name : {"status", "edid"}) {
+			std::ifstream file(connector / name, std::ios::binary);
+			mix(std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()));
+		}
+	}
+
+	return h;
+}
+
+/**
+ * Mode list of the default adapter, read from the cache once per process.
+ */
+const std::vector<D3DDISPLAYMODE>& D3DCaps::modes() {
+	static const std::vector<D3DDISPLAYMODE> modes = []() {
+		std::vector<D3DDISPLAYMODE> r;
+		uint32_t outputs = D3DCaps::outputs();
+
+		if (!D3DCaps::cache().getModes(r, outputs)) {
+			r = D3DCaps::probeModes();
+			D3DCaps::cache().putModes(r, outputs);
+		}
+
+		return r;
+	}();
+
+	return modes;
+}
+
+bool D3DCaps::isDisplayFormat(D3DFORMAT Format) {
+	return Format == D3DFMT_X8R8G8B8 || Format == D3DFMT_R5G6B5 || Format == D3DFMT_X1R5G5B5;
+}
+
+static bool isRenderTargetFormat(D3DFORMAT Format) {
+	switch (Format) {
+		case D3DFMT_A8R8G8B8:
+		case D3DFMT_X8R8G8B8:
+		case D3DFMT_R5G6B5:
+		case D3DFMT_R16F:
+		case D3DFMT_G16R16F:
+		case D3DFMT_A16B16G16R16F:
+		case D3DFMT_R32F:
+		case D3DFMT_G32R32F:
+		case D3DFMT_A32B32G32R32F:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static bool isDepthStencilFormat(D3DFORMAT Format) {
+	return Format == D3DFMT_D16 || Format == D3DFMT_D15S1 || Format == D3DFMT_D24X8 || Format == D3DFMT_D24S8 || Format == D3DFMT_D24X4S4 || Format == D3DFMT_D32;
+}
+
+static bool isTextureFormat(D3DFORMAT Format) {
+	switch (Format) {
+		case D3DFMT_A8R8G8B8:
+		case D3DFMT_X8R8G8B8:
+		case D3DFMT_R5G6B5:
+		case D3DFMT_X1R5G5B5:
+		case D3DFMT_A1R5G5B5:
+		case D3DFMT_A4R4G4B4:
+		case D3DFMT_A8:
+		case D3DFMT_L8:
+		case D3DFMT_A8L8:
+		case D3DFMT_DXT1:
+		case D3DFMT_DXT2:
+		case D3DFMT_DXT3:
+		case D3DFMT_DXT4:
+		case D3DFMT_DXT5:
+		case D3DFMT_R16F:
+		case D3DFMT_G16R16F:
+		case D3DFMT_A16B16G16R16F:
+		case D3DFMT_R32F:
+		case D3DFMT_G32R32F:
+		case D3DFMT_A32B32G32R32F:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * Formats the sampler decodes from sRGB: those of 8 bits or fewer per
+ * color channel.
+ */
+static bool isSrgbReadFormat(D3DFORMAT Format) {
+	switch (Format) {
+		case D3DFMT_A8R8G8B8:
+		case D3DFMT_X8R8G8B8:
+		case D3DFMT_R5G6B5:
+		case D3DFMT_X1R5G5B5:
+		case D3DFMT_A1R5G5B5:
+		case D3DFMT_A4R4G4B4:
+		case D3DFMT_L8:
+		case D3DFMT_A8L8:
+		case D3DFMT_DXT1:
+		case D3DFMT_DXT2:
+		case D3DFMT_DXT3:
+		case D3DFMT_DXT4:
+		case D3DFMT_DXT5:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * Render targets the output merger encodes to sRGB.
+ */
+static bool isSrgbWriteFormat(D3DFORMAT Format) {
+	return Format == D3DFMT_A8R8G8B8 || Format == D3DFMT_X8R8G8B8;
+}
+
+HRESULT D3DCaps::probeFormat(D3DDEVTYPE DeviceType, D3DFORMAT AdapterFormat, DWORD Usage, D3DRESOURCETYPE RType, D3DFORMAT CheckFormat) {
+	if (!D3DCaps::isDisplayFormat(AdapterFormat))
+		return D3DERR_NOTAVAILABLE;
+
+	if (RType == D3DRTYPE_VERTEXBUFFER)
+		return CheckFormat == D3DFMT_VERTEXDATA ? D3D_OK : D3DERR_NOTAVAILABLE;
+	if (RType == D3DRTYPE_INDEXBUFFER)
+		return CheckFormat == D3DFMT_INDEX16 || CheckFormat == D3DFMT_INDEX32 ? D3D_OK : D3DERR_NOTAVAILABLE;
+
+	if (RType != D3DRTYPE_SURFACE && RType != D3DRTYPE_TEXTURE && RType != D3DRTYPE_CUBETEXTURE && RType != D3DRTYPE_VOLUMETEXTURE)
+		return D3DERR_NOTAVAILABLE;
+
+	//volumes are stored in 3D bricks, which DXTn blocks do not fit; nothing renders into them
+	if (RType == D3DRTYPE_VOLUMETEXTURE && (PixelFormat::isCompressed(CheckFormat) || (Usage & (D3DUSAGE_RENDERTARGET | D3DUSAGE_DEPTHSTENCIL))))
+		return D3DERR_NOTAVAILABLE;
+
+	if (Usage & D3DUSAGE_DEPTHSTENCIL)
+		return isDepthStencilFormat(CheckFormat) ? D3D_OK : D3DERR_NOTAVAILABLE;
+
+	if ((Usage & (D3DUSAGE_RENDERTARGET | D3DUSAGE_QUERY_POSTPIXELSHADER_BLENDING)) && !isRenderTargetFormat(CheckFormat))
+		return D3DERR_NOTAVAILABLE;
+
+	if (!isTextureFormat(CheckFormat))
+		return D3DERR_NOTAVAILABLE;
+
+	if ((Usage & D3DUSAGE_QUERY_SRGBREAD) && !isSrgbReadFormat(CheckFormat))
+		return D3DERR_NOTAVAILABLE;
+
+	if ((Usage & D3DUSAGE_QUERY_SRGBWRITE) && !isSrgbWriteFormat(CheckFormat))
+		return D3DERR_NOTAVAILABLE;
+
+	if (Usage & (D3DUSAGE_QUERY_VERTEXTEXTURE | D3DUSAGE_QUERY_LEGACYBUMPMAP))
+		return D3DERR_NOTAVAILABLE;
+
+	if (Usage & D3DUSAGE_AUTOGENMIPMAP)
+		return D3DOK_NOAUTOGEN;
+
+	return D3D_OK;
+}
+
+HRESULT D3DCaps::probeMultiSample(D3DDEVTYPE DeviceType, D3DFORMAT SurfaceFormat, BOOL Windowed, D3DMULTISAMPLE_TYPE MultiSampleType, DWORD* pQualityLevels) {
+	if (!isRenderTargetFormat(SurfaceFormat) && !isDepthStencilFormat(SurfaceFormat)) {
+		if (pQualityLevels != NULL) *pQualityLevels = 0;
+		return D3DERR_NOTAVAILABLE;
+	}
+
+	//the rasterizer has one sample per pixel
+	if (MultiSampleType != D3DMULTISAMPLE_NONE) {
+		if (pQualityLevels != NULL) *pQualityLevels = 0;
+		return D3DERR_NOTAVAILABLE;
+	}
+
+	if (pQualityLevels != NULL) *pQualityLevels = 1;
+	return D3D_OK;
+}
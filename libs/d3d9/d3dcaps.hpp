@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+#include <windows.h>
+#include <d3d9.h>
+#include <cache/CapsCache.hpp>
+
+/**
+ * What the runtime supports, answered from the shared CapsCache.
+ *
+ * The probe* functions compute a result from scratch (DRM queries,
+ * format tables); they only run when the cache has no answer yet.
+ */
+class D3DCaps {
+	public:static CapsCache& cache();
+
+	public:static void probeCaps(D3DDEVTYPE DeviceType, D3DCAPS9* pCaps);
+	public:static std::vector<D3DDISPLAYMODE> probeModes();
+	public:static uint32_t outputs();
+	public:static HRESULT probeFormat(D3DDEVTYPE DeviceType, D3DFORMAT AdapterFormat, DWORD Usage, D3DRESOURCETYPE RType, D3DFORMAT CheckFormat);
+	public:static HRESULT probeMultiSample(D3DDEVTYPE DeviceType, D3DFORMAT SurfaceFormat, BOOL Windowed, D3DMULTISAMPLE_TYPE MultiSampleType, DWORD* pQualityLevels);
+
+	public:static const std::vector<D3DDISPLAYMODE>& modes();
+	public:static bool isDisplayFormat(D3DFORMAT Format);
+};
@@ -0,0 +1,270 @@
+#include "depthstencil.hpp"
+#include "blockaccess.hpp"
+#include <algorithm>
+#include <cmath>
+#include <simd/Lanes.hpp>
+#include <simd/VectorMath.hpp>
+
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+using Lanes::f32x8;
+using Lanes::i32x8;
+using Lanes::u32x8;
+typedef DepthStencil::Mode Mode;
+
+#define ODX_INLINE inline __attribute__((always_inline))
+
+//--- formats
+
+/**
+ * Layout of a depth/stencil word: depth above SHIFT, stencil in the
+ * STENCIL bits, the rest of the low bits unused (and kept).
+ */
+template<D3DFORMAT F> struct Format;
+
+template<> struct Format<D3DFMT_D24S8> {
+	typedef uint32_t Word;
+	static constexpr uint32_t SHIFT = 8;
+	static constexpr uint32_t DEPTH = 0xFFFFFF;
+	static constexpr uint32_t STENCIL = 0xFF;
+};
+
+template<> struct Format<D3DFMT_D24X8> {
+	typedef uint32_t Word;
+	static constexpr uint32_t SHIFT = 8;
+	static constexpr uint32_t DEPTH = 0xFFFFFF;
+	static constexpr uint32_t STENCIL = 0;
+};
+
+template<> struct Format<D3DFMT_D24X4S4> {
+	typedef uint32_t Word;
+	static constexpr uint32_t SHIFT = 8;
+	static constexpr uint32_t DEPTH = 0xFFFFFF;
+	static constexpr uint32_t STENCIL = 0xF;
+};
+
+template<> struct Format<D3DFMT_D16> {
+	typedef uint16_t Word;
+	static constexpr uint32_t SHIFT = 0;
+	static constexpr uint32_t DEPTH = 0xFFFF;
+	static constexpr uint32_t STENCIL = 0;
+};
+
+template<> struct Format<D3DFMT_D15S1> {
+	typedef uint16_t Word;
+	static constexpr uint32_t SHIFT = 1;
+	static constexpr uint32_t DEPTH = 0x7FFF;
+	static constexpr uint32_t STENCIL = 1;
+};
+
+template<D3DFORMAT F>
+ODX_INLINE u32x8 load(const Surface& surface, int bx, int by) {
+	typename Format<F>::Word words[8];
+	gather(surface, bx, by, words);
+	u32x8 r;
+	for (int i = 0; i < 8; i++) r[i] = words[i];
+	return r;
+}
+
+template<D3DFORMAT F>
+ODX_INLINE void store(const Surface& surface, int bx, int by, u32x8 values, uint32_t mask) {
+	typename Format<F>::Word words[8];
+	for (int i = 0; i < 8; i++) words[i] = values[i];
+	scatter(surface, bx, by, words, mask);
+}
+
+/**
+ * 0..1 depths to the format's integers; 1.0 would round up past the
+ * largest one in 24-bit formats.
+ */
+template<D3DFORMAT F>
+ODX_INLINE i32x8 quantize(const float* z) {
+	constexpr uint32_t max = Format<F>::DEPTH;
+	return Lanes::min(Lanes::toInt(Lanes::clamp01(Lanes::load(z)) * (float) max + 0.5f), Lanes::splat((int32_t) max));
+}
+
+//--- tests
+
+ODX_INLINE i32x8 compare(D3DCMPFUNC func, i32x8 a, i32x8 b) {
+	switch (func) {
+		case D3DCMP_NEVER: return Lanes::splat(0);
+		case D3DCMP_LESS: return a < b;
+		case D3DCMP_EQUAL: return a == b;
+		case D3DCMP_LESSEQUAL: return a <= b;
+		case D3DCMP_GREATER: return a > b;
+		case D3DCMP_NOTEQUAL: return a != b;
+		case D3DCMP_GREATEREQUAL: return a >= b;
+		default: return Lanes::splat(-1);
+	}
+}
+
+/**
+ * "op" applied to stencil values "s" of a format whose largest
+ * stencil value is "max".
+ */
+ODX_INLINE u32x8 apply(D3DSTENCILOP op, u32x8 s, uint32_t ref, uint32_t max) {
+	switch (op) {
+		case D3DSTENCILOP_ZERO: return u32x8{};
+		case D3DSTENCILOP_REPLACE: return Lanes::splat(ref);
+		case D3DSTENCILOP_INCRSAT: return Lanes::select((i32x8) (s < max), s + 1, s);
+		case D3DSTENCILOP_DECRSAT: return Lanes::select((i32x8) (s > 0), s - 1, s);
+		case D3DSTENCILOP_INVERT: return ~s & max;
+		case D3DSTENCILOP_INCR: return (s + 1) & max;
+		case D3DSTENCILOP_DECR: return (s - 1) & max;
+		default: return s;
+	}
+}
+
+template<D3DFORMAT F, Mode M>
+ODX_INLINE uint32_t test(const DrawState& state, int bx, int by, const float* z, uint32_t mask, bool ccw) {
+	typedef Format<F> T;
+	constexpr uint32_t unused = ((1u << T::SHIFT) - 1) & ~T::STENCIL;
+
+	const u32x8 stored = load<F>(state.depth, bx, by);
+	const i32x8 depth = quantize<F>(z);
+	const i32x8 storedDepth = (i32x8) (stored >> T::SHIFT);
+
+	i32x8 zPass;
+	if constexpr (M == DepthStencil::DEPTH_LESSEQUAL) zPass = depth <= storedDepth;
+	else zPass = state.zEnable ? compare(state.zFunc, depth, storedDepth) : Lanes::splat(-1);
+
+	if constexpr (M == DepthStencil::DEPTH_LESSEQUAL || M == DepthStencil::DEPTH) {
+		mask &= Lanes::bits(zPass);
+		if (mask != 0 && state.zWrite) store<F>(state.depth, bx, by, (u32x8) depth << T::SHIFT | (stored & ((1u << T::SHIFT) - 1)), mask);
+		return mask;
+	} else {
+		const u32x8 s = stored & T::STENCIL;
+		const uint32_t ref = state.stencilRef & T::STENCIL;
+
+		i32x8 sPass = Lanes::splat(-1);
+		if constexpr (M != DepthStencil::SHADOW) {
+			sPass = compare(state.stencilFunc[ccw], Lanes::splat((int32_t) (ref & state.stencilMask)), (i32x8) (s & (uint32_t) state.stencilMask));
+		}
+
+		const uint32_t passed = mask & Lanes::bits(sPass & zPass);
+
+		if constexpr (M == DepthStencil::STENCIL_TEST) {
+			if (passed != 0 && state.zWrite) store<F>(state.depth, bx, by, (u32x8) depth << T::SHIFT | (stored & ((1u << T::SHIFT) - 1)), passed);
+			return passed;
+		} else {
+			u32x8 next = Lanes::select(zPass, apply(state.stencilPass[ccw], s, ref, T::STENCIL), apply(state.stencilZFail[ccw], s, ref, T::STENCIL));
+			if constexpr (M != DepthStencil::SHADOW) next = Lanes::select(sPass, next, apply(state.stencilFail[ccw], s, ref, T::STENCIL));
+
+			const uint32_t write = state.stencilWriteMask & T::STENCIL;
+			next = (s & ~write) | (next & write);
+
+			u32x8 words = (u32x8) storedDepth << T::SHIFT | next | (stored & unused);
+			if constexpr (M != DepthStencil::SHADOW) {
+				if (state.zWrite) words = Lanes::select(sPass & zPass, (u32x8) depth << T::SHIFT | next | (stored & unused), words);
+			}
+
+			//shadow volumes mostly leave the stencil as it is: write only what changed
+			const uint32_t changed = mask & Lanes::bits((i32x8) (words != stored));
+			if (changed != 0) store<F>(state.depth, bx, by, words, changed);
+			return passed;
+		}
+	}
+}
+
+template<D3DFORMAT F, Mode M>
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma")))
+#endif
+uint32_t testAVX2(const DrawState& state, int bx, int by, const float* z, uint32_t mask, bool ccw) {
+	return test<F, M>(state, bx, by, z, mask, ccw);
+}
+
+template<D3DFORMAT F, Mode M>
+uint32_t testGeneric(const DrawState& state, int bx, int by, const float* z, uint32_t mask, bool ccw) {
+	return test<F, M>(state, bx, by, z, mask, ccw);
+}
+
+template<D3DFORMAT F>
+static DepthKernel pick(Mode mode, bool avx2) {
+	//formats without stencil bits never test stencil
+	if (Format<F>::STENCIL == 0 && mode > DepthStencil::DEPTH) mode = DepthStencil::DEPTH;
+
+	switch (mode) {
+		case DepthStencil::DEPTH_LESSEQUAL: return avx2 ? testAVX2<F, DepthStencil::DEPTH_LESSEQUAL> : testGeneric<F, DepthStencil::DEPTH_LESSEQUAL>;
+		case DepthStencil::DEPTH: return avx2 ? testAVX2<F, DepthStencil::DEPTH> : testGeneric<F, DepthStencil::DEPTH>;
+		case DepthStencil::SHADOW: return avx2 ? testAVX2<F, DepthStencil::SHADOW> : testGeneric<F, DepthStencil::SHADOW>;
+		case DepthStencil::STENCIL_TEST: return avx2 ? testAVX2<F, DepthStencil::STENCIL_TEST> : testGeneric<F, DepthStencil::STENCIL_TEST>;
+		default: return avx2 ? testAVX2<F, DepthStencil::STENCIL> : testGeneric<F, DepthStencil::STENCIL>;
+	}
+}
+
+Mode DepthStencil::mode(const DrawState& state) {
+	if (!state.stencil) return state.zEnable && state.zWrite && state.zFunc == D3DCMP_LESSEQUAL ? DEPTH_LESSEQUAL : DEPTH;
+
+	//without two-sided stencil both faces hold the clockwise state
+	const auto keeps = [&state](int face) {
+		return state.stencilFail[face] == D3DSTENCILOP_KEEP && state.stencilZFail[face] == D3DSTENCILOP_KEEP && state.stencilPass[face] == D3DSTENCILOP_KEEP;
+	};
+	if ((state.stencilWriteMask & 0xFF) == 0 || (keeps(0) && keeps(1))) return STENCIL_TEST;
+
+	if (state.stencilFunc[0] == D3DCMP_ALWAYS && state.stencilFunc[1] == D3DCMP_ALWAYS && !state.zWrite) return SHADOW;
+	return STENCIL;
+}
+
+DepthKernel DepthStencil::select(const DrawState& state) {
+	if (state.depth.bits == NULL) return NULL;
+	if (!state.zEnable && (!state.stencil || DepthStencil::stencilBits(state.depth.format) == 0)) return NULL;
+
+	const Mode mode = DepthStencil::mode(state);
+	const bool avx2 = VectorMath::hasAVX2();
+
+	switch (state.depth.format) {
+		case D3DFMT_D24S8: return pick<D3DFMT_D24S8>(mode, avx2);
+		case D3DFMT_D24X8: return pick<D3DFMT_D24X8>(mode, avx2);
+		case D3DFMT_D24X4S4: return pick<D3DFMT_D24X4S4>(mode, avx2);
+		case D3DFMT_D16: return pick<D3DFMT_D16>(mode, avx2);
+		case D3DFMT_D15S1: return pick<D3DFMT_D15S1>(mode, avx2);
+		default: return NULL;
+	}
+}
+
+D3DFORMAT DepthStencil::storage(D3DFORMAT format) {
+	return format == D3DFMT_D32 ? D3DFMT_D24X8 : format;
+}
+
+UINT DepthStencil::pixelSize(D3DFORMAT format) {
+	return format == D3DFMT_D16 || format == D3DFMT_D15S1 ? 2 : 4;
+}
+
+UINT DepthStencil::stencilBits(D3DFORMAT format) {
+	switch (format) {
+		case D3DFMT_D24S8: return 8;
+		case D3DFMT_D24X4S4: return 4;
+		case D3DFMT_D15S1: return 1;
+		default: return 0;
+	}
+}
+
+template<D3DFORMAT F>
+static void fill(const Surface& depth, DWORD flags, float z, DWORD stencil, int x0, int y0, int x1, int y1) {
+	typedef Format<F> T;
+	typedef typename T::Word Word;
+
+	const uint32_t depthBits = (uint32_t) std::lrint(std::clamp(z, 0.0f, 1.0f) * (double) T::DEPTH) << T::SHIFT;
+	uint32_t keep = 0;
+	if (!(flags & D3DCLEAR_ZBUFFER)) keep |= T::DEPTH << T::SHIFT;
+	if (!(flags & D3DCLEAR_STENCIL)) keep |= T::STENCIL;
+	const Word value = (Word) ((depthBits | (stencil & T::STENCIL)) & ~keep);
+
+	for (int y = y0; y < y1; y++) {
+		Word* row = (Word*) (depth.bits + (size_t) y * depth.pitch);
+		if (keep == 0) std::fill(row + x0, row + x1, value);
+		else for (int x = x0; x < x1; x++) row[x] = (Word) ((row[x] & keep) | value);
+	}
+}
+
+void DepthStencil::fill(const Surface& depth, DWORD flags, float z, DWORD stencil, int x0, int y0, int x1, int y1) {
+	switch (depth.format) {
+		case D3DFMT_D24S8: ::fill<D3DFMT_D24S8>(depth, flags, z, stencil, x0, y0, x1, y1); break;
+		case D3DFMT_D24X8: ::fill<D3DFMT_D24X8>(depth, flags, z, stencil, x0, y0, x1, y1); break;
+		case D3DFMT_D24X4S4: ::fill<D3DFMT_D24X4S4>(depth, flags, z, stencil, x0, y0, x1, y1); break;
+		case D3DFMT_D16: ::fill<D3DFMT_D16>(depth, flags, z, stencil, x0, y0, x1, y1); break;
+		case D3DFMT_D15S1: ::fill<D3DFMT_D15S1>(depth, flags, z, stencil, x0, y0, x1, y1); break;
+		default: break;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "rasterizer.hpp"
+
+/**
+ * Depth and stencil testing and their writes, fused: each 4x2 block
+ * of the packed depth/stencil words is read once, tested against
+ * depth and stencil together, updated and written back once.
+ *
+ * As with the OutputMerger, every (depth format, mode) pair is a
+ * kernel of its own, built for AVX2 and for SSE2, and select() picks
+ * one per state. The common states have dedicated modes: plain
+ * less-equal depth, stencil shadow volumes (stencil ALWAYS, no depth
+ * writes, one- or two-sided) and read-only stencil masks.
+ */
+class DepthStencil {
+	public:enum Mode {
+		DEPTH_LESSEQUAL, //LESSEQUAL with depth writes, no stencil
+		DEPTH, //any depth state, no stencil
+		SHADOW, //stencil ALWAYS, no depth writes
+		STENCIL_TEST, //stencil never written
+		STENCIL
+	};
+
+	/**
+	 * Kernel for the depth format and state of "state", NULL when
+	 * neither depth nor stencil is tested.
+	 */
+	public:static DepthKernel select(const DrawState& state);
+
+	public:static Mode mode(const DrawState& state);
+
+	public:static UINT pixelSize(D3DFORMAT format);
+
+	/**
+	 * Formats the surface is kept in: D32 is stored as D24X8.
+	 */
+	public:static D3DFORMAT storage(D3DFORMAT format);
+
+	/**
+	 * Bits of stencil in "format", 0 without stencil.
+	 */
+	public:static UINT stencilBits(D3DFORMAT format);
+
+	/**
+	 * Clears "rect" of "depth": the depth, the stencil or both as
+	 * "flags" (D3DCLEAR_ZBUFFER, D3DCLEAR_STENCIL) say.
+	 */
+	public:static void fill(const Surface& depth, DWORD flags, float z, DWORD stencil, int x0, int y0, int x1, int y1);
+};
@@ -0,0 +1,153 @@
+#include "direct3dcubetexture9.hpp"
+#include "direct3ddevice9.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <format/PixelFormat.hpp>
+
+static std::atomic<uint64_t> serials = 0;
+
+Direct3DCubeTexture9::Direct3DCubeTexture9(IDirect3DDevice9* device, UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool) :
+	device(device), format(Format), usage(Usage), pool(Pool), changes(++serials) {
+	UINT count = Levels == 0 ? PixelFormat::levels(EdgeLength, EdgeLength) : Levels;
+
+	for (UINT i = 0; i < count; i++) {
+		UINT size = PixelFormat::mipSize(EdgeLength, i);
+		this->levels.push_back({size, PixelFormat::pitch(Format, size), this->faceSize});
+		this->faceSize += (PixelFormat::size(Format, size, size) + 63) & ~(size_t) 63;
+	}
+	this->surfaces.resize(count * Direct3DCubeTexture9::FACES);
+
+	const size_t total = this->faceSize * Direct3DCubeTexture9::FACES;
+	this->storage = std::shared_ptr<void>(std::aligned_alloc(64, total), std::free);
+	if (this->storage != NULL) memset(this->storage.get(), 0, total);
+
+	this->device->AddRef();
+}
+
+Direct3DCubeTexture9::~Direct3DCubeTexture9() {
+	this->device->Release();
+}
+
+HRESULT Direct3DCubeTexture9::QueryInterface(REFIID riid, void** ppvObject) {
+	if (ppvObject == NULL) return E_POINTER;
+
+	*ppvObject = NULL;
+	return E_NOINTERFACE;
+}
+
+ULONG Direct3DCubeTexture9::AddRef() {
+	return ++this->references;
+}
+
+ULONG Direct3DCubeTexture9::Release() {
+	ULONG references = --this->references;
+	if (references == 0) delete this;
+	return references;
+}
+
+DWORD Direct3DCubeTexture9::SetPriority(DWORD PriorityNew) {
+	if (this->pool != D3DPOOL_MANAGED) return 0;
+
+	DWORD old = this->priority;
+	this->priority = PriorityNew;
+	return old;
+}
+
+DWORD Direct3DCubeTexture9::GetPriority() {
+	return this->pool == D3DPOOL_MANAGED ? this->priority : 0;
+}
+
+void Direct3DCubeTexture9::PreLoad() {}
+
+D3DRESOURCETYPE Direct3DCubeTexture9::GetType() {
+	return D3DRTYPE_CUBETEXTURE;
+}
+
+DWORD Direct3DCubeTexture9::SetLOD(DWORD LODNew) {
+	if (this->pool != D3DPOOL_MANAGED) return 0;
+
+	DWORD old = this->lod;
+	this->lod = std::min<DWORD>(LODNew, this->levels.size() - 1);
+	return old;
+}
+
+DWORD Direct3DCubeTexture9::GetLOD() {
+	return this->pool == D3DPOOL_MANAGED ? this->lod : 0;
+}
+
+DWORD Direct3DCubeTexture9::GetLevelCount() {
+	return this->levels.size();
+}
+
+HRESULT Direct3DCubeTexture9::GetLevelDesc(UINT Level, D3DSURFACE_DESC* pDesc) {
+	if (pDesc == NULL || Level >= this->levels.size()) return D3DERR_INVALIDCALL;
+
+	pDesc->Format = this->format;
+	pDesc->Type = D3DRTYPE_SURFACE;
+	pDesc->Usage = this->usage;
+	pDesc->Pool = this->pool;
+	pDesc->MultiSampleType = D3DMULTISAMPLE_NONE;
+	pDesc->MultiSampleQuality = 0;
+	pDesc->Width = this->levels[Level].size;
+	pDesc->Height = this->levels[Level].size;
+	return D3D_OK;
+}
+
+BYTE* Direct3DCubeTexture9::bits(UINT face, UINT level) const {
+	if (face >= Direct3DCubeTexture9::FACES || level >= this->levels.size() || this->storage == NULL) return NULL;
+
+	return (BYTE*) this->storage.get() + face * this->faceSize + this->levels[level].offset;
+}
+
+HRESULT Direct3DCubeTexture9::GetCubeMapSurface(D3DCUBEMAP_FACES FaceType, UINT Level, IDirect3DSurface9** ppCubeMapSurface) {
+	if (ppCubeMapSurface == NULL) return D3DERR_INVALIDCALL;
+
+	*ppCubeMapSurface = NULL;
+	BYTE* bits = this->bits(FaceType, Level);
+	if (bits == NULL) return D3DERR_INVALIDCALL;
+
+	std::unique_ptr<Direct3DSurface9>& surface = this->surfaces[FaceType * this->levels.size() + Level];
+	if (surface == NULL) {
+		const Direct3DCubeTexture9::Level& storage = this->levels[Level];
+		const Surface memory = {this->format, storage.size, storage.size, storage.pitch, bits};
+		surface.reset(new (std::nothrow) Direct3DSurface9(this->device, this, FaceType, Level, memory, this->usage, this->pool));
+		if (surface == NULL) return E_OUTOFMEMORY;
+	}
+
+	surface->AddRef();
+	*ppCubeMapSurface = surface.get();
+	return D3D_OK;
+}
+
+HRESULT Direct3DCubeTexture9::LockRect(D3DCUBEMAP_FACES FaceType, UINT Level, D3DLOCKED_RECT* pLockedRect, const RECT* pRect, DWORD Flags) {
+	if (pLockedRect == NULL) return D3DERR_INVALIDCALL;
+	//rendered to, and sampled by pending draws
+	static_cast<Direct3DDevice9*>(this->device)->flush();
+
+	BYTE* bits = this->bits(FaceType, Level);
+	if (bits == NULL) return D3DERR_INVALIDCALL;
+	if (!(Flags & D3DLOCK_READONLY)) this->changes = ++serials;
+
+	const Direct3DCubeTexture9::Level& storage = this->levels[Level];
+	if (pRect != NULL) {
+		if (pRect->left < 0 || pRect->top < 0 || pRect->right > (LONG) storage.size || pRect->bottom > (LONG) storage.size
+			|| pRect->left >= pRect->right || pRect->top >= pRect->bottom) {
+			return D3DERR_INVALIDCALL;
+		}
+
+		//DXTn rectangles are addressed in 4x4 blocks
+		UINT row = PixelFormat::isCompressed(this->format) ? pRect->top / 4 : pRect->top;
+		bits += (size_t) row * storage.pitch + PixelFormat::pitch(this->format, pRect->left);
+	}
+
+	pLockedRect->pBits = bits;
+	pLockedRect->Pitch = storage.pitch;
+	return D3D_OK;
+}
+
+HRESULT Direct3DCubeTexture9::UnlockRect(D3DCUBEMAP_FACES FaceType, UINT Level) {
+	return FaceType < Direct3DCubeTexture9::FACES && Level < this->levels.size() ? D3D_OK : D3DERR_INVALIDCALL;
+}
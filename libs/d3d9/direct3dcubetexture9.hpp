@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <windows.h>
+#include <d3d9.h>
+#include "direct3dsurface9.hpp"
+
+/**
+ * Cube texture in system memory.
+ *
+ * The six faces lie one after the other in one block, each with the
+ * same level layout, so the sampler reaches a face of any level by
+ * adding face * faceSize to the level of face 0.
+ */
+class Direct3DCubeTexture9 final : public IDirect3DCubeTexture9 {
+	public:static constexpr const UINT FACES = 6;
+
+	public:struct Level {
+		UINT size;
+		UINT pitch;
+		size_t offset; //from the start of face 0
+	};
+
+	private:ULONG references = 1;
+	private:IDirect3DDevice9* device;
+	private:D3DFORMAT format;
+	private:DWORD usage;
+	private:D3DPOOL pool;
+	private:std::vector<Level> levels;
+	private:size_t faceSize = 0;
+	private:std::shared_ptr<void> storage;
+	private:DWORD priority = 0;
+	private:DWORD lod = 0;
+	private:uint64_t changes;
+	private:std::vector<std::unique_ptr<Direct3DSurface9>> surfaces; //per face and level, made by GetCubeMapSurface()
+
+	public:Direct3DCubeTexture9(IDirect3DDevice9* device, UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool);
+	public:~Direct3DCubeTexture9();
+
+	public:HRESULT QueryInterface(REFIID riid, void** ppvObject) override;
+	public:ULONG AddRef() override;
+	public:ULONG Release() override;
+
+	public:DWORD SetPriority(DWORD PriorityNew) override;
+	public:DWORD GetPriority() override;
+	public:void PreLoad() override;
+	public:D3DRESOURCETYPE GetType() override;
+
+	public:DWORD SetLOD(DWORD LODNew) override;
+	public:DWORD GetLOD() override;
+	public:DWORD GetLevelCount() override;
+	public:HRESULT GetLevelDesc(UINT Level, D3DSURFACE_DESC* pDesc) override;
+	public:HRESULT GetCubeMapSurface(D3DCUBEMAP_FACES FaceType, UINT Level, IDirect3DSurface9** ppCubeMapSurface) override;
+	public:HRESULT LockRect(D3DCUBEMAP_FACES FaceType, UINT Level, D3DLOCKED_RECT* pLockedRect, const RECT* pRect, DWORD Flags) override;
+	public:HRESULT UnlockRect(D3DCUBEMAP_FACES FaceType, UINT Level) override;
+
+	/**
+	 * Storage of "level" of face "face"; NULL when out of range or
+	 * out of memory.
+	 */
+	public:BYTE* bits(UINT face, UINT level) const;
+
+	public:const Level& level(UINT level) const {
+		return this->levels[level];
+	}
+
+	public:size_t faceStride() const {
+		return this->faceSize;
+	}
+
+	/**
+	 * Owner of the storage of every level.
+	 */
+	public:const std::shared_ptr<void>& memory() const {
+		return this->storage;
+	}
+
+	/**
+	 * Most detailed level sampling may read.
+	 */
+	public:UINT firstLevel() const {
+		return this->lod;
+	}
+
+	/**
+	 * Changes with every lock that may write a face; see
+	 * Direct3DTexture9::version().
+	 */
+	public:uint64_t version() const {
+		return this->usage & (D3DUSAGE_RENDERTARGET | D3DUSAGE_DEPTHSTENCIL) ? 0 : this->changes;
+	}
+};
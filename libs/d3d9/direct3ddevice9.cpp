@@ -0,0 +1,1261 @@
+#include "direct3ddevice9.hpp"
+#include "direct3dcubetexture9.hpp"
+#include "direct3dtexture9.hpp"
+#include "direct3dvertexbuffer9.hpp"
+#include "direct3dvolumetexture9.hpp"
+#include "depthstencil.hpp"
+#include "outputmerger.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <simd/ColorConvert.hpp>
+#include <simd/VectorMath.hpp>
+#include <thread/WorkerPool.hpp>
+
+static DWORD floatBits(float value) {
+	return std::bit_cast<uint32_t>(value);
+}
+
+static float bitsFloat(DWORD value) {
+	return std::bit_cast<float>((uint32_t) value);
+}
+
+static void colorFloats(D3DCOLOR color, float* out) {
+	out[0] = (color >> 16 & 0xFF) / 255.0f;
+	out[1] = (color >> 8 & 0xFF) / 255.0f;
+	out[2] = (color & 0xFF) / 255.0f;
+	out[3] = (color >> 24 & 0xFF) / 255.0f;
+}
+
+/**
+ * N-patch tessellations of vertex buffer draws kept at most; the cache
+ * starts over when it is full
+ */
+static constexpr size_t NPATCH_CACHE = 256;
+
+/**
+ * Bounds of vertex buffer ranges kept at most, likewise
+ */
+static constexpr size_t BOUNDS_CACHE = 4096;
+
+static constexpr D3DMATRIX IDENTITY = {{{
+	{1.0f, 0.0f, 0.0f, 0.0f},
+	{0.0f, 1.0f, 0.0f, 0.0f},
+	{0.0f, 0.0f, 1.0f, 0.0f},
+	{0.0f, 0.0f, 0.0f, 1.0f}
+}}};
+
+Direct3DDevice9::Direct3DDevice9(IDirect3D9* d3d, D3DDEVTYPE DeviceType, HWND hFocusWindow, DWORD BehaviorFlags, const D3DPRESENT_PARAMETERS* pPresentationParameters) :
+	d3d(d3d), type(DeviceType), window(hFocusWindow), behavior(BehaviorFlags),
+	softwareVertexProcessing((BehaviorFlags & D3DCREATE_SOFTWARE_VERTEXPROCESSING) != 0), presentation(*pPresentationParameters) {
+	this->d3d->AddRef();
+
+	//the back buffer's references are the device's, as with its swap chain on Windows
+	const UINT width = this->presentation.BackBufferWidth, height = this->presentation.BackBufferHeight;
+	const bool lockable = (this->presentation.Flags & D3DPRESENTFLAG_LOCKABLE_BACKBUFFER) != 0;
+	this->backBuffer = new Direct3DSurface9(this, this, width, height, this->presentation.BackBufferFormat, D3DUSAGE_RENDERTARGET, D3DPOOL_DEFAULT, lockable);
+	this->renderTargets[0] = this->backBuffer;
+
+	this->depth = {D3DFMT_D24S8, width, height, width * 4, NULL};
+	if (this->presentation.EnableAutoDepthStencil) {
+		const D3DFORMAT format = DepthStencil::storage(this->presentation.AutoDepthStencilFormat);
+		const UINT depthPitch = (width * DepthStencil::pixelSize(format) + 3) & ~3u;
+		this->depthBuffer.resize((size_t) depthPitch / 4 * height);
+		this->depth = {format, width, height, depthPitch, (BYTE*) this->depthBuffer.data()};
+	}
+
+	for (D3DMATRIX& matrix : this->world) matrix = IDENTITY;
+	this->blendDirty.set();
+	for (D3DMATRIX& matrix : this->texture) matrix = IDENTITY;
+	this->view = IDENTITY;
+	this->projection = IDENTITY;
+	this->viewport = {0, 0, width, height, 0.0f, 1.0f};
+
+	DWORD* rs = this->renderStates;
+	rs[D3DRS_ZENABLE] = this->presentation.EnableAutoDepthStencil ? D3DZB_TRUE : D3DZB_FALSE;
+	rs[D3DRS_FILLMODE] = D3DFILL_SOLID;
+	rs[D3DRS_SHADEMODE] = D3DSHADE_GOURAUD;
+	rs[D3DRS_ZWRITEENABLE] = TRUE;
+	rs[D3DRS_LASTPIXEL] = TRUE;
+	rs[D3DRS_SRCBLEND] = D3DBLEND_ONE;
+	rs[D3DRS_DESTBLEND] = D3DBLEND_ZERO;
+	rs[D3DRS_CULLMODE] = D3DCULL_CCW;
+	rs[D3DRS_ZFUNC] = D3DCMP_LESSEQUAL;
+	rs[D3DRS_ALPHAFUNC] = D3DCMP_ALWAYS;
+	rs[D3DRS_FOGEND] = floatBits(1.0f);
+	rs[D3DRS_FOGDENSITY] = floatBits(1.0f);
+	rs[D3DRS_STENCILFAIL] = D3DSTENCILOP_KEEP;
+	rs[D3DRS_STENCILZFAIL] = D3DSTENCILOP_KEEP;
+	rs[D3DRS_STENCILPASS] = D3DSTENCILOP_KEEP;
+	rs[D3DRS_STENCILFUNC] = D3DCMP_ALWAYS;
+	rs[D3DRS_STENCILMASK] = 0xFFFFFFFF;
+	rs[D3DRS_STENCILWRITEMASK] = 0xFFFFFFFF;
+	rs[D3DRS_TEXTUREFACTOR] = 0xFFFFFFFF;
+	rs[D3DRS_CLIPPING] = TRUE;
+	rs[D3DRS_LIGHTING] = TRUE;
+	rs[D3DRS_COLORVERTEX] = TRUE;
+	rs[D3DRS_LOCALVIEWER] = TRUE;
+	rs[D3DRS_DIFFUSEMATERIALSOURCE] = D3DMCS_COLOR1;
+	rs[D3DRS_SPECULARMATERIALSOURCE] = D3DMCS_COLOR2;
+	rs[D3DRS_VERTEXBLEND] = D3DVBF_DISABLE;
+	rs[D3DRS_POINTSIZE] = floatBits(1.0f);
+	rs[D3DRS_POINTSIZE_MIN] = floatBits(1.0f);
+	rs[D3DRS_POINTSCALE_A] = floatBits(1.0f);
+	rs[D3DRS_MULTISAMPLEANTIALIAS] = TRUE;
+	rs[D3DRS_MULTISAMPLEMASK] = 0xFFFFFFFF;
+	rs[D3DRS_POINTSIZE_MAX] = floatBits(64.0f);
+	rs[D3DRS_COLORWRITEENABLE] = 0xF;
+	rs[D3DRS_BLENDOP] = D3DBLENDOP_ADD;
+	rs[D3DRS_POSITIONDEGREE] = D3DDEGREE_CUBIC;
+	rs[D3DRS_NORMALDEGREE] = D3DDEGREE_LINEAR;
+	rs[D3DRS_MINTESSELLATIONLEVEL] = floatBits(1.0f);
+	rs[D3DRS_MAXTESSELLATIONLEVEL] = floatBits(1.0f);
+	rs[D3DRS_ADAPTIVETESS_Z] = floatBits(1.0f);
+	rs[D3DRS_CCW_STENCILFAIL] = D3DSTENCILOP_KEEP;
+	rs[D3DRS_CCW_STENCILZFAIL] = D3DSTENCILOP_KEEP;
+	rs[D3DRS_CCW_STENCILPASS] = D3DSTENCILOP_KEEP;
+	rs[D3DRS_CCW_STENCILFUNC] = D3DCMP_ALWAYS;
+	rs[D3DRS_COLORWRITEENABLE1] = 0xF;
+	rs[D3DRS_COLORWRITEENABLE2] = 0xF;
+	rs[D3DRS_COLORWRITEENABLE3] = 0xF;
+	rs[D3DRS_BLENDFACTOR] = 0xFFFFFFFF;
+	rs[D3DRS_SRCBLENDALPHA] = D3DBLEND_ONE;
+	rs[D3DRS_DESTBLENDALPHA] = D3DBLEND_ZERO;
+	rs[D3DRS_BLENDOPALPHA] = D3DBLENDOP_ADD;
+
+	for (UINT stage = 0; stage < maxTextureStages; stage++) {
+		DWORD* tss = this->textureStageStates[stage];
+		tss[D3DTSS_COLOROP] = stage == 0 ? D3DTOP_MODULATE : D3DTOP_DISABLE;
+		tss[D3DTSS_COLORARG1] = D3DTA_TEXTURE;
+		tss[D3DTSS_COLORARG2] = D3DTA_CURRENT;
+		tss[D3DTSS_ALPHAOP] = stage == 0 ? D3DTOP_SELECTARG1 : D3DTOP_DISABLE;
+		tss[D3DTSS_ALPHAARG1] = D3DTA_TEXTURE;
+		tss[D3DTSS_ALPHAARG2] = D3DTA_CURRENT;
+		tss[D3DTSS_TEXCOORDINDEX] = stage;
+		tss[D3DTSS_TEXTURETRANSFORMFLAGS] = D3DTTFF_DISABLE;
+		tss[D3DTSS_COLORARG0] = D3DTA_CURRENT;
+		tss[D3DTSS_ALPHAARG0] = D3DTA_CURRENT;
+		tss[D3DTSS_RESULTARG] = D3DTA_CURRENT;
+	}
+
+	for (DWORD* sampler : this->samplerStates) {
+		sampler[D3DSAMP_ADDRESSU] = D3DTADDRESS_WRAP;
+		sampler[D3DSAMP_ADDRESSV] = D3DTADDRESS_WRAP;
+		sampler[D3DSAMP_ADDRESSW] = D3DTADDRESS_WRAP;
+		sampler[D3DSAMP_MAGFILTER] = D3DTEXF_POINT;
+		sampler[D3DSAMP_MINFILTER] = D3DTEXF_POINT;
+		sampler[D3DSAMP_MAXANISOTROPY] = 1;
+	}
+}
+
+Direct3DDevice9::~Direct3DDevice9() {
+	for (IDirect3DBaseTexture9* texture : this->textures) {
+		if (texture != NULL) texture->Release();
+	}
+	for (Stream& stream : this->streams) {
+		if (stream.buffer != NULL) stream.buffer->Release();
+	}
+	for (Direct3DSurface9* target : this->renderTargets) {
+		if (target != NULL && target != this->backBuffer) target->Release();
+	}
+	delete this->backBuffer;
+	if (this->cursor != NULL) g_object_unref(this->cursor);
+	if (this->hiddenCursor != NULL) g_object_unref(this->hiddenCursor);
+
+	this->d3d->Release();
+}
+
+HRESULT Direct3DDevice9::QueryInterface(REFIID riid, void** ppvObject) {
+	if (ppvObject == NULL) return E_POINTER;
+
+	*ppvObject = NULL;
+	return E_NOINTERFACE;
+}
+
+ULONG Direct3DDevice9::AddRef() {
+	return ++this->references;
+}
+
+ULONG Direct3DDevice9::Release() {
+	ULONG references = --this->references;
+	if (references == 0) delete this;
+	return references;
+}
+
+HRESULT Direct3DDevice9::CreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle) {
+	if (ppTexture == NULL || Width == 0 || Height == 0 || pSharedHandle != NULL)
+		return D3DERR_INVALIDCALL;
+	if (FAILED(this->d3d->CheckDeviceFormat(D3DADAPTER_DEFAULT, this->type, D3DFMT_X8R8G8B8, Usage, D3DRTYPE_TEXTURE, Format)))
+		return D3DERR_INVALIDCALL;
+	if ((Usage & (D3DUSAGE_RENDERTARGET | D3DUSAGE_DEPTHSTENCIL)) && Pool != D3DPOOL_DEFAULT)
+		return D3DERR_INVALIDCALL;
+
+	*ppTexture = new (std::nothrow) Direct3DTexture9(this, Width, Height, Levels, Usage, Format, Pool);
+	return *ppTexture != NULL ? D3D_OK : E_OUTOFMEMORY;
+}
+
+HRESULT Direct3DDevice9::CreateVolumeTexture(UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DVolumeTexture9** ppVolumeTexture, HANDLE* pSharedHandle) {
+	if (ppVolumeTexture == NULL || Width == 0 || Height == 0 || Depth == 0 || pSharedHandle != NULL)
+		return D3DERR_INVALIDCALL;
+	if (FAILED(this->d3d->CheckDeviceFormat(D3DADAPTER_DEFAULT, this->type, D3DFMT_X8R8G8B8, Usage, D3DRTYPE_VOLUMETEXTURE, Format)))
+		return D3DERR_INVALIDCALL;
+
+	Direct3DVolumeTexture9* texture = new (std::nothrow) Direct3DVolumeTexture9(this, Width, Height, Depth, Levels, Usage, Format, Pool);
+	if (texture != NULL && texture->level(0).bits == NULL) {
+		texture->Release();
+		texture = NULL;
+	}
+
+	*ppVolumeTexture = texture;
+	return texture != NULL ? D3D_OK : E_OUTOFMEMORY;
+}
+
+HRESULT Direct3DDevice9::CreateCubeTexture(UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DCubeTexture9** ppCubeTexture, HANDLE* pSharedHandle) {
+	if (ppCubeTexture == NULL || EdgeLength == 0 || pSharedHandle != NULL)
+		return D3DERR_INVALIDCALL;
+	if (FAILED(this->d3d->CheckDeviceFormat(D3DADAPTER_DEFAULT, this->type, D3DFMT_X8R8G8B8, Usage, D3DRTYPE_CUBETEXTURE, Format)))
+		return D3DERR_INVALIDCALL;
+	if ((Usage & (D3DUSAGE_RENDERTARGET | D3DUSAGE_DEPTHSTENCIL)) && Pool != D3DPOOL_DEFAULT)
+		return D3DERR_INVALIDCALL;
+
+	Direct3DCubeTexture9* texture = new (std::nothrow) Direct3DCubeTexture9(this, EdgeLength, Levels, Usage, Format, Pool);
+	if (texture != NULL && texture->bits(0, 0) == NULL) {
+		texture->Release();
+		texture = NULL;
+	}
+
+	*ppCubeTexture = texture;
+	return texture != NULL ? D3D_OK : E_OUTOFMEMORY;
+}
+
+HRESULT Direct3DDevice9::CreateVertexBuffer(UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool, IDirect3DVertexBuffer9** ppVertexBuffer, HANDLE* pSharedHandle) {
+	if (ppVertexBuffer == NULL || Length == 0 || pSharedHandle != NULL || Pool == D3DPOOL_SCRATCH)
+		return D3DERR_INVALIDCALL;
+	if (FVF != 0 && Length < VertexStage::size(FVF))
+		return D3DERR_INVALIDCALL;
+
+	Direct3DVertexBuffer9* buffer = new (std::nothrow) Direct3DVertexBuffer9(this, Length, Usage, FVF, Pool);
+	if (buffer != NULL && buffer->data() == NULL) {
+		buffer->Release();
+		buffer = NULL;
+	}
+
+	*ppVertexBuffer = buffer;
+	return buffer != NULL ? D3D_OK : E_OUTOFMEMORY;
+}
+
+HRESULT Direct3DDevice9::CreateRenderTarget(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle) {
+	if (ppSurface == NULL || Width == 0 || Height == 0 || pSharedHandle != NULL) return D3DERR_INVALIDCALL;
+	if (!OutputMerger::isRenderTarget(Format) || MultiSample != D3DMULTISAMPLE_NONE) return D3DERR_INVALIDCALL;
+
+	Direct3DSurface9* surface = new (std::nothrow) Direct3DSurface9(this, NULL, Width, Height, Format, D3DUSAGE_RENDERTARGET, D3DPOOL_DEFAULT, Lockable);
+	if (surface != NULL && surface->surface().bits == NULL) {
+		surface->Release();
+		surface = NULL;
+	}
+
+	*ppSurface = surface;
+	return surface != NULL ? D3D_OK : E_OUTOFMEMORY;
+}
+
+/**
+ * What was drawn to the previous target is rendered first: it may be
+ * released or sampled next.
+ */
+HRESULT Direct3DDevice9::SetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget) {
+	if (RenderTargetIndex >= DrawState::MAX_TARGETS || (RenderTargetIndex == 0 && pRenderTarget == NULL)) return D3DERR_INVALIDCALL;
+
+	Direct3DSurface9* target = static_cast<Direct3DSurface9*>(pRenderTarget);
+	if (target != NULL && (!target->isRenderTarget() || !OutputMerger::isRenderTarget(target->surface().format))) return D3DERR_INVALIDCALL;
+
+	Direct3DSurface9*& slot = this->renderTargets[RenderTargetIndex];
+	if (slot == target) return D3D_OK;
+
+	this->rasterizer.flush();
+	if (target != NULL && target != this->backBuffer) target->AddRef();
+	if (slot != NULL && slot != this->backBuffer) slot->Release();
+	slot = target;
+
+	//the viewport covers a new first target
+	if (RenderTargetIndex == 0) this->viewport = {0, 0, target->surface().width, target->surface().height, 0.0f, 1.0f};
+	this->stateDirty = true;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::GetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9** ppRenderTarget) {
+	if (ppRenderTarget == NULL || RenderTargetIndex >= DrawState::MAX_TARGETS) return D3DERR_INVALIDCALL;
+
+	*ppRenderTarget = this->renderTargets[RenderTargetIndex];
+	if (*ppRenderTarget == NULL) return D3DERR_NOTFOUND;
+
+	(*ppRenderTarget)->AddRef();
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::GetBackBuffer(UINT iSwapChain, UINT iBackBuffer, D3DBACKBUFFER_TYPE Type, IDirect3DSurface9** ppBackBuffer) {
+	if (ppBackBuffer == NULL || iSwapChain != 0 || iBackBuffer != 0 || Type != D3DBACKBUFFER_TYPE_MONO) return D3DERR_INVALIDCALL;
+
+	this->backBuffer->AddRef();
+	*ppBackBuffer = this->backBuffer;
+	return D3D_OK;
+}
+
+void Direct3DDevice9::flush() {
+	this->rasterizer.flush();
+}
+
+UINT Direct3DDevice9::targets(Surface* out, UINT* slots) const {
+	const Surface& first = this->renderTargets[0]->surface();
+	UINT count = 0;
+
+	for (UINT i = 0; i < DrawState::MAX_TARGETS; i++) {
+		if (this->renderTargets[i] == NULL) continue;
+
+		const Surface& surface = this->renderTargets[i]->surface();
+		if (surface.width != first.width || surface.height != first.height) continue;
+
+		out[count] = surface;
+		slots[count++] = i;
+	}
+	return count;
+}
+
+Surface Direct3DDevice9::depthSurface() const {
+	const Surface& target = this->renderTargets[0]->surface();
+	Surface depth = this->depth;
+	if (depth.width < target.width || depth.height < target.height) depth.bits = NULL;
+	return depth;
+}
+
+HRESULT Direct3DDevice9::BeginScene() {
+	if (this->inScene) return D3DERR_INVALIDCALL;
+
+	this->inScene = true;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::EndScene() {
+	if (!this->inScene) return D3DERR_INVALIDCALL;
+
+	this->inScene = false;
+	return D3D_OK;
+}
+
+/**
+ * Storage of a SetTransform() matrix, NULL for an unknown one.
+ */
+D3DMATRIX* Direct3DDevice9::transform(D3DTRANSFORMSTATETYPE State) {
+	if (State == D3DTS_VIEW) return &this->view;
+	if (State == D3DTS_PROJECTION) return &this->projection;
+	if (State >= D3DTS_TEXTURE0 && State <= D3DTS_TEXTURE7) return &this->texture[State - D3DTS_TEXTURE0];
+	if (State >= D3DTS_WORLD && State < D3DTS_WORLDMATRIX(maxWorldMatrices)) return &this->world[State - D3DTS_WORLD];
+	return NULL;
+}
+
+HRESULT Direct3DDevice9::SetTransform(D3DTRANSFORMSTATETYPE State, const D3DMATRIX* pMatrix) {
+	D3DMATRIX* matrix = this->transform(State);
+	if (matrix == NULL || pMatrix == NULL) return D3DERR_INVALIDCALL;
+
+	*matrix = *pMatrix;
+	if (State == D3DTS_PROJECTION) this->stateDirty = true; //it picks depth or distance fog
+	if (State == D3DTS_VIEW) this->blendDirty.set();
+	if (State >= D3DTS_WORLD && State < D3DTS_WORLDMATRIX(maxWorldMatrices)) this->blendDirty.set(State - D3DTS_WORLD);
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::GetTransform(D3DTRANSFORMSTATETYPE State, D3DMATRIX* pMatrix) {
+	D3DMATRIX* matrix = this->transform(State);
+	if (matrix == NULL || pMatrix == NULL) return D3DERR_INVALIDCALL;
+
+	*pMatrix = *matrix;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::SetViewport(const D3DVIEWPORT9* pViewport) {
+	if (pViewport == NULL || pViewport->Width == 0 || pViewport->Height == 0) return D3DERR_INVALIDCALL;
+	const Surface& target = this->renderTargets[0]->surface();
+	if (pViewport->X + pViewport->Width > target.width || pViewport->Y + pViewport->Height > target.height) return D3DERR_INVALIDCALL;
+	if (!(pViewport->MinZ >= 0.0f && pViewport->MinZ <= pViewport->MaxZ && pViewport->MaxZ <= 1.0f)) return D3DERR_INVALIDCALL;
+
+	this->viewport = *pViewport;
+	this->stateDirty = true;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::GetViewport(D3DVIEWPORT9* pViewport) {
+	if (pViewport == NULL) return D3DERR_INVALIDCALL;
+
+	*pViewport = this->viewport;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::SetMaterial(const D3DMATERIAL9* pMaterial) {
+	if (pMaterial == NULL) return D3DERR_INVALIDCALL;
+
+	this->material = *pMaterial;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::GetMaterial(D3DMATERIAL9* pMaterial) {
+	if (pMaterial == NULL) return D3DERR_INVALIDCALL;
+
+	*pMaterial = this->material;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::SetLight(DWORD Index, const D3DLIGHT9* pLight) {
+	if (pLight == NULL || pLight->Type < D3DLIGHT_POINT || pLight->Type > D3DLIGHT_DIRECTIONAL) return D3DERR_INVALIDCALL;
+	if (pLight->Type != D3DLIGHT_DIRECTIONAL && !(pLight->Range >= 0.0f)) return D3DERR_INVALIDCALL;
+
+	auto found = this->lights.find(Index);
+	if (found == this->lights.end()) this->lights[Index] = {*pLight, false};
+	else found->second.light = *pLight;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::GetLight(DWORD Index, D3DLIGHT9* pLight) {
+	auto found = this->lights.find(Index);
+	if (pLight == NULL || found == this->lights.end()) return D3DERR_INVALIDCALL;
+
+	*pLight = found->second.light;
+	return D3D_OK;
+}
+
+/**
+ * Enabling a light that was never set creates the default one: a
+ * white directional light shining along +z.
+ */
+HRESULT Direct3DDevice9::LightEnable(DWORD Index, BOOL Enable) {
+	auto found = this->lights.find(Index);
+
+	if (found == this->lights.end()) {
+		if (!Enable) return D3D_OK;
+
+		D3DLIGHT9 light = {};
+		light.Type = D3DLIGHT_DIRECTIONAL;
+		light.Diffuse = {1.0f, 1.0f, 1.0f, 0.0f};
+		light.Direction = {0.0f, 0.0f, 1.0f};
+		found = this->lights.emplace(Index, LightSlot{light, false}).first;
+	}
+
+	if (Enable && !found->second.enabled) {
+		UINT enabled = 0;
+		for (const auto& [index, slot] : this->lights) enabled += slot.enabled;
+		if (enabled >= maxActiveLights) return D3DERR_INVALIDCALL;
+	}
+
+	found->second.enabled = Enable;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::GetLightEnable(DWORD Index, BOOL* pEnable) {
+	auto found = this->lights.find(Index);
+	if (pEnable == NULL || found == this->lights.end()) return D3DERR_INVALIDCALL;
+
+	*pEnable = found->second.enabled;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::SetRenderState(D3DRENDERSTATETYPE State, DWORD Value) {
+	if ((UINT) State >= sizeof(this->renderStates) / sizeof(this->renderStates[0])) return D3DERR_INVALIDCALL;
+
+	this->renderStates[State] = Value;
+	this->stateDirty = true;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::GetRenderState(D3DRENDERSTATETYPE State, DWORD* pValue) {
+	if ((UINT) State >= sizeof(this->renderStates) / sizeof(this->renderStates[0]) || pValue == NULL) return D3DERR_INVALIDCALL;
+
+	*pValue = this->renderStates[State];
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::SetSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD Value) {
+	if (Sampler >= maxSamplers || Type < D3DSAMP_ADDRESSU || Type > D3DSAMP_DMAPOFFSET) return D3DERR_INVALIDCALL;
+
+	this->samplerStates[Sampler][Type] = Value;
+	this->stateDirty = true;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::SetTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture) {
+	if (Stage >= maxSamplers) return D3DERR_INVALIDCALL;
+
+	if (pTexture != NULL) pTexture->AddRef();
+	if (this->textures[Stage] != NULL) this->textures[Stage]->Release();
+	this->textures[Stage] = pTexture;
+	this->stateDirty = true;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::GetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD* pValue) {
+	if (Stage >= maxTextureStages || Type < D3DTSS_COLOROP || Type > D3DTSS_CONSTANT || pValue == NULL) return D3DERR_INVALIDCALL;
+
+	*pValue = this->textureStageStates[Stage][Type];
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::SetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value) {
+	if (Stage >= maxTextureStages || Type < D3DTSS_COLOROP || Type > D3DTSS_CONSTANT) return D3DERR_INVALIDCALL;
+
+	this->textureStageStates[Stage][Type] = Value;
+	this->stateDirty = true;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::SetFVF(DWORD FVF) {
+	this->fvf = FVF;
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::SetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer9* pStreamData, UINT OffsetInBytes, UINT Stride) {
+	if (StreamNumber >= maxStreams) return D3DERR_INVALIDCALL;
+
+	Stream& stream = this->streams[StreamNumber];
+	if (pStreamData != NULL) pStreamData->AddRef();
+	if (stream.buffer != NULL) stream.buffer->Release();
+	stream = {static_cast<Direct3DVertexBuffer9*>(pStreamData), OffsetInBytes, Stride};
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::GetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer9** ppStreamData, UINT* pOffsetInBytes, UINT* pStride) {
+	if (StreamNumber >= maxStreams || ppStreamData == NULL || pOffsetInBytes == NULL || pStride == NULL) return D3DERR_INVALIDCALL;
+
+	const Stream& stream = this->streams[StreamNumber];
+	if (stream.buffer != NULL) stream.buffer->AddRef();
+	*ppStreamData = stream.buffer;
+	*pOffsetInBytes = stream.offset;
+	*pStride = stream.stride;
+	return D3D_OK;
+}
+
+/**
+ * Vertex processing always runs on the CPU, multithreaded: the mode
+ * is only kept for the application, which may only change it on a
+ * D3DCREATE_MIXED_VERTEXPROCESSING device.
+ */
+HRESULT Direct3DDevice9::SetSoftwareVertexProcessing(BOOL bSoftware) {
+	if (!(this->behavior & D3DCREATE_MIXED_VERTEXPROCESSING)) return D3DERR_INVALIDCALL;
+
+	this->softwareVertexProcessing = bSoftware != FALSE;
+	return D3D_OK;
+}
+
+BOOL Direct3DDevice9::GetSoftwareVertexProcessing() {
+	return this->softwareVertexProcessing;
+}
+
+/**
+ * Segments of each N-patch edge; less than 1 turns N-patches off.
+ */
+HRESULT Direct3DDevice9::SetNPatchMode(float nSegments) {
+	this->nPatchSegments = nSegments;
+	return D3D_OK;
+}
+
+float Direct3DDevice9::GetNPatchMode() {
+	return this->nPatchSegments;
+}
+
+//--- drawing
+
+/**
+ * Inverse transpose of "m", which is "m" itself for rotations (and
+ * is kept when "m" has no inverse).
+ */
+static void normalMatrix(D3DMATRIX& out, const D3DMATRIX& m) {
+	D3DMATRIX inverse;
+	if (!VectorMath::inverse(inverse, NULL, m)) {
+		out = m;
+		return;
+	}
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) out.m[i][j] = inverse.m[j][i];
+	}
+}
+
+VertexState Direct3DDevice9::vertexState() {
+	const DWORD* rs = this->renderStates;
+	VertexState state;
+
+	state.fvf = this->fvf;
+	VectorMath::multiply(state.worldView, this->world[0], this->view);
+	VectorMath::multiply(state.worldViewProjection, state.worldView, this->projection);
+	state.viewportHeight = this->viewport.Height;
+
+	//XYZB1 to XYZB5 carry 1 to 5 betas: weights, then the matrix indices when the last beta holds them
+	const DWORD position = this->fvf & D3DFVF_POSITION_MASK;
+	const UINT betas = position >= D3DFVF_XYZB1 && position <= D3DFVF_XYZB5 ? (position - D3DFVF_XYZRHW) / 2 : 0;
+	const bool indices = betas > 0 && (this->fvf & (D3DFVF_LASTBETA_UBYTE4 | D3DFVF_LASTBETA_D3DCOLOR));
+	const DWORD blend = rs[D3DRS_VERTEXBLEND];
+	const UINT matrices = blend == D3DVBF_0WEIGHTS ? 1 : blend >= D3DVBF_1WEIGHTS && blend <= D3DVBF_3WEIGHTS ? blend + 1 : 0;
+
+	//without indices, one matrix is world[0] alone: no blending
+	state.indexedBlend = indices && rs[D3DRS_INDEXEDVERTEXBLENDENABLE] != FALSE;
+	state.blendMatrices = betas > 0 ? std::min(matrices, betas - (indices ? 1 : 0) + 1) : 0;
+	if (state.blendMatrices == 1 && !state.indexedBlend) state.blendMatrices = 0;
+	state.blendWorldView = this->blendWorldView;
+	state.blendNormal = this->blendNormal;
+	state.projection = this->projection;
+
+	const UINT palette = state.indexedBlend ? maxWorldMatrices : state.blendMatrices;
+	for (UINT i = 0; i < palette; i++) {
+		if (!this->blendDirty[i]) continue;
+		VectorMath::multiply(this->blendWorldView[i], this->world[i], this->view);
+		normalMatrix(this->blendNormal[i], this->blendWorldView[i]);
+		this->blendDirty.reset(i);
+	}
+
+	state.pointSizeMax = std::min(bitsFloat(rs[D3DRS_POINTSIZE_MAX]), 64.0f);
+	state.pointSizeMin = std::min(bitsFloat(rs[D3DRS_POINTSIZE_MIN]), state.pointSizeMax);
+	state.pointSize = bitsFloat(rs[D3DRS_POINTSIZE]);
+	state.pointScale = rs[D3DRS_POINTSCALEENABLE] != FALSE;
+	state.pointScaleA = bitsFloat(rs[D3DRS_POINTSCALE_A]);
+	state.pointScaleB = bitsFloat(rs[D3DRS_POINTSCALE_B]);
+	state.pointScaleC = bitsFloat(rs[D3DRS_POINTSCALE_C]);
+
+	const bool transformed = VertexStage::isTransformed(this->fvf);
+	state.lighting = rs[D3DRS_LIGHTING] != FALSE && !transformed;
+	state.specular = rs[D3DRS_SPECULARENABLE] != FALSE;
+	state.normalizeNormals = rs[D3DRS_NORMALIZENORMALS] != FALSE;
+	state.localViewer = rs[D3DRS_LOCALVIEWER] != FALSE;
+
+	//normals go through the inverse transpose, which is worldView itself for rotations
+	normalMatrix(state.normal, state.worldView);
+
+	//vertex colors replace material colors only when the FVF has them
+	auto source = [&](DWORD value) {
+		if (rs[D3DRS_COLORVERTEX] == FALSE) return D3DMCS_MATERIAL;
+		if (value == D3DMCS_COLOR1 && (this->fvf & D3DFVF_DIFFUSE)) return D3DMCS_COLOR1;
+		if (value == D3DMCS_COLOR2 && (this->fvf & D3DFVF_SPECULAR)) return D3DMCS_COLOR2;
+		return D3DMCS_MATERIAL;
+	};
+	state.material = this->material;
+	state.diffuseSource = source(rs[D3DRS_DIFFUSEMATERIALSOURCE]);
+	state.ambientSource = source(rs[D3DRS_AMBIENTMATERIALSOURCE]);
+	state.specularSource = source(rs[D3DRS_SPECULARMATERIALSOURCE]);
+	state.emissiveSource = source(rs[D3DRS_EMISSIVEMATERIALSOURCE]);
+
+	const D3DCOLOR ambient = rs[D3DRS_AMBIENT];
+	state.ambient[0] = (ambient >> 16 & 0xFF) / 255.0f;
+	state.ambient[1] = (ambient >> 8 & 0xFF) / 255.0f;
+	state.ambient[2] = (ambient & 0xFF) / 255.0f;
+
+	//lights are set in world space and lit in eye space
+	state.lightCount = 0;
+	for (const auto& [index, slot] : this->lights) {
+		if (!slot.enabled || state.lightCount == maxActiveLights) continue;
+
+		const D3DLIGHT9& in = slot.light;
+		Light& light = state.lights[state.lightCount++];
+		light.type = in.Type;
+		const D3DCOLORVALUE* colors[3] = {&in.Diffuse, &in.Specular, &in.Ambient};
+		float* outs[3] = {light.diffuse, light.specular, light.ambient};
+		for (int k = 0; k < 3; k++) {
+			outs[k][0] = colors[k]->r;
+			outs[k][1] = colors[k]->g;
+			outs[k][2] = colors[k]->b;
+		}
+
+		VectorMath::transformOne<VectorMath::NORMAL>(light.direction, &in.Direction.x, this->view);
+		const float length = std::sqrt(light.direction[0] * light.direction[0] + light.direction[1] * light.direction[1] + light.direction[2] * light.direction[2]);
+		if (length > 0.0f) {
+			for (float& c : light.direction) c /= length;
+		}
+
+		float position[4];
+		VectorMath::transformOne<VectorMath::POINT>(position, &in.Position.x, this->view);
+		memcpy(light.position, position, sizeof(light.position));
+
+		light.range = in.Range;
+		light.attenuation[0] = in.Attenuation0;
+		light.attenuation[1] = in.Attenuation1;
+		light.attenuation[2] = in.Attenuation2;
+		light.falloff = in.Falloff;
+		light.cosTheta = std::cos(in.Theta * 0.5f);
+		light.cosPhi = std::cos(in.Phi * 0.5f);
+	}
+
+	//table fog wins over vertex fog; pre-transformed vertices bring their own
+	state.fog = rs[D3DRS_FOGENABLE] != FALSE && rs[D3DRS_FOGTABLEMODE] == D3DFOG_NONE && rs[D3DRS_FOGVERTEXMODE] != D3DFOG_NONE && !transformed;
+	state.rangeFog = rs[D3DRS_RANGEFOGENABLE] != FALSE;
+	state.fogParameters = {(D3DFOGMODE) rs[D3DRS_FOGVERTEXMODE], bitsFloat(rs[D3DRS_FOGSTART]), bitsFloat(rs[D3DRS_FOGEND]), bitsFloat(rs[D3DRS_FOGDENSITY])};
+
+	state.textureStages = 0;
+	while (state.textureStages < maxTextureStages && this->textureStageStates[state.textureStages][D3DTSS_COLOROP] != D3DTOP_DISABLE) state.textureStages++;
+	for (UINT t = 0; t < state.textureStages; t++) {
+		state.texCoordIndex[t] = this->textureStageStates[t][D3DTSS_TEXCOORDINDEX];
+		state.textureTransform[t] = this->textureStageStates[t][D3DTSS_TEXTURETRANSFORMFLAGS];
+		state.textureMatrix[t] = this->texture[t];
+	}
+	return state;
+}
+
+DrawState Direct3DDevice9::drawState() const {
+	const DWORD* rs = this->renderStates;
+	DrawState state;
+
+	UINT slots[DrawState::MAX_TARGETS];
+	state.targetCount = this->targets(state.targets, slots);
+	state.depth = this->depthSurface();
+	state.viewport = this->viewport;
+	state.clip = {(LONG) this->viewport.X, (LONG) this->viewport.Y, (LONG) (this->viewport.X + this->viewport.Width), (LONG) (this->viewport.Y + this->viewport.Height)};
+
+	state.cull = (D3DCULL) rs[D3DRS_CULLMODE];
+	state.fill = (D3DFILLMODE) rs[D3DRS_FILLMODE];
+	state.flat = rs[D3DRS_SHADEMODE] == D3DSHADE_FLAT;
+	state.lastPixel = rs[D3DRS_LASTPIXEL] != FALSE;
+	state.pointSprite = rs[D3DRS_POINTSPRITEENABLE] != FALSE;
+	state.specular = rs[D3DRS_SPECULARENABLE] != FALSE;
+
+	const D3DCOLOR fog = rs[D3DRS_FOGCOLOR];
+	state.fog = rs[D3DRS_FOGENABLE] != FALSE;
+	state.fogTable = rs[D3DRS_FOGTABLEMODE] != D3DFOG_NONE;
+	state.fogW = this->projection.m[2][3] != 0.0f; //perspective projections fog by eye distance
+	state.fogParameters = {(D3DFOGMODE) rs[D3DRS_FOGTABLEMODE], bitsFloat(rs[D3DRS_FOGSTART]), bitsFloat(rs[D3DRS_FOGEND]), bitsFloat(rs[D3DRS_FOGDENSITY])};
+	state.fogColor[0] = (fog >> 16 & 0xFF) / 255.0f;
+	state.fogColor[1] = (fog >> 8 & 0xFF) / 255.0f;
+	state.fogColor[2] = (fog & 0xFF) / 255.0f;
+
+	state.zEnable = rs[D3DRS_ZENABLE] != D3DZB_FALSE && state.depth.bits != NULL;
+	state.zWrite = state.zEnable && rs[D3DRS_ZWRITEENABLE] != FALSE;
+	state.zFunc = (D3DCMPFUNC) rs[D3DRS_ZFUNC];
+
+	//CCW_* apply to counter-clockwise triangles in two-sided mode only
+	state.stencil = rs[D3DRS_STENCILENABLE] != FALSE && DepthStencil::stencilBits(state.depth.format) != 0 && state.depth.bits != NULL;
+	const bool twoSided = rs[D3DRS_TWOSIDEDSTENCILMODE] != FALSE;
+	for (int face = 0; face < 2; face++) {
+		const bool ccw = face == 1 && twoSided;
+		state.stencilFunc[face] = (D3DCMPFUNC) rs[ccw ? D3DRS_CCW_STENCILFUNC : D3DRS_STENCILFUNC];
+		state.stencilFail[face] = (D3DSTENCILOP) rs[ccw ? D3DRS_CCW_STENCILFAIL : D3DRS_STENCILFAIL];
+		state.stencilZFail[face] = (D3DSTENCILOP) rs[ccw ? D3DRS_CCW_STENCILZFAIL : D3DRS_STENCILZFAIL];
+		state.stencilPass[face] = (D3DSTENCILOP) rs[ccw ? D3DRS_CCW_STENCILPASS : D3DRS_STENCILPASS];
+	}
+	state.stencilRef = rs[D3DRS_STENCILREF];
+	state.stencilMask = rs[D3DRS_STENCILMASK];
+	state.stencilWriteMask = rs[D3DRS_STENCILWRITEMASK];
+
+	state.alphaTest = rs[D3DRS_ALPHATESTENABLE] != FALSE;
+	state.alphaFunc = (D3DCMPFUNC) rs[D3DRS_ALPHAFUNC];
+	state.alphaRef = rs[D3DRS_ALPHAREF] & 0xFF;
+
+	state.blend = rs[D3DRS_ALPHABLENDENABLE] != FALSE;
+	state.srcBlend = (D3DBLEND) rs[D3DRS_SRCBLEND];
+	state.destBlend = (D3DBLEND) rs[D3DRS_DESTBLEND];
+	state.blendOp = (D3DBLENDOP) rs[D3DRS_BLENDOP];
+
+	//BOTH* set the destination factor along with the source one
+	if (state.srcBlend == D3DBLEND_BOTHSRCALPHA) {
+		state.srcBlend = D3DBLEND_SRCALPHA;
+		state.destBlend = D3DBLEND_INVSRCALPHA;
+	} else if (state.srcBlend == D3DBLEND_BOTHINVSRCALPHA) {
+		state.srcBlend = D3DBLEND_INVSRCALPHA;
+		state.destBlend = D3DBLEND_SRCALPHA;
+	}
+
+	if (rs[D3DRS_SEPARATEALPHABLENDENABLE]) {
+		state.srcBlendAlpha = (D3DBLEND) rs[D3DRS_SRCBLENDALPHA];
+		state.destBlendAlpha = (D3DBLEND) rs[D3DRS_DESTBLENDALPHA];
+		state.blendOpAlpha = (D3DBLENDOP) rs[D3DRS_BLENDOPALPHA];
+	} else {
+		state.srcBlendAlpha = state.srcBlend;
+		state.destBlendAlpha = state.destBlend;
+		state.blendOpAlpha = state.blendOp;
+	}
+
+	state.blendFactor = rs[D3DRS_BLENDFACTOR];
+	static constexpr D3DRENDERSTATETYPE COLOR_WRITE[DrawState::MAX_TARGETS] = {D3DRS_COLORWRITEENABLE, D3DRS_COLORWRITEENABLE1, D3DRS_COLORWRITEENABLE2, D3DRS_COLORWRITEENABLE3};
+	for (UINT i = 0; i < state.targetCount; i++) state.colorWrite[i] = rs[COLOR_WRITE[slots[i]]] & 0xF;
+
+	//stages up to the first disabled one, as the vertex stage counts them
+	state.textureSets = 0;
+	while (state.textureSets < maxTextureStages && this->textureStageStates[state.textureSets][D3DTSS_COLOROP] != D3DTOP_DISABLE) state.textureSets++;
+	for (UINT i = 0; i < state.textureSets; i++) {
+		const DWORD* tss = this->textureStageStates[i];
+		const DWORD* ss = this->samplerStates[i];
+		TextureStage& stage = state.stages[i];
+
+		stage.colorOp = (D3DTEXTUREOP) tss[D3DTSS_COLOROP];
+		stage.alphaOp = (D3DTEXTUREOP) tss[D3DTSS_ALPHAOP];
+		stage.colorArg[0] = tss[D3DTSS_COLORARG1];
+		stage.colorArg[1] = tss[D3DTSS_COLORARG2];
+		stage.colorArg[2] = tss[D3DTSS_COLORARG0];
+		stage.alphaArg[0] = tss[D3DTSS_ALPHAARG1];
+		stage.alphaArg[1] = tss[D3DTSS_ALPHAARG2];
+		stage.alphaArg[2] = tss[D3DTSS_ALPHAARG0];
+		stage.temp = tss[D3DTSS_RESULTARG] == D3DTA_TEMP;
+		colorFloats(tss[D3DTSS_CONSTANT], stage.constant);
+
+		//the last coordinate the texture transform makes divides the others
+		const DWORD flags = tss[D3DTSS_TEXTURETRANSFORMFLAGS];
+		stage.projected = flags & D3DTTFF_PROJECTED ? flags & 0xFF : 0;
+
+		stage.view.levels = 0;
+		if (this->textures[i] != NULL) Sampler::view(this->textures[i], ss[D3DSAMP_MAXMIPLEVEL], stage.view);
+
+		SamplerState& sampler = stage.sampler;
+		sampler.address[0] = (D3DTEXTUREADDRESS) ss[D3DSAMP_ADDRESSU];
+		sampler.address[1] = (D3DTEXTUREADDRESS) ss[D3DSAMP_ADDRESSV];
+		sampler.address[2] = (D3DTEXTUREADDRESS) ss[D3DSAMP_ADDRESSW];
+		colorFloats(ss[D3DSAMP_BORDERCOLOR], sampler.border);
+		sampler.magFilter = (D3DTEXTUREFILTERTYPE) ss[D3DSAMP_MAGFILTER];
+		sampler.minFilter = (D3DTEXTUREFILTERTYPE) ss[D3DSAMP_MINFILTER];
+		sampler.mipFilter = (D3DTEXTUREFILTERTYPE) ss[D3DSAMP_MIPFILTER];
+		sampler.lodBias = bitsFloat(ss[D3DSAMP_MIPMAPLODBIAS]);
+		sampler.maxAnisotropy = sampler.minFilter == D3DTEXF_ANISOTROPIC ? std::clamp<UINT>(ss[D3DSAMP_MAXANISOTROPY], 1, maxAnisotropy) : 1;
+		sampler.srgb = ss[D3DSAMP_SRGBTEXTURE] != FALSE;
+	}
+	colorFloats(rs[D3DRS_TEXTUREFACTOR], state.textureFactor);
+	state.dither = rs[D3DRS_DITHERENABLE] != FALSE;
+	state.srgbWrite = rs[D3DRS_SRGBWRITEENABLE] != FALSE;
+	return state;
+}
+
+HRESULT Direct3DDevice9::Clear(DWORD Count, const D3DRECT* pRects, DWORD Flags, D3DCOLOR Color, float Z, DWORD Stencil) {
+	if ((Count > 0 && pRects == NULL) || (Flags & (D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER | D3DCLEAR_STENCIL)) == 0) return D3DERR_INVALIDCALL;
+	const Surface depth = this->depthSurface();
+	if ((Flags & (D3DCLEAR_ZBUFFER | D3DCLEAR_STENCIL)) && depth.bits == NULL) return D3DERR_INVALIDCALL;
+	if ((Flags & D3DCLEAR_STENCIL) && DepthStencil::stencilBits(depth.format) == 0) return D3DERR_INVALIDCALL;
+
+	//every render target is cleared
+	Surface targets[DrawState::MAX_TARGETS];
+	UINT slots[DrawState::MAX_TARGETS];
+	const UINT targetCount = this->targets(targets, slots);
+
+	//clears are limited to the viewport
+	const RECT viewport = {(LONG) this->viewport.X, (LONG) this->viewport.Y, (LONG) (this->viewport.X + this->viewport.Width), (LONG) (this->viewport.Y + this->viewport.Height)};
+	Z = std::clamp(Z, 0.0f, 1.0f);
+
+	if (Count == 0) {
+		this->rasterizer.clear(viewport, Flags, Color, Z, Stencil, targets, targetCount, depth);
+		return D3D_OK;
+	}
+
+	for (DWORD i = 0; i < Count; i++) {
+		RECT rect = {
+			std::max<LONG>(pRects[i].x1, viewport.left),
+			std::max<LONG>(pRects[i].y1, viewport.top),
+			std::min<LONG>(pRects[i].x2, viewport.right),
+			std::min<LONG>(pRects[i].y2, viewport.bottom)
+		};
+		if (rect.left < rect.right && rect.top < rect.bottom) this->rasterizer.clear(rect, Flags, Color, Z, Stencil, targets, targetCount, depth);
+	}
+
+	return D3D_OK;
+}
+
+/**
+ * Vertices read by "count" primitives of "type", 0 for an unknown type
+ */
+static UINT vertexCount(D3DPRIMITIVETYPE type, UINT count) {
+	switch (type) {
+		case D3DPT_POINTLIST: return count;
+		case D3DPT_LINELIST: return count * 2;
+		case D3DPT_LINESTRIP: return count + 1;
+		case D3DPT_TRIANGLELIST: return count * 3;
+		case D3DPT_TRIANGLESTRIP: case D3DPT_TRIANGLEFAN: return count + 2;
+		default: return 0;
+	}
+}
+
+/**
+ * Version and first level of a texture: locks and streaming change
+ * them without going through the device.
+ */
+static uint64_t textureStamp(IDirect3DBaseTexture9* texture) {
+	switch (texture->GetType()) {
+		case D3DRTYPE_TEXTURE: {
+			const Direct3DTexture9* t = static_cast<Direct3DTexture9*>(texture);
+			return t->version() << 4 | t->firstLevel();
+		}
+		case D3DRTYPE_CUBETEXTURE: {
+			const Direct3DCubeTexture9* t = static_cast<Direct3DCubeTexture9*>(texture);
+			return t->version() << 4 | t->firstLevel();
+		}
+		case D3DRTYPE_VOLUMETEXTURE: {
+			const Direct3DVolumeTexture9* t = static_cast<Direct3DVolumeTexture9*>(texture);
+			return t->version() << 4 | t->firstLevel();
+		}
+		default:
+			return 0;
+	}
+}
+
+void Direct3DDevice9::updateState() {
+	for (UINT i = 0; i < maxTextureStages; i++) {
+		const uint64_t stamp = this->textures[i] != NULL ? textureStamp(this->textures[i]) : 0;
+		if (stamp != this->textureStamps[i]) this->stateDirty = true;
+		this->textureStamps[i] = stamp;
+	}
+
+	if (this->stateDirty) {
+		this->rasterizer.setState(this->drawState());
+		this->stateDirty = false;
+	}
+}
+
+void Direct3DDevice9::draw(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, const BYTE* vertices, UINT stride, UINT count, const Direct3DVertexBuffer9* buffer, UINT first) {
+	const bool triangles = PrimitiveType == D3DPT_TRIANGLELIST || PrimitiveType == D3DPT_TRIANGLESTRIP || PrimitiveType == D3DPT_TRIANGLEFAN;
+	if (this->nPatchSegments >= 1.0f && triangles && (this->fvf & D3DFVF_NORMAL) && Tessellator::supports(this->fvf)) {
+		this->drawTessellation(this->nPatch(PrimitiveType, PrimitiveCount, vertices, stride, buffer, first));
+		return;
+	}
+
+	this->vertices.resize(count);
+	VertexStage::process(this->vertexState(), vertices, stride, count, this->vertices.data());
+
+	this->updateState();
+
+	this->rasterizer.draw(PrimitiveType, this->vertices.data(), PrimitiveCount, VertexStage::isTransformed(this->fvf));
+}
+
+const Tessellation& Direct3DDevice9::nPatch(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, const BYTE* vertices, UINT stride, const Direct3DVertexBuffer9* buffer, UINT first) {
+	const DWORD* rs = this->renderStates;
+	const UINT segments = (UINT) std::ceil(std::min(this->nPatchSegments, (float) Tessellator::MAX_SEGMENTS));
+	PatchSource source = {0, 0, first, stride, this->fvf, {(float) segments}, rs[D3DRS_POSITIONDEGREE] << 8 | rs[D3DRS_NORMALDEGREE]};
+
+	Tessellation* out = &this->tessellation;
+	if (buffer != NULL) {
+		source.buffer = buffer->id();
+		source.version = buffer->version();
+		if (this->nPatches.size() >= NPATCH_CACHE) this->nPatches.clear();
+
+		NPatch& cached = this->nPatches[{source.buffer, first, PrimitiveCount, PrimitiveType}];
+		if (cached.source == source && cached.tessellation.count != 0) return cached.tessellation;
+		cached.source = source;
+		out = &cached.tessellation;
+	}
+
+	//strips alternate their winding
+	std::vector<uint32_t> triangles((size_t) PrimitiveCount * 3);
+	for (UINT i = 0; i < PrimitiveCount; i++) {
+		uint32_t* t = triangles.data() + (size_t) i * 3;
+		switch (PrimitiveType) {
+			case D3DPT_TRIANGLESTRIP:
+				t[0] = i % 2 == 0 ? i : i + 1;
+				t[1] = i % 2 == 0 ? i + 1 : i;
+				t[2] = i + 2;
+				break;
+			case D3DPT_TRIANGLEFAN:
+				t[0] = 0;
+				t[1] = i + 1;
+				t[2] = i + 2;
+				break;
+			default:
+				t[0] = i * 3;
+				t[1] = i * 3 + 1;
+				t[2] = i * 3 + 2;
+				break;
+		}
+	}
+
+	Tessellator::nPatches(this->fvf, vertices, stride, triangles.data(), PrimitiveCount, segments, (D3DDEGREETYPE) rs[D3DRS_POSITIONDEGREE], (D3DDEGREETYPE) rs[D3DRS_NORMALDEGREE], *out);
+	return *out;
+}
+
+/**
+ * Tessellations share their vertices between triangles: the vertex
+ * stage runs on each once, then the triangle list is gathered.
+ */
+void Direct3DDevice9::drawTessellation(const Tessellation& tessellation) {
+	if (tessellation.indices.empty()) return;
+
+	this->patchVertices.resize(tessellation.count);
+	VertexStage::process(this->vertexState(), tessellation.vertices.data(), VertexStage::size(this->fvf), tessellation.count, this->patchVertices.data());
+
+	this->vertices.resize(tessellation.indices.size());
+	for (size_t i = 0; i < tessellation.indices.size(); i++) this->vertices[i] = this->patchVertices[tessellation.indices[i]];
+
+	this->updateState();
+
+	this->rasterizer.draw(D3DPT_TRIANGLELIST, this->vertices.data(), tessellation.indices.size() / 3, false);
+}
+
+/**
+ * The box is transformed to clip space, and the draw is off screen
+ * when its eight corners are all outside the same side of the clip
+ * volume. Points are as large as their size, and N-patches and
+ * blended vertices move out of the box, so those are always drawn.
+ */
+bool Direct3DDevice9::offscreen(D3DPRIMITIVETYPE PrimitiveType, const Direct3DVertexBuffer9* buffer, UINT first, UINT stride, UINT count) {
+	const DWORD position = this->fvf & D3DFVF_POSITION_MASK;
+	if (PrimitiveType == D3DPT_POINTLIST || this->nPatchSegments >= 1.0f) return false;
+	if (position == D3DFVF_XYZRHW || position == D3DFVF_XYZW) return false;
+	if (position != D3DFVF_XYZ && this->renderStates[D3DRS_VERTEXBLEND] != D3DVBF_DISABLE) return false;
+
+	if (this->bounds.size() >= BOUNDS_CACHE) this->bounds.clear();
+	Bounds& box = this->bounds[{buffer->id(), first, stride, count}];
+	if (box.version != buffer->version()) {
+		box.version = buffer->version();
+		std::fill(box.min, box.min + 3, INFINITY);
+		std::fill(box.max, box.max + 3, -INFINITY);
+
+		const BYTE* vertices = buffer->data() + first;
+		for (UINT i = 0; i < count; i++) {
+			float p[3];
+			memcpy(p, vertices + (size_t) i * stride, sizeof(p));
+			for (int c = 0; c < 3; c++) {
+				box.min[c] = std::min(box.min[c], p[c]);
+				box.max[c] = std::max(box.max[c], p[c]);
+			}
+		}
+	}
+
+	D3DMATRIX worldView, worldViewProjection;
+	VectorMath::multiply(worldView, this->world[0], this->view);
+	VectorMath::multiply(worldViewProjection, worldView, this->projection);
+
+	//a bit per side, set while every corner so far is beyond it
+	uint32_t outside = 0x3F;
+	for (int corner = 0; corner < 8 && outside != 0; corner++) {
+		const float p[3] = {
+			corner & 1 ? box.max[0] : box.min[0],
+			corner & 2 ? box.max[1] : box.min[1],
+			corner & 4 ? box.max[2] : box.min[2]
+		};
+		float clip[4];
+		VectorMath::transformOne<VectorMath::POINT>(clip, p, worldViewProjection);
+
+		uint32_t code = 0;
+		if (clip[0] < -clip[3]) code |= 1 << 0;
+		if (clip[0] > clip[3]) code |= 1 << 1;
+		if (clip[1] < -clip[3]) code |= 1 << 2;
+		if (clip[1] > clip[3]) code |= 1 << 3;
+		if (clip[2] < 0.0f) code |= 1 << 4;
+		if (clip[2] > clip[3]) code |= 1 << 5;
+		outside &= code;
+	}
+	return outside != 0;
+}
+
+HRESULT Direct3DDevice9::DrawPrimitive(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount) {
+	const Stream& stream = this->streams[0];
+	if (!this->inScene || stream.buffer == NULL) return D3DERR_INVALIDCALL;
+
+	const UINT size = VertexStage::size(this->fvf);
+	const UINT count = vertexCount(PrimitiveType, PrimitiveCount);
+	if (size == 0 || stream.stride < size || vertexCount(PrimitiveType, 1) == 0) return D3DERR_INVALIDCALL;
+	if (PrimitiveCount == 0) return D3D_OK;
+
+	//the last vertex only needs its own bytes
+	const uint64_t first = stream.offset + (uint64_t) StartVertex * stream.stride;
+	if (first + (uint64_t) (count - 1) * stream.stride + size > stream.buffer->size()) return D3DERR_INVALIDCALL;
+
+	if (this->offscreen(PrimitiveType, stream.buffer, (UINT) first, stream.stride, count)) return D3D_OK;
+
+	this->draw(PrimitiveType, PrimitiveCount, stream.buffer->data() + first, stream.stride, count, stream.buffer, (UINT) first);
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::DrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, const void* pVertexStreamZeroData, UINT VertexStreamZeroStride) {
+	if (!this->inScene || pVertexStreamZeroData == NULL) return D3DERR_INVALIDCALL;
+
+	const UINT size = VertexStage::size(this->fvf);
+	if (size == 0 || VertexStreamZeroStride < size || vertexCount(PrimitiveType, 1) == 0) return D3DERR_INVALIDCALL;
+	if (PrimitiveCount == 0) return D3D_OK;
+
+	this->draw(PrimitiveType, PrimitiveCount, (const BYTE*) pVertexStreamZeroData, VertexStreamZeroStride, vertexCount(PrimitiveType, PrimitiveCount), NULL, 0);
+	return D3D_OK;
+}
+
+/**
+ * Stream 0 goes through the vertex stage as for a draw, and the
+ * result is written to pDestBuffer in its own FVF, which must be
+ * D3DFVF_XYZRHW: vertex declarations are not supported, so
+ * pVertexDecl is unused. Texture set i of the destination gets the
+ * coordinates of stage i, enabled or not.
+ */
+HRESULT Direct3DDevice9::ProcessVertices(UINT SrcStartIndex, UINT DestIndex, UINT VertexCount, IDirect3DVertexBuffer9* pDestBuffer, IDirect3DVertexDeclaration9* pVertexDecl, DWORD Flags) {
+	const Stream& stream = this->streams[0];
+	D3DVERTEXBUFFER_DESC desc;
+	if (pDestBuffer == NULL || stream.buffer == NULL || FAILED(pDestBuffer->GetDesc(&desc))) return D3DERR_INVALIDCALL;
+
+	const UINT size = VertexStage::size(this->fvf), outSize = VertexStage::size(desc.FVF);
+	if (size == 0 || VertexStage::isTransformed(this->fvf) || stream.stride < size) return D3DERR_INVALIDCALL;
+	if (outSize == 0 || !VertexStage::isTransformed(desc.FVF) || (desc.FVF & D3DFVF_NORMAL)) return D3DERR_INVALIDCALL;
+	if (VertexCount == 0) return D3D_OK;
+
+	const uint64_t first = stream.offset + (uint64_t) SrcStartIndex * stream.stride;
+	const uint64_t target = (uint64_t) DestIndex * outSize;
+	if (first + (uint64_t) (VertexCount - 1) * stream.stride + size > stream.buffer->size()) return D3DERR_INVALIDCALL;
+	if (target + (uint64_t) VertexCount * outSize > desc.Size) return D3DERR_INVALIDCALL;
+
+	//a write lock, so that what was derived from the old vertices is redone
+	void* data;
+	if (FAILED(pDestBuffer->Lock((UINT) target, VertexCount * outSize, &data, 0))) return D3DERR_INVALIDCALL;
+
+	VertexState state = this->vertexState();
+	const UINT sets = (desc.FVF & D3DFVF_TEXCOUNT_MASK) >> D3DFVF_TEXCOUNT_SHIFT;
+	for (UINT t = state.textureStages; t < sets; t++) {
+		state.texCoordIndex[t] = this->textureStageStates[t][D3DTSS_TEXCOORDINDEX];
+		state.textureTransform[t] = this->textureStageStates[t][D3DTSS_TEXTURETRANSFORMFLAGS];
+		state.textureMatrix[t] = this->texture[t];
+	}
+	state.textureStages = std::max(state.textureStages, sets);
+
+	const VertexOutput output = {desc.FVF, outSize, this->viewport, (Flags & D3DPV_DONOTCOPYDATA) == 0};
+	VertexStage::processTo(state, stream.buffer->data() + first, stream.stride, VertexCount, output, (BYTE*) data);
+	pDestBuffer->Unlock();
+	return D3D_OK;
+}
+
+/**
+ * Handle 0 tessellates every time. Other handles keep the patch of
+ * their first call, which later calls draw without info; it is
+ * tessellated again only when the segments, the FVF or stream 0
+ * (its buffer, a write lock of it, its offset or stride) change.
+ */
+HRESULT Direct3DDevice9::drawPatch(UINT Handle, const float* pNumSegs, bool triangle, const D3DRECTPATCH_INFO* pRectPatchInfo, const D3DTRIPATCH_INFO* pTriPatchInfo) {
+	const Stream& stream = this->streams[0];
+	const UINT size = VertexStage::size(this->fvf);
+	const bool info = pRectPatchInfo != NULL || pTriPatchInfo != NULL;
+	if (!this->inScene || pNumSegs == NULL || stream.buffer == NULL || (Handle == 0 && !info)) return D3DERR_INVALIDCALL;
+	if (!Tessellator::supports(this->fvf) || stream.stride < size || (uint64_t) stream.offset + size > stream.buffer->size()) return D3DERR_INVALIDCALL;
+
+	Patch uncached = {};
+	Patch* patch = &uncached;
+	if (Handle != 0) {
+		const auto found = this->patches.find(Handle);
+		if (!info && found == this->patches.end()) return D3DERR_INVALIDCALL;
+		patch = &this->patches[Handle];
+	}
+
+	if (info) {
+		patch->triangle = triangle;
+		if (triangle) patch->tri = *pTriPatchInfo;
+		else patch->rect = *pRectPatchInfo;
+		patch->valid = false;
+	} else if (patch->triangle != triangle) {
+		//the handle belongs to the other shape
+		return D3DERR_INVALIDCALL;
+	}
+
+	PatchSource source = {stream.buffer->id(), stream.buffer->version(), stream.offset, stream.stride, this->fvf, {}, 0};
+	memcpy(source.segments, pNumSegs, (triangle ? 3 : 4) * sizeof(float));
+
+	if (!patch->valid || !(patch->source == source)) {
+		const BYTE* vertices = stream.buffer->data() + stream.offset;
+		const UINT count = (stream.buffer->size() - stream.offset - size) / stream.stride + 1;
+		const bool tessellated = patch->triangle
+			? Tessellator::triPatch(this->fvf, vertices, stream.stride, count, patch->tri, pNumSegs, patch->tessellation)
+			: Tessellator::rectPatch(this->fvf, vertices, stream.stride, count, patch->rect, pNumSegs, patch->tessellation);
+
+		if (!tessellated) {
+			if (Handle != 0) this->patches.erase(Handle);
+			return D3DERR_INVALIDCALL;
+		}
+		patch->source = source;
+		patch->valid = true;
+	}
+
+	this->drawTessellation(patch->tessellation);
+	return D3D_OK;
+}
+
+HRESULT Direct3DDevice9::DrawRectPatch(UINT Handle, const float* pNumSegs, const D3DRECTPATCH_INFO* pRectPatchInfo) {
+	return this->drawPatch(Handle, pNumSegs, false, pRectPatchInfo, NULL);
+}
+
+HRESULT Direct3DDevice9::DrawTriPatch(UINT Handle, const float* pNumSegs, const D3DTRIPATCH_INFO* pTriPatchInfo) {
+	return this->drawPatch(Handle, pNumSegs, true, NULL, pTriPatchInfo);
+}
+
+HRESULT Direct3DDevice9::DeletePatch(UINT Handle) {
+	return this->patches.erase(Handle) != 0 ? D3D_OK : D3DERR_INVALIDCALL;
+}
+
+/**
+ * The image becomes the cursor of the device window. The compositor
+ * shows it on the display's cursor plane, so it moves with the
+ * pointer at input rate, whatever the frame rate, and is never drawn
+ * into the back buffer.
+ */
+HRESULT Direct3DDevice9::SetCursorProperties(UINT XHotSpot, UINT YHotSpot, IDirect3DSurface9* pCursorBitmap) {
+	if (pCursorBitmap == NULL) return D3DERR_INVALIDCALL;
+
+	D3DSURFACE_DESC desc;
+	if (FAILED(pCursorBitmap->GetDesc(&desc)) || desc.Format != D3DFMT_A8R8G8B8) return D3DERR_INVALIDCALL;
+	if (XHotSpot >= desc.Width || YHotSpot >= desc.Height) return D3DERR_INVALIDCALL;
+
+	D3DLOCKED_RECT locked;
+	if (FAILED(pCursorBitmap->LockRect(&locked, NULL, D3DLOCK_READONLY))) return D3DERR_INVALIDCALL;
+
+	//A8R8G8B8 in a little endian word is B8G8R8A8 in memory, not premultiplied
+	const size_t row = (size_t) desc.Width * 4;
+	BYTE* pixels = (BYTE*) g_malloc(row * desc.Height);
+	for (UINT y = 0; y < desc.Height; y++) memcpy(pixels + y * row, (const BYTE*) locked.pBits + (size_t) y * locked.Pitch, row);
+	pCursorBitmap->UnlockRect();
+
+	GBytes* bytes = g_bytes_new_take(pixels, row * desc.Height);
+	GdkTexture* texture = gdk_memory_texture_new(desc.Width, desc.Height, GDK_MEMORY_B8G8R8A8, bytes, row);
+	g_bytes_unref(bytes);
+
+	if (this->cursor != NULL) g_object_unref(this->cursor);
+	this->cursor = gdk_cursor_new_from_texture(texture, XHotSpot, YHotSpot, NULL);
+	g_object_unref(texture);
+
+	if (this->cursorShown) this->ShowCursor(TRUE);
+	return D3D_OK;
+}
+
+/**
+ * Nothing to do: the compositor moves the cursor with the pointer
+ * itself, and GTK cannot warp the pointer.
+ */
+void Direct3DDevice9::SetCursorPosition(int X, int Y, DWORD Flags) {}
+
+BOOL Direct3DDevice9::ShowCursor(BOOL bShow) {
+	const BOOL shown = this->cursorShown;
+	this->cursorShown = bShow;
+
+	//a NULL cursor would give the window the default arrow back
+	if (!bShow && this->hiddenCursor == NULL) this->hiddenCursor = gdk_cursor_new_from_name("none", NULL);
+
+	HWND window = this->deviceWindow();
+	if (window != NULL) gtk_widget_set_cursor(window, bShow ? this->cursor : this->hiddenCursor);
+	return shown;
+}
+
+/**
+ * Renders what is pending and shows the back buffer in the window as
+ * a GdkTexture. The message loop (PeekMessage) draws it.
+ */
+HRESULT Direct3DDevice9::Present(const RECT* pSourceRect, const RECT* pDestRect, HWND hDestWindowOverride, const void* pDirtyRegion) {
+	HWND window = hDestWindowOverride != NULL ? hDestWindowOverride : this->deviceWindow();
+	if (window == NULL) return D3DERR_INVALIDCALL;
+
+	this->rasterizer.flush();
+
+	const Surface& target = this->backBuffer->surface();
+	const size_t size = (size_t) target.width * target.height * 4;
+	uint32_t* pixels = (uint32_t*) g_malloc(size);
+
+	//B8G8R8A8 in memory is A8R8G8B8 in a little endian word; the back buffer is opaque
+	WorkerPool::shared().parallelFor(target.height, 16, [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; y++) {
+			const BYTE* row = target.bits + y * target.pitch;
+			uint32_t* out = pixels + y * target.width;
+
+			if (target.format == D3DFMT_R5G6B5) ColorConvert::expand565(out, (const uint16_t*) row, target.width);
+			else ColorConvert::swizzle32(out, (const uint32_t*) row, target.width, false, true);
+		}
+	});
+
+	GBytes* bytes = g_bytes_new_take(pixels, size);
+	GdkTexture* texture = gdk_memory_texture_new(target.width, target.height, GDK_MEMORY_B8G8R8A8_PREMULTIPLIED, bytes, target.width * 4);
+	g_bytes_unref(bytes);
+
+	GtkWidget* picture = (GtkWidget*) g_object_get_data(G_OBJECT(window), "odx-present");
+	if (picture == NULL) {
+		picture = gtk_picture_new();
+		gtk_window_set_child(GTK_WINDOW(window), picture);
+		g_object_set_data(G_OBJECT(window), "odx-present", picture);
+	}
+
+	gtk_picture_set_paintable(GTK_PICTURE(picture), GDK_PAINTABLE(texture));
+	g_object_unref(texture);
+	return D3D_OK;
+}
@@ -0,0 +1,248 @@
+#pragma once
+#include <atomic>
+#include <bitset>
+#include <map>
+#include <tuple>
+#include <vector>
+#include <windows.h>
+#include <d3d9.h>
+#include "direct3dsurface9.hpp"
+#include "direct3dvertexbuffer9.hpp"
+#include "rasterizer.hpp"
+#include "tessellator.hpp"
+#include "vertexstage.hpp"
+
+/**
+ * The software device (every D3DDEVTYPE is served by it).
+ *
+ * Resources live in system memory. Draws go through the vertex
+ * stage into the tiled Rasterizer, which renders them when the back
+ * buffer is presented, a render target is locked or another one is
+ * set; Present() then shows the back buffer in a GtkPicture inside
+ * the device window. The cursor is a GdkCursor of that window.
+ *
+ * Patches are tessellated once and kept by handle (N-patches of
+ * vertex buffers by buffer range) until their control points or
+ * segment counts change; only the vertex stage runs on them per draw.
+ * Vertex buffer ranges also keep the box around their positions, so
+ * draws entirely off screen are dropped before the vertex stage.
+ */
+class Direct3DDevice9 final : public IDirect3DDevice9 {
+	public:static constexpr const UINT maxSamplers = 16;
+	public:static constexpr const UINT maxTextureStages = 8;
+	public:static constexpr const UINT maxActiveLights = 8;
+	public:static constexpr const UINT maxAnisotropy = 16;
+	public:static constexpr const UINT maxStreams = 16;
+	public:static constexpr const UINT maxWorldMatrices = 256; //D3DTS_WORLDMATRIX(0 to 255)
+
+	private:struct LightSlot {
+		D3DLIGHT9 light;
+		bool enabled;
+	};
+
+	private:struct Stream {
+		Direct3DVertexBuffer9* buffer; //referenced
+		UINT offset;
+		UINT stride;
+	};
+
+	/**
+	 * What a tessellation was built from: it is redone when any of it
+	 * changes.
+	 */
+	private:struct PatchSource {
+		uint64_t buffer; //Direct3DVertexBuffer9::id()
+		uint64_t version;
+		UINT offset; //bytes
+		UINT stride;
+		DWORD fvf;
+		float segments[4];
+		DWORD degrees; //N-patches: POSITIONDEGREE << 8 | NORMALDEGREE
+
+		bool operator==(const PatchSource&) const = default;
+	};
+
+	private:struct Patch {
+		bool triangle;
+		D3DRECTPATCH_INFO rect;
+		D3DTRIPATCH_INFO tri;
+		PatchSource source;
+		bool valid; //"tessellation" matches "source"
+		Tessellation tessellation;
+	};
+
+	private:struct NPatch {
+		PatchSource source;
+		Tessellation tessellation;
+	};
+
+	/**
+	 * Object-space box around the positions of a vertex buffer range,
+	 * which are the first three floats of every FVF vertex.
+	 */
+	private:struct Bounds {
+		uint64_t version = UINT64_MAX; //Direct3DVertexBuffer9::version() it was computed at
+		float min[3];
+		float max[3];
+	};
+
+	private:std::atomic<ULONG> references = 1; //a texture released by a streaming job releases the device there
+	private:IDirect3D9* d3d;
+	private:D3DDEVTYPE type;
+	private:HWND window;
+	private:DWORD behavior;
+	private:bool softwareVertexProcessing; //only switchable on D3DCREATE_MIXED_VERTEXPROCESSING devices
+	private:D3DPRESENT_PARAMETERS presentation;
+
+	private:DWORD renderStates[256] = {};
+	private:DWORD samplerStates[maxSamplers][D3DSAMP_DMAPOFFSET + 1] = {};
+	private:IDirect3DBaseTexture9* textures[maxSamplers] = {};
+	private:DWORD textureStageStates[maxTextureStages][D3DTSS_CONSTANT + 1] = {};
+	private:DWORD fvf = 0;
+	private:Stream streams[maxStreams] = {};
+	private:float nPatchSegments = 0.0f;
+	private:bool inScene = false;
+
+	private:D3DMATRIX world[maxWorldMatrices];
+	private:D3DMATRIX blendWorldView[maxWorldMatrices]; //world[n] times the view, for vertex blending
+	private:D3DMATRIX blendNormal[maxWorldMatrices]; //their inverse transposes
+	private:std::bitset<maxWorldMatrices> blendDirty; //entries to recompute before blending with them
+	private:D3DMATRIX view;
+	private:D3DMATRIX projection;
+	private:D3DMATRIX texture[8];
+	private:D3DVIEWPORT9 viewport;
+	private:D3DMATERIAL9 material = {};
+	private:std::map<DWORD, LightSlot> lights; //SetLight() indices are sparse
+
+	private:Direct3DSurface9* backBuffer;
+	private:Direct3DSurface9* renderTargets[DrawState::MAX_TARGETS] = {}; //referenced, except the back buffer
+	private:std::vector<uint32_t> depthBuffer;
+	private:Surface depth;
+
+	private:GdkCursor* cursor = NULL; //of SetCursorProperties()
+	private:GdkCursor* hiddenCursor = NULL; //"none", for ShowCursor(FALSE)
+	private:bool cursorShown = false;
+
+	private:Rasterizer rasterizer;
+	private:bool stateDirty = true; //render states changed since the last draw
+	private:uint64_t textureStamps[maxTextureStages] = {}; //of the bound textures when the state was last captured
+	private:std::vector<Vertex> vertices;
+	private:std::vector<Vertex> patchVertices;
+	private:Tessellation tessellation; //of patches drawn without caching
+	private:std::map<UINT, Patch> patches; //DrawRectPatch() and DrawTriPatch() handles
+	private:std::map<std::tuple<uint64_t, UINT, UINT, D3DPRIMITIVETYPE>, NPatch> nPatches; //by buffer, first vertex, primitives, type
+	private:std::map<std::tuple<uint64_t, UINT, UINT, UINT>, Bounds> bounds; //by buffer, first byte, stride, vertices
+
+	public:Direct3DDevice9(IDirect3D9* d3d, D3DDEVTYPE DeviceType, HWND hFocusWindow, DWORD BehaviorFlags, const D3DPRESENT_PARAMETERS* pPresentationParameters);
+	public:~Direct3DDevice9();
+
+	public:HRESULT QueryInterface(REFIID riid, void** ppvObject) override;
+	public:ULONG AddRef() override;
+	public:ULONG Release() override;
+
+	public:HRESULT SetCursorProperties(UINT XHotSpot, UINT YHotSpot, IDirect3DSurface9* pCursorBitmap) override;
+	public:void SetCursorPosition(int X, int Y, DWORD Flags) override;
+	public:BOOL ShowCursor(BOOL bShow) override;
+	public:HRESULT Present(const RECT* pSourceRect, const RECT* pDestRect, HWND hDestWindowOverride, const void* pDirtyRegion) override;
+	public:HRESULT GetBackBuffer(UINT iSwapChain, UINT iBackBuffer, D3DBACKBUFFER_TYPE Type, IDirect3DSurface9** ppBackBuffer) override;
+	public:HRESULT CreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle) override;
+	public:HRESULT CreateVolumeTexture(UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DVolumeTexture9** ppVolumeTexture, HANDLE* pSharedHandle) override;
+	public:HRESULT CreateCubeTexture(UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DCubeTexture9** ppCubeTexture, HANDLE* pSharedHandle) override;
+	public:HRESULT CreateVertexBuffer(UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool, IDirect3DVertexBuffer9** ppVertexBuffer, HANDLE* pSharedHandle) override;
+	public:HRESULT CreateRenderTarget(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle) override;
+	public:HRESULT SetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget) override;
+	public:HRESULT GetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9** ppRenderTarget) override;
+	public:HRESULT BeginScene() override;
+	public:HRESULT EndScene() override;
+	public:HRESULT Clear(DWORD Count, const D3DRECT* pRects, DWORD Flags, D3DCOLOR Color, float Z, DWORD Stencil) override;
+	public:HRESULT SetTransform(D3DTRANSFORMSTATETYPE State, const D3DMATRIX* pMatrix) override;
+	public:HRESULT GetTransform(D3DTRANSFORMSTATETYPE State, D3DMATRIX* pMatrix) override;
+	public:HRESULT SetViewport(const D3DVIEWPORT9* pViewport) override;
+	public:HRESULT GetViewport(D3DVIEWPORT9* pViewport) override;
+	public:HRESULT SetMaterial(const D3DMATERIAL9* pMaterial) override;
+	public:HRESULT GetMaterial(D3DMATERIAL9* pMaterial) override;
+	public:HRESULT SetLight(DWORD Index, const D3DLIGHT9* pLight) override;
+	public:HRESULT GetLight(DWORD Index, D3DLIGHT9* pLight) override;
+	public:HRESULT LightEnable(DWORD Index, BOOL Enable) override;
+	public:HRESULT GetLightEnable(DWORD Index, BOOL* pEnable) override;
+	public:HRESULT SetRenderState(D3DRENDERSTATETYPE State, DWORD Value) override;
+	public:HRESULT GetRenderState(D3DRENDERSTATETYPE State, DWORD* pValue) override;
+	public:HRESULT SetTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture) override;
+	public:HRESULT GetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD* pValue) override;
+	public:HRESULT SetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value) override;
+	public:HRESULT SetSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD Value) override;
+	public:HRESULT SetSoftwareVertexProcessing(BOOL bSoftware) override;
+	public:BOOL GetSoftwareVertexProcessing() override;
+	public:HRESULT SetNPatchMode(float nSegments) override;
+	public:float GetNPatchMode() override;
+	public:HRESULT DrawPrimitive(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount) override;
+	public:HRESULT DrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, const void* pVertexStreamZeroData, UINT VertexStreamZeroStride) override;
+	public:HRESULT ProcessVertices(UINT SrcStartIndex, UINT DestIndex, UINT VertexCount, IDirect3DVertexBuffer9* pDestBuffer, IDirect3DVertexDeclaration9* pVertexDecl, DWORD Flags) override;
+	public:HRESULT SetFVF(DWORD FVF) override;
+	public:HRESULT SetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer9* pStreamData, UINT OffsetInBytes, UINT Stride) override;
+	public:HRESULT GetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer9** ppStreamData, UINT* pOffsetInBytes, UINT* pStride) override;
+	public:HRESULT DrawRectPatch(UINT Handle, const float* pNumSegs, const D3DRECTPATCH_INFO* pRectPatchInfo) override;
+	public:HRESULT DrawTriPatch(UINT Handle, const float* pNumSegs, const D3DTRIPATCH_INFO* pTriPatchInfo) override;
+	public:HRESULT DeletePatch(UINT Handle) override;
+
+	/**
+	 * Renders every pending draw, before the CPU reads a render target.
+	 */
+	public:void flush();
+
+	/**
+	 * Where Present() shows the back buffer by default.
+	 */
+	private:HWND deviceWindow() const {
+		return this->presentation.hDeviceWindow != NULL ? this->presentation.hDeviceWindow : this->window;
+	}
+
+	private:D3DMATRIX* transform(D3DTRANSFORMSTATETYPE State);
+
+	/**
+	 * Memory of the bound render targets the size of the first, which
+	 * are the ones drawn to, and their SetRenderTarget() indices;
+	 * returns their count.
+	 */
+	private:UINT targets(Surface* out, UINT* slots) const;
+
+	/**
+	 * The depth buffer, or none when it is smaller than the first
+	 * render target.
+	 */
+	private:Surface depthSurface() const;
+	/**
+	 * The vertex stage's state; brings the blend matrices the draw
+	 * may use up to date first.
+	 */
+	private:VertexState vertexState();
+	private:DrawState drawState() const;
+
+	/**
+	 * Hands the draw state to the rasterizer if it changed, bound
+	 * textures being written or streamed in included.
+	 */
+	private:void updateState();
+
+	/**
+	 * Runs "count" vertices through the vertex stage and draws them,
+	 * as N-patches when those are on and the primitives are triangles.
+	 * "buffer" is the vertex buffer they come from, if any, and
+	 * "first" the byte offset of "vertices" in it.
+	 */
+	private:void draw(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, const BYTE* vertices, UINT stride, UINT count, const Direct3DVertexBuffer9* buffer, UINT first);
+
+	/**
+	 * Tessellation of the triangles of a draw as N-patches, cached when
+	 * they come from a vertex buffer.
+	 */
+	private:const Tessellation& nPatch(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, const BYTE* vertices, UINT stride, const Direct3DVertexBuffer9* buffer, UINT first);
+	private:void drawTessellation(const Tessellation& tessellation);
+
+	/**
+	 * Whether a vertex buffer draw cannot reach the viewport, judged
+	 * from the bounds of its positions before any vertex is processed.
+	 */
+	private:bool offscreen(D3DPRIMITIVETYPE PrimitiveType, const Direct3DVertexBuffer9* buffer, UINT first, UINT stride, UINT count);
+	private:HRESULT drawPatch(UINT Handle, const float* pNumSegs, bool triangle, const D3DRECTPATCH_INFO* pRectPatchInfo, const D3DTRIPATCH_INFO* pTriPatchInfo);
+};
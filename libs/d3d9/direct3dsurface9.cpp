@@ -0,0 +1,108 @@
+#include "direct3dsurface9.hpp"
+#include "direct3ddevice9.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <format/PixelFormat.hpp>
+
+Direct3DSurface9::Direct3DSurface9(IDirect3DDevice9* device, IUnknown* container, UINT Width, UINT Height, D3DFORMAT Format, DWORD Usage, D3DPOOL Pool, bool Lockable) :
+	device(device), container(container), usage(Usage), pool(Pool), lockable(Lockable) {
+	const UINT pitch = (PixelFormat::pitch(Format, Width) + 3) & ~3u;
+	const size_t size = ((size_t) pitch * Height + 63) & ~(size_t) 63;
+
+	this->storage = std::shared_ptr<void>(std::aligned_alloc(64, size), std::free);
+	if (this->storage != NULL) memset(this->storage.get(), 0, size);
+	this->memory = {Format, Width, Height, pitch, (BYTE*) this->storage.get()};
+
+	if (this->container == NULL) this->device->AddRef();
+}
+
+Direct3DSurface9::Direct3DSurface9(IDirect3DDevice9* device, IDirect3DBaseTexture9* texture, UINT Face, UINT Level, const Surface& memory, DWORD Usage, D3DPOOL Pool) :
+	device(device), container(texture), texture(texture), face(Face), level(Level), usage(Usage), pool(Pool), lockable(true), memory(memory) {}
+
+Direct3DSurface9::~Direct3DSurface9() {
+	if (this->container == NULL) this->device->Release();
+}
+
+HRESULT Direct3DSurface9::QueryInterface(REFIID riid, void** ppvObject) {
+	if (ppvObject == NULL) return E_POINTER;
+
+	*ppvObject = NULL;
+	return E_NOINTERFACE;
+}
+
+ULONG Direct3DSurface9::AddRef() {
+	if (this->container != NULL) return this->container->AddRef();
+	return ++this->references;
+}
+
+ULONG Direct3DSurface9::Release() {
+	if (this->container != NULL) return this->container->Release();
+
+	ULONG references = --this->references;
+	if (references == 0) delete this;
+	return references;
+}
+
+DWORD Direct3DSurface9::SetPriority(DWORD PriorityNew) {
+	return 0;
+}
+
+DWORD Direct3DSurface9::GetPriority() {
+	return 0;
+}
+
+void Direct3DSurface9::PreLoad() {}
+
+D3DRESOURCETYPE Direct3DSurface9::GetType() {
+	return D3DRTYPE_SURFACE;
+}
+
+HRESULT Direct3DSurface9::GetDesc(D3DSURFACE_DESC* pDesc) {
+	if (pDesc == NULL) return D3DERR_INVALIDCALL;
+
+	pDesc->Format = this->memory.format;
+	pDesc->Type = D3DRTYPE_SURFACE;
+	pDesc->Usage = this->usage;
+	pDesc->Pool = this->pool;
+	pDesc->MultiSampleType = D3DMULTISAMPLE_NONE;
+	pDesc->MultiSampleQuality = 0;
+	pDesc->Width = this->memory.width;
+	pDesc->Height = this->memory.height;
+	return D3D_OK;
+}
+
+/**
+ * Render targets are drawn when the device flushes, so what is
+ * pending is rendered first.
+ */
+HRESULT Direct3DSurface9::LockRect(D3DLOCKED_RECT* pLockedRect, const RECT* pRect, DWORD Flags) {
+	if (this->texture != NULL && this->texture->GetType() == D3DRTYPE_CUBETEXTURE) {
+		return static_cast<IDirect3DCubeTexture9*>(this->texture)->LockRect((D3DCUBEMAP_FACES) this->face, this->level, pLockedRect, pRect, Flags);
+	}
+	if (this->texture != NULL) return static_cast<IDirect3DTexture9*>(this->texture)->LockRect(this->level, pLockedRect, pRect, Flags);
+	if (pLockedRect == NULL || !this->lockable || this->memory.bits == NULL) return D3DERR_INVALIDCALL;
+
+	if (this->isRenderTarget()) static_cast<Direct3DDevice9*>(this->device)->flush();
+
+	BYTE* bits = this->memory.bits;
+	if (pRect != NULL) {
+		if (pRect->left < 0 || pRect->top < 0 || pRect->right > (LONG) this->memory.width || pRect->bottom > (LONG) this->memory.height
+			|| pRect->left >= pRect->right || pRect->top >= pRect->bottom) {
+			return D3DERR_INVALIDCALL;
+		}
+
+		bits += (size_t) pRect->top * this->memory.pitch + PixelFormat::pitch(this->memory.format, pRect->left);
+	}
+
+	pLockedRect->pBits = bits;
+	pLockedRect->Pitch = this->memory.pitch;
+	return D3D_OK;
+}
+
+HRESULT Direct3DSurface9::UnlockRect() {
+	if (this->texture != NULL && this->texture->GetType() == D3DRTYPE_CUBETEXTURE) {
+		return static_cast<IDirect3DCubeTexture9*>(this->texture)->UnlockRect((D3DCUBEMAP_FACES) this->face, this->level);
+	}
+	if (this->texture != NULL) return static_cast<IDirect3DTexture9*>(this->texture)->UnlockRect(this->level);
+	return D3D_OK;
+}
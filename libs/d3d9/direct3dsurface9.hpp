@@ -0,0 +1,65 @@
+#pragma once
+#include <memory>
+#include <windows.h>
+#include <d3d9.h>
+#include "rasterizer.hpp"
+
+/**
+ * Surface in system memory: a back buffer, a render target or a
+ * texture level.
+ *
+ * Surfaces with a container (texture levels, the back buffer) use
+ * memory the container owns and count their references on it, as
+ * D3D does; the container deletes them. Standalone surfaces own
+ * their memory and hold a reference to the device.
+ */
+class Direct3DSurface9 final : public IDirect3DSurface9 {
+	private:ULONG references = 1;
+	private:IDirect3DDevice9* device;
+	private:IUnknown* container;
+	private:IDirect3DBaseTexture9* texture = NULL; //set for texture levels, which lock through it
+	private:UINT face = 0;
+	private:UINT level = 0;
+	private:DWORD usage;
+	private:D3DPOOL pool;
+	private:bool lockable;
+	private:Surface memory;
+	private:std::shared_ptr<void> storage;
+
+	/**
+	 * Surface owning zeroed memory of "Width" x "Height" pixels;
+	 * "container" may be NULL.
+	 */
+	public:Direct3DSurface9(IDirect3DDevice9* device, IUnknown* container, UINT Width, UINT Height, D3DFORMAT Format, DWORD Usage, D3DPOOL Pool, bool Lockable);
+
+	/**
+	 * Level "Level" of "texture" (of face "Face" for cube textures),
+	 * whose storage is "memory"
+	 */
+	public:Direct3DSurface9(IDirect3DDevice9* device, IDirect3DBaseTexture9* texture, UINT Face, UINT Level, const Surface& memory, DWORD Usage, D3DPOOL Pool);
+	public:~Direct3DSurface9();
+
+	public:HRESULT QueryInterface(REFIID riid, void** ppvObject) override;
+	public:ULONG AddRef() override;
+	public:ULONG Release() override;
+
+	public:DWORD SetPriority(DWORD PriorityNew) override;
+	public:DWORD GetPriority() override;
+	public:void PreLoad() override;
+	public:D3DRESOURCETYPE GetType() override;
+
+	public:HRESULT GetDesc(D3DSURFACE_DESC* pDesc) override;
+	public:HRESULT LockRect(D3DLOCKED_RECT* pLockedRect, const RECT* pRect, DWORD Flags) override;
+	public:HRESULT UnlockRect() override;
+
+	/**
+	 * Memory the rasterizer renders into
+	 */
+	public:const Surface& surface() const {
+		return this->memory;
+	}
+
+	public:bool isRenderTarget() const {
+		return (this->usage & D3DUSAGE_RENDERTARGET) != 0;
+	}
+};
@@ -0,0 +1,202 @@
+#include "direct3dtexture9.hpp"
+#include "direct3ddevice9.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <format/PixelFormat.hpp>
+#include "texturestreamer.hpp"
+
+static std::atomic<uint64_t> serials = 0;
+
+Direct3DTexture9::Direct3DTexture9(IDirect3DDevice9* device, UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool) :
+	device(device), format(Format), usage(Usage), pool(Pool), changes(++serials) {
+	UINT count = Levels == 0 ? PixelFormat::levels(Width, Height) : Levels;
+
+	for (UINT i = 0; i < count; i++) {
+		UINT width = PixelFormat::mipSize(Width, i), height = PixelFormat::mipSize(Height, i);
+		this->levels.push_back({width, height, PixelFormat::pitch(Format, width), NULL, NULL});
+	}
+	this->surfaces.resize(count);
+
+	this->device->AddRef();
+}
+
+Direct3DTexture9::~Direct3DTexture9() {
+	this->device->Release();
+}
+
+HRESULT Direct3DTexture9::QueryInterface(REFIID riid, void** ppvObject) {
+	if (ppvObject == NULL) return E_POINTER;
+
+	*ppvObject = NULL;
+	return E_NOINTERFACE;
+}
+
+ULONG Direct3DTexture9::AddRef() {
+	return ++this->references;
+}
+
+ULONG Direct3DTexture9::Release() {
+	ULONG references = --this->references;
+	if (references == 0) delete this;
+	return references;
+}
+
+/**
+ * Priorities only order the streaming of MANAGED textures.
+ */
+DWORD Direct3DTexture9::SetPriority(DWORD PriorityNew) {
+	if (this->pool != D3DPOOL_MANAGED) return 0;
+
+	return this->priority.exchange(PriorityNew);
+}
+
+DWORD Direct3DTexture9::GetPriority() {
+	return this->pool == D3DPOOL_MANAGED ? this->priority.load() : 0;
+}
+
+void Direct3DTexture9::PreLoad() {
+	if (this->resident.load(std::memory_order_acquire) > 0) TextureStreamer::shared().finish(this);
+}
+
+D3DRESOURCETYPE Direct3DTexture9::GetType() {
+	return D3DRTYPE_TEXTURE;
+}
+
+DWORD Direct3DTexture9::SetLOD(DWORD LODNew) {
+	if (this->pool != D3DPOOL_MANAGED) return 0;
+
+	DWORD old = this->lod;
+	this->lod = std::min<DWORD>(LODNew, this->levels.size() - 1);
+	return old;
+}
+
+DWORD Direct3DTexture9::GetLOD() {
+	return this->pool == D3DPOOL_MANAGED ? this->lod : 0;
+}
+
+DWORD Direct3DTexture9::GetLevelCount() {
+	return this->levels.size();
+}
+
+HRESULT Direct3DTexture9::GetLevelDesc(UINT Level, D3DSURFACE_DESC* pDesc) {
+	if (pDesc == NULL || Level >= this->levels.size()) return D3DERR_INVALIDCALL;
+
+	pDesc->Format = this->format;
+	pDesc->Type = D3DRTYPE_SURFACE;
+	pDesc->Usage = this->usage;
+	pDesc->Pool = this->pool;
+	pDesc->MultiSampleType = D3DMULTISAMPLE_NONE;
+	pDesc->MultiSampleQuality = 0;
+	pDesc->Width = this->levels[Level].width;
+	pDesc->Height = this->levels[Level].height;
+	return D3D_OK;
+}
+
+HRESULT Direct3DTexture9::GetSurfaceLevel(UINT Level, IDirect3DSurface9** ppSurfaceLevel) {
+	if (ppSurfaceLevel == NULL) return D3DERR_INVALIDCALL;
+
+	*ppSurfaceLevel = NULL;
+	const Direct3DTexture9::Level* storage = this->level(Level);
+	if (storage == NULL) return D3DERR_INVALIDCALL;
+
+	std::unique_ptr<Direct3DSurface9>& surface = this->surfaces[Level];
+	if (surface == NULL) {
+		const Surface memory = {this->format, storage->width, storage->height, storage->pitch, storage->bits};
+		surface.reset(new (std::nothrow) Direct3DSurface9(this->device, this, 0, Level, memory, this->usage, this->pool));
+		if (surface == NULL) return E_OUTOFMEMORY;
+	}
+
+	surface->AddRef();
+	*ppSurfaceLevel = surface.get();
+	return D3D_OK;
+}
+
+/**
+ * One zeroed block for every level that has no storage yet.
+ */
+void Direct3DTexture9::allocate() {
+	size_t total = 0;
+	for (const Level& level : this->levels) {
+		if (level.bits == NULL) total += ((size_t) level.pitch * PixelFormat::rows(this->format, level.height) + 63) & ~(size_t) 63;
+	}
+	if (total == 0) return;
+
+	std::shared_ptr<void> block(std::aligned_alloc(64, total), std::free);
+	if (block == NULL) return;
+	memset(block.get(), 0, total);
+
+	BYTE* next = (BYTE*) block.get();
+	for (Level& level : this->levels) {
+		if (level.bits != NULL) continue;
+
+		level.bits = next;
+		level.owner = block;
+		next += ((size_t) level.pitch * PixelFormat::rows(this->format, level.height) + 63) & ~(size_t) 63;
+	}
+}
+
+const Direct3DTexture9::Level* Direct3DTexture9::level(UINT level) {
+	if (level >= this->levels.size()) return NULL;
+	if (this->levels[level].bits == NULL) this->allocate();
+
+	return this->levels[level].bits != NULL ? &this->levels[level] : NULL;
+}
+
+bool Direct3DTexture9::adopt(UINT level, std::shared_ptr<void> owner, BYTE* bits, UINT pitch) {
+	if (level >= this->levels.size() || this->levels[level].bits != NULL) return false;
+	if (pitch < PixelFormat::pitch(this->format, this->levels[level].width)) return false;
+
+	this->levels[level].bits = bits;
+	this->levels[level].pitch = pitch;
+	this->levels[level].owner = std::move(owner);
+	return true;
+}
+
+void Direct3DTexture9::stream(UINT resident, std::function<void()> load) {
+	this->resident.store(std::min<UINT>(resident, this->levels.size()), std::memory_order_release);
+
+	TextureStreamer::shared().enqueue(this, [this, load = std::move(load)]() {
+		load();
+		this->changes.store(++serials, std::memory_order_release);
+		this->resident.store(0, std::memory_order_release);
+	});
+}
+
+UINT Direct3DTexture9::firstLevel() const {
+	const UINT resident = this->resident.load(std::memory_order_acquire);
+	if (resident >= this->levels.size()) return this->levels.size();
+	return std::min<UINT>(std::max<UINT>(this->lod, resident), this->levels.size() - 1);
+}
+
+HRESULT Direct3DTexture9::LockRect(UINT Level, D3DLOCKED_RECT* pLockedRect, const RECT* pRect, DWORD Flags) {
+	if (pLockedRect == NULL) return D3DERR_INVALIDCALL;
+	//the application sees the texture as loaded, and as rendered to; pending draws sample what they were drawn with
+	if (Level < this->resident.load(std::memory_order_acquire)) TextureStreamer::shared().finish(this);
+	static_cast<Direct3DDevice9*>(this->device)->flush();
+
+	const Direct3DTexture9::Level* storage = this->level(Level);
+	if (storage == NULL) return D3DERR_INVALIDCALL;
+	if (!(Flags & D3DLOCK_READONLY)) this->changes = ++serials;
+
+	BYTE* bits = storage->bits;
+	if (pRect != NULL) {
+		if (pRect->left < 0 || pRect->top < 0 || pRect->right > (LONG) storage->width || pRect->bottom > (LONG) storage->height
+			|| pRect->left >= pRect->right || pRect->top >= pRect->bottom) {
+			return D3DERR_INVALIDCALL;
+		}
+
+		//DXTn rectangles are addressed in 4x4 blocks
+		UINT row = PixelFormat::isCompressed(this->format) ? pRect->top / 4 : pRect->top;
+		bits += (size_t) row * storage->pitch + PixelFormat::pitch(this->format, pRect->left);
+	}
+
+	pLockedRect->pBits = bits;
+	pLockedRect->Pitch = storage->pitch;
+	return D3D_OK;
+}
+
+HRESULT Direct3DTexture9::UnlockRect(UINT Level) {
+	return Level < this->levels.size() ? D3D_OK : D3DERR_INVALIDCALL;
+}
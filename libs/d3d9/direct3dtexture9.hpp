@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <windows.h>
+#include <d3d9.h>
+#include "direct3dsurface9.hpp"
+
+/**
+ * 2D texture in system memory.
+ *
+ * Storage is allocated on first use, so a level can instead be
+ * adopted from memory someone else owns (D3DX maps DDS files and
+ * hands their mips over without copying). Adopted memory must be
+ * writable; a private file mapping copies pages only when locked
+ * for writing.
+ *
+ * MANAGED textures can be streamed: levels above "resident" are
+ * filled by a background job while sampling uses the resident ones.
+ */
+class Direct3DTexture9 final : public IDirect3DTexture9 {
+	public:struct Level {
+		UINT width;
+		UINT height;
+		UINT pitch;
+		BYTE* bits;
+		std::shared_ptr<void> owner;
+	};
+
+	private:std::atomic<ULONG> references = 1; //TextureStreamer jobs release theirs on worker threads
+	private:IDirect3DDevice9* device;
+	private:D3DFORMAT format;
+	private:DWORD usage;
+	private:D3DPOOL pool;
+	private:std::vector<Level> levels;
+	private:std::atomic<DWORD> priority = 0;
+	private:DWORD lod = 0;
+	private:std::atomic<UINT> resident = 0;
+	private:std::atomic<uint64_t> changes; //also bumped by the streaming job
+	private:std::vector<std::unique_ptr<Direct3DSurface9>> surfaces; //per level, made by GetSurfaceLevel()
+
+	public:Direct3DTexture9(IDirect3DDevice9* device, UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool);
+	public:~Direct3DTexture9();
+
+	public:HRESULT QueryInterface(REFIID riid, void** ppvObject) override;
+	public:ULONG AddRef() override;
+	public:ULONG Release() override;
+
+	public:DWORD SetPriority(DWORD PriorityNew) override;
+	public:DWORD GetPriority() override;
+	public:void PreLoad() override;
+	public:D3DRESOURCETYPE GetType() override;
+
+	public:DWORD SetLOD(DWORD LODNew) override;
+	public:DWORD GetLOD() override;
+	public:DWORD GetLevelCount() override;
+	public:HRESULT GetLevelDesc(UINT Level, D3DSURFACE_DESC* pDesc) override;
+	public:HRESULT GetSurfaceLevel(UINT Level, IDirect3DSurface9** ppSurfaceLevel) override;
+	public:HRESULT LockRect(UINT Level, D3DLOCKED_RECT* pLockedRect, const RECT* pRect, DWORD Flags) override;
+	public:HRESULT UnlockRect(UINT Level) override;
+
+	/**
+	 * Use "bits" (rows "pitch" bytes apart, kept alive by "owner")
+	 * as the storage of "level". Only before the level is used.
+	 */
+	public:bool adopt(UINT level, std::shared_ptr<void> owner, BYTE* bits, UINT pitch);
+
+	/**
+	 * Storage of "level", allocating what is still missing.
+	 */
+	public:const Level* level(UINT level);
+
+	/**
+	 * Levels before "resident" are filled by "load" on the
+	 * TextureStreamer; their storage must exist already. Its end bumps
+	 * the version. With every level streamed, nothing can be sampled
+	 * until it ends.
+	 */
+	public:void stream(UINT resident, std::function<void()> load);
+
+	/**
+	 * Most detailed level sampling may read: the LOD, or the first
+	 * resident level while the others are streamed in. The level count
+	 * while none is resident.
+	 */
+	public:UINT firstLevel() const;
+
+	/**
+	 * Changes with every lock that may write the texels, and is unique
+	 * among textures of this type for the life of the process. 0 for
+	 * render targets, which draws write without locking.
+	 */
+	public:uint64_t version() const {
+		return this->usage & (D3DUSAGE_RENDERTARGET | D3DUSAGE_DEPTHSTENCIL) ? 0 : this->changes.load(std::memory_order_acquire);
+	}
+
+	private:void allocate();
+};
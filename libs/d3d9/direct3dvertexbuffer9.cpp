@@ -0,0 +1,84 @@
+#include "direct3dvertexbuffer9.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+static std::atomic<uint64_t> serials = 0;
+
+Direct3DVertexBuffer9::Direct3DVertexBuffer9(IDirect3DDevice9* device, UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool) :
+	device(device), length(Length), usage(Usage), fvf(FVF), pool(Pool), serial(++serials) {
+	const size_t size = ((size_t) Length + 63) & ~(size_t) 63;
+
+	this->storage = std::shared_ptr<void>(std::aligned_alloc(64, size), std::free);
+	if (this->storage != NULL) memset(this->storage.get(), 0, size);
+
+	this->device->AddRef();
+}
+
+Direct3DVertexBuffer9::~Direct3DVertexBuffer9() {
+	this->device->Release();
+}
+
+HRESULT Direct3DVertexBuffer9::QueryInterface(REFIID riid, void** ppvObject) {
+	if (ppvObject == NULL) return E_POINTER;
+
+	*ppvObject = NULL;
+	return E_NOINTERFACE;
+}
+
+ULONG Direct3DVertexBuffer9::AddRef() {
+	return ++this->references;
+}
+
+ULONG Direct3DVertexBuffer9::Release() {
+	ULONG references = --this->references;
+	if (references == 0) delete this;
+	return references;
+}
+
+DWORD Direct3DVertexBuffer9::SetPriority(DWORD PriorityNew) {
+	if (this->pool != D3DPOOL_MANAGED) return 0;
+
+	DWORD old = this->priority;
+	this->priority = PriorityNew;
+	return old;
+}
+
+DWORD Direct3DVertexBuffer9::GetPriority() {
+	return this->pool == D3DPOOL_MANAGED ? this->priority : 0;
+}
+
+void Direct3DVertexBuffer9::PreLoad() {}
+
+D3DRESOURCETYPE Direct3DVertexBuffer9::GetType() {
+	return D3DRTYPE_VERTEXBUFFER;
+}
+
+/**
+ * A size of 0 locks the whole buffer from the offset. DISCARD and
+ * NOOVERWRITE need no renaming: draws have read their vertices already.
+ */
+HRESULT Direct3DVertexBuffer9::Lock(UINT OffsetToLock, UINT SizeToLock, void** ppbData, DWORD Flags) {
+	if (ppbData == NULL || this->storage == NULL || OffsetToLock > this->length) return D3DERR_INVALIDCALL;
+	if (SizeToLock != 0 && SizeToLock > this->length - OffsetToLock) return D3DERR_INVALIDCALL;
+
+	if (!(Flags & D3DLOCK_READONLY)) this->changes++;
+	*ppbData = (BYTE*) this->storage.get() + OffsetToLock;
+	return D3D_OK;
+}
+
+HRESULT Direct3DVertexBuffer9::Unlock() {
+	return D3D_OK;
+}
+
+HRESULT Direct3DVertexBuffer9::GetDesc(D3DVERTEXBUFFER_DESC* pDesc) {
+	if (pDesc == NULL) return D3DERR_INVALIDCALL;
+
+	pDesc->Format = D3DFMT_VERTEXDATA;
+	pDesc->Type = D3DRTYPE_VERTEXBUFFER;
+	pDesc->Usage = this->usage;
+	pDesc->Pool = this->pool;
+	pDesc->Size = this->length;
+	pDesc->FVF = this->fvf;
+	return D3D_OK;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <windows.h>
+#include <d3d9.h>
+
+/**
+ * Vertex buffer in system memory.
+ *
+ * Draws read it when they are issued, so locking never waits for
+ * the rasterizer. Every lock that may write bumps version(): caches
+ * of what was derived from the vertices (tessellated patches) compare
+ * it with the version they were built from.
+ */
+class Direct3DVertexBuffer9 final : public IDirect3DVertexBuffer9 {
+	private:ULONG references = 1;
+	private:IDirect3DDevice9* device;
+	private:UINT length;
+	private:DWORD usage;
+	private:DWORD fvf;
+	private:D3DPOOL pool;
+	private:std::shared_ptr<void> storage;
+	private:uint64_t serial; //unique for the life of the process, unlike the address
+	private:uint64_t changes = 0;
+	private:DWORD priority = 0;
+
+	public:Direct3DVertexBuffer9(IDirect3DDevice9* device, UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool);
+	public:~Direct3DVertexBuffer9();
+
+	public:HRESULT QueryInterface(REFIID riid, void** ppvObject) override;
+	public:ULONG AddRef() override;
+	public:ULONG Release() override;
+
+	public:DWORD SetPriority(DWORD PriorityNew) override;
+	public:DWORD GetPriority() override;
+	public:void PreLoad() override;
+	public:D3DRESOURCETYPE GetType() override;
+
+	public:HRESULT Lock(UINT OffsetToLock, UINT SizeToLock, void** ppbData, DWORD Flags) override;
+	public:HRESULT Unlock() override;
+	public:HRESULT GetDesc(D3DVERTEXBUFFER_DESC* pDesc) override;
+
+	/**
+	 * The vertices, NULL when out of memory.
+	 */
+	public:const BYTE* data() const {
+		return (const BYTE*) this->storage.get();
+	}
+
+	public:UINT size() const {
+		return this->length;
+	}
+
+	public:uint64_t id() const {
+		return this->serial;
+	}
+
+	/**
+	 * Count of locks that may have changed the vertices.
+	 */
+	public:uint64_t version() const {
+		return this->changes;
+	}
+};
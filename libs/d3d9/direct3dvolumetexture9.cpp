@@ -0,0 +1,171 @@
+#include "direct3dvolumetexture9.hpp"
+#include "direct3ddevice9.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <format/PixelFormat.hpp>
+
+static std::atomic<uint64_t> serials = 0;
+
+Direct3DVolumeTexture9::Direct3DVolumeTexture9(IDirect3DDevice9* device, UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool) :
+	device(device), format(Format), usage(Usage), pool(Pool), texelSize(PixelFormat::bits(Format) / 8), changes(++serials) {
+	UINT count = Levels == 0 ? PixelFormat::levels(std::max(Width, Height), Depth) : Levels;
+
+	size_t total = 0;
+	std::vector<size_t> offsets;
+	for (UINT i = 0; i < count; i++) {
+		UINT width = PixelFormat::mipSize(Width, i), height = PixelFormat::mipSize(Height, i), depth = PixelFormat::mipSize(Depth, i);
+		UINT bricksX = (width + 3) / 4, bricksY = (height + 3) / 4, bricksZ = (depth + 3) / 4;
+
+		this->levels.push_back({width, height, depth, bricksX, bricksY, NULL});
+		offsets.push_back(total);
+		total += (size_t) bricksX * bricksY * bricksZ * 64 * this->texelSize;
+	}
+	this->locks.resize(count);
+
+	this->storage = std::shared_ptr<void>(std::aligned_alloc(64, total), std::free);
+	if (this->storage != NULL) {
+		memset(this->storage.get(), 0, total);
+		for (UINT i = 0; i < count; i++) this->levels[i].bits = (BYTE*) this->storage.get() + offsets[i];
+	}
+
+	this->device->AddRef();
+}
+
+Direct3DVolumeTexture9::~Direct3DVolumeTexture9() {
+	this->device->Release();
+}
+
+HRESULT Direct3DVolumeTexture9::QueryInterface(REFIID riid, void** ppvObject) {
+	if (ppvObject == NULL) return E_POINTER;
+
+	*ppvObject = NULL;
+	return E_NOINTERFACE;
+}
+
+ULONG Direct3DVolumeTexture9::AddRef() {
+	return ++this->references;
+}
+
+ULONG Direct3DVolumeTexture9::Release() {
+	ULONG references = --this->references;
+	if (references == 0) delete this;
+	return references;
+}
+
+DWORD Direct3DVolumeTexture9::SetPriority(DWORD PriorityNew) {
+	if (this->pool != D3DPOOL_MANAGED) return 0;
+
+	DWORD old = this->priority;
+	this->priority = PriorityNew;
+	return old;
+}
+
+DWORD Direct3DVolumeTexture9::GetPriority() {
+	return this->pool == D3DPOOL_MANAGED ? this->priority : 0;
+}
+
+void Direct3DVolumeTexture9::PreLoad() {}
+
+D3DRESOURCETYPE Direct3DVolumeTexture9::GetType() {
+	return D3DRTYPE_VOLUMETEXTURE;
+}
+
+DWORD Direct3DVolumeTexture9::SetLOD(DWORD LODNew) {
+	if (this->pool != D3DPOOL_MANAGED) return 0;
+
+	DWORD old = this->lod;
+	this->lod = std::min<DWORD>(LODNew, this->levels.size() - 1);
+	return old;
+}
+
+DWORD Direct3DVolumeTexture9::GetLOD() {
+	return this->pool == D3DPOOL_MANAGED ? this->lod : 0;
+}
+
+DWORD Direct3DVolumeTexture9::GetLevelCount() {
+	return this->levels.size();
+}
+
+HRESULT Direct3DVolumeTexture9::GetLevelDesc(UINT Level, D3DVOLUME_DESC* pDesc) {
+	if (pDesc == NULL || Level >= this->levels.size()) return D3DERR_INVALIDCALL;
+
+	pDesc->Format = this->format;
+	pDesc->Type = D3DRTYPE_VOLUME;
+	pDesc->Usage = this->usage;
+	pDesc->Pool = this->pool;
+	pDesc->Width = this->levels[Level].width;
+	pDesc->Height = this->levels[Level].height;
+	pDesc->Depth = this->levels[Level].depth;
+	return D3D_OK;
+}
+
+/**
+ * Moves the locked box between the linear copy and the bricks, in
+ * runs of up to four texels that are contiguous in both.
+ */
+void Direct3DVolumeTexture9::copy(const Level& level, const Lock& lock, bool toBricks) {
+	const size_t row = (size_t) level.width * this->texelSize, slice = row * level.height;
+	const D3DBOX& box = lock.box;
+
+	for (UINT z = box.Front; z < box.Back; z++) {
+		for (UINT y = box.Top; y < box.Bottom; y++) {
+			for (UINT x = box.Left; x < box.Right;) {
+				const UINT run = std::min<UINT>((x | 3) + 1, box.Right) - x;
+				BYTE* linear = (BYTE*) lock.linear.data() + z * slice + y * row + (size_t) x * this->texelSize;
+				BYTE* brick = level.bits + this->offset(level, x, y, z);
+
+				if (toBricks) memcpy(brick, linear, run * this->texelSize);
+				else memcpy(linear, brick, run * this->texelSize);
+				x += run;
+			}
+		}
+	}
+}
+
+HRESULT Direct3DVolumeTexture9::LockBox(UINT Level, D3DLOCKED_BOX* pLockedVolume, const D3DBOX* pBox, DWORD Flags) {
+	if (pLockedVolume == NULL || Level >= this->levels.size() || this->locks[Level] != NULL) return D3DERR_INVALIDCALL;
+
+	const Direct3DVolumeTexture9::Level& storage = this->levels[Level];
+	if (storage.bits == NULL) return D3DERR_INVALIDCALL;
+
+	//pending draws sample what they were drawn with
+	static_cast<Direct3DDevice9*>(this->device)->flush();
+
+	D3DBOX box = {0, 0, storage.width, storage.height, 0, storage.depth};
+	if (pBox != NULL) {
+		if (pBox->Right > storage.width || pBox->Bottom > storage.height || pBox->Back > storage.depth
+			|| pBox->Left >= pBox->Right || pBox->Top >= pBox->Bottom || pBox->Front >= pBox->Back) {
+			return D3DERR_INVALIDCALL;
+		}
+		box = *pBox;
+	}
+
+	std::unique_ptr<Lock> lock(new (std::nothrow) Lock());
+	if (lock == NULL) return E_OUTOFMEMORY;
+
+	const size_t row = (size_t) storage.width * this->texelSize, slice = row * storage.height;
+	lock->linear.resize(slice * storage.depth);
+	lock->box = box;
+	lock->write = (Flags & D3DLOCK_READONLY) == 0;
+	if ((Flags & D3DLOCK_DISCARD) == 0) this->copy(storage, *lock, false);
+
+	pLockedVolume->RowPitch = row;
+	pLockedVolume->SlicePitch = slice;
+	pLockedVolume->pBits = lock->linear.data() + box.Front * slice + box.Top * row + (size_t) box.Left * this->texelSize;
+	this->locks[Level] = std::move(lock);
+	return D3D_OK;
+}
+
+HRESULT Direct3DVolumeTexture9::UnlockBox(UINT Level) {
+	if (Level >= this->levels.size() || this->locks[Level] == NULL) return D3DERR_INVALIDCALL;
+
+	if (this->locks[Level]->write) {
+		this->copy(this->levels[Level], *this->locks[Level], true);
+		this->changes = ++serials;
+	}
+	this->locks[Level].reset();
+	return D3D_OK;
+}
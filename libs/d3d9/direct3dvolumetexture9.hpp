@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <windows.h>
+#include <d3d9.h>
+
+/**
+ * Volume texture in system memory.
+ *
+ * Levels are stored in bricks of 4x4x4 texels, so the eight texels a
+ * trilinear fetch reads are in one or two cache lines however the
+ * volume is sliced. Bricks are laid out x first, then y, then z, and
+ * texels within a brick the same way. Locking hands out a linear copy
+ * of the level that is swizzled back into bricks on unlock.
+ *
+ * DXTn volumes are not supported: their blocks are 2D.
+ */
+class Direct3DVolumeTexture9 final : public IDirect3DVolumeTexture9 {
+	public:static constexpr const UINT BRICK = 4;
+
+	public:struct Level {
+		UINT width;
+		UINT height;
+		UINT depth;
+		UINT bricksX; //bricks per row
+		UINT bricksY; //rows of bricks per slice
+		BYTE* bits;
+	};
+
+	private:struct Lock {
+		std::vector<BYTE> linear;
+		D3DBOX box;
+		bool write;
+	};
+
+	private:ULONG references = 1;
+	private:IDirect3DDevice9* device;
+	private:D3DFORMAT format;
+	private:DWORD usage;
+	private:D3DPOOL pool;
+	private:UINT texelSize;
+	private:std::vector<Level> levels;
+	private:std::vector<std::unique_ptr<Lock>> locks; //per level, while locked
+	private:std::shared_ptr<void> storage;
+	private:DWORD priority = 0;
+	private:DWORD lod = 0;
+	private:uint64_t changes;
+
+	public:Direct3DVolumeTexture9(IDirect3DDevice9* device, UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool);
+	public:~Direct3DVolumeTexture9();
+
+	public:HRESULT QueryInterface(REFIID riid, void** ppvObject) override;
+	public:ULONG AddRef() override;
+	public:ULONG Release() override;
+
+	public:DWORD SetPriority(DWORD PriorityNew) override;
+	public:DWORD GetPriority() override;
+	public:void PreLoad() override;
+	public:D3DRESOURCETYPE GetType() override;
+
+	public:DWORD SetLOD(DWORD LODNew) override;
+	public:DWORD GetLOD() override;
+	public:DWORD GetLevelCount() override;
+	public:HRESULT GetLevelDesc(UINT Level, D3DVOLUME_DESC* pDesc) override;
+	public:HRESULT LockBox(UINT Level, D3DLOCKED_BOX* pLockedVolume, const D3DBOX* pBox, DWORD Flags) override;
+	public:HRESULT UnlockBox(UINT Level) override;
+
+	/**
+	 * Bricked storage of "level"; its bits are NULL when out of memory.
+	 */
+	public:const Level& level(UINT level) const {
+		return this->levels[level];
+	}
+
+	/**
+	 * Owner of the storage of every level.
+	 */
+	public:const std::shared_ptr<void>& memory() const {
+		return this->storage;
+	}
+
+	/**
+	 * Most detailed level sampling may read.
+	 */
+	public:UINT firstLevel() const {
+		return this->lod;
+	}
+
+	/**
+	 * Changes when an unlock swizzles written texels back into bricks;
+	 * see Direct3DTexture9::version().
+	 */
+	public:uint64_t version() const {
+		return this->usage & (D3DUSAGE_RENDERTARGET | D3DUSAGE_DEPTHSTENCIL) ? 0 : this->changes;
+	}
+
+	/**
+	 * Byte offset of texel ("x", "y", "z") in "level".
+	 */
+	public:size_t offset(const Level& level, UINT x, UINT y, UINT z) const {
+		const size_t brick = ((size_t) (z / 4) * level.bricksY + y / 4) * level.bricksX + x / 4;
+		return (brick * 64 + (z % 4) * 16 + (y % 4) * 4 + x % 4) * this->texelSize;
+	}
+
+	private:void copy(const Level& level, const Lock& lock, bool toBricks);
+};
@@ -0,0 +1,462 @@
+#include "outputmerger.hpp"
+#include "blockaccess.hpp"
+#include <algorithm>
+#include <simd/Lanes.hpp>
+#include <simd/VectorMath.hpp>
+#include <format/PixelFormat.hpp>
+
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+using Lanes::f32x8;
+using Lanes::i32x8;
+using Lanes::u32x8;
+typedef OutputMerger::Mode Mode;
+
+#define ODX_INLINE inline __attribute__((always_inline))
+
+//--- formats
+
+/**
+ * Conversion between render target pixels and r, g, b, a lanes.
+ * UNORM formats clamp to 0..1; formats without alpha read as 1.
+ * F16C is set in kernels built for AVX2.
+ */
+template<D3DFORMAT F> struct Format;
+
+template<> struct Format<D3DFMT_A8R8G8B8> {
+	static constexpr bool UNORM = true;
+	static constexpr DWORD CHANNELS = 0xF;
+
+	template<bool F16C>
+	static ODX_INLINE void load(const Surface& surface, int bx, int by, f32x8* color) {
+		const u32x8 p = load32(surface, bx, by);
+		color[0] = Lanes::fromUnorm8(p >> 16);
+		color[1] = Lanes::fromUnorm8(p >> 8);
+		color[2] = Lanes::fromUnorm8(p);
+		color[3] = Lanes::fromUnorm8(p >> 24);
+	}
+
+	template<bool F16C>
+	static ODX_INLINE void store(const Surface& surface, int bx, int by, const f32x8* color, uint32_t mask) {
+		const u32x8 p = Lanes::toUnorm8(color[3]) << 24 | Lanes::toUnorm8(color[0]) << 16 | Lanes::toUnorm8(color[1]) << 8 | Lanes::toUnorm8(color[2]);
+		store32(surface, bx, by, p, mask);
+	}
+};
+
+template<> struct Format<D3DFMT_X8R8G8B8> {
+	static constexpr bool UNORM = true;
+	static constexpr DWORD CHANNELS = 0x7;
+
+	template<bool F16C>
+	static ODX_INLINE void load(const Surface& surface, int bx, int by, f32x8* color) {
+		const u32x8 p = load32(surface, bx, by);
+		color[0] = Lanes::fromUnorm8(p >> 16);
+		color[1] = Lanes::fromUnorm8(p >> 8);
+		color[2] = Lanes::fromUnorm8(p);
+		color[3] = Lanes::splat(1.0f);
+	}
+
+	template<bool F16C>
+	static ODX_INLINE void store(const Surface& surface, int bx, int by, const f32x8* color, uint32_t mask) {
+		const u32x8 p = 0xFF000000 | Lanes::toUnorm8(color[0]) << 16 | Lanes::toUnorm8(color[1]) << 8 | Lanes::toUnorm8(color[2]);
+		store32(surface, bx, by, p, mask);
+	}
+};
+
+template<> struct Format<D3DFMT_R5G6B5> {
+	static constexpr bool UNORM = true;
+	static constexpr DWORD CHANNELS = 0x7;
+
+	template<bool F16C>
+	static ODX_INLINE void load(const Surface& surface, int bx, int by, f32x8* color) {
+		uint16_t lanes[8];
+		gather(surface, bx, by, lanes);
+		const u32x8 p = {lanes[0], lanes[1], lanes[2], lanes[3], lanes[4], lanes[5], lanes[6], lanes[7]};
+
+		color[0] = Lanes::toFloat((i32x8) (p >> 11)) * (1.0f / 31.0f);
+		color[1] = Lanes::toFloat((i32x8) (p >> 5 & 63)) * (1.0f / 63.0f);
+		color[2] = Lanes::toFloat((i32x8) (p & 31)) * (1.0f / 31.0f);
+		color[3] = Lanes::splat(1.0f);
+	}
+
+	template<bool F16C>
+	static ODX_INLINE void store(const Surface& surface, int bx, int by, const f32x8* color, uint32_t mask) {
+		const u32x8 r = (u32x8) Lanes::toInt(Lanes::clamp01(color[0]) * 31.0f + 0.5f);
+		const u32x8 g = (u32x8) Lanes::toInt(Lanes::clamp01(color[1]) * 63.0f + 0.5f);
+		const u32x8 b = (u32x8) Lanes::toInt(Lanes::clamp01(color[2]) * 31.0f + 0.5f);
+		const u32x8 p = r << 11 | g << 5 | b;
+
+		uint16_t lanes[8];
+		for (int i = 0; i < 8; i++) lanes[i] = p[i];
+		scatter(surface, bx, by, lanes, mask);
+	}
+};
+
+/**
+ * Eight floats or halves at "p", as the kernel's target allows
+ */
+template<bool F16C>
+ODX_INLINE f32x8 unpack(const float* p) {
+	return Lanes::load(p);
+}
+
+template<bool F16C>
+ODX_INLINE f32x8 unpack(const uint16_t* p) {
+	#if defined(__x86_64__)
+		if constexpr (F16C) return Lanes::loadHalfF16C(p);
+	#endif
+	return Lanes::loadHalf(p);
+}
+
+template<bool F16C>
+ODX_INLINE void pack(float* p, f32x8 v) {
+	Lanes::store(p, v);
+}
+
+template<bool F16C>
+ODX_INLINE void pack(uint16_t* p, f32x8 v) {
+	#if defined(__x86_64__)
+		if constexpr (F16C) {
+			Lanes::storeHalfF16C(p, v);
+			return;
+		}
+	#endif
+	Lanes::storeHalf(p, v);
+}
+
+/**
+ * Float and half formats: N channels of type C per pixel, red first.
+ * The block's 8 * N channels are converted N vectors at a time and
+ * then transposed, so each conversion is one F16C instruction. Missing
+ * channels read as 1, as D3D samples them.
+ */
+template<typename C, int N>
+struct FloatFormat {
+	static constexpr bool UNORM = false;
+	static constexpr DWORD CHANNELS = (1 << N) - 1;
+
+	struct Pixel {
+		C channels[N];
+	};
+
+	template<bool F16C>
+	static ODX_INLINE void load(const Surface& surface, int bx, int by, f32x8* color) {
+		Pixel lanes[8];
+		C channels[8 * N];
+		gather(surface, bx, by, lanes);
+		memcpy(channels, lanes, sizeof(lanes));
+
+		f32x8 v[N];
+		for (int k = 0; k < N; k++) v[k] = unpack<F16C>(channels + k * 8);
+
+		if constexpr (N == 1) {
+			color[0] = v[0];
+		} else if constexpr (N == 2) {
+			color[0] = __builtin_shufflevector(v[0], v[1], 0, 2, 4, 6, 8, 10, 12, 14);
+			color[1] = __builtin_shufflevector(v[0], v[1], 1, 3, 5, 7, 9, 11, 13, 15);
+		} else {
+			const f32x8 rg0 = __builtin_shufflevector(v[0], v[1], 0, 4, 8, 12, 1, 5, 9, 13);
+			const f32x8 ba0 = __builtin_shufflevector(v[0], v[1], 2, 6, 10, 14, 3, 7, 11, 15);
+			const f32x8 rg1 = __builtin_shufflevector(v[2], v[3], 0, 4, 8, 12, 1, 5, 9, 13);
+			const f32x8 ba1 = __builtin_shufflevector(v[2], v[3], 2, 6, 10, 14, 3, 7, 11, 15);
+			color[0] = __builtin_shufflevector(rg0, rg1, 0, 1, 2, 3, 8, 9, 10, 11);
+			color[1] = __builtin_shufflevector(rg0, rg1, 4, 5, 6, 7, 12, 13, 14, 15);
+			color[2] = __builtin_shufflevector(ba0, ba1, 0, 1, 2, 3, 8, 9, 10, 11);
+			color[3] = __builtin_shufflevector(ba0, ba1, 4, 5, 6, 7, 12, 13, 14, 15);
+		}
+		for (int c = N; c < 4; c++) color[c] = Lanes::splat(1.0f);
+	}
+
+	template<bool F16C>
+	static ODX_INLINE void store(const Surface& surface, int bx, int by, const f32x8* color, uint32_t mask) {
+		f32x8 v[N];
+		if constexpr (N == 1) {
+			v[0] = color[0];
+		} else if constexpr (N == 2) {
+			v[0] = __builtin_shufflevector(color[0], color[1], 0, 8, 1, 9, 2, 10, 3, 11);
+			v[1] = __builtin_shufflevector(color[0], color[1], 4, 12, 5, 13, 6, 14, 7, 15);
+		} else {
+			const f32x8 rb0 = __builtin_shufflevector(color[0], color[2], 0, 8, 1, 9, 2, 10, 3, 11);
+			const f32x8 rb1 = __builtin_shufflevector(color[0], color[2], 4, 12, 5, 13, 6, 14, 7, 15);
+			const f32x8 ga0 = __builtin_shufflevector(color[1], color[3], 0, 8, 1, 9, 2, 10, 3, 11);
+			const f32x8 ga1 = __builtin_shufflevector(color[1], color[3], 4, 12, 5, 13, 6, 14, 7, 15);
+			v[0] = __builtin_shufflevector(rb0, ga0, 0, 8, 1, 9, 2, 10, 3, 11);
+			v[1] = __builtin_shufflevector(rb0, ga0, 4, 12, 5, 13, 6, 14, 7, 15);
+			v[2] = __builtin_shufflevector(rb1, ga1, 0, 8, 1, 9, 2, 10, 3, 11);
+			v[3] = __builtin_shufflevector(rb1, ga1, 4, 12, 5, 13, 6, 14, 7, 15);
+		}
+
+		Pixel lanes[8];
+		C channels[8 * N];
+		for (int k = 0; k < N; k++) pack<F16C>(channels + k * 8, v[k]);
+		memcpy(lanes, channels, sizeof(lanes));
+		scatter(surface, bx, by, lanes, mask);
+	}
+};
+
+template<> struct Format<D3DFMT_R16F> : FloatFormat<uint16_t, 1> {};
+template<> struct Format<D3DFMT_G16R16F> : FloatFormat<uint16_t, 2> {};
+template<> struct Format<D3DFMT_A16B16G16R16F> : FloatFormat<uint16_t, 4> {};
+template<> struct Format<D3DFMT_R32F> : FloatFormat<float, 1> {};
+template<> struct Format<D3DFMT_G32R32F> : FloatFormat<float, 2> {};
+template<> struct Format<D3DFMT_A32B32G32R32F> : FloatFormat<float, 4> {};
+
+//--- blending
+
+ODX_INLINE void blendFactor(D3DBLEND blend, const f32x8* src, const f32x8* dst, const f32x8* constant, f32x8* factor) {
+	const f32x8 one = Lanes::splat(1.0f);
+
+	for (int c = 0; c < 4; c++) {
+		switch (blend) {
+			case D3DBLEND_ZERO: factor[c] = Lanes::splat(0.0f); break;
+			case D3DBLEND_SRCCOLOR: factor[c] = src[c]; break;
+			case D3DBLEND_INVSRCCOLOR: factor[c] = one - src[c]; break;
+			case D3DBLEND_SRCALPHA: factor[c] = src[3]; break;
+			case D3DBLEND_INVSRCALPHA: factor[c] = one - src[3]; break;
+			case D3DBLEND_DESTALPHA: factor[c] = dst[3]; break;
+			case D3DBLEND_INVDESTALPHA: factor[c] = one - dst[3]; break;
+			case D3DBLEND_DESTCOLOR: factor[c] = dst[c]; break;
+			case D3DBLEND_INVDESTCOLOR: factor[c] = one - dst[c]; break;
+			case D3DBLEND_SRCALPHASAT: factor[c] = c == 3 ? one : Lanes::min(src[3], one - dst[3]); break;
+			case D3DBLEND_BLENDFACTOR: factor[c] = constant[c]; break;
+			case D3DBLEND_INVBLENDFACTOR: factor[c] = one - constant[c]; break;
+			default: factor[c] = one; break;
+		}
+	}
+}
+
+ODX_INLINE f32x8 blendOp(D3DBLENDOP op, f32x8 src, f32x8 srcFactor, f32x8 dst, f32x8 dstFactor) {
+	switch (op) {
+		case D3DBLENDOP_SUBTRACT: return src * srcFactor - dst * dstFactor;
+		case D3DBLENDOP_REVSUBTRACT: return dst * dstFactor - src * srcFactor;
+		case D3DBLENDOP_MIN: return Lanes::min(src, dst);
+		case D3DBLENDOP_MAX: return Lanes::max(src, dst);
+		default: return src * srcFactor + dst * dstFactor;
+	}
+}
+
+/**
+ * Any factors and operations, switching on them per block
+ */
+ODX_INLINE void blendGeneric(const DrawState& state, f32x8* color, const f32x8* dst) {
+	const D3DCOLOR factor = state.blendFactor;
+	const f32x8 constant[4] = {
+		Lanes::splat((factor >> 16 & 0xFF) / 255.0f),
+		Lanes::splat((factor >> 8 & 0xFF) / 255.0f),
+		Lanes::splat((factor & 0xFF) / 255.0f),
+		Lanes::splat((factor >> 24) / 255.0f)
+	};
+	f32x8 srcFactor[4], dstFactor[4], alphaSrc[4], alphaDst[4];
+
+	blendFactor(state.srcBlend, color, dst, constant, srcFactor);
+	blendFactor(state.destBlend, color, dst, constant, dstFactor);
+	blendFactor(state.srcBlendAlpha, color, dst, constant, alphaSrc);
+	blendFactor(state.destBlendAlpha, color, dst, constant, alphaDst);
+
+	const f32x8 alpha = blendOp(state.blendOpAlpha, color[3], alphaSrc[3], dst[3], alphaDst[3]);
+	for (int c = 0; c < 3; c++) color[c] = blendOp(state.blendOp, color[c], srcFactor[c], dst[c], dstFactor[c]);
+	color[3] = alpha;
+}
+
+//--- kernels
+
+/**
+ * 4x4 ordered dither thresholds of the block's lanes, rows 0-1 and
+ * rows 2-3, centered on 0
+ */
+static constexpr float DITHER[2][8] = {
+	{0.0f, 8.0f, 12.0f, 4.0f, 2.0f, 10.0f, 14.0f, 6.0f},
+	{3.0f, 11.0f, 15.0f, 7.0f, 1.0f, 9.0f, 13.0f, 5.0f}
+};
+
+template<D3DFORMAT F, Mode M, bool MASKED, bool DITHERED, bool SRGB, bool F16C>
+ODX_INLINE void merge(const DrawState& state, UINT target, int bx, int by, const float* in, uint32_t mask) {
+	typedef Format<F> Target;
+	const Surface& surface = state.targets[target];
+	f32x8 color[4], dst[4], stored[4];
+
+	for (int c = 0; c < 4; c++) {
+		color[c] = Lanes::load(in + c * 8);
+		if constexpr (Target::UNORM) color[c] = Lanes::clamp01(color[c]);
+	}
+
+	if constexpr (M != OutputMerger::OPAQUE || MASKED) {
+		Target::template load<F16C>(surface, bx, by, dst);
+
+		//blending happens in linear; masked channels keep their stored bytes
+		if constexpr (SRGB) {
+			for (int c = 0; c < 4; c++) stored[c] = dst[c];
+			for (int c = 0; c < 3; c++) dst[c] = Lanes::fromSrgb8(Lanes::toUnorm8(dst[c]));
+		}
+	}
+
+	if constexpr (M == OutputMerger::ADDITIVE) {
+		for (int c = 0; c < 4; c++) color[c] += dst[c];
+	} else if constexpr (M == OutputMerger::PREMULTIPLIED) {
+		const f32x8 inverse = 1.0f - color[3];
+		for (int c = 0; c < 4; c++) color[c] += dst[c] * inverse;
+	} else if constexpr (M == OutputMerger::SRC_ALPHA) {
+		const f32x8 alpha = color[3], inverse = 1.0f - alpha;
+		for (int c = 0; c < 4; c++) color[c] = color[c] * alpha + dst[c] * inverse;
+	} else if constexpr (M == OutputMerger::GENERIC) {
+		blendGeneric(state, color, dst);
+	}
+
+	if constexpr (SRGB) {
+		for (int c = 0; c < 3; c++) color[c] = Lanes::toSrgb(color[c]);
+	}
+
+	if constexpr (MASKED) {
+		const f32x8* kept = SRGB ? stored : dst;
+		for (int c = 0; c < 4; c++) {
+			if (!(state.colorWrite[target] & (1 << c))) color[c] = kept[c];
+		}
+	}
+
+	//R5G6B5 only: up to half a step either way before rounding
+	if constexpr (DITHERED) {
+		const f32x8 threshold = (Lanes::load(DITHER[by >> 1 & 1]) - 7.5f) * (1.0f / 16.0f);
+		color[0] += threshold * (1.0f / 31.0f);
+		color[1] += threshold * (1.0f / 63.0f);
+		color[2] += threshold * (1.0f / 31.0f);
+	}
+
+	Target::template store<F16C>(surface, bx, by, color, mask);
+}
+
+template<D3DFORMAT F, Mode M, bool MASKED, bool DITHERED, bool SRGB>
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma,f16c")))
+#endif
+void mergeAVX2(const DrawState& state, UINT target, int bx, int by, const float* color, uint32_t mask) {
+	merge<F, M, MASKED, DITHERED, SRGB, true>(state, target, bx, by, color, mask);
+}
+
+template<D3DFORMAT F, Mode M, bool MASKED, bool DITHERED, bool SRGB>
+void mergeGeneric(const DrawState& state, UINT target, int bx, int by, const float* color, uint32_t mask) {
+	merge<F, M, MASKED, DITHERED, SRGB, false>(state, target, bx, by, color, mask);
+}
+
+template<D3DFORMAT F, Mode M, bool DITHERED, bool SRGB>
+static MergeKernel pick(bool masked, bool avx2) {
+	if (masked) return avx2 ? mergeAVX2<F, M, true, DITHERED, SRGB> : mergeGeneric<F, M, true, DITHERED, SRGB>;
+	return avx2 ? mergeAVX2<F, M, false, DITHERED, SRGB> : mergeGeneric<F, M, false, DITHERED, SRGB>;
+}
+
+/**
+ * DITHERED is for R5G6B5 only and SRGB for the 8-bit formats only, so
+ * other formats build neither variant.
+ */
+template<D3DFORMAT F, bool DITHERED = false, bool SRGB = false>
+static MergeKernel pick(Mode mode, DWORD colorWrite, bool avx2) {
+	const DWORD written = colorWrite & Format<F>::CHANNELS;
+	if (written == 0) return NULL;
+
+	const bool masked = written != Format<F>::CHANNELS;
+	switch (mode) {
+		case OutputMerger::OPAQUE: return pick<F, OutputMerger::OPAQUE, DITHERED, SRGB>(masked, avx2);
+		case OutputMerger::ADDITIVE: return pick<F, OutputMerger::ADDITIVE, DITHERED, SRGB>(masked, avx2);
+		case OutputMerger::PREMULTIPLIED: return pick<F, OutputMerger::PREMULTIPLIED, DITHERED, SRGB>(masked, avx2);
+		case OutputMerger::SRC_ALPHA: return pick<F, OutputMerger::SRC_ALPHA, DITHERED, SRGB>(masked, avx2);
+		default: return pick<F, OutputMerger::GENERIC, DITHERED, SRGB>(masked, avx2);
+	}
+}
+
+Mode OutputMerger::mode(const DrawState& state) {
+	if (!state.blend) return OPAQUE;
+
+	//the alpha channel has to blend the same way
+	const auto is = [&state](D3DBLEND src, D3DBLEND dest) {
+		return state.srcBlend == src && state.destBlend == dest && state.srcBlendAlpha == src && state.destBlendAlpha == dest
+			&& state.blendOp == D3DBLENDOP_ADD && state.blendOpAlpha == D3DBLENDOP_ADD;
+	};
+
+	if (is(D3DBLEND_ONE, D3DBLEND_ZERO)) return OPAQUE;
+	if (is(D3DBLEND_ONE, D3DBLEND_ONE)) return ADDITIVE;
+	if (is(D3DBLEND_ONE, D3DBLEND_INVSRCALPHA)) return PREMULTIPLIED;
+	if (is(D3DBLEND_SRCALPHA, D3DBLEND_INVSRCALPHA)) return SRC_ALPHA;
+	return GENERIC;
+}
+
+MergeKernel OutputMerger::select(const DrawState& state, UINT target) {
+	const Mode mode = OutputMerger::mode(state);
+	const DWORD colorWrite = state.colorWrite[target];
+	const bool avx2 = VectorMath::hasAVX2();
+
+	switch (state.targets[target].format) {
+		case D3DFMT_A8R8G8B8:
+			if (state.srgbWrite) return pick<D3DFMT_A8R8G8B8, false, true>(mode, colorWrite, avx2);
+			return pick<D3DFMT_A8R8G8B8>(mode, colorWrite, avx2);
+		case D3DFMT_X8R8G8B8:
+			if (state.srgbWrite) return pick<D3DFMT_X8R8G8B8, false, true>(mode, colorWrite, avx2);
+			return pick<D3DFMT_X8R8G8B8>(mode, colorWrite, avx2);
+		case D3DFMT_R5G6B5:
+			if (state.dither) return pick<D3DFMT_R5G6B5, true>(mode, colorWrite, avx2);
+			return pick<D3DFMT_R5G6B5>(mode, colorWrite, avx2);
+		case D3DFMT_R16F: return pick<D3DFMT_R16F>(mode, colorWrite, avx2);
+		case D3DFMT_G16R16F: return pick<D3DFMT_G16R16F>(mode, colorWrite, avx2);
+		case D3DFMT_A16B16G16R16F: return pick<D3DFMT_A16B16G16R16F>(mode, colorWrite, avx2);
+		case D3DFMT_R32F: return pick<D3DFMT_R32F>(mode, colorWrite, avx2);
+		case D3DFMT_G32R32F: return pick<D3DFMT_G32R32F>(mode, colorWrite, avx2);
+		case D3DFMT_A32B32G32R32F: return pick<D3DFMT_A32B32G32R32F>(mode, colorWrite, avx2);
+		default: return NULL;
+	}
+}
+
+bool OutputMerger::isRenderTarget(D3DFORMAT format) {
+	switch (format) {
+		case D3DFMT_A8R8G8B8: case D3DFMT_X8R8G8B8: case D3DFMT_R5G6B5:
+		case D3DFMT_R16F: case D3DFMT_G16R16F: case D3DFMT_A16B16G16R16F:
+		case D3DFMT_R32F: case D3DFMT_G32R32F: case D3DFMT_A32B32G32R32F:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+UINT OutputMerger::pixelSize(D3DFORMAT format) {
+	return PixelFormat::bits(format) / 8;
+}
+
+template<typename T>
+static void fillRows(const Surface& target, T value, int x0, int y0, int x1, int y1) {
+	for (int y = y0; y < y1; y++) {
+		T* row = (T*) (target.bits + (size_t) y * target.pitch);
+		std::fill(row + x0, row + x1, value);
+	}
+}
+
+/**
+ * The color's channels in red, green, blue, alpha order, as floats or halves
+ */
+template<typename C, int N>
+static void fillFloat(const Surface& target, D3DCOLOR color, int x0, int y0, int x1, int y1) {
+	const f32x8 channels = {(color >> 16 & 0xFF) / 255.0f, (color >> 8 & 0xFF) / 255.0f, (color & 0xFF) / 255.0f, (color >> 24) / 255.0f};
+	C converted[8];
+	pack<false>(converted, channels);
+
+	typename FloatFormat<C, N>::Pixel pixel;
+	memcpy(pixel.channels, converted, sizeof(pixel.channels));
+	fillRows(target, pixel, x0, y0, x1, y1);
+}
+
+void OutputMerger::fill(const Surface& target, D3DCOLOR color, int x0, int y0, int x1, int y1) {
+	switch (target.format) {
+		case D3DFMT_R5G6B5:
+			fillRows<uint16_t>(target, (color >> 8 & 0xF800) | (color >> 5 & 0x07E0) | (color >> 3 & 0x001F), x0, y0, x1, y1);
+			break;
+		case D3DFMT_R16F: fillFloat<uint16_t, 1>(target, color, x0, y0, x1, y1); break;
+		case D3DFMT_G16R16F: fillFloat<uint16_t, 2>(target, color, x0, y0, x1, y1); break;
+		case D3DFMT_A16B16G16R16F: fillFloat<uint16_t, 4>(target, color, x0, y0, x1, y1); break;
+		case D3DFMT_R32F: fillFloat<float, 1>(target, color, x0, y0, x1, y1); break;
+		case D3DFMT_G32R32F: fillFloat<float, 2>(target, color, x0, y0, x1, y1); break;
+		case D3DFMT_A32B32G32R32F: fillFloat<float, 4>(target, color, x0, y0, x1, y1); break;
+		case D3DFMT_X8R8G8B8:
+			fillRows<uint32_t>(target, color | 0xFF000000, x0, y0, x1, y1);
+			break;
+		default:
+			fillRows<uint32_t>(target, color, x0, y0, x1, y1);
+			break;
+	}
+}
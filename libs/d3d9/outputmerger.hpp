@@ -0,0 +1,41 @@
+#pragma once
+#include "rasterizer.hpp"
+
+/**
+ * Output merger: blending, the color write mask and dithering, then
+ * the store into the render target.
+ *
+ * Every (render target format, blend mode) pair has a kernel of its
+ * own, built once for AVX2 and once for SSE2. select() picks one when
+ * a state is set, so pixels never switch on formats or blend factors.
+ * Opaque, additive, premultiplied and source-alpha blending have
+ * dedicated kernels; other factor combinations use the generic one.
+ * With sRGB writes, 8-bit targets are decoded through a table, blended
+ * in linear and encoded again by a polynomial, never by powf.
+ */
+class OutputMerger {
+	public:enum Mode {
+		OPAQUE, //ONE, ZERO (or blending off)
+		ADDITIVE, //ONE, ONE
+		PREMULTIPLIED, //ONE, INVSRCALPHA
+		SRC_ALPHA, //SRCALPHA, INVSRCALPHA
+		GENERIC
+	};
+
+	/**
+	 * Kernel for the format of render target "target" and the blend
+	 * state of "state", for AVX2 or SSE2 as the CPU allows. NULL when
+	 * no channel of that target is written.
+	 */
+	public:static MergeKernel select(const DrawState& state, UINT target);
+
+	public:static Mode mode(const DrawState& state);
+
+	public:static bool isRenderTarget(D3DFORMAT format);
+	public:static UINT pixelSize(D3DFORMAT format);
+
+	/**
+	 * Clears "rect" of "target" to "color".
+	 */
+	public:static void fill(const Surface& target, D3DCOLOR color, int x0, int y0, int x1, int y1);
+};
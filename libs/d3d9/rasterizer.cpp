@@ -0,0 +1,1264 @@
+#include "rasterizer.hpp"
+#include "depthstencil.hpp"
+#include "outputmerger.hpp"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <bit>
+#include <simd/Lanes.hpp>
+#include <simd/VectorMath.hpp>
+#include <thread/WorkerPool.hpp>
+
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+using Lanes::f32x8;
+using Lanes::i32x8;
+using Lanes::u32x8;
+typedef Rasterizer::Primitive Primitive;
+typedef Rasterizer::ScreenVertex ScreenVertex;
+
+#define ODX_INLINE inline __attribute__((always_inline))
+
+static constexpr int TILE = Rasterizer::TILE_SIZE;
+
+/**
+ * Outcodes: planes triangles and lines are clipped against, then
+ * the view frustum, only used to reject.
+ */
+enum : uint32_t {
+	CLIP_NEAR = 1 << 0,
+	CLIP_FAR = 1 << 1,
+	CLIP_GUARD = 0xF << 2,
+	CLIP_PLANES = CLIP_NEAR | CLIP_FAR | CLIP_GUARD,
+	CLIP_FRUSTUM = 0xF << 6
+};
+
+static float distance(const Vertex& vertex, UINT plane, float guardX, float guardY) {
+	const float* p = vertex.position;
+
+	switch (plane) {
+		case 0: return p[2];
+		case 1: return p[3] - p[2];
+		case 2: return guardX * p[3] + p[0];
+		case 3: return guardX * p[3] - p[0];
+		case 4: return guardY * p[3] + p[1];
+		default: return guardY * p[3] - p[1];
+	}
+}
+
+static void lerp(Vertex& out, const Vertex& a, const Vertex& b, float t) {
+	const float* from = (const float*) &a;
+	const float* to = (const float*) &b;
+	float* r = (float*) &out;
+
+	for (size_t i = 0; i < sizeof(Vertex) / sizeof(float); i++) r[i] = from[i] + (to[i] - from[i]) * t;
+}
+
+static int32_t snap(float v) {
+	return (int32_t) std::lrint(v * 16.0f);
+}
+
+/**
+ * Whether "op" reads the texture, through an argument or a
+ * BLENDTEXTUREALPHA* factor.
+ */
+static bool readsTexture(D3DTEXTUREOP op, const DWORD* args) {
+	if (op == D3DTOP_DISABLE) return false;
+	if (op == D3DTOP_BLENDTEXTUREALPHA || op == D3DTOP_BLENDTEXTUREALPHAPM) return true;
+
+	const int count = op == D3DTOP_MULTIPLYADD || op == D3DTOP_LERP ? 3 : 2;
+	for (int i = 0; i < count; i++) {
+		if ((args[i] & D3DTA_SELECTMASK) == D3DTA_TEXTURE) return true;
+	}
+	return false;
+}
+
+/**
+ * Keys of states, primitives and tiles: FNV-1a over 64-bit words,
+ * folding the high half down after each so that every bit counts.
+ */
+struct Key {
+	uint64_t h = 14695981039346656037ull;
+
+	void add(uint64_t v) {
+		this->h = (this->h ^ v) * 1099511628211ull;
+		this->h ^= this->h >> 32;
+	}
+
+	void add(const void* pointer) {
+		this->add((uint64_t) (uintptr_t) pointer);
+	}
+
+	void add(const float* v, size_t count) {
+		size_t i = 0;
+		for (; i + 1 < count; i += 2) this->add((uint64_t) std::bit_cast<uint32_t>(v[i]) << 32 | std::bit_cast<uint32_t>(v[i + 1]));
+		if (i < count) this->add(std::bit_cast<uint32_t>(v[i]));
+	}
+
+	void add(const Surface& surface) {
+		this->add(surface.format);
+		this->add((uint64_t) surface.width << 32 | surface.height);
+		this->add(surface.pitch);
+		this->add(surface.bits);
+	}
+
+	//never 0, which stands for uncacheable
+	uint64_t value() const {
+		return this->h != 0 ? this->h : 1;
+	}
+};
+
+/**
+ * Everything "state" rasterizes with, or 0 when it samples a texture
+ * draws may write.
+ */
+static uint64_t stateKey(const DrawState& state) {
+	Key key;
+	key.add(state.targetCount);
+	for (UINT i = 0; i < state.targetCount; i++) {
+		key.add(state.targets[i]);
+		key.add(state.colorWrite[i]);
+	}
+	key.add(state.depth);
+
+	const D3DVIEWPORT9& viewport = state.viewport;
+	key.add((uint64_t) viewport.X << 32 | viewport.Y);
+	key.add((uint64_t) viewport.Width << 32 | viewport.Height);
+	key.add(&viewport.MinZ, 1);
+	key.add(&viewport.MaxZ, 1);
+	key.add((uint64_t) (uint32_t) state.clip.left << 32 | (uint32_t) state.clip.top);
+	key.add((uint64_t) (uint32_t) state.clip.right << 32 | (uint32_t) state.clip.bottom);
+
+	key.add(state.cull);
+	key.add(state.fill);
+	key.add(state.flat | state.lastPixel << 1 | state.pointSprite << 2 | state.specular << 3);
+	key.add(state.fog | state.fogTable << 1 | state.fogW << 2);
+	key.add(state.fogParameters.mode);
+	key.add(&state.fogParameters.start, 1);
+	key.add(&state.fogParameters.end, 1);
+	key.add(&state.fogParameters.density, 1);
+	key.add(state.fogColor, 3);
+
+	key.add(state.zEnable | state.zWrite << 1 | state.stencil << 2);
+	key.add(state.zFunc);
+	for (UINT i = 0; i < 2; i++) {
+		key.add(state.stencilFunc[i]);
+		key.add(state.stencilFail[i]);
+		key.add(state.stencilZFail[i]);
+		key.add(state.stencilPass[i]);
+	}
+	key.add(state.stencilRef);
+	key.add(state.stencilMask);
+	key.add(state.stencilWriteMask);
+
+	key.add(state.alphaTest);
+	key.add(state.alphaFunc);
+	key.add(state.alphaRef);
+
+	key.add(state.blend);
+	key.add(state.srcBlend);
+	key.add(state.destBlend);
+	key.add(state.blendOp);
+	key.add(state.srcBlendAlpha);
+	key.add(state.destBlendAlpha);
+	key.add(state.blendOpAlpha);
+	key.add(state.blendFactor);
+
+	key.add(state.textureSets);
+	for (UINT i = 0; i < state.textureSets; i++) {
+		const TextureStage& stage = state.stages[i];
+		key.add(stage.colorOp);
+		key.add(stage.alphaOp);
+		for (UINT j = 0; j < 3; j++) {
+			key.add(stage.colorArg[j]);
+			key.add(stage.alphaArg[j]);
+		}
+		key.add(stage.temp);
+		key.add(stage.constant, 4);
+		key.add(stage.projected);
+
+		const TextureView& view = stage.view;
+		key.add(view.levels);
+		if (view.levels == 0) continue;
+		if (view.version == 0) return 0;
+
+		key.add(view.type);
+		key.add(view.format);
+		key.add(view.faceSize);
+		key.add(view.version);
+		for (UINT l = 0; l < view.levels; l++) {
+			const TextureView::Level& level = view.level[l];
+			key.add(level.bits);
+			key.add((uint64_t) level.width << 32 | level.height);
+			key.add((uint64_t) level.depth << 32 | level.pitch);
+			key.add(level.slice);
+		}
+
+		const SamplerState& sampler = stage.sampler;
+		for (UINT j = 0; j < 3; j++) key.add(sampler.address[j]);
+		key.add(sampler.border, 4);
+		key.add(sampler.magFilter);
+		key.add(sampler.minFilter);
+		key.add(sampler.mipFilter);
+		key.add(&sampler.lodBias, 1);
+		key.add(sampler.maxAnisotropy);
+		key.add(sampler.srgb);
+	}
+	key.add(state.textureFactor, 4);
+	key.add(state.dither | state.srgbWrite << 1);
+	return key.value();
+}
+
+//--- submission
+
+void Rasterizer::resize(UINT width, UINT height) {
+	this->width = width;
+	this->height = height;
+	this->tilesX = (width + TILE - 1) / TILE;
+	this->tilesY = (height + TILE - 1) / TILE;
+	this->bins.resize(this->tilesX * this->tilesY);
+	this->cache.resize(this->bins.size());
+}
+
+void Rasterizer::setState(const DrawState& state) {
+	const Surface& target = state.targets[0];
+	if (target.width != this->width || target.height != this->height) {
+		this->flush();
+		this->resize(target.width, target.height);
+	}
+
+	PixelKernels kernels = {{}, DepthStencil::select(state), 0, {}, {}};
+	for (UINT i = 0; i < state.targetCount; i++) {
+		const MergeKernel merge = OutputMerger::select(state, i);
+		if (merge == NULL) continue;
+
+		kernels.merge[kernels.merges] = merge;
+		kernels.target[kernels.merges++] = i;
+	}
+
+	this->states.push_back(state);
+	for (UINT i = 0; i < state.textureSets; i++) {
+		TextureStage& stage = this->states.back().stages[i];
+		if (stage.view.levels > 0) kernels.sample[i] = Sampler::select(stage.view);
+		if (kernels.sample[i] != NULL) continue;
+
+		//without a texture, ops that read one pass CURRENT on
+		if (readsTexture(stage.colorOp, stage.colorArg)) {
+			stage.colorOp = D3DTOP_SELECTARG1;
+			stage.colorArg[0] = D3DTA_CURRENT;
+		}
+		if (readsTexture(stage.alphaOp, stage.alphaArg)) {
+			stage.alphaOp = D3DTOP_SELECTARG1;
+			stage.alphaArg[0] = D3DTA_CURRENT;
+		}
+	}
+	this->kernels.push_back(kernels);
+	this->stateKeys.push_back(stateKey(this->states.back()));
+
+	//the guard band in clip space: screen x within +-GUARD_BAND on both sides
+	const D3DVIEWPORT9& viewport = state.viewport;
+	const float band = GUARD_BAND - TILE;
+	this->guardX = viewport.Width > 0 ? 2.0f * (band - viewport.X) / viewport.Width - 1.0f : 1.0f;
+	this->guardY = viewport.Height > 0 ? 2.0f * (band - viewport.Y) / viewport.Height - 1.0f : 1.0f;
+}
+
+void Rasterizer::bin(uint32_t command, const int32_t* bounds) {
+	UINT x0 = bounds[0] / TILE, y0 = bounds[1] / TILE;
+	UINT x1 = (bounds[2] - 1) / TILE, y1 = (bounds[3] - 1) / TILE;
+
+	for (UINT y = y0; y <= y1; y++) {
+		for (UINT x = x0; x <= x1; x++) this->bins[y * this->tilesX + x].push_back(command);
+	}
+}
+
+uint32_t Rasterizer::push(Primitive& primitive) {
+	uint32_t index = this->primitives.size();
+	primitive.state = this->states.size() - 1;
+	primitive.key = 0;
+
+	const uint64_t state = this->stateKeys.back();
+	if (state != 0) {
+		Key key;
+		key.add(state);
+		key.add(primitive.kind | primitive.backFace << 8);
+		key.add((uint64_t) (uint32_t) primitive.bounds[0] << 32 | (uint32_t) primitive.bounds[1]);
+		key.add((uint64_t) (uint32_t) primitive.bounds[2] << 32 | (uint32_t) primitive.bounds[3]);
+		key.add(primitive.ref, 2);
+
+		switch (primitive.kind) {
+			case TRIANGLE:
+				for (UINT i = 0; i < 3; i++) {
+					key.add((uint64_t) (uint32_t) primitive.edges.a[i] << 32 | (uint32_t) primitive.edges.b[i]);
+					key.add(primitive.edges.c[i]);
+				}
+				break;
+			case LINE:
+				key.add(primitive.line.xMajor);
+				key.add(&primitive.line.origin, 1);
+				key.add(&primitive.line.minor0, 1);
+				key.add(&primitive.line.slope, 1);
+				key.add((uint64_t) (uint32_t) primitive.line.first << 32 | (uint32_t) primitive.line.last);
+				break;
+			case RECTANGLE:
+				break;
+		}
+
+		key.add(&this->planes[primitive.plane], this->planeCount() * 3);
+		primitive.key = key.value();
+	}
+	this->primitives.push_back(primitive);
+	this->bin(index, primitive.bounds);
+	return index;
+}
+
+void Rasterizer::clear(const RECT& rect, DWORD Flags, D3DCOLOR Color, float Z, DWORD Stencil, const Surface* targets, UINT targetCount, const Surface& depth) {
+	const Surface& target = targets[0];
+	if (target.width != this->width || target.height != this->height) {
+		this->flush();
+		this->resize(target.width, target.height);
+	}
+
+	Clear clear = {rect, Flags, Color, Z, Stencil, {}, std::min(targetCount, DrawState::MAX_TARGETS), depth};
+	std::copy(targets, targets + clear.targetCount, clear.targets);
+	clear.rect.left = std::max<LONG>(clear.rect.left, 0);
+	clear.rect.top = std::max<LONG>(clear.rect.top, 0);
+	clear.rect.right = std::min<LONG>(clear.rect.right, target.width);
+	clear.rect.bottom = std::min<LONG>(clear.rect.bottom, target.height);
+	if (clear.rect.left >= clear.rect.right || clear.rect.top >= clear.rect.bottom) return;
+
+	const int32_t bounds[4] = {(int32_t) clear.rect.left, (int32_t) clear.rect.top, (int32_t) clear.rect.right, (int32_t) clear.rect.bottom};
+	this->clears.push_back(clear);
+	this->bin(CLEAR_BIT | (this->clears.size() - 1), bounds);
+}
+
+uint32_t Rasterizer::outcode(const Vertex& vertex) const {
+	const float* p = vertex.position;
+	uint32_t code = 0;
+
+	if (p[2] < 0.0f || !(p[3] > 0.0f)) code |= CLIP_NEAR;
+	if (p[3] - p[2] < 0.0f) code |= CLIP_FAR;
+	for (UINT plane = 2; plane < 6; plane++) {
+		if (distance(vertex, plane, this->guardX, this->guardY) < 0.0f) code |= 1 << plane;
+	}
+
+	if (p[3] + p[0] < 0.0f) code |= 1 << 6;
+	if (p[3] - p[0] < 0.0f) code |= 1 << 7;
+	if (p[3] + p[1] < 0.0f) code |= 1 << 8;
+	if (p[3] - p[1] < 0.0f) code |= 1 << 9;
+	return code;
+}
+
+ScreenVertex Rasterizer::project(const Vertex& vertex) const {
+	const D3DVIEWPORT9& viewport = this->state().viewport;
+	const float rhw = 1.0f / vertex.position[3];
+
+	return {
+		viewport.X + (1.0f + vertex.position[0] * rhw) * viewport.Width * 0.5f,
+		viewport.Y + (1.0f - vertex.position[1] * rhw) * viewport.Height * 0.5f,
+		viewport.MinZ + vertex.position[2] * rhw * (viewport.MaxZ - viewport.MinZ),
+		rhw,
+		&vertex
+	};
+}
+
+void Rasterizer::draw(D3DPRIMITIVETYPE type, const Vertex* vertices, UINT primitiveCount, bool transformed) {
+	UINT count;
+	switch (type) {
+		case D3DPT_POINTLIST: count = primitiveCount; break;
+		case D3DPT_LINELIST: count = primitiveCount * 2; break;
+		case D3DPT_LINESTRIP: count = primitiveCount + 1; break;
+		case D3DPT_TRIANGLELIST: count = primitiveCount * 3; break;
+		case D3DPT_TRIANGLESTRIP: case D3DPT_TRIANGLEFAN: count = primitiveCount + 2; break;
+		default: return;
+	}
+
+	this->screen.resize(count);
+	this->outcodes.resize(count);
+
+	for (UINT i = 0; i < count; i++) {
+		const float* p = vertices[i].position;
+
+		if (transformed) {
+			//no clipping: whatever leaves the guard band is dropped
+			this->screen[i] = {p[0], p[1], p[2], p[3], &vertices[i]};
+			this->outcodes[i] = std::fabs(p[0]) < GUARD_BAND && std::fabs(p[1]) < GUARD_BAND ? 0 : (uint32_t) CLIP_GUARD;
+		} else {
+			this->outcodes[i] = this->outcode(vertices[i]);
+			if ((this->outcodes[i] & CLIP_PLANES) == 0) this->screen[i] = this->project(vertices[i]);
+		}
+	}
+
+	switch (type) {
+		case D3DPT_POINTLIST:
+			this->drawPoints(vertices, count, transformed);
+			break;
+		case D3DPT_LINELIST: case D3DPT_LINESTRIP:
+			this->drawLines(type, vertices, primitiveCount, transformed);
+			break;
+		default:
+			this->drawTriangles(type, vertices, primitiveCount, transformed);
+			break;
+	}
+}
+
+//--- triangles
+
+void Rasterizer::drawTriangles(D3DPRIMITIVETYPE type, const Vertex* vertices, UINT primitiveCount, bool transformed) {
+	for (UINT i = 0; i < primitiveCount; i++) {
+		//the first index is the vertex flat shading takes its colors from
+		UINT index[3];
+		switch (type) {
+			case D3DPT_TRIANGLELIST: index[0] = i * 3; index[1] = i * 3 + 1; index[2] = i * 3 + 2; break;
+			case D3DPT_TRIANGLESTRIP: index[0] = i; index[1] = i + 1 + (i & 1); index[2] = i + 2 - (i & 1); break;
+			default: index[0] = i + 1; index[1] = i + 2; index[2] = 0; break;
+		}
+
+		uint32_t a = this->outcodes[index[0]], b = this->outcodes[index[1]], c = this->outcodes[index[2]];
+		if (a & b & c) continue;
+
+		if (((a | b | c) & CLIP_PLANES) == 0) {
+			this->setupTriangle(this->screen[index[0]], this->screen[index[1]], this->screen[index[2]], &vertices[index[0]]);
+		} else if (!transformed) {
+			this->clipTriangle(&vertices[index[0]], &vertices[index[1]], &vertices[index[2]], (a | b | c) & CLIP_PLANES);
+		}
+	}
+}
+
+/**
+ * Sutherland-Hodgman against the planes the triangle crosses. New
+ * vertices are always interpolated from the inside one, so edges
+ * shared by two triangles are cut at the same point.
+ */
+void Rasterizer::clipTriangle(const Vertex* v0, const Vertex* v1, const Vertex* v2, uint32_t planes) {
+	Vertex storage[12];
+	const Vertex* polygon[2][9] = {{v0, v1, v2}};
+	UINT count = 3, used = 0, current = 0;
+
+	for (UINT plane = 0; plane < 6; plane++) {
+		if (!(planes & (1 << plane))) continue;
+
+		const Vertex** in = polygon[current];
+		const Vertex** out = polygon[current ^ 1];
+		UINT n = 0;
+
+		for (UINT i = 0; i < count; i++) {
+			const Vertex* a = in[i];
+			const Vertex* b = in[(i + 1) % count];
+			float da = distance(*a, plane, this->guardX, this->guardY);
+			float db = distance(*b, plane, this->guardX, this->guardY);
+
+			if (da >= 0.0f) out[n++] = a;
+			if ((da >= 0.0f) != (db >= 0.0f)) {
+				if (da >= 0.0f) lerp(storage[used], *a, *b, da / (da - db));
+				else lerp(storage[used], *b, *a, db / (db - da));
+				out[n++] = &storage[used++];
+			}
+		}
+
+		count = n;
+		current ^= 1;
+		if (count < 3) return;
+	}
+
+	ScreenVertex screen[9];
+	for (UINT i = 0; i < count; i++) screen[i] = this->project(*polygon[current][i]);
+	for (UINT i = 1; i + 1 < count; i++) this->setupTriangle(screen[0], screen[i], screen[i + 1], v0);
+}
+
+void Rasterizer::attributes(const ScreenVertex& vertex, const Vertex* colors, float* out) const {
+	const float rhw = vertex.rhw;
+
+	out[PLANE_Z] = vertex.z;
+	out[PLANE_RHW] = rhw;
+	for (UINT c = 0; c < 4; c++) {
+		out[PLANE_DIFFUSE + c] = colors->color[0][c] * rhw;
+		out[PLANE_SPECULAR + c] = colors->color[1][c] * rhw;
+	}
+
+	for (UINT t = 0; t < this->state().textureSets; t++) {
+		for (UINT c = 0; c < 4; c++) out[PLANE_TEXTURE + t * 4 + c] = vertex.vertex->texture[t][c] * rhw;
+	}
+}
+
+void Rasterizer::setupTriangle(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2, const Vertex* provoking) {
+	const DrawState& state = this->state();
+	const ScreenVertex* v[3] = {&v0, &v1, &v2};
+	int32_t x[3] = {snap(v0.x), snap(v1.x), snap(v2.x)};
+	int32_t y[3] = {snap(v0.y), snap(v1.y), snap(v2.y)};
+
+	//> 0: clockwise on screen (y points down)
+	int64_t area = (int64_t) (x[1] - x[0]) * (y[2] - y[0]) - (int64_t) (x[2] - x[0]) * (y[1] - y[0]);
+	if (area == 0) return;
+	if ((state.cull == D3DCULL_CW && area > 0) || (state.cull == D3DCULL_CCW && area < 0)) return;
+
+	if (state.fill == D3DFILL_WIREFRAME) {
+		const ScreenVertex ends[6] = {v0, v1, v1, v2, v2, v0};
+		this->setupLines(ends, 3);
+		return;
+	}
+	if (state.fill == D3DFILL_POINT) {
+		const ScreenVertex points[3] = {v0, v1, v2};
+		this->setupPoints(points, 3);
+		return;
+	}
+
+	Primitive p;
+	p.kind = TRIANGLE;
+	p.backFace = area < 0;
+	if (area < 0) {
+		std::swap(v[1], v[2]);
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+	}
+
+	//pixel centers inside the bounding box, then the clip rectangle
+	p.bounds[0] = std::max<int32_t>((std::min({x[0], x[1], x[2]}) + 15) >> 4, state.clip.left);
+	p.bounds[1] = std::max<int32_t>((std::min({y[0], y[1], y[2]}) + 15) >> 4, state.clip.top);
+	p.bounds[2] = std::min<int32_t>((std::max({x[0], x[1], x[2]}) >> 4) + 1, state.clip.right);
+	p.bounds[3] = std::min<int32_t>((std::max({y[0], y[1], y[2]}) >> 4) + 1, state.clip.bottom);
+	if (p.bounds[0] >= p.bounds[2] || p.bounds[1] >= p.bounds[3]) return;
+
+	//top-left rule: pixels exactly on other edges belong to the neighbour
+	for (UINT e = 0; e < 3; e++) {
+		UINT i = e, j = (e + 1) % 3;
+		int32_t a = y[i] - y[j], b = x[j] - x[i];
+		bool topLeft = a > 0 || (a == 0 && b > 0);
+
+		p.edges.a[e] = a * 16;
+		p.edges.b[e] = b * 16;
+		p.edges.c[e] = -((int64_t) a * x[i] + (int64_t) b * y[i]) - (topLeft ? 0 : 1);
+	}
+
+	const float x0 = x[0] / 16.0f, y0 = y[0] / 16.0f;
+	const float dx1 = (x[1] - x[0]) / 16.0f, dy1 = (y[1] - y[0]) / 16.0f;
+	const float dx2 = (x[2] - x[0]) / 16.0f, dy2 = (y[2] - y[0]) / 16.0f;
+	const float inverse = 1.0f / (dx1 * dy2 - dx2 * dy1);
+	const UINT n = this->planeCount();
+	float values[3][MAX_PLANES];
+
+	for (UINT i = 0; i < 3; i++) this->attributes(*v[i], state.flat ? provoking : v[i]->vertex, values[i]);
+
+	p.ref[0] = x0;
+	p.ref[1] = y0;
+	p.plane = this->planes.size();
+	this->planes.resize(p.plane + n * 3);
+	float* plane = &this->planes[p.plane];
+
+	for (UINT k = 0; k < n; k++, plane += 3) {
+		float d1 = values[1][k] - values[0][k], d2 = values[2][k] - values[0][k];
+		plane[0] = values[0][k];
+		plane[1] = (d1 * dy2 - d2 * dy1) * inverse;
+		plane[2] = (d2 * dx1 - d1 * dx2) * inverse;
+	}
+
+	this->push(p);
+}
+
+//--- lines
+
+void Rasterizer::drawLines(D3DPRIMITIVETYPE type, const Vertex* vertices, UINT primitiveCount, bool transformed) {
+	this->batch.clear();
+
+	for (UINT i = 0; i < primitiveCount; i++) {
+		UINT from = type == D3DPT_LINELIST ? i * 2 : i, to = from + 1;
+		uint32_t a = this->outcodes[from], b = this->outcodes[to];
+		if (a & b) continue;
+
+		if (((a | b) & CLIP_PLANES) == 0) {
+			this->batch.push_back(this->screen[from]);
+			this->batch.push_back(this->screen[to]);
+		} else if (!transformed) {
+			//keep submission order: lines before this one are set up first
+			this->setupLines(this->batch.data(), this->batch.size() / 2);
+			this->batch.clear();
+			this->clipLine(&vertices[from], &vertices[to], (a | b) & CLIP_PLANES);
+		}
+	}
+
+	this->setupLines(this->batch.data(), this->batch.size() / 2);
+}
+
+void Rasterizer::clipLine(const Vertex* v0, const Vertex* v1, uint32_t planes) {
+	float t0 = 0.0f, t1 = 1.0f;
+
+	for (UINT plane = 0; plane < 6; plane++) {
+		if (!(planes & (1 << plane))) continue;
+
+		float d0 = distance(*v0, plane, this->guardX, this->guardY);
+		float d1 = distance(*v1, plane, this->guardX, this->guardY);
+		if (d0 < 0.0f && d1 < 0.0f) return;
+		if (d0 < 0.0f) t0 = std::max(t0, d0 / (d0 - d1));
+		if (d1 < 0.0f) t1 = std::min(t1, d0 / (d0 - d1));
+	}
+	if (t0 >= t1) return;
+
+	Vertex ends[2];
+	lerp(ends[0], *v0, *v1, t0);
+	lerp(ends[1], *v0, *v1, t1);
+	if (this->state().flat) memcpy(ends[0].color, v0->color, sizeof(v0->color));
+
+	const ScreenVertex screen[2] = {this->project(ends[0]), this->project(ends[1])};
+	this->setupLines(screen, 1);
+}
+
+/**
+ * Eight lines at a time: major axis, slope, pixel range and the
+ * gradient of every attribute along the major axis are computed in
+ * lanes, then each line is stored and binned.
+ */
+void Rasterizer::setupLines(const ScreenVertex* ends, UINT count) {
+	const DrawState& state = this->state();
+	const UINT n = this->planeCount();
+
+	for (UINT base = 0; base < count; base += 8) {
+		const UINT lines = std::min<UINT>(count - base, 8);
+		const ScreenVertex* end = ends + base * 2;
+		float x0[8], y0[8], x1[8], y1[8];
+		float start[MAX_PLANES][8], finish[MAX_PLANES][8], gradient[MAX_PLANES][8];
+
+		for (UINT i = 0; i < 8; i++) {
+			//spare lanes repeat the first line
+			const ScreenVertex& a = end[(i < lines ? i : 0) * 2];
+			const ScreenVertex& b = end[(i < lines ? i : 0) * 2 + 1];
+			float values[2][MAX_PLANES];
+
+			x0[i] = a.x;
+			y0[i] = a.y;
+			x1[i] = b.x;
+			y1[i] = b.y;
+			this->attributes(a, a.vertex, values[0]);
+			this->attributes(b, state.flat ? a.vertex : b.vertex, values[1]);
+			for (UINT k = 0; k < n; k++) {
+				start[k][i] = values[0][k];
+				finish[k][i] = values[1][k];
+			}
+		}
+
+		const f32x8 ax = Lanes::load(x0), ay = Lanes::load(y0), bx = Lanes::load(x1), by = Lanes::load(y1);
+		const i32x8 xMajor = Lanes::abs(bx - ax) >= Lanes::abs(by - ay);
+		const f32x8 major0 = Lanes::select(xMajor, ax, ay), major1 = Lanes::select(xMajor, bx, by);
+		const f32x8 minor0 = Lanes::select(xMajor, ay, ax), minor1 = Lanes::select(xMajor, by, bx);
+		const f32x8 length = major1 - major0;
+		const f32x8 inverse = Lanes::select(length != 0.0f, 1.0f / length, Lanes::splat(0.0f));
+		const f32x8 slope = (minor1 - minor0) * inverse;
+
+		//pixels whose centers are nearest to the ends
+		const i32x8 first = Lanes::floor(major0 + 0.5f), last = Lanes::floor(major1 + 0.5f);
+		const i32x8 minorFirst = Lanes::floor(minor0 + slope * (Lanes::toFloat(first) - major0) + 0.5f);
+		const i32x8 minorLast = Lanes::floor(minor0 + slope * (Lanes::toFloat(last) - major0) + 0.5f);
+
+		for (UINT k = 0; k < n; k++) Lanes::store(gradient[k], (Lanes::load(finish[k]) - Lanes::load(start[k])) * inverse);
+
+		for (UINT i = 0; i < lines; i++) {
+			if (!std::isfinite(x0[i] + y0[i] + x1[i] + y1[i])) continue;
+
+			int32_t from = first[i], to = last[i];
+			if (!state.lastPixel) {
+				if (from == to) continue;
+				to += from < to ? -1 : 1;
+			}
+
+			Primitive p;
+			p.kind = LINE;
+			p.backFace = false;
+			p.line.xMajor = xMajor[i] != 0;
+			p.line.origin = major0[i];
+			p.line.minor0 = minor0[i];
+			p.line.slope = slope[i];
+			p.line.first = std::min(from, to);
+			p.line.last = std::max(from, to);
+
+			const int32_t minorMin = std::min(minorFirst[i], minorLast[i]), minorMax = std::max(minorFirst[i], minorLast[i]);
+			const int major = p.line.xMajor ? 0 : 1, minor = major ^ 1;
+			p.bounds[major] = p.line.first;
+			p.bounds[major + 2] = p.line.last + 1;
+			p.bounds[minor] = minorMin;
+			p.bounds[minor + 2] = minorMax + 1;
+
+			p.bounds[0] = std::max<int32_t>(p.bounds[0], state.clip.left);
+			p.bounds[1] = std::max<int32_t>(p.bounds[1], state.clip.top);
+			p.bounds[2] = std::min<int32_t>(p.bounds[2], state.clip.right);
+			p.bounds[3] = std::min<int32_t>(p.bounds[3], state.clip.bottom);
+			if (p.bounds[0] >= p.bounds[2] || p.bounds[1] >= p.bounds[3]) continue;
+
+			p.ref[0] = x0[i];
+			p.ref[1] = y0[i];
+			p.plane = this->planes.size();
+			this->planes.resize(p.plane + n * 3);
+			float* plane = &this->planes[p.plane];
+
+			for (UINT k = 0; k < n; k++, plane += 3) {
+				plane[0] = start[k][i];
+				plane[1] = p.line.xMajor ? gradient[k][i] : 0.0f;
+				plane[2] = p.line.xMajor ? 0.0f : gradient[k][i];
+			}
+
+			this->push(p);
+		}
+	}
+}
+
+//--- points
+
+void Rasterizer::drawPoints(const Vertex* vertices, UINT count, bool transformed) {
+	this->batch.clear();
+
+	//points are not clipped: their center has to be inside
+	for (UINT i = 0; i < count; i++) {
+		if ((this->outcodes[i] & CLIP_PLANES) == 0) this->batch.push_back(this->screen[i]);
+	}
+
+	this->setupPoints(this->batch.data(), this->batch.size());
+}
+
+/**
+ * A point covers the pixel centers in [x - size / 2, x + size / 2)
+ * (same for y), at least one. Its attributes are constant but for
+ * point sprites, whose texture coordinates go from (0, 0) at the
+ * top left corner to (1, 1) at the bottom right.
+ */
+void Rasterizer::setupPoints(const ScreenVertex* points, UINT count) {
+	const DrawState& state = this->state();
+	const UINT n = this->planeCount();
+
+	for (UINT base = 0; base < count; base += 8) {
+		const UINT batch = std::min<UINT>(count - base, 8);
+		float xs[8], ys[8], sizes[8];
+
+		for (UINT i = 0; i < 8; i++) {
+			const ScreenVertex& point = points[base + (i < batch ? i : 0)];
+			xs[i] = point.x;
+			ys[i] = point.y;
+			sizes[i] = point.vertex->size;
+		}
+
+		const f32x8 x = Lanes::load(xs), y = Lanes::load(ys), size = Lanes::load(sizes);
+		const f32x8 half = size * 0.5f;
+		const f32x8 reach = Lanes::min(half, Lanes::splat(GUARD_BAND));
+		const i32x8 inside = (Lanes::abs(x) < GUARD_BAND) & (Lanes::abs(y) < GUARD_BAND);
+		const f32x8 cx = Lanes::select(inside, x, Lanes::splat(0.0f)), cy = Lanes::select(inside, y, Lanes::splat(0.0f));
+		const i32x8 left = Lanes::ceil(cx - reach), top = Lanes::ceil(cy - reach);
+		const i32x8 right = Lanes::max(Lanes::ceil(cx + reach), left + 1);
+		const i32x8 bottom = Lanes::max(Lanes::ceil(cy + reach), top + 1);
+		const i32x8 x0 = Lanes::max(left, Lanes::splat((int32_t) state.clip.left));
+		const i32x8 y0 = Lanes::max(top, Lanes::splat((int32_t) state.clip.top));
+		const i32x8 x1 = Lanes::min(right, Lanes::splat((int32_t) state.clip.right));
+		const i32x8 y1 = Lanes::min(bottom, Lanes::splat((int32_t) state.clip.bottom));
+		const f32x8 step = Lanes::select(size > 0.0f, 1.0f / size, Lanes::splat(0.0f));
+
+		for (UINT i = 0; i < batch; i++) {
+			if (!inside[i] || x0[i] >= x1[i] || y0[i] >= y1[i]) continue;
+
+			const ScreenVertex& point = points[base + i];
+			float values[MAX_PLANES];
+			this->attributes(point, point.vertex, values);
+
+			Primitive p;
+			p.kind = RECTANGLE;
+			p.backFace = false;
+			p.bounds[0] = x0[i];
+			p.bounds[1] = y0[i];
+			p.bounds[2] = x1[i];
+			p.bounds[3] = y1[i];
+			p.ref[0] = xs[i] - half[i];
+			p.ref[1] = ys[i] - half[i];
+			p.plane = this->planes.size();
+			this->planes.resize(p.plane + n * 3);
+			float* plane = &this->planes[p.plane];
+
+			for (UINT k = 0; k < n; k++) {
+				plane[k * 3] = values[k];
+				plane[k * 3 + 1] = plane[k * 3 + 2] = 0.0f;
+			}
+
+			if (state.pointSprite) {
+				const float rhw = point.rhw, delta = step[i] * rhw;
+				for (UINT t = 0; t < state.textureSets; t++) {
+					float* u = plane + (PLANE_TEXTURE + t * 4) * 3;
+					u[0] = 0.0f; u[1] = delta; u[2] = 0.0f;
+					u[3] = 0.0f; u[4] = 0.0f; u[5] = delta;
+					u[6] = 0.0f; u[7] = 0.0f; u[8] = 0.0f;
+					u[9] = rhw; u[10] = 0.0f; u[11] = 0.0f;
+				}
+			}
+
+			this->push(p);
+		}
+	}
+}
+
+//--- tiles
+
+void Rasterizer::flush() {
+	if (!this->empty()) {
+		WorkerPool::shared().parallelFor(this->bins.size(), 1, [this](size_t begin, size_t end) {
+			for (size_t tile = begin; tile < end; tile++) {
+				if (!this->bins[tile].empty()) this->renderCached(tile);
+			}
+		});
+
+		for (std::vector<uint32_t>& bin : this->bins) bin.clear();
+		this->primitives.clear();
+		this->planes.clear();
+		this->clears.clear();
+	}
+
+	if (this->states.size() > 1) {
+		this->states.erase(this->states.begin(), this->states.end() - 1);
+		this->kernels.erase(this->kernels.begin(), this->kernels.end() - 1);
+		this->stateKeys.erase(this->stateKeys.begin(), this->stateKeys.end() - 1);
+	}
+}
+
+//lanes are two 2x2 quads: x = 0 1 0 1 2 3 2 3, y = 0 0 1 1 0 0 1 1
+static constexpr uint32_t COLUMN_LANES[4] = {0x05, 0x0A, 0x50, 0xA0};
+static constexpr uint32_t ROW_LANES[2] = {0x33, 0xCC};
+
+ODX_INLINE i32x8 laneX() {
+	return i32x8{0, 1, 0, 1, 2, 3, 2, 3};
+}
+
+ODX_INLINE i32x8 laneY() {
+	return i32x8{0, 0, 1, 1, 0, 0, 1, 1};
+}
+
+ODX_INLINE uint32_t columnMask(int bx, int x0, int x1) {
+	uint32_t mask = 0;
+	for (int i = 0; i < 4; i++) mask |= bx + i >= x0 && bx + i < x1 ? COLUMN_LANES[i] : 0;
+	return mask;
+}
+
+ODX_INLINE uint32_t rowMask(int by, int y0, int y1) {
+	return (by >= y0 && by < y1 ? ROW_LANES[0] : 0) | (by + 1 >= y0 && by + 1 < y1 ? ROW_LANES[1] : 0);
+}
+
+//--- pixel pipeline
+
+ODX_INLINE f32x8 evaluate(const float* plane, f32x8 dx, f32x8 dy) {
+	return plane[0] + plane[1] * dx + plane[2] * dy;
+}
+
+ODX_INLINE i32x8 compare(D3DCMPFUNC func, i32x8 a, i32x8 b) {
+	switch (func) {
+		case D3DCMP_NEVER: return Lanes::splat(0);
+		case D3DCMP_LESS: return a < b;
+		case D3DCMP_EQUAL: return a == b;
+		case D3DCMP_LESSEQUAL: return a <= b;
+		case D3DCMP_GREATER: return a > b;
+		case D3DCMP_NOTEQUAL: return a != b;
+		case D3DCMP_GREATEREQUAL: return a >= b;
+		default: return Lanes::splat(-1);
+	}
+}
+
+/**
+ * Channel "c" of argument "arg" (D3DTA_*), "source" being indexed by
+ * D3DTA_SELECTMASK.
+ */
+ODX_INLINE f32x8 argument(DWORD arg, int c, const f32x8* const* source) {
+	const f32x8 v = source[arg & D3DTA_SELECTMASK][arg & D3DTA_ALPHAREPLICATE ? 3 : c];
+	return arg & D3DTA_COMPLEMENT ? 1.0f - v : v;
+}
+
+ODX_INLINE f32x8 blend(f32x8 a, f32x8 b, f32x8 factor) {
+	return a * factor + b * (1.0f - factor);
+}
+
+/**
+ * Channel "c" of what "op" makes of "args" (ARG1, ARG2, ARG0).
+ */
+ODX_INLINE f32x8 combine(D3DTEXTUREOP op, const DWORD* args, int c, const f32x8* const* source) {
+	const f32x8 a = argument(args[0], c, source), b = argument(args[1], c, source);
+
+	switch (op) {
+		case D3DTOP_SELECTARG2: return b;
+		case D3DTOP_MODULATE: return a * b;
+		case D3DTOP_MODULATE2X: return a * b * 2.0f;
+		case D3DTOP_MODULATE4X: return a * b * 4.0f;
+		case D3DTOP_ADD: return a + b;
+		case D3DTOP_ADDSIGNED: return a + b - 0.5f;
+		case D3DTOP_ADDSIGNED2X: return (a + b - 0.5f) * 2.0f;
+		case D3DTOP_SUBTRACT: return a - b;
+		case D3DTOP_ADDSMOOTH: return a + b * (1.0f - a);
+		case D3DTOP_BLENDDIFFUSEALPHA: return blend(a, b, source[D3DTA_DIFFUSE][3]);
+		case D3DTOP_BLENDTEXTUREALPHA: return blend(a, b, source[D3DTA_TEXTURE][3]);
+		case D3DTOP_BLENDFACTORALPHA: return blend(a, b, source[D3DTA_TFACTOR][3]);
+		case D3DTOP_BLENDCURRENTALPHA: return blend(a, b, source[D3DTA_CURRENT][3]);
+		case D3DTOP_BLENDTEXTUREALPHAPM: return a + b * (1.0f - source[D3DTA_TEXTURE][3]);
+		case D3DTOP_MODULATEALPHA_ADDCOLOR: return a + argument(args[0], 3, source) * b;
+		case D3DTOP_MODULATECOLOR_ADDALPHA: return a * b + argument(args[0], 3, source);
+		case D3DTOP_MODULATEINVALPHA_ADDCOLOR: return a + (1.0f - argument(args[0], 3, source)) * b;
+		case D3DTOP_MODULATEINVCOLOR_ADDALPHA: return (1.0f - a) * b + argument(args[0], 3, source);
+		case D3DTOP_MULTIPLYADD: return argument(args[2], c, source) + a * b;
+		case D3DTOP_LERP: return blend(a, b, argument(args[2], c, source));
+		default: return a; //SELECTARG1, and bump mapping, which is not supported
+	}
+}
+
+/**
+ * Runs the texture stages: "color" holds the diffuse color and
+ * receives CURRENT after the last stage. Each stage samples its
+ * texture with perspective-correct coordinates for the whole block,
+ * helper lanes outside the primitive included, so that the sampler
+ * gets every quad's derivatives.
+ */
+ODX_INLINE void textureStages(const DrawState& state, const PixelKernels& kernels, const float* planes, f32x8 dx, f32x8 dy, f32x8 w, f32x8* color) {
+	f32x8 diffuse[4], current[4], texture[4] = {}, factor[4], specular[4], temp[4] = {}, constant[4];
+	for (int c = 0; c < 4; c++) {
+		diffuse[c] = current[c] = color[c];
+		factor[c] = Lanes::splat(state.textureFactor[c]);
+		specular[c] = evaluate(planes + (Rasterizer::PLANE_SPECULAR + c) * 3, dx, dy) * w;
+	}
+	const f32x8* const source[7] = {diffuse, current, texture, factor, specular, temp, constant};
+
+	for (UINT i = 0; i < state.textureSets; i++) {
+		const TextureStage& stage = state.stages[i];
+
+		if (kernels.sample[i] != NULL) {
+			f32x8 uvwq[4];
+			for (int c = 0; c < 4; c++) uvwq[c] = evaluate(planes + (Rasterizer::PLANE_TEXTURE + i * 4 + c) * 3, dx, dy) * w;
+			if (stage.projected > 1) {
+				const f32x8 q = 1.0f / uvwq[stage.projected - 1];
+				for (UINT c = 0; c + 1 < stage.projected; c++) uvwq[c] *= q;
+			}
+
+			alignas(32) float coords[3][8], sampled[4][8];
+			for (int c = 0; c < 3; c++) Lanes::store(coords[c], uvwq[c]);
+			kernels.sample[i](stage.view, stage.sampler, &coords[0][0], &sampled[0][0]);
+			for (int c = 0; c < 4; c++) texture[c] = Lanes::load(sampled[c]);
+		}
+		for (int c = 0; c < 4; c++) constant[c] = Lanes::splat(stage.constant[c]);
+
+		f32x8 result[4];
+		if (stage.colorOp == D3DTOP_DOTPRODUCT3) {
+			//4 * dot(arg1 - 0.5, arg2 - 0.5), into alpha too
+			f32x8 dot = {};
+			for (int c = 0; c < 3; c++) dot += (argument(stage.colorArg[0], c, source) - 0.5f) * (argument(stage.colorArg[1], c, source) - 0.5f);
+			for (int c = 0; c < 4; c++) result[c] = Lanes::clamp01(dot * 4.0f);
+		} else {
+			for (int c = 0; c < 3; c++) result[c] = Lanes::clamp01(combine(stage.colorOp, stage.colorArg, c, source));
+			result[3] = stage.alphaOp == D3DTOP_DISABLE ? current[3] : Lanes::clamp01(combine(stage.alphaOp, stage.alphaArg, 3, source));
+		}
+
+		f32x8* out = stage.temp ? temp : current;
+		for (int c = 0; c < 4; c++) out[c] = result[c];
+	}
+
+	for (int c = 0; c < 4; c++) color[c] = current[c];
+}
+
+/**
+ * Shades the "mask" lanes of the block at (bx, by): depth and stencil
+ * (before shading unless alpha testing may still drop pixels),
+ * perspective-correct colors, texture stages, specular, fog, alpha
+ * test, then the output merger of each render target.
+ */
+ODX_INLINE void shade(const DrawState& state, const PixelKernels& kernels, const Primitive& p, const float* planes, int bx, int by, uint32_t mask) {
+	const f32x8 dx = Lanes::toFloat(Lanes::splat(bx) + laneX()) - p.ref[0];
+	const f32x8 dy = Lanes::toFloat(Lanes::splat(by) + laneY()) - p.ref[1];
+	alignas(32) float z[8];
+
+	if (kernels.depth != NULL) {
+		Lanes::store(z, evaluate(planes + Rasterizer::PLANE_Z * 3, dx, dy));
+		if (!state.alphaTest) {
+			mask = kernels.depth(state, bx, by, z, mask, p.backFace);
+			if (mask == 0) return;
+		}
+	}
+
+	//depth and stencil only, as in shadow volume passes
+	if (kernels.merges == 0 && !state.alphaTest) return;
+
+	const f32x8 w = 1.0f / evaluate(planes + Rasterizer::PLANE_RHW * 3, dx, dy);
+	f32x8 color[4];
+	for (int c = 0; c < 4; c++) color[c] = evaluate(planes + (Rasterizer::PLANE_DIFFUSE + c) * 3, dx, dy) * w;
+	if (state.textureSets > 0) textureStages(state, kernels, planes, dx, dy, w, color);
+	if (state.specular) {
+		for (int c = 0; c < 3; c++) color[c] += evaluate(planes + (Rasterizer::PLANE_SPECULAR + c) * 3, dx, dy) * w;
+	}
+
+	if (state.fog) {
+		f32x8 f;
+		if (!state.fogTable) f = Lanes::clamp01(evaluate(planes + (Rasterizer::PLANE_SPECULAR + 3) * 3, dx, dy) * w);
+		else if (state.fogW) f = state.fogParameters.factor(w);
+		else f = state.fogParameters.factor(Lanes::clamp01(evaluate(planes + Rasterizer::PLANE_Z * 3, dx, dy)));
+		for (int c = 0; c < 3; c++) color[c] = state.fogColor[c] + (color[c] - state.fogColor[c]) * f;
+	}
+
+	//pixels the alpha test drops leave depth and stencil untouched
+	if (state.alphaTest) {
+		mask &= Lanes::bits(compare(state.alphaFunc, (i32x8) Lanes::toUnorm8(color[3]), Lanes::splat((int32_t) (state.alphaRef & 0xFF))));
+		if (mask != 0 && kernels.depth != NULL) mask = kernels.depth(state, bx, by, z, mask, p.backFace);
+		if (mask == 0 || kernels.merges == 0) return;
+	}
+
+	alignas(32) float out[4][8];
+	for (int c = 0; c < 4; c++) Lanes::store(out[c], color[c]);
+	for (UINT i = 0; i < kernels.merges; i++) kernels.merge[i](state, kernels.target[i], bx, by, &out[0][0], mask);
+}
+
+//--- coverage
+
+ODX_INLINE void rasterizeTriangle(const DrawState& state, const PixelKernels& kernels, const Primitive& p, const float* planes, int x0, int y0, int x1, int y1) {
+	const auto& edges = p.edges;
+	int32_t a[3], b[3], start[3];
+	UINT active = 0;
+
+	//edges the whole area is inside of are not tested per block
+	for (UINT e = 0; e < 3; e++) {
+		int64_t at = (int64_t) edges.a[e] * x0 + (int64_t) edges.b[e] * y0 + edges.c[e];
+		int64_t spanX = (int64_t) edges.a[e] * (x1 - 1 - x0), spanY = (int64_t) edges.b[e] * (y1 - 1 - y0);
+		int64_t lowest = at + std::min<int64_t>(spanX, 0) + std::min<int64_t>(spanY, 0);
+		int64_t highest = at + std::max<int64_t>(spanX, 0) + std::max<int64_t>(spanY, 0);
+
+		if (highest < 0) return;
+		if (lowest >= 0) continue;
+
+		a[active] = edges.a[e];
+		b[active] = edges.b[e];
+		start[active++] = (int32_t) at;
+	}
+
+	const int bx0 = x0 & ~3;
+	for (int by = y0 & ~1; by < y1; by += 2) {
+		const uint32_t rows = rowMask(by, y0, y1);
+		i32x8 e[3];
+		for (UINT i = 0; i < active; i++) e[i] = Lanes::splat(start[i] + a[i] * (bx0 - x0) + b[i] * (by - y0)) + a[i] * laneX() + b[i] * laneY();
+
+		for (int bx = bx0; bx < x1; bx += 4) {
+			i32x8 outside = Lanes::splat(0);
+			for (UINT i = 0; i < active; i++) {
+				outside |= e[i];
+				e[i] += a[i] * 4;
+			}
+
+			uint32_t mask = Lanes::bits(outside >= 0) & rows & columnMask(bx, x0, x1);
+			if (mask != 0) shade(state, kernels, p, planes, bx, by, mask);
+		}
+	}
+}
+
+ODX_INLINE void rasterizeLine(const DrawState& state, const PixelKernels& kernels, const Primitive& p, const float* planes, int x0, int y0, int x1, int y1) {
+	const auto& line = p.line;
+
+	if (line.xMajor) {
+		for (int bx = x0 & ~3; bx < x1; bx += 4) {
+			const i32x8 x = Lanes::splat(bx) + laneX();
+			const i32x8 row = Lanes::floor(line.minor0 + line.slope * (Lanes::toFloat(x) - line.origin) + 0.5f);
+			const i32x8 valid = (x >= x0) & (x < x1);
+			int lowest = y1, highest = y0 - 1;
+
+			for (int i : {0, 1, 4, 5}) {
+				if (!valid[i]) continue;
+				lowest = std::min(lowest, row[i]);
+				highest = std::max(highest, row[i]);
+			}
+
+			for (int by = std::max(lowest, y0) & ~1; by <= std::min(highest, y1 - 1); by += 2) {
+				const i32x8 y = Lanes::splat(by) + laneY();
+				uint32_t mask = Lanes::bits(valid & (row == y)) & rowMask(by, y0, y1);
+				if (mask != 0) shade(state, kernels, p, planes, bx, by, mask);
+			}
+		}
+	} else {
+		for (int by = y0 & ~1; by < y1; by += 2) {
+			const i32x8 y = Lanes::splat(by) + laneY();
+			const i32x8 column = Lanes::floor(line.minor0 + line.slope * (Lanes::toFloat(y) - line.origin) + 0.5f);
+			const i32x8 valid = (y >= y0) & (y < y1);
+			int lowest = x1, highest = x0 - 1;
+
+			for (int i : {0, 2}) {
+				if (!valid[i]) continue;
+				lowest = std::min(lowest, column[i]);
+				highest = std::max(highest, column[i]);
+			}
+
+			for (int bx = std::max(lowest, x0) & ~3; bx <= std::min(highest, x1 - 1); bx += 4) {
+				const i32x8 x = Lanes::splat(bx) + laneX();
+				uint32_t mask = Lanes::bits(valid & (column == x)) & columnMask(bx, x0, x1);
+				if (mask != 0) shade(state, kernels, p, planes, bx, by, mask);
+			}
+		}
+	}
+}
+
+ODX_INLINE void rasterizeRectangle(const DrawState& state, const PixelKernels& kernels, const Primitive& p, const float* planes, int x0, int y0, int x1, int y1) {
+	for (int by = y0 & ~1; by < y1; by += 2) {
+		const uint32_t rows = rowMask(by, y0, y1);
+		for (int bx = x0 & ~3; bx < x1; bx += 4) shade(state, kernels, p, planes, bx, by, rows & columnMask(bx, x0, x1));
+	}
+}
+
+static void clearTile(const Rasterizer::Clear& clear, int x0, int y0, int x1, int y1) {
+	if (clear.flags & D3DCLEAR_TARGET) {
+		for (UINT i = 0; i < clear.targetCount; i++) OutputMerger::fill(clear.targets[i], clear.color, x0, y0, x1, y1);
+	}
+
+	const DWORD depthFlags = clear.flags & (D3DCLEAR_ZBUFFER | D3DCLEAR_STENCIL);
+	if (depthFlags != 0 && clear.depth.bits != NULL) DepthStencil::fill(clear.depth, depthFlags, clear.z, clear.stencil, x0, y0, x1, y1);
+}
+
+inline __attribute__((always_inline)) void Rasterizer::renderTileBody(UINT tile) {
+	const int tx = (tile % this->tilesX) * TILE, ty = (tile / this->tilesX) * TILE;
+
+	for (uint32_t command : this->bins[tile]) {
+		if (command & CLEAR_BIT) {
+			const Clear& clear = this->clears[command & ~CLEAR_BIT];
+			int x0 = std::max<int>(clear.rect.left, tx), y0 = std::max<int>(clear.rect.top, ty);
+			int x1 = std::min<int>(clear.rect.right, tx + TILE), y1 = std::min<int>(clear.rect.bottom, ty + TILE);
+			if (x0 < x1 && y0 < y1) clearTile(clear, x0, y0, x1, y1);
+			continue;
+		}
+
+		const Primitive& p = this->primitives[command];
+		const DrawState& state = this->states[p.state];
+		const PixelKernels& kernels = this->kernels[p.state];
+		const float* planes = &this->planes[p.plane];
+		int x0 = std::max(p.bounds[0], tx), y0 = std::max(p.bounds[1], ty);
+		int x1 = std::min(p.bounds[2], tx + TILE), y1 = std::min(p.bounds[3], ty + TILE);
+		if (x0 >= x1 || y0 >= y1) continue;
+
+		switch (p.kind) {
+			case TRIANGLE: rasterizeTriangle(state, kernels, p, planes, x0, y0, x1, y1); break;
+			case LINE: rasterizeLine(state, kernels, p, planes, x0, y0, x1, y1); break;
+			case RECTANGLE: rasterizeRectangle(state, kernels, p, planes, x0, y0, x1, y1); break;
+		}
+	}
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma")))
+#endif
+void Rasterizer::renderTileAVX2(UINT tile) {
+	this->renderTileBody(tile);
+}
+
+void Rasterizer::renderTileGeneric(UINT tile) {
+	this->renderTileBody(tile);
+}
+
+void Rasterizer::renderTile(UINT tile) {
+	if (VectorMath::hasAVX2()) this->renderTileAVX2(tile);
+	else this->renderTileGeneric(tile);
+}
+
+//--- tile cache
+
+/**
+ * Whether every surface of "targets" and "depth" is one "clear"
+ * clears.
+ */
+static bool clearedBy(const Rasterizer::Clear& clear, const Surface* targets, UINT targetCount, const Surface& depth) {
+	for (UINT i = 0; i < targetCount; i++) {
+		bool found = false;
+		for (UINT j = 0; j < clear.targetCount; j++) found |= targets[i].bits == clear.targets[j].bits;
+		if (!found) return false;
+	}
+	return depth.bits == NULL || depth.bits == clear.depth.bits;
+}
+
+uint64_t Rasterizer::tileKey(UINT tile) const {
+	const std::vector<uint32_t>& bin = this->bins[tile];
+	if (!(bin[0] & CLEAR_BIT)) return 0;
+
+	//the clear has to cover the tile, color and depth alike
+	const Clear& first = this->clears[bin[0] & ~CLEAR_BIT];
+	const LONG tx = (tile % this->tilesX) * TILE, ty = (tile / this->tilesX) * TILE;
+	if (first.rect.left > tx || first.rect.top > ty) return 0;
+	if (first.rect.right < std::min<LONG>(tx + TILE, this->width) || first.rect.bottom < std::min<LONG>(ty + TILE, this->height)) return 0;
+	if (!(first.flags & D3DCLEAR_TARGET)) return 0;
+	if (first.depth.bits != NULL) {
+		if (!(first.flags & D3DCLEAR_ZBUFFER)) return 0;
+		if (DepthStencil::stencilBits(first.depth.format) > 0 && !(first.flags & D3DCLEAR_STENCIL)) return 0;
+	}
+
+	Key key;
+	key.add(tile);
+	uint32_t checked = UINT32_MAX; //state last found to write only what the clear covers
+	for (uint32_t command : bin) {
+		if (command & CLEAR_BIT) {
+			const Clear& clear = this->clears[command & ~CLEAR_BIT];
+			if (!clearedBy(first, clear.targets, clear.targetCount, clear.depth)) return 0;
+
+			key.add((uint64_t) (uint32_t) clear.rect.left << 32 | (uint32_t) clear.rect.top);
+			key.add((uint64_t) (uint32_t) clear.rect.right << 32 | (uint32_t) clear.rect.bottom);
+			key.add(clear.flags);
+			key.add(clear.color);
+			key.add(&clear.z, 1);
+			key.add(clear.stencil);
+			key.add(clear.targetCount);
+			for (UINT i = 0; i < clear.targetCount; i++) key.add(clear.targets[i]);
+			key.add(clear.depth);
+			continue;
+		}
+
+		const Primitive& p = this->primitives[command];
+		if (p.key == 0) return 0;
+		if (p.state != checked) {
+			const DrawState& state = this->states[p.state];
+			if (!clearedBy(first, state.targets, state.targetCount, state.depth)) return 0;
+			checked = p.state;
+		}
+		key.add(p.key);
+	}
+	return key.value();
+}
+
+void Rasterizer::copyTile(UINT tile, std::vector<BYTE>& pixels, bool store) const {
+	const Clear& clear = this->clears[this->bins[tile][0] & ~CLEAR_BIT];
+	const UINT x0 = (tile % this->tilesX) * TILE, y0 = (tile / this->tilesX) * TILE;
+	const UINT x1 = std::min<UINT>(x0 + TILE, this->width), y1 = std::min<UINT>(y0 + TILE, this->height);
+
+	const Surface* surfaces[DrawState::MAX_TARGETS + 1];
+	UINT sizes[DrawState::MAX_TARGETS + 1];
+	UINT count = 0;
+	size_t total = 0;
+	for (UINT i = 0; i < clear.targetCount; i++) {
+		surfaces[count] = &clear.targets[i];
+		sizes[count] = OutputMerger::pixelSize(clear.targets[i].format);
+		total += (size_t) sizes[count++] * (x1 - x0) * (y1 - y0);
+	}
+	if (clear.depth.bits != NULL) {
+		surfaces[count] = &clear.depth;
+		sizes[count] = DepthStencil::pixelSize(clear.depth.format);
+		total += (size_t) sizes[count++] * (x1 - x0) * (y1 - y0);
+	}
+	if (store) pixels.resize(total);
+
+	BYTE* copy = pixels.data();
+	for (UINT i = 0; i < count; i++) {
+		const size_t row = (size_t) sizes[i] * (x1 - x0);
+		for (UINT y = y0; y < y1; y++, copy += row) {
+			BYTE* bits = surfaces[i]->bits + (size_t) y * surfaces[i]->pitch + (size_t) x0 * sizes[i];
+			if (store) memcpy(copy, bits, row);
+			else memcpy(bits, copy, row);
+		}
+	}
+}
+
+void Rasterizer::renderCached(UINT tile) {
+	const uint64_t key = this->tileKey(tile);
+	if (key == 0) {
+		this->renderTile(tile);
+		return;
+	}
+
+	CachedTile& cached = this->cache[tile];
+	for (UINT way = 0; way < CachedTile::WAYS; way++) {
+		if (cached.keys[way] != key) continue;
+		this->copyTile(tile, cached.pixels[way], false);
+		return;
+	}
+
+	this->renderTile(tile);
+	if (std::find(cached.seen, cached.seen + CachedTile::WAYS, key) != cached.seen + CachedTile::WAYS) {
+		//twice in the latest renders: likely to come back
+		const UINT way = cached.next;
+		cached.next = (way + 1) % CachedTile::WAYS;
+		cached.keys[way] = key;
+		this->copyTile(tile, cached.pixels[way], true);
+		return;
+	}
+	std::copy_backward(cached.seen, cached.seen + CachedTile::WAYS - 1, cached.seen + CachedTile::WAYS);
+	cached.seen[0] = key;
+}
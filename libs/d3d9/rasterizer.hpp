@@ -0,0 +1,354 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <windows.h>
+#include <d3d9.h>
+#include "sampler.hpp"
+#include "vertexstage.hpp"
+
+/**
+ * Memory the rasterizer reads and writes: a render target or a
+ * depth buffer. Depth buffer words pack depth in the high bits and
+ * stencil in the low ones (D24S8, D24X8, D24X4S4, D16, D15S1).
+ */
+struct Surface {
+	D3DFORMAT format;
+	UINT width;
+	UINT height;
+	UINT pitch;
+	BYTE* bits;
+};
+
+/**
+ * A fixed-function texture stage: what it samples and how its color
+ * and alpha combine with the stages before it.
+ */
+struct TextureStage {
+	D3DTEXTUREOP colorOp;
+	D3DTEXTUREOP alphaOp;
+	DWORD colorArg[3]; //D3DTA_* of ARG1, ARG2 and ARG0
+	DWORD alphaArg[3];
+	bool temp; //the result goes to TEMP rather than CURRENT
+	float constant[4]; //CONSTANT, r, g, b, a
+
+	UINT projected; //coordinate count with D3DTTFF_PROJECTED: the last divides the others; 0 without
+	TextureView view; //no levels without a texture
+	SamplerState sampler;
+};
+
+/**
+ * Device state a draw is rasterized with, captured when it is
+ * submitted.
+ */
+struct DrawState {
+	static constexpr const UINT MAX_TARGETS = 4;
+	static constexpr const UINT MAX_STAGES = 8;
+
+	//every target gets the same shaded color; all are the size of the first
+	Surface targets[MAX_TARGETS];
+	DWORD colorWrite[MAX_TARGETS];
+	UINT targetCount;
+	Surface depth; //bits is NULL without a depth buffer
+	D3DVIEWPORT9 viewport;
+	RECT clip; //pixels that may be written
+
+	D3DCULL cull;
+	D3DFILLMODE fill;
+	bool flat;
+	bool lastPixel;
+	bool pointSprite;
+	bool specular;
+
+	bool fog;
+	bool fogTable; //per pixel fog, else the interpolated specular alpha
+	bool fogW; //table fog by eye distance (1 / rhw) rather than depth
+	Fog fogParameters;
+	float fogColor[3];
+
+	bool zEnable;
+	bool zWrite;
+	D3DCMPFUNC zFunc;
+
+	//[0] for clockwise triangles, lines and points, [1] for counter-clockwise triangles
+	bool stencil;
+	D3DCMPFUNC stencilFunc[2];
+	D3DSTENCILOP stencilFail[2];
+	D3DSTENCILOP stencilZFail[2];
+	D3DSTENCILOP stencilPass[2];
+	DWORD stencilRef;
+	DWORD stencilMask;
+	DWORD stencilWriteMask;
+
+	bool alphaTest;
+	D3DCMPFUNC alphaFunc;
+	DWORD alphaRef;
+
+	bool blend;
+	D3DBLEND srcBlend;
+	D3DBLEND destBlend;
+	D3DBLENDOP blendOp;
+	D3DBLEND srcBlendAlpha;
+	D3DBLEND destBlendAlpha;
+	D3DBLENDOP blendOpAlpha;
+	D3DCOLOR blendFactor;
+
+	//stage i reads the coordinates of set i
+	UINT textureSets; //texture coordinates interpolated per pixel, one set per enabled stage
+	TextureStage stages[MAX_STAGES];
+	float textureFactor[4]; //TFACTOR, r, g, b, a
+	bool dither;
+	bool srgbWrite; //A8R8G8B8 and X8R8G8B8 targets store sRGB, blending in linear
+};
+
+/**
+ * Writes the "mask" pixels of the 4x2 block at (bx, by) to render
+ * target "target". "color" holds r, g, b and a for the eight pixels,
+ * in that order; see OutputMerger.
+ */
+typedef void (*MergeKernel)(const DrawState& state, UINT target, int bx, int by, const float* color, uint32_t mask);
+
+/**
+ * Tests the "mask" pixels of the block at (bx, by) against depth and
+ * stencil and updates both; returns the pixels that passed. "z"
+ * holds the eight depths, "ccw" picks the counter-clockwise stencil
+ * state. See DepthStencil.
+ */
+typedef uint32_t (*DepthKernel)(const DrawState& state, int bx, int by, const float* z, uint32_t mask, bool ccw);
+
+/**
+ * Kernels a state's pixels go through; "depth" is NULL when nothing
+ * is tested. merge[i] writes render target target[i], for the
+ * "merges" targets that have channels to write. sample[i] reads the
+ * texture of stage i, NULL if it has none.
+ */
+struct PixelKernels {
+	SampleKernel sample[DrawState::MAX_STAGES];
+	DepthKernel depth;
+	UINT merges;
+	MergeKernel merge[DrawState::MAX_TARGETS];
+	UINT target[DrawState::MAX_TARGETS];
+};
+
+/**
+ * Tiled software rasterizer.
+ *
+ * Draws are clipped, set up and binned into 64x64 tiles as they are
+ * submitted; flush() then renders the tiles on the worker pool, each
+ * tile running its commands in submission order. Pixels are shaded
+ * eight at a time as a 4x2 block of two 2x2 quads, going through the
+ * DepthStencil and OutputMerger kernels chosen for the state. A block
+ * is shaded once for all render targets: its colors stay in
+ * registers while each target's kernel blends and converts them.
+ *
+ * Points, point sprites and lines are primitives of their own:
+ * sprites are screen-aligned rectangles and lines are stepped along
+ * their major axis, neither is expanded into triangles.
+ *
+ * Tiles that start with a clear of everything they draw to are keyed
+ * by what their bin holds: the clear, and each primitive with its
+ * setup and state, texture versions included. A tile that comes back
+ * with the key of one of its last renders is copied from a stored
+ * copy of its pixels instead of being drawn again; copies are only
+ * kept of keys seen twice, so tiles that change every frame pay for
+ * hashing alone.
+ */
+class Rasterizer {
+	public:static constexpr const int TILE_SIZE = 64;
+
+	/**
+	 * Screen coordinates are clipped to +-GUARD_BAND pixels, which
+	 * keeps edge equations in 32-bit integers inside a tile.
+	 */
+	public:static constexpr const float GUARD_BAND = 8192.0f;
+
+	public:static constexpr const UINT MAX_PLANES = 10 + 8 * 4;
+
+	public:enum Kind : uint8_t {
+		TRIANGLE,
+		LINE,
+		RECTANGLE
+	};
+
+	/**
+	 * Attributes are planes: value at (x, y) = value + dx * (x - ref x) + dy * (y - ref y).
+	 * Z is linear in screen space, the others are divided by RHW.
+	 */
+	public:enum Plane : UINT {
+		PLANE_Z = 0,
+		PLANE_RHW = 1,
+		PLANE_DIFFUSE = 2,
+		PLANE_SPECULAR = 6,
+		PLANE_TEXTURE = 10
+	};
+
+	public:struct Primitive {
+		Kind kind;
+		bool backFace;
+		uint32_t state;
+		uint32_t plane; //first float in "planes"
+		uint64_t key; //what it draws, 0 if tiles it covers cannot be cached
+		int32_t bounds[4]; //x0, y0, x1, y1 (exclusive), inside the clip rectangle
+		float ref[2];
+
+		union {
+			//edge functions a * x + b * y + c >= 0, x and y in 1/16 pixels
+			struct {
+				int32_t a[3];
+				int32_t b[3];
+				int64_t c[3];
+			} edges;
+
+			//minor = minor0 + slope * (major - origin), major from "first" to "last"
+			struct {
+				bool xMajor;
+				float origin;
+				float minor0;
+				float slope;
+				int32_t first;
+				int32_t last;
+			} line;
+		};
+	};
+
+	/**
+	 * Screen-space vertex handed to setup
+	 */
+	public:struct ScreenVertex {
+		float x;
+		float y;
+		float z;
+		float rhw;
+		const Vertex* vertex;
+	};
+
+	public:struct Clear {
+		RECT rect;
+		DWORD flags;
+		D3DCOLOR color;
+		float z;
+		DWORD stencil;
+		Surface targets[DrawState::MAX_TARGETS];
+		UINT targetCount;
+		Surface depth;
+	};
+
+	/**
+	 * The latest renders of a tile, by key, and stored copies of its
+	 * targets and depth buffer (rows of each, in that order).
+	 */
+	private:struct CachedTile {
+		static constexpr const UINT WAYS = 2;
+
+		uint64_t seen[WAYS] = {}; //newest first
+		uint64_t keys[WAYS] = {};
+		std::vector<BYTE> pixels[WAYS];
+		UINT next = 0;
+	};
+
+	private:std::vector<DrawState> states;
+	private:std::vector<PixelKernels> kernels; //one per state
+	private:std::vector<uint64_t> stateKeys; //one per state, 0 if its draws cannot be cached
+	private:std::vector<Primitive> primitives;
+	private:std::vector<float> planes;
+	private:std::vector<Clear> clears;
+	private:std::vector<std::vector<uint32_t>> bins; //primitive index, or CLEAR_BIT | clear index
+	private:std::vector<CachedTile> cache; //one per tile
+	private:UINT width = 0;
+	private:UINT height = 0;
+	private:UINT tilesX = 0;
+	private:UINT tilesY = 0;
+	private:float guardX = 1.0f;
+	private:float guardY = 1.0f;
+
+	//per draw
+	private:std::vector<ScreenVertex> screen;
+	private:std::vector<uint32_t> outcodes;
+	private:std::vector<ScreenVertex> batch;
+
+	private:static constexpr const uint32_t CLEAR_BIT = 0x80000000;
+
+	/**
+	 * Following draws use "state". The tile grid follows the size of
+	 * its render target.
+	 */
+	public:void setState(const DrawState& state);
+
+	/**
+	 * Clears "rect" of every target in "targets", the first of which
+	 * sets the size, and of "depth".
+	 */
+	public:void clear(const RECT& rect, DWORD Flags, D3DCOLOR Color, float Z, DWORD Stencil, const Surface* targets, UINT targetCount, const Surface& depth);
+
+	/**
+	 * "vertices" come from the vertex stage; pre-transformed ones are
+	 * already in screen space and are not clipped.
+	 */
+	public:void draw(D3DPRIMITIVETYPE type, const Vertex* vertices, UINT primitiveCount, bool transformed);
+
+	/**
+	 * Renders everything submitted so far.
+	 */
+	public:void flush();
+
+	public:bool empty() const {
+		return this->primitives.empty() && this->clears.empty();
+	}
+
+	private:void resize(UINT width, UINT height);
+	private:void bin(uint32_t command, const int32_t* bounds);
+	private:const DrawState& state() const {
+		return this->states.back();
+	}
+	private:UINT planeCount() const {
+		return PLANE_TEXTURE + this->state().textureSets * 4;
+	}
+
+	private:void drawTriangles(D3DPRIMITIVETYPE type, const Vertex* vertices, UINT primitiveCount, bool transformed);
+	private:void drawLines(D3DPRIMITIVETYPE type, const Vertex* vertices, UINT primitiveCount, bool transformed);
+	private:void drawPoints(const Vertex* vertices, UINT count, bool transformed);
+
+	private:void clipTriangle(const Vertex* v0, const Vertex* v1, const Vertex* v2, uint32_t planes);
+	private:void clipLine(const Vertex* v0, const Vertex* v1, uint32_t planes);
+
+	/**
+	 * "provoking" gives the colors of flat shaded triangles.
+	 */
+	private:void setupTriangle(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2, const Vertex* provoking);
+
+	/**
+	 * Lines from ends[2 * i] to ends[2 * i + 1], eight at a time.
+	 */
+	private:void setupLines(const ScreenVertex* ends, UINT count);
+	private:void setupPoints(const ScreenVertex* points, UINT count);
+	private:void attributes(const ScreenVertex& vertex, const Vertex* colors, float* out) const;
+	private:uint32_t push(Primitive& primitive);
+
+	private:ScreenVertex project(const Vertex& vertex) const;
+	private:uint32_t outcode(const Vertex& vertex) const;
+
+	/**
+	 * Key of what "tile" renders, 0 unless its first command clears
+	 * every target and depth buffer its later commands write.
+	 */
+	private:uint64_t tileKey(UINT tile) const;
+
+	/**
+	 * Renders "tile", or restores it from the cache.
+	 */
+	private:void renderCached(UINT tile);
+
+	/**
+	 * Copies the pixels of "tile" to "pixels" or, unless "store",
+	 * back from them.
+	 */
+	private:void copyTile(UINT tile, std::vector<BYTE>& pixels, bool store) const;
+
+	/**
+	 * renderTileBody() is compiled twice, for AVX2 and for SSE2;
+	 * renderTile() picks one.
+	 */
+	private:void renderTile(UINT tile);
+	private:void renderTileAVX2(UINT tile);
+	private:void renderTileGeneric(UINT tile);
+	private:void renderTileBody(UINT tile);
+};
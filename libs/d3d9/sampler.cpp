@@ -0,0 +1,747 @@
+#include "sampler.hpp"
+#include "direct3dcubetexture9.hpp"
+#include "direct3dtexture9.hpp"
+#include "direct3dvolumetexture9.hpp"
+#include <algorithm>
+#include <vector>
+#include <simd/Lanes.hpp>
+#include <simd/VectorMath.hpp>
+#include <format/PixelFormat.hpp>
+
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+using Lanes::f32x8;
+using Lanes::i32x8;
+using Lanes::u32x8;
+
+#define ODX_INLINE inline __attribute__((always_inline))
+
+//--- texels
+
+/**
+ * One value of type T at each lane's pointer.
+ */
+template<typename T>
+static ODX_INLINE u32x8 gather(const BYTE* const* p, size_t offset = 0) {
+	u32x8 r;
+	for (int i = 0; i < 8; i++) {
+		T v;
+		memcpy(&v, p[i] + offset, sizeof(T));
+		r[i] = v;
+	}
+	return r;
+}
+
+static ODX_INLINE f32x8 unorm(u32x8 v, uint32_t max) {
+	return Lanes::toFloat((i32x8) (v & max)) * (1.0f / max);
+}
+
+/**
+ * sRGB color channels go through the table from their bytes; alpha
+ * is always linear.
+ */
+static ODX_INLINE f32x8 channel8(u32x8 v, bool srgb) {
+	return srgb ? Lanes::fromSrgb8(v) : Lanes::fromUnorm8(v);
+}
+
+static ODX_INLINE void argb8(u32x8 p, bool srgb, f32x8* color) {
+	color[0] = channel8(p >> 16, srgb);
+	color[1] = channel8(p >> 8, srgb);
+	color[2] = channel8(p, srgb);
+	color[3] = Lanes::fromUnorm8(p >> 24);
+}
+
+/**
+ * sRGB for formats of fewer bits per channel: they are widened to
+ * bytes first, as hardware does
+ */
+static ODX_INLINE void linearize(bool srgb, f32x8* color) {
+	if (!srgb) return;
+	for (int c = 0; c < 3; c++) color[c] = Lanes::fromSrgb8(Lanes::toUnorm8(color[c]));
+}
+
+/**
+ * Float texels: missing channels read as 1. They are linear already.
+ */
+template<typename C, int N>
+static ODX_INLINE void floats(const BYTE* const* p, f32x8* color) {
+	for (int c = 0; c < 4; c++) {
+		if (c >= N) color[c] = Lanes::splat(1.0f);
+		else if constexpr (sizeof(C) == 2) color[c] = Lanes::fromHalf(gather<uint16_t>(p, c * 2));
+		else color[c] = (f32x8) gather<uint32_t>(p, c * 4);
+	}
+}
+
+static ODX_INLINE uint32_t expand565(uint32_t c) {
+	const uint32_t r = c >> 11 & 31, g = c >> 5 & 63, b = c & 31;
+	return (r << 3 | r >> 2) << 16 | (g << 2 | g >> 4) << 8 | (b << 3 | b >> 2);
+}
+
+/**
+ * (a * wa + b * wb) / (wa + wb) of each byte of two 888 colors
+ */
+static ODX_INLINE uint32_t mix888(uint32_t a, uint32_t b, uint32_t wa, uint32_t wb) {
+	uint32_t r = 0;
+	for (int shift = 0; shift < 24; shift += 8) r |= ((a >> shift & 0xFF) * wa + (b >> shift & 0xFF) * wb) / (wa + wb) << shift;
+	return r;
+}
+
+/**
+ * Texel "sub" of a DXT color block as X8R8G8B8; with "punchThrough"
+ * (DXT1) the three-color mode has transparent black, flagged by a
+ * clear bit 24.
+ */
+static ODX_INLINE uint32_t dxtColor(const BYTE* block, int sub, bool punchThrough) {
+	const uint32_t c0 = block[0] | block[1] << 8, c1 = block[2] | block[3] << 8;
+	const uint32_t index = (block[4 + sub / 4] >> (sub % 4 * 2)) & 3;
+	const uint32_t a = expand565(c0), b = expand565(c1);
+
+	if (c0 > c1 || !punchThrough) {
+		switch (index) {
+			case 0: return a | 0x1000000;
+			case 1: return b | 0x1000000;
+			case 2: return mix888(a, b, 2, 1) | 0x1000000;
+			default: return mix888(a, b, 1, 2) | 0x1000000;
+		}
+	}
+
+	switch (index) {
+		case 0: return a | 0x1000000;
+		case 1: return b | 0x1000000;
+		case 2: return mix888(a, b, 1, 1) | 0x1000000;
+		default: return 0;
+	}
+}
+
+static ODX_INLINE uint32_t dxt5Alpha(const BYTE* block, int sub) {
+	const uint32_t a0 = block[0], a1 = block[1];
+	uint64_t bits = 0;
+	memcpy(&bits, block + 2, 6);
+	const uint32_t index = bits >> (sub * 3) & 7;
+
+	if (index == 0) return a0;
+	if (index == 1) return a1;
+	if (a0 > a1) return (a0 * (8 - index) + a1 * (index - 1)) / 7;
+	if (index == 6) return 0;
+	if (index == 7) return 255;
+	return (a0 * (6 - index) + a1 * (index - 1)) / 5;
+}
+
+/**
+ * Decoding of texels to r, g, b, a lanes from one pointer per lane.
+ * SIZE is bytes per texel, or per 4x4 block for DXTn, where "sub"
+ * is the texel within the block. With "srgb", color channels are
+ * converted to linear before anything filters them.
+ */
+template<D3DFORMAT F> struct Texel;
+
+template<> struct Texel<D3DFMT_A8R8G8B8> {
+	static constexpr UINT SIZE = 4;
+	static ODX_INLINE void decode(const BYTE* const* p, const int* sub, bool srgb, f32x8* color) {
+		argb8(gather<uint32_t>(p), srgb, color);
+	}
+};
+
+template<> struct Texel<D3DFMT_X8R8G8B8> {
+	static constexpr UINT SIZE = 4;
+	static ODX_INLINE void decode(const BYTE* const* p, const int* sub, bool srgb, f32x8* color) {
+		argb8(gather<uint32_t>(p) | 0xFF000000, srgb, color);
+	}
+};
+
+template<> struct Texel<D3DFMT_R5G6B5> {
+	static constexpr UINT SIZE = 2;
+	static ODX_INLINE void decode(const BYTE* const* p, const int* sub, bool srgb, f32x8* color) {
+		const u32x8 t = gather<uint16_t>(p);
+		color[0] = unorm(t >> 11, 31);
+		color[1] = unorm(t >> 5, 63);
+		color[2] = unorm(t, 31);
+		color[3] = Lanes::splat(1.0f);
+		linearize(srgb, color);
+	}
+};
+
+template<> struct Texel<D3DFMT_X1R5G5B5> {
+	static constexpr UINT SIZE = 2;
+	static ODX_INLINE void decode(const BYTE* const* p, const int* sub, bool srgb, f32x8* color) {
+		const u32x8 t = gather<uint16_t>(p);
+		color[0] = unorm(t >> 10, 31);
+		color[1] = unorm(t >> 5, 31);
+		color[2] = unorm(t, 31);
+		color[3] = Lanes::splat(1.0f);
+		linearize(srgb, color);
+	}
+};
+
+template<> struct Texel<D3DFMT_A1R5G5B5> {
+	static constexpr UINT SIZE = 2;
+	static ODX_INLINE void decode(const BYTE* const* p, const int* sub, bool srgb, f32x8* color) {
+		const u32x8 t = gather<uint16_t>(p);
+		color[0] = unorm(t >> 10, 31);
+		color[1] = unorm(t >> 5, 31);
+		color[2] = unorm(t, 31);
+		color[3] = unorm(t >> 15, 1);
+		linearize(srgb, color);
+	}
+};
+
+template<> struct Texel<D3DFMT_A4R4G4B4> {
+	static constexpr UINT SIZE = 2;
+	static ODX_INLINE void decode(const BYTE* const* p, const int* sub, bool srgb, f32x8* color) {
+		const u32x8 t = gather<uint16_t>(p);
+		color[0] = unorm(t >> 8, 15);
+		color[1] = unorm(t >> 4, 15);
+		color[2] = unorm(t, 15);
+		color[3] = unorm(t >> 12, 15);
+		linearize(srgb, color);
+	}
+};
+
+template<> struct Texel<D3DFMT_A8> {
+	static constexpr UINT SIZE = 1;
+	static ODX_INLINE void decode(const BYTE* const* p, const int* sub, bool srgb, f32x8* color) {
+		color[0] = color[1] = color[2] = Lanes::splat(0.0f);
+		color[3] = Lanes::fromUnorm8(gather<uint8_t>(p));
+	}
+};
+
+template<> struct Texel<D3DFMT_L8> {
+	static constexpr UINT SIZE = 1;
+	static ODX_INLINE void decode(const BYTE* const* p, const int* sub, bool srgb, f32x8* color) {
+		color[0] = color[1] = color[2] = channel8(gather<uint8_t>(p), srgb);
+		color[3] = Lanes::splat(1.0f);
+	}
+};
+
+template<> struct Texel<D3DFMT_A8L8> {
+	static constexpr UINT SIZE = 2;
+	static ODX_INLINE void decode(const BYTE* const* p, const int* sub, bool srgb, f32x8* color) {
+		const u32x8 t = gather<uint16_t>(p);
+		color[0] = color[1] = color[2] = channel8(t, srgb);
+		color[3] = Lanes::fromUnorm8(t >> 8);
+	}
+};
+
+template<> struct Texel<D3DFMT_DXT1> {
+	static constexpr UINT SIZE = 8;
+	static ODX_INLINE void decode(const BYTE* const* p, const int* sub, bool srgb, f32x8* color) {
+		u32x8 t;
+		for (int i = 0; i < 8; i++) {
+			const uint32_t c = dxtColor(p[i], sub[i], true);
+			t[i] = c & 0x1000000 ? c | 0xFF000000 : 0;
+		}
+		argb8(t, srgb, color);
+	}
+};
+
+//DXT2 and DXT4 hold premultiplied colors, which are sampled as stored
+template<> struct Texel<D3DFMT_DXT3> {
+	static constexpr UINT SIZE = 16;
+	static ODX_INLINE void decode(const BYTE* const* p, const int* sub, bool srgb, f32x8* color) {
+		u32x8 t;
+		for (int i = 0; i < 8; i++) {
+			const uint32_t alpha = (p[i][sub[i] / 2] >> (sub[i] % 2 * 4)) & 0xF;
+			t[i] = (dxtColor(p[i] + 8, sub[i], false) & 0xFFFFFF) | alpha * 17 << 24;
+		}
+		argb8(t, srgb, color);
+	}
+};
+template<> struct Texel<D3DFMT_DXT2> : Texel<D3DFMT_DXT3> {};
+
+template<> struct Texel<D3DFMT_DXT5> {
+	static constexpr UINT SIZE = 16;
+	static ODX_INLINE void decode(const BYTE* const* p, const int* sub, bool srgb, f32x8* color) {
+		u32x8 t;
+		for (int i = 0; i < 8; i++) t[i] = (dxtColor(p[i] + 8, sub[i], false) & 0xFFFFFF) | dxt5Alpha(p[i], sub[i]) << 24;
+		argb8(t, srgb, color);
+	}
+};
+template<> struct Texel<D3DFMT_DXT4> : Texel<D3DFMT_DXT5> {};
+
+template<typename C, int N> struct FloatTexel {
+	static constexpr UINT SIZE = sizeof(C) * N;
+	static ODX_INLINE void decode(const BYTE* const* p, const int* sub, bool srgb, f32x8* color) {
+		floats<C, N>(p, color);
+	}
+};
+template<> struct Texel<D3DFMT_R16F> : FloatTexel<uint16_t, 1> {};
+template<> struct Texel<D3DFMT_G16R16F> : FloatTexel<uint16_t, 2> {};
+template<> struct Texel<D3DFMT_A16B16G16R16F> : FloatTexel<uint16_t, 4> {};
+template<> struct Texel<D3DFMT_R32F> : FloatTexel<float, 1> {};
+template<> struct Texel<D3DFMT_G32R32F> : FloatTexel<float, 2> {};
+template<> struct Texel<D3DFMT_A32B32G32R32F> : FloatTexel<float, 4> {};
+
+//--- levels and addressing
+
+/**
+ * The level each lane reads, on the face it reads for cube textures.
+ */
+struct LevelLanes {
+	const BYTE* bits[8];
+	i32x8 width;
+	i32x8 height;
+	i32x8 depth;
+	i32x8 pitch;
+	i32x8 slice;
+};
+
+static ODX_INLINE void levelLanes(const TextureView& view, i32x8 level, i32x8 face, LevelLanes& out) {
+	for (int i = 0; i < 8; i++) {
+		const TextureView::Level& l = view.level[level[i]];
+		out.bits[i] = l.bits + face[i] * view.faceSize;
+		out.width[i] = l.width;
+		out.height[i] = l.height;
+		out.depth[i] = l.depth;
+		out.pitch[i] = l.pitch;
+		out.slice[i] = l.slice;
+	}
+}
+
+/**
+ * Texel coordinate "x" of a texture "size" texels wide, wrapped or
+ * clamped into it. Lanes that read the border color are set in
+ * "border".
+ */
+static ODX_INLINE i32x8 address(D3DTEXTUREADDRESS mode, i32x8 x, i32x8 size, i32x8& border) {
+	const i32x8 last = size - 1;
+	switch (mode) {
+		case D3DTADDRESS_WRAP: {
+			const f32x8 s = Lanes::toFloat(size);
+			x = x - Lanes::floor(Lanes::toFloat(x) / s) * size;
+			break;
+		}
+		case D3DTADDRESS_MIRROR: {
+			const i32x8 period = size * 2;
+			x = x - Lanes::floor(Lanes::toFloat(x) / Lanes::toFloat(period)) * period;
+			x = Lanes::select(x > last, period - 1 - x, x);
+			break;
+		}
+		case D3DTADDRESS_BORDER:
+			border |= (x < 0) | (x > last);
+			break;
+		case D3DTADDRESS_MIRRORONCE:
+			x = Lanes::select(x < 0, -1 - x, x);
+			break;
+		default:
+			break;
+	}
+
+	//also keeps reads inside the level whatever rounding did above
+	return Lanes::min(Lanes::max(x, Lanes::splat(0)), last);
+}
+
+/**
+ * Texel coordinates "s" (in texels, centers at .5) to the first of
+ * the texels a lane filters and the weight of the second. Point
+ * lanes take the texel "s" is in, with a weight of 0.
+ */
+static ODX_INLINE i32x8 texel(f32x8 s, i32x8 linear, f32x8& weight) {
+	//far out coordinates wrap to noise anyway; this keeps them in int range
+	s = Lanes::min(Lanes::max(s, Lanes::splat(-0x1p24f)), Lanes::splat(0x1p24f));
+
+	const f32x8 t = Lanes::select(linear, s - 0.5f, s);
+	const i32x8 x = Lanes::floor(t);
+	weight = Lanes::select(linear, t - Lanes::toFloat(x), Lanes::splat(0.0f));
+	return x;
+}
+
+template<D3DRESOURCETYPE T, D3DFORMAT F>
+static ODX_INLINE void fetch(const LevelLanes& level, i32x8 x, i32x8 y, i32x8 z, bool srgb, f32x8* color) {
+	constexpr UINT SIZE = Texel<F>::SIZE;
+	const BYTE* p[8];
+	int sub[8];
+
+	for (int i = 0; i < 8; i++) {
+		if constexpr (T == D3DRTYPE_VOLUMETEXTURE) {
+			const size_t brick = ((size_t) (z[i] >> 2) * level.slice[i] + (y[i] >> 2)) * level.pitch[i] + (x[i] >> 2);
+			p[i] = level.bits[i] + (brick * 64 + (z[i] & 3) * 16 + (y[i] & 3) * 4 + (x[i] & 3)) * SIZE;
+		} else if constexpr (PixelFormat::isCompressed(F)) {
+			p[i] = level.bits[i] + (size_t) (y[i] >> 2) * level.pitch[i] + (x[i] >> 2) * SIZE;
+			sub[i] = (y[i] & 3) * 4 + (x[i] & 3);
+		} else {
+			p[i] = level.bits[i] + (size_t) y[i] * level.pitch[i] + x[i] * SIZE;
+		}
+	}
+	Texel<F>::decode(p, sub, srgb, color);
+}
+
+static ODX_INLINE void lerp(f32x8* a, const f32x8* b, f32x8 weight) {
+	for (int c = 0; c < 4; c++) a[c] += (b[c] - a[c]) * weight;
+}
+
+static ODX_INLINE void applyBorder(const SamplerState& sampler, i32x8 border, f32x8* color) {
+	for (int c = 0; c < 4; c++) color[c] = Lanes::select(border, Lanes::splat(sampler.border[c]), color[c]);
+}
+
+//--- filters
+
+/**
+ * One level of a 2D texture or a cube face: point or bilinear per
+ * lane. Cube faces clamp to their edges.
+ */
+template<D3DRESOURCETYPE T, D3DFORMAT F>
+static ODX_INLINE void filter2D(const LevelLanes& level, const SamplerState& sampler, f32x8 u, f32x8 v, i32x8 linear, f32x8* color) {
+	const D3DTEXTUREADDRESS addressU = T == D3DRTYPE_CUBETEXTURE ? D3DTADDRESS_CLAMP : sampler.address[0];
+	const D3DTEXTUREADDRESS addressV = T == D3DRTYPE_CUBETEXTURE ? D3DTADDRESS_CLAMP : sampler.address[1];
+	const bool border = addressU == D3DTADDRESS_BORDER || addressV == D3DTADDRESS_BORDER;
+	const i32x8 zero = {};
+
+	f32x8 wx, wy;
+	const i32x8 s = texel(u * Lanes::toFloat(level.width), linear, wx);
+	const i32x8 t = texel(v * Lanes::toFloat(level.height), linear, wy);
+
+	i32x8 outX[2] = {}, outY[2] = {};
+	const i32x8 x0 = address(addressU, s, level.width, outX[0]);
+	const i32x8 y0 = address(addressV, t, level.height, outY[0]);
+	fetch<T, F>(level, x0, y0, zero, sampler.srgb, color);
+	if (border) applyBorder(sampler, outX[0] | outY[0], color);
+	if (Lanes::bits(linear) == 0) return;
+
+	const i32x8 x1 = address(addressU, s + 1, level.width, outX[1]);
+	const i32x8 y1 = address(addressV, t + 1, level.height, outY[1]);
+
+	f32x8 tap[4], row[4];
+	fetch<T, F>(level, x1, y0, zero, sampler.srgb, tap);
+	if (border) applyBorder(sampler, outX[1] | outY[0], tap);
+	lerp(color, tap, wx);
+
+	fetch<T, F>(level, x0, y1, zero, sampler.srgb, row);
+	if (border) applyBorder(sampler, outX[0] | outY[1], row);
+	fetch<T, F>(level, x1, y1, zero, sampler.srgb, tap);
+	if (border) applyBorder(sampler, outX[1] | outY[1], tap);
+	lerp(row, tap, wx);
+
+	lerp(color, row, wy);
+}
+
+/**
+ * One level of a volume: point or trilinear per lane. The eight taps
+ * come from one brick unless the footprint straddles a brick edge.
+ */
+template<D3DFORMAT F>
+static ODX_INLINE void filter3D(const LevelLanes& level, const SamplerState& sampler, f32x8 u, f32x8 v, f32x8 w, i32x8 linear, f32x8* color) {
+	const bool border = sampler.address[0] == D3DTADDRESS_BORDER || sampler.address[1] == D3DTADDRESS_BORDER
+		|| sampler.address[2] == D3DTADDRESS_BORDER;
+
+	f32x8 wx, wy, wz;
+	const i32x8 s = texel(u * Lanes::toFloat(level.width), linear, wx);
+	const i32x8 t = texel(v * Lanes::toFloat(level.height), linear, wy);
+	const i32x8 r = texel(w * Lanes::toFloat(level.depth), linear, wz);
+
+	i32x8 outX[2] = {}, outY[2] = {}, outZ[2] = {};
+	const i32x8 x[2] = {address(sampler.address[0], s, level.width, outX[0]), address(sampler.address[0], s + 1, level.width, outX[1])};
+	const i32x8 y[2] = {address(sampler.address[1], t, level.height, outY[0]), address(sampler.address[1], t + 1, level.height, outY[1])};
+	const i32x8 z[2] = {address(sampler.address[2], r, level.depth, outZ[0]), address(sampler.address[2], r + 1, level.depth, outZ[1])};
+
+	fetch<D3DRTYPE_VOLUMETEXTURE, F>(level, x[0], y[0], z[0], sampler.srgb, color);
+	if (border) applyBorder(sampler, outX[0] | outY[0] | outZ[0], color);
+	if (Lanes::bits(linear) == 0) return;
+
+	//rows along x at (y, z) = (0, 0), (1, 0), (0, 1), (1, 1)
+	f32x8 row[4][4];
+	for (int i = 0; i < 4; i++) {
+		const int j = i & 1, k = i >> 1;
+		f32x8 tap[4];
+		if (i == 0) {
+			for (int c = 0; c < 4; c++) row[0][c] = color[c];
+		} else {
+			fetch<D3DRTYPE_VOLUMETEXTURE, F>(level, x[0], y[j], z[k], sampler.srgb, row[i]);
+			if (border) applyBorder(sampler, outX[0] | outY[j] | outZ[k], row[i]);
+		}
+		fetch<D3DRTYPE_VOLUMETEXTURE, F>(level, x[1], y[j], z[k], sampler.srgb, tap);
+		if (border) applyBorder(sampler, outX[1] | outY[j] | outZ[k], tap);
+		lerp(row[i], tap, wx);
+	}
+
+	lerp(row[0], row[1], wy);
+	lerp(row[2], row[3], wy);
+	lerp(row[0], row[2], wz);
+	for (int c = 0; c < 4; c++) color[c] = row[0][c];
+}
+
+/**
+ * Direction (x, y, z) to a face and u, v on it, as D3D lays cube
+ * faces out: the major axis picks the face, the other two divided
+ * by it are the coordinates.
+ */
+static ODX_INLINE i32x8 cubeFace(f32x8 x, f32x8 y, f32x8 z, f32x8& u, f32x8& v) {
+	const f32x8 ax = Lanes::abs(x), ay = Lanes::abs(y), az = Lanes::abs(z);
+	const i32x8 xMajor = (ax >= ay) & (ax >= az);
+	const i32x8 yMajor = ~xMajor & (ay >= az);
+	const i32x8 zMajor = ~xMajor & ~yMajor;
+	const i32x8 one = Lanes::splat(1);
+
+	const i32x8 face = (xMajor & ((x < 0.0f) & one)) | (yMajor & (2 + ((y < 0.0f) & one))) | (zMajor & (4 + ((z < 0.0f) & one)));
+	const f32x8 major = Lanes::select(xMajor, ax, Lanes::select(yMajor, ay, az));
+
+	//sc, tc per face: +x (-z, -y), -x (z, -y), +y (x, z), -y (x, -z), +z (x, -y), -z (-x, -y)
+	f32x8 sc = Lanes::select(xMajor, Lanes::select(x < 0.0f, z, -z), Lanes::select(zMajor & (z < 0.0f), -x, x));
+	f32x8 tc = Lanes::select(yMajor, Lanes::select(y < 0.0f, -z, z), -y);
+
+	const f32x8 scale = 0.5f / Lanes::max(major, Lanes::splat(0x1p-100f));
+	u = sc * scale + 0.5f;
+	v = tc * scale + 0.5f;
+	return face;
+}
+
+//--- kernels
+
+static ODX_INLINE bool isLinear(D3DTEXTUREFILTERTYPE filter) {
+	return filter >= D3DTEXF_LINEAR;
+}
+
+/**
+ * Levels: lanes with a LOD up to 0 magnify, the others minify and
+ * read one level, or two blended by the fraction of the LOD.
+ */
+template<D3DRESOURCETYPE T, D3DFORMAT F>
+static ODX_INLINE void filterLevels(const TextureView& view, const SamplerState& sampler, f32x8 u, f32x8 v, f32x8 w, f32x8 lod, f32x8* color) {
+	i32x8 face = {};
+	if constexpr (T == D3DRTYPE_CUBETEXTURE) face = cubeFace(u, v, w, u, v);
+
+	const i32x8 magnify = !(lod > 0.0f); //NaN too
+	const i32x8 linear = Lanes::select(magnify, Lanes::splat(isLinear(sampler.magFilter) ? -1 : 0), Lanes::splat(isLinear(sampler.minFilter) ? -1 : 0));
+
+	const float last = view.levels - 1;
+	const f32x8 l = Lanes::min(Lanes::max(lod, Lanes::splat(0.0f)), Lanes::splat(last));
+	i32x8 level = {};
+	f32x8 fraction = {};
+	if (sampler.mipFilter == D3DTEXF_POINT) {
+		level = Lanes::toInt(l + 0.5f);
+		level = Lanes::min(level, Lanes::splat((int32_t) last));
+	} else if (sampler.mipFilter != D3DTEXF_NONE) {
+		level = Lanes::toInt(l);
+		fraction = l - Lanes::toFloat(level);
+	}
+
+	LevelLanes lanes;
+	levelLanes(view, level, face, lanes);
+	if constexpr (T == D3DRTYPE_VOLUMETEXTURE) filter3D<F>(lanes, sampler, u, v, w, linear, color);
+	else filter2D<T, F>(lanes, sampler, u, v, linear, color);
+
+	if (Lanes::bits(fraction > 0.0f) != 0) {
+		f32x8 next[4];
+		levelLanes(view, Lanes::min(level + 1, Lanes::splat((int32_t) last)), face, lanes);
+		if constexpr (T == D3DRTYPE_VOLUMETEXTURE) filter3D<F>(lanes, sampler, u, v, w, linear, next);
+		else filter2D<T, F>(lanes, sampler, u, v, linear, next);
+		lerp(color, next, fraction);
+	}
+}
+
+//--- level of detail
+
+//lanes are two 2x2 quads: x = 0 1 0 1 2 3 2 3, y = 0 0 1 1 0 0 1 1
+static ODX_INLINE f32x8 ddx(f32x8 v) {
+	return __builtin_shufflevector(v, v, 1, 1, 3, 3, 5, 5, 7, 7) - __builtin_shufflevector(v, v, 0, 0, 2, 2, 4, 4, 6, 6);
+}
+
+static ODX_INLINE f32x8 ddy(f32x8 v) {
+	return __builtin_shufflevector(v, v, 2, 3, 2, 3, 6, 7, 6, 7) - __builtin_shufflevector(v, v, 0, 1, 0, 1, 4, 5, 4, 5);
+}
+
+/**
+ * The footprint of each pixel on the most detailed level: its LOD,
+ * and with anisotropy the number of taps and the step between them
+ * along the major axis, in coordinates.
+ *
+ * Derivatives are taken along the rows and columns of each quad. The
+ * texture size scales them to texels; cube derivatives are those of
+ * the direction, scaled by the face size over the major axis.
+ */
+template<D3DRESOURCETYPE T>
+static ODX_INLINE f32x8 footprint(const TextureView& view, const SamplerState& sampler, const f32x8* c, i32x8& taps, f32x8* step) {
+	constexpr int AXES = T == D3DRTYPE_TEXTURE ? 2 : 3;
+	const TextureView::Level& top = view.level[0];
+
+	f32x8 scale[3];
+	if constexpr (T == D3DRTYPE_CUBETEXTURE) {
+		const f32x8 major = Lanes::max(Lanes::max(Lanes::abs(c[0]), Lanes::abs(c[1])), Lanes::abs(c[2]));
+		scale[0] = scale[1] = scale[2] = (0.5f * top.width) / Lanes::max(major, Lanes::splat(0x1p-100f));
+	} else {
+		scale[0] = Lanes::splat((float) top.width);
+		scale[1] = Lanes::splat((float) top.height);
+		scale[2] = Lanes::splat((float) top.depth);
+	}
+
+	f32x8 dx[3], dy[3];
+	f32x8 x2 = {}, y2 = {};
+	for (int a = 0; a < AXES; a++) {
+		dx[a] = ddx(c[a]);
+		dy[a] = ddy(c[a]);
+		const f32x8 tx = dx[a] * scale[a], ty = dy[a] * scale[a];
+		x2 += tx * tx;
+		y2 += ty * ty;
+	}
+
+	//squared lengths in texels, kept where log2() is defined (NaN too)
+	const f32x8 low = Lanes::splat(0x1p-100f), high = Lanes::splat(0x1p100f);
+	const i32x8 xMajor = x2 >= y2;
+	f32x8 major2 = Lanes::select(xMajor, x2, y2), minor2 = Lanes::select(xMajor, y2, x2);
+	major2 = Lanes::min(Lanes::select(major2 > low, major2, low), high);
+	minor2 = Lanes::min(Lanes::select(minor2 > low, minor2, low), major2);
+
+	f32x8 lod = 0.5f * Lanes::log2(major2);
+	taps = Lanes::splat(1);
+	if (sampler.maxAnisotropy > 1) {
+		//ceil(major / minor) taps; the LOD is that of the footprint one tap covers
+		const f32x8 ratio = Lanes::sqrt(major2 / minor2);
+		taps = Lanes::min(Lanes::ceil(Lanes::min(ratio, Lanes::splat(64.0f)) - 0x1p-10f), Lanes::splat((int32_t) sampler.maxAnisotropy));
+		taps = Lanes::max(taps, Lanes::splat(1));
+		lod -= Lanes::log2(Lanes::toFloat(taps));
+		for (int a = 0; a < AXES; a++) step[a] = Lanes::select(xMajor, dx[a], dy[a]) / Lanes::toFloat(taps);
+	}
+
+	return lod + sampler.lodBias;
+}
+
+template<D3DRESOURCETYPE T, D3DFORMAT F>
+static ODX_INLINE void sample(const TextureView& view, const SamplerState& sampler, const float* coords, float* out) {
+	const f32x8 c[3] = {Lanes::load(coords), Lanes::load(coords + 8), Lanes::load(coords + 16)};
+	i32x8 taps;
+	f32x8 step[3] = {};
+	const f32x8 lod = footprint<T>(view, sampler, c, taps, step);
+
+	f32x8 color[4];
+	int most = 1;
+	for (int i = 0; i < 8; i++) most = std::max<int>(most, taps[i]);
+	if (most == 1) {
+		filterLevels<T, F>(view, sampler, c[0], c[1], c[2], lod, color);
+		for (int i = 0; i < 4; i++) Lanes::store(out + i * 8, color[i]);
+		return;
+	}
+
+	//taps centered on the pixel, spread over its major axis; lanes that take fewer weigh the extra ones 0
+	const f32x8 n = Lanes::toFloat(taps);
+	for (int i = 0; i < 4; i++) color[i] = Lanes::splat(0.0f);
+	for (int t = 0; t < most; t++) {
+		const f32x8 offset = (t + 0.5f) - 0.5f * n;
+		const f32x8 weight = Lanes::select(Lanes::splat(t) < taps, 1.0f / n, Lanes::splat(0.0f));
+
+		f32x8 tap[4];
+		filterLevels<T, F>(view, sampler, c[0] + step[0] * offset, c[1] + step[1] * offset, c[2] + step[2] * offset, lod, tap);
+		for (int i = 0; i < 4; i++) color[i] += tap[i] * weight;
+	}
+	for (int i = 0; i < 4; i++) Lanes::store(out + i * 8, color[i]);
+}
+
+template<D3DRESOURCETYPE T, D3DFORMAT F>
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma")))
+#endif
+void sampleAVX2(const TextureView& view, const SamplerState& sampler, const float* coords, float* color) {
+	sample<T, F>(view, sampler, coords, color);
+}
+
+template<D3DRESOURCETYPE T, D3DFORMAT F>
+void sampleGeneric(const TextureView& view, const SamplerState& sampler, const float* coords, float* color) {
+	sample<T, F>(view, sampler, coords, color);
+}
+
+template<D3DRESOURCETYPE T>
+static SampleKernel pick(D3DFORMAT format, bool avx2) {
+	#define ODX_SAMPLE(F) case F: return avx2 ? sampleAVX2<T, F> : sampleGeneric<T, F>;
+	switch (format) {
+		ODX_SAMPLE(D3DFMT_A8R8G8B8) ODX_SAMPLE(D3DFMT_X8R8G8B8) ODX_SAMPLE(D3DFMT_R5G6B5)
+		ODX_SAMPLE(D3DFMT_X1R5G5B5) ODX_SAMPLE(D3DFMT_A1R5G5B5) ODX_SAMPLE(D3DFMT_A4R4G4B4)
+		ODX_SAMPLE(D3DFMT_A8) ODX_SAMPLE(D3DFMT_L8) ODX_SAMPLE(D3DFMT_A8L8)
+		ODX_SAMPLE(D3DFMT_R16F) ODX_SAMPLE(D3DFMT_G16R16F) ODX_SAMPLE(D3DFMT_A16B16G16R16F)
+		ODX_SAMPLE(D3DFMT_R32F) ODX_SAMPLE(D3DFMT_G32R32F) ODX_SAMPLE(D3DFMT_A32B32G32R32F)
+		default: break;
+	}
+
+	//DXTn blocks are 2D, so volumes never hold them
+	if constexpr (T != D3DRTYPE_VOLUMETEXTURE) {
+		switch (format) {
+			ODX_SAMPLE(D3DFMT_DXT1) ODX_SAMPLE(D3DFMT_DXT2) ODX_SAMPLE(D3DFMT_DXT3)
+			ODX_SAMPLE(D3DFMT_DXT4) ODX_SAMPLE(D3DFMT_DXT5)
+			default: break;
+		}
+	}
+	#undef ODX_SAMPLE
+	return NULL;
+}
+
+SampleKernel Sampler::select(const TextureView& view) {
+	const bool avx2 = VectorMath::hasAVX2();
+
+	switch (view.type) {
+		case D3DRTYPE_TEXTURE: return pick<D3DRTYPE_TEXTURE>(view.format, avx2);
+		case D3DRTYPE_CUBETEXTURE: return pick<D3DRTYPE_CUBETEXTURE>(view.format, avx2);
+		case D3DRTYPE_VOLUMETEXTURE: return pick<D3DRTYPE_VOLUMETEXTURE>(view.format, avx2);
+		default: return NULL;
+	}
+}
+
+bool Sampler::view(IDirect3DBaseTexture9* texture, DWORD maxMipLevel, TextureView& view) {
+	view.type = texture->GetType();
+	view.faceSize = 0;
+	view.levels = 0;
+	const UINT count = texture->GetLevelCount();
+
+	switch (view.type) {
+		case D3DRTYPE_TEXTURE: {
+			Direct3DTexture9* t = static_cast<Direct3DTexture9*>(texture);
+			view.version = t->version();
+			D3DSURFACE_DESC desc;
+			t->GetLevelDesc(0, &desc);
+			view.format = desc.Format;
+
+			//still being decoded as a whole
+			if (t->firstLevel() >= count) return false;
+
+			//levels adopted from files have owners of their own
+			std::vector<std::shared_ptr<void>> owners;
+			const UINT first = std::min<UINT>(std::max<UINT>(t->firstLevel(), maxMipLevel), count - 1);
+			for (UINT i = first; i < count && view.levels < TextureView::MAX_LEVELS; i++) {
+				const Direct3DTexture9::Level* level = t->level(i);
+				if (level == NULL) break;
+				view.level[view.levels++] = {level->bits, level->width, level->height, 1, level->pitch, 0};
+				if (std::find(owners.begin(), owners.end(), level->owner) == owners.end()) owners.push_back(level->owner);
+			}
+			if (owners.size() == 1) view.storage = owners[0];
+			else view.storage = std::make_shared<std::vector<std::shared_ptr<void>>>(std::move(owners));
+			break;
+		}
+
+		case D3DRTYPE_CUBETEXTURE: {
+			Direct3DCubeTexture9* t = static_cast<Direct3DCubeTexture9*>(texture);
+			view.version = t->version();
+			D3DSURFACE_DESC desc;
+			t->GetLevelDesc(0, &desc);
+			view.format = desc.Format;
+			view.faceSize = t->faceStride();
+			view.storage = t->memory();
+
+			const UINT first = std::min<UINT>(std::max<UINT>(t->firstLevel(), maxMipLevel), count - 1);
+			for (UINT i = first; i < count && view.levels < TextureView::MAX_LEVELS; i++) {
+				const BYTE* bits = t->bits(0, i);
+				if (bits == NULL) break;
+				const Direct3DCubeTexture9::Level& level = t->level(i);
+				view.level[view.levels++] = {bits, level.size, level.size, 1, level.pitch, 0};
+			}
+			break;
+		}
+
+		case D3DRTYPE_VOLUMETEXTURE: {
+			Direct3DVolumeTexture9* t = static_cast<Direct3DVolumeTexture9*>(texture);
+			view.version = t->version();
+			D3DVOLUME_DESC desc;
+			t->GetLevelDesc(0, &desc);
+			view.format = desc.Format;
+			view.storage = t->memory();
+
+			const UINT first = std::min<UINT>(std::max<UINT>(t->firstLevel(), maxMipLevel), count - 1);
+			for (UINT i = first; i < count && view.levels < TextureView::MAX_LEVELS; i++) {
+				const Direct3DVolumeTexture9::Level& level = t->level(i);
+				if (level.bits == NULL) break;
+				view.level[view.levels++] = {level.bits, level.width, level.height, level.depth, level.bricksX, level.bricksY};
+			}
+			break;
+		}
+
+		default:
+			return false;
+	}
+
+	return view.levels > 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <windows.h>
+#include <d3d9.h>
+
+/**
+ * A texture as the sampler reads it, captured with the draw state:
+ * its levels from the most detailed one sampling may use.
+ */
+struct TextureView {
+	static constexpr const UINT MAX_LEVELS = 14;
+
+	struct Level {
+		const BYTE* bits; //of face 0 for cube textures
+		UINT width;
+		UINT height;
+		UINT depth;
+		UINT pitch; //bytes per row (of blocks for DXTn); bricks per row for volumes
+		UINT slice; //rows of bricks per slice, for volumes
+	};
+
+	D3DRESOURCETYPE type; //TEXTURE, CUBETEXTURE or VOLUMETEXTURE
+	D3DFORMAT format;
+	UINT levels;
+	size_t faceSize; //from one cube face to the next
+	Level level[MAX_LEVELS];
+	uint64_t version; //of the texels, 0 when draws may write them; see Direct3DTexture9::version()
+
+	//keeps the levels alive while draws that sample them are pending
+	std::shared_ptr<const void> storage;
+};
+
+struct SamplerState {
+	D3DTEXTUREADDRESS address[3]; //u, v, w
+	float border[4]; //r, g, b, a
+	D3DTEXTUREFILTERTYPE magFilter;
+	D3DTEXTUREFILTERTYPE minFilter;
+	D3DTEXTUREFILTERTYPE mipFilter;
+	float lodBias; //MIPMAPLODBIAS
+	UINT maxAnisotropy; //1 unless the min filter is anisotropic
+	bool srgb; //SRGBTEXTURE: color channels decode to linear
+};
+
+/**
+ * Samples a 4x2 block of two 2x2 quads, lanes laid out as the
+ * rasterizer shades them: "coords" holds u[8], v[8] and w[8] (x, y, z
+ * for cube textures) and "color" receives r[8], g[8], b[8], a[8].
+ * The level of detail and anisotropy of each pixel come from the
+ * differences between its quad's lanes.
+ */
+typedef void (*SampleKernel)(const TextureView& view, const SamplerState& sampler, const float* coords, float* color);
+
+/**
+ * Texture sampling: texel decoding, addressing and filtering.
+ *
+ * Like the output merger, every (texture type, format) pair has a
+ * kernel of its own, built once for AVX2 and once for SSE2; filters
+ * and address modes are decided per draw and branch uniformly.
+ * Cube textures pick a face per lane and project onto it; volumes
+ * are read from the bricks of Direct3DVolumeTexture9.
+ *
+ * Anisotropic filtering takes as many taps along the major axis of
+ * the pixel footprint as its elongation asks for, up to the
+ * sampler's maximum: most blocks of a draw take one or two, and
+ * only those seen at grazing angles pay for more.
+ */
+class Sampler {
+	/**
+	 * Kernel for "view", for AVX2 or SSE2 as the CPU allows. NULL when
+	 * the format cannot be sampled.
+	 */
+	public:static SampleKernel select(const TextureView& view);
+
+	/**
+	 * Fills "view" from "texture", starting at level "maxMipLevel" or
+	 * at the texture's own first level if that is less detailed.
+	 * False when the texture has no storage.
+	 */
+	public:static bool view(IDirect3DBaseTexture9* texture, DWORD maxMipLevel, TextureView& view);
+};
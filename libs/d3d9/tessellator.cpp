@@ -0,0 +1,512 @@
+#include "tessellator.hpp"
+#include "vertexstage.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <simd/Lanes.hpp>
+#include <simd/VectorMath.hpp>
+#include <thread/WorkerPool.hpp>
+
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+using Lanes::f32x8;
+
+#define ODX_INLINE inline __attribute__((always_inline))
+
+/**
+ * Floats of an unpacked vertex at most, a multiple of 8: XYZB5, a
+ * normal, a point size, two colors and eight 4D texture sets
+ */
+static constexpr UINT MAX_CHANNELS = 56;
+
+/**
+ * N-patch triangles per worker
+ */
+static constexpr UINT TRIANGLE_GRAIN = 64;
+
+//--- vertices as floats
+
+/**
+ * Where the attributes of an FVF vertex are. Every 4 bytes of it is
+ * one float channel, except colors, which are four.
+ */
+struct Layout {
+	UINT size; //bytes per vertex
+	UINT channels; //floats per unpacked vertex, a multiple of 8
+	UINT normal; //channel of the normal's x; the position is at 0
+	UINT diffuse; //byte offset, or size when there is none
+	UINT specular;
+
+	Layout(DWORD fvf) {
+		const DWORD position = fvf & D3DFVF_POSITION_MASK;
+		this->size = VertexStage::size(fvf);
+		this->normal = VertexStage::size(position) / 4;
+		this->diffuse = fvf & D3DFVF_DIFFUSE ? VertexStage::size(fvf & (position | D3DFVF_NORMAL | D3DFVF_PSIZE)) : this->size;
+		this->specular = fvf & D3DFVF_SPECULAR ? VertexStage::size(fvf & (position | D3DFVF_NORMAL | D3DFVF_PSIZE | D3DFVF_DIFFUSE)) : this->size;
+
+		const UINT colors = (fvf & D3DFVF_DIFFUSE ? 1 : 0) + (fvf & D3DFVF_SPECULAR ? 1 : 0);
+		this->channels = (this->size / 4 + colors * 3 + 7) & ~7u;
+	}
+};
+
+static void unpack(const Layout& layout, const BYTE* in, float* out) {
+	UINT c = 0;
+	for (UINT offset = 0; offset < layout.size; offset += 4) {
+		if (offset == layout.diffuse || offset == layout.specular) {
+			D3DCOLOR color;
+			memcpy(&color, in + offset, 4);
+			out[c++] = (color >> 16 & 0xFF) / 255.0f;
+			out[c++] = (color >> 8 & 0xFF) / 255.0f;
+			out[c++] = (color & 0xFF) / 255.0f;
+			out[c++] = (color >> 24) / 255.0f;
+		} else {
+			memcpy(out + c++, in + offset, 4);
+		}
+	}
+	for (; c < layout.channels; c++) out[c] = 0.0f;
+}
+
+static DWORD unorm8(float v) {
+	return (DWORD) (std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static void pack(const Layout& layout, const float* in, BYTE* out) {
+	UINT c = 0;
+	for (UINT offset = 0; offset < layout.size; offset += 4) {
+		if (offset == layout.diffuse || offset == layout.specular) {
+			const D3DCOLOR color = unorm8(in[c + 3]) << 24 | unorm8(in[c]) << 16 | unorm8(in[c + 1]) << 8 | unorm8(in[c + 2]);
+			memcpy(out + offset, &color, 4);
+			c += 4;
+		} else {
+			memcpy(out + offset, in + c++, 4);
+		}
+	}
+}
+
+bool Tessellator::supports(DWORD fvf) {
+	if (VertexStage::size(fvf) == 0 || VertexStage::isTransformed(fvf)) return false;
+	if (fvf & (D3DFVF_LASTBETA_UBYTE4 | D3DFVF_LASTBETA_D3DCOLOR)) return false;
+	return Layout(fvf).channels <= MAX_CHANNELS;
+}
+
+//--- power basis
+
+/**
+ * Polynomials of every channel: c[i][j] multiplies u^i v^j.
+ */
+struct Coefficients {
+	alignas(32) float c[4][4][MAX_CHANNELS];
+};
+
+/**
+ * Basis matrix of a span of degree "degree": row i gives the
+ * coefficient of t^i from each control point.
+ */
+static bool basis(D3DBASISTYPE type, UINT degree, float (*m)[4]) {
+	static constexpr float BEZIER[4][4][4] = {
+		{},
+		{{1, 0}, {-1, 1}},
+		{{1, 0, 0}, {-2, 2, 0}, {1, -2, 1}},
+		{{1, 0, 0, 0}, {-3, 3, 0, 0}, {3, -6, 3, 0}, {-1, 3, -3, 1}}
+	};
+	static constexpr float BSPLINE[4][4][4] = {
+		{},
+		{{1, 0}, {-1, 1}},
+		{{0.5f, 0.5f, 0}, {-1, 1, 0}, {0.5f, -1, 0.5f}},
+		{{1 / 6.0f, 4 / 6.0f, 1 / 6.0f, 0}, {-0.5f, 0, 0.5f, 0}, {0.5f, -1, 0.5f, 0}, {-1 / 6.0f, 0.5f, -0.5f, 1 / 6.0f}}
+	};
+	static constexpr float CATMULL_ROM[4][4] = {{0, 1, 0, 0}, {-0.5f, 0, 0.5f, 0}, {1, -2.5f, 2, -0.5f}, {-0.5f, 1.5f, -1.5f, 0.5f}};
+
+	if (degree < 1 || degree > 3) return false;
+	const float (*source)[4];
+	switch (type) {
+		case D3DBASIS_BEZIER: source = BEZIER[degree]; break;
+		case D3DBASIS_BSPLINE: source = BSPLINE[degree]; break;
+		case D3DBASIS_CATMULL_ROM:
+			if (degree == 2) return false;
+			source = degree == 1 ? BEZIER[1] : CATMULL_ROM;
+			break;
+		default: return false;
+	}
+	memcpy(m, source, sizeof(float[4][4]));
+	return true;
+}
+
+/**
+ * Coefficients of a rectangular span: "points" are its (degree + 1)^2
+ * unpacked control points, u first.
+ */
+static void rectCoefficients(const float* const* points, const float (*m)[4], UINT degree, UINT channels, Coefficients& out) {
+	memset(&out, 0, sizeof(out));
+	for (UINT i = 0; i <= degree; i++) {
+		for (UINT j = 0; j <= degree; j++) {
+			float* c = out.c[i][j];
+			for (UINT b = 0; b <= degree; b++) {
+				for (UINT a = 0; a <= degree; a++) {
+					const float k = m[i][a] * m[j][b];
+					if (k == 0.0f) continue;
+					const float* p = points[b * (degree + 1) + a];
+					for (UINT ch = 0; ch < channels; ch++) c[ch] += k * p[ch];
+				}
+			}
+		}
+	}
+}
+
+/**
+ * (i, j, k) of the control points of triangular patches, in the
+ * order of Tessellator::triPatch()
+ */
+static constexpr UINT TRIANGLE_POINTS[4][10][3] = {
+	{},
+	{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}},
+	{{2, 0, 0}, {0, 2, 0}, {0, 0, 2}, {1, 1, 0}, {0, 1, 1}, {1, 0, 1}},
+	{{3, 0, 0}, {0, 3, 0}, {0, 0, 3}, {2, 1, 0}, {1, 2, 0}, {0, 2, 1}, {0, 1, 2}, {1, 0, 2}, {2, 0, 1}, {1, 1, 1}}
+};
+
+static constexpr float FACTORIAL[4] = {1, 1, 2, 6};
+
+/**
+ * Coefficients of channels "first" to "last" (excluded) of a
+ * triangular Bezier patch: sum of d! / (i! j! k!) u^i v^j w^k P_ijk,
+ * with w^k = (1 - u - v)^k expanded.
+ */
+static void triCoefficients(const float* const* points, UINT degree, UINT first, UINT last, Coefficients& out) {
+	for (UINT i = 0; i < 4; i++) {
+		for (UINT j = 0; j < 4; j++) std::fill(out.c[i][j] + first, out.c[i][j] + last, 0.0f);
+	}
+
+	const UINT count = (degree + 1) * (degree + 2) / 2;
+	for (UINT p = 0; p < count; p++) {
+		const UINT* ijk = TRIANGLE_POINTS[degree][p];
+		const float m = FACTORIAL[degree] / (FACTORIAL[ijk[0]] * FACTORIAL[ijk[1]] * FACTORIAL[ijk[2]]);
+		const UINT k = ijk[2];
+
+		for (UINT a = 0; a <= k; a++) {
+			for (UINT b = 0; a + b <= k; b++) {
+				const float sign = (a + b) % 2 == 0 ? 1.0f : -1.0f;
+				const float w = m * sign * FACTORIAL[k] / (FACTORIAL[a] * FACTORIAL[b] * FACTORIAL[k - a - b]);
+				float* c = out.c[ijk[0] + a][ijk[1] + b];
+				for (UINT ch = first; ch < last; ch++) c[ch] += w * points[p][ch];
+			}
+		}
+	}
+}
+
+//--- forward differencing
+
+/**
+ * Differences of a cubic with coefficients "a" at steps of "h":
+ * f, d1, d2, d3.
+ */
+ODX_INLINE void differences(const f32x8* a, float h, f32x8* d) {
+	const float h2 = h * h, h3 = h2 * h;
+	d[0] = a[0];
+	d[1] = a[1] * h + a[2] * h2 + a[3] * h3;
+	d[2] = a[2] * (2.0f * h2) + a[3] * (6.0f * h3);
+	d[3] = a[3] * (6.0f * h3);
+}
+
+ODX_INLINE void step(f32x8* d) {
+	d[0] += d[1];
+	d[1] += d[2];
+	d[2] += d[3];
+}
+
+/**
+ * Writes the grid of nu x nv segments, row after row of "pitch"
+ * floats; triangles have nu = nv and rows of one vertex less each,
+ * packed. Each vertex is "channels" floats.
+ */
+ODX_INLINE void evaluateBody(const Coefficients& coefficients, UINT channels, UINT nu, UINT nv, bool triangle, float* out, size_t pitch) {
+	const float hu = 1.0f / nu, hv = 1.0f / nv;
+
+	for (UINT chunk = 0; chunk < channels; chunk += 8) {
+		//row[i] walks the coefficient of u^i down the rows
+		f32x8 row[4][4];
+		for (UINT i = 0; i < 4; i++) {
+			f32x8 a[4];
+			for (UINT j = 0; j < 4; j++) a[j] = Lanes::load(coefficients.c[i][j] + chunk);
+			differences(a, hv, row[i]);
+		}
+
+		float* line = out + chunk;
+		for (UINT r = 0; r <= nv; r++) {
+			const UINT count = triangle ? nu - r + 1 : nu + 1;
+			const f32x8 a[4] = {row[0][0], row[1][0], row[2][0], row[3][0]};
+			f32x8 d[4];
+			differences(a, hu, d);
+
+			float* p = line;
+			for (UINT col = 0; col < count; col++, p += channels) {
+				Lanes::store(p, d[0]);
+				step(d);
+			}
+
+			for (UINT i = 0; i < 4; i++) step(row[i]);
+			line += triangle ? (size_t) count * channels : pitch;
+		}
+	}
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma")))
+#endif
+static void evaluateAVX2(const Coefficients& coefficients, UINT channels, UINT nu, UINT nv, bool triangle, float* out, size_t pitch) {
+	evaluateBody(coefficients, channels, nu, nv, triangle, out, pitch);
+}
+
+static void evaluateGeneric(const Coefficients& coefficients, UINT channels, UINT nu, UINT nv, bool triangle, float* out, size_t pitch) {
+	evaluateBody(coefficients, channels, nu, nv, triangle, out, pitch);
+}
+
+static void evaluate(const Coefficients& coefficients, UINT channels, UINT nu, UINT nv, bool triangle, float* out, size_t pitch) {
+	if (VectorMath::hasAVX2()) evaluateAVX2(coefficients, channels, nu, nv, triangle, out, pitch);
+	else evaluateGeneric(coefficients, channels, nu, nv, triangle, out, pitch);
+}
+
+//--- topology
+
+/**
+ * Segments of an edge asked for "segments", shared by "spans"
+ */
+static UINT segmentCount(float segments, UINT spans) {
+	if (!(segments >= 1.0f)) return 1;
+	return std::clamp<UINT>((UINT) std::ceil(std::min(segments, (float) Tessellator::MAX_SEGMENTS) / spans), 1, Tessellator::MAX_SEGMENTS);
+}
+
+static void gridTriangles(UINT columns, UINT rows, std::vector<uint32_t>& indices) {
+	for (UINT y = 0; y + 1 < rows; y++) {
+		for (UINT x = 0; x + 1 < columns; x++) {
+			const uint32_t i = y * columns + x;
+			indices.insert(indices.end(), {i, i + 1, i + columns, i + 1, i + columns + 1, i + columns});
+		}
+	}
+}
+
+/**
+ * Triangles of a triangular grid of "n" segments whose first vertex
+ * is "base"
+ */
+static void triangleTriangles(UINT n, uint32_t base, uint32_t* out) {
+	for (UINT r = 0; r < n; r++) {
+		const UINT count = n - r + 1;
+		for (UINT k = 0; k + 1 < count; k++) {
+			*out++ = base + k;
+			*out++ = base + k + 1;
+			*out++ = base + count + k;
+			if (k + 2 < count) {
+				*out++ = base + k + 1;
+				*out++ = base + count + k + 1;
+				*out++ = base + count + k;
+			}
+		}
+		base += count;
+	}
+}
+
+static void packAll(const Layout& layout, const std::vector<float>& grid, UINT count, Tessellation& out) {
+	out.count = count;
+	out.vertices.resize((size_t) count * layout.size);
+	for (UINT i = 0; i < count; i++) pack(layout, grid.data() + (size_t) i * layout.channels, out.vertices.data() + (size_t) i * layout.size);
+}
+
+//--- patches
+
+bool Tessellator::rectPatch(DWORD fvf, const BYTE* vertices, UINT stride, UINT count, const D3DRECTPATCH_INFO& info, const float* segments, Tessellation& out) {
+	const UINT degree = info.Degree;
+	float m[4][4];
+	if (!Tessellator::supports(fvf) || !basis(info.Basis, degree, m)) return false;
+	if (info.Width < degree + 1 || info.Height < degree + 1 || info.Stride < info.StartVertexOffsetWidth + info.Width) return false;
+
+	//Bezier spans share their end points, the others all but one
+	const bool bezier = info.Basis == D3DBASIS_BEZIER;
+	if (bezier && ((info.Width - 1) % degree != 0 || (info.Height - 1) % degree != 0)) return false;
+	const UINT advance = bezier ? degree : 1;
+	const UINT spansU = (info.Width - 1 - degree) / advance + 1, spansV = (info.Height - 1 - degree) / advance + 1;
+
+	const size_t last = ((size_t) info.StartVertexOffsetHeight + info.Height - 1) * info.Stride + info.StartVertexOffsetWidth + info.Width - 1;
+	if (last >= count) return false;
+
+	const Layout layout(fvf);
+	std::vector<float> points((size_t) info.Width * info.Height * layout.channels);
+	for (UINT y = 0; y < info.Height; y++) {
+		for (UINT x = 0; x < info.Width; x++) {
+			const size_t index = ((size_t) info.StartVertexOffsetHeight + y) * info.Stride + info.StartVertexOffsetWidth + x;
+			unpack(layout, vertices + index * stride, points.data() + ((size_t) y * info.Width + x) * layout.channels);
+		}
+	}
+
+	const UINT nu = segmentCount(std::max(segments[0], segments[2]), spansU);
+	const UINT nv = segmentCount(std::max(segments[1], segments[3]), spansV);
+	const UINT columns = spansU * nu + 1, rows = spansV * nv + 1;
+	std::vector<float> grid((size_t) columns * rows * layout.channels);
+
+	Coefficients coefficients;
+	const float* span[16];
+	for (UINT sv = 0; sv < spansV; sv++) {
+		for (UINT su = 0; su < spansU; su++) {
+			for (UINT b = 0; b <= degree; b++) {
+				for (UINT a = 0; a <= degree; a++) {
+					span[b * (degree + 1) + a] = points.data() + ((size_t) (sv * advance + b) * info.Width + su * advance + a) * layout.channels;
+				}
+			}
+			rectCoefficients(span, m, degree, layout.channels, coefficients);
+
+			float* origin = grid.data() + ((size_t) sv * nv * columns + su * nu) * layout.channels;
+			evaluate(coefficients, layout.channels, nu, nv, false, origin, (size_t) columns * layout.channels);
+		}
+	}
+
+	packAll(layout, grid, columns * rows, out);
+	out.indices.clear();
+	gridTriangles(columns, rows, out.indices);
+	return true;
+}
+
+bool Tessellator::triPatch(DWORD fvf, const BYTE* vertices, UINT stride, UINT count, const D3DTRIPATCH_INFO& info, const float* segments, Tessellation& out) {
+	const UINT degree = info.Degree;
+	if (!Tessellator::supports(fvf) || info.Basis != D3DBASIS_BEZIER || degree < 1 || degree > 3) return false;
+	if (info.NumVertices != (degree + 1) * (degree + 2) / 2 || (size_t) info.StartVertexOffset + info.NumVertices > count) return false;
+
+	const Layout layout(fvf);
+	std::vector<float> points((size_t) info.NumVertices * layout.channels);
+	const float* net[10];
+	for (UINT p = 0; p < info.NumVertices; p++) {
+		unpack(layout, vertices + ((size_t) info.StartVertexOffset + p) * stride, points.data() + (size_t) p * layout.channels);
+		net[p] = points.data() + (size_t) p * layout.channels;
+	}
+
+	Coefficients coefficients;
+	triCoefficients(net, degree, 0, layout.channels, coefficients);
+
+	const UINT n = segmentCount(std::max({segments[0], segments[1], segments[2]}), 1);
+	const UINT total = (n + 1) * (n + 2) / 2;
+	std::vector<float> grid((size_t) total * layout.channels);
+	evaluate(coefficients, layout.channels, n, n, true, grid.data(), 0);
+
+	packAll(layout, grid, total, out);
+	out.indices.resize((size_t) n * n * 3);
+	triangleTriangles(n, 0, out.indices.data());
+	return true;
+}
+
+//--- N-patches
+
+static float dot3(const float* a, const float* b) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void normalize3(float* v) {
+	const float length = std::sqrt(dot3(v, v));
+	if (length > 0.0f) {
+		for (int c = 0; c < 3; c++) v[c] /= length;
+	}
+}
+
+/**
+ * Control points of the PN triangle of "p" and "n": b_ijk of the
+ * cubic positions (in TRIANGLE_POINTS order) and the quadratic normals
+ */
+static void pnTriangle(const float (*p)[3], const float (*n)[3], float (*position)[3], float (*normal)[3]) {
+	//edge point next to corner i towards corner j, pulled onto the tangent plane of i
+	const auto edge = [&](int i, int j, float* out) {
+		float d[3];
+		for (int c = 0; c < 3; c++) d[c] = p[j][c] - p[i][c];
+		const float w = dot3(d, n[i]);
+		for (int c = 0; c < 3; c++) out[c] = (2.0f * p[i][c] + p[j][c] - w * n[i][c]) / 3.0f;
+	};
+
+	static constexpr int EDGES[6][2] = {{0, 1}, {1, 0}, {1, 2}, {2, 1}, {2, 0}, {0, 2}};
+	float e[3] = {}, v[3] = {};
+	for (int c = 0; c < 3; c++) {
+		for (int k = 0; k < 3; k++) position[k][c] = p[k][c];
+	}
+	for (int k = 0; k < 6; k++) {
+		edge(EDGES[k][0], EDGES[k][1], position[3 + k]);
+		for (int c = 0; c < 3; c++) e[c] += position[3 + k][c] / 6.0f;
+	}
+	for (int c = 0; c < 3; c++) {
+		v[c] = (p[0][c] + p[1][c] + p[2][c]) / 3.0f;
+		position[9][c] = e[c] + (e[c] - v[c]) * 0.5f;
+	}
+
+	//mid-edge normals are mirrored across the plane perpendicular to the edge
+	static constexpr int MIDDLES[3][2] = {{0, 1}, {1, 2}, {2, 0}};
+	for (int k = 0; k < 3; k++) {
+		for (int c = 0; c < 3; c++) normal[k][c] = n[k][c];
+
+		const int i = MIDDLES[k][0], j = MIDDLES[k][1];
+		float d[3], sum[3];
+		for (int c = 0; c < 3; c++) {
+			d[c] = p[j][c] - p[i][c];
+			sum[c] = n[i][c] + n[j][c];
+		}
+		const float length = dot3(d, d);
+		const float mirror = length > 0.0f ? 2.0f * dot3(d, sum) / length : 0.0f;
+		for (int c = 0; c < 3; c++) normal[3 + k][c] = sum[c] - mirror * d[c];
+		normalize3(normal[3 + k]);
+	}
+}
+
+void Tessellator::nPatches(DWORD fvf, const BYTE* vertices, UINT stride, const uint32_t* triangles, UINT triangleCount, UINT segments, D3DDEGREETYPE position, D3DDEGREETYPE normal, Tessellation& out) {
+	const Layout layout(fvf);
+	const UINT n = std::clamp<UINT>(segments, 1, Tessellator::MAX_SEGMENTS);
+	const UINT perTriangle = (n + 1) * (n + 2) / 2;
+	//without normals there is nothing to curve the triangles with
+	const bool normals = (fvf & D3DFVF_NORMAL) != 0;
+	const bool cubic = position != D3DDEGREE_LINEAR && normals;
+	const bool quadratic = normal == D3DDEGREE_QUADRATIC && normals;
+
+	out.count = triangleCount * perTriangle;
+	out.vertices.resize((size_t) out.count * layout.size);
+	out.indices.resize((size_t) triangleCount * n * n * 3);
+
+	WorkerPool::shared().parallelFor(triangleCount, TRIANGLE_GRAIN, [&](size_t begin, size_t end) {
+		std::vector<float> corners((size_t) 3 * layout.channels), grid((size_t) perTriangle * layout.channels);
+		Coefficients coefficients;
+
+		for (size_t t = begin; t < end; t++) {
+			const float* net[10];
+			float p[3][3], nrm[3][3] = {};
+			for (int k = 0; k < 3; k++) {
+				float* corner = corners.data() + (size_t) k * layout.channels;
+				unpack(layout, vertices + (size_t) triangles[t * 3 + k] * stride, corner);
+				net[k] = corner;
+				memcpy(p[k], corner, sizeof(p[k]));
+				if (normals) {
+					memcpy(nrm[k], corner + layout.normal, sizeof(nrm[k]));
+					normalize3(nrm[k]);
+				}
+			}
+
+			//every channel linear, then positions and normals of higher degree over it
+			triCoefficients(net, 1, 0, layout.channels, coefficients);
+
+			float positions[10][3], normals[6][3];
+			pnTriangle(p, nrm, positions, normals);
+			if (cubic) {
+				float points[10][MAX_CHANNELS];
+				for (int k = 0; k < 10; k++) {
+					memcpy(points[k], positions[k], sizeof(positions[k]));
+					net[k] = points[k];
+				}
+				triCoefficients(net, 3, 0, 3, coefficients);
+			}
+			if (quadratic) {
+				float points[6][MAX_CHANNELS];
+				for (int k = 0; k < 6; k++) {
+					memcpy(points[k] + layout.normal, normals[k], sizeof(normals[k]));
+					net[k] = points[k];
+				}
+				triCoefficients(net, 2, layout.normal, layout.normal + 3, coefficients);
+			}
+
+			evaluate(coefficients, layout.channels, n, n, true, grid.data(), 0);
+
+			BYTE* packed = out.vertices.data() + t * perTriangle * layout.size;
+			for (UINT i = 0; i < perTriangle; i++) pack(layout, grid.data() + (size_t) i * layout.channels, packed + (size_t) i * layout.size);
+			triangleTriangles(n, t * perTriangle, out.indices.data() + t * n * n * 3);
+		}
+	});
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <windows.h>
+#include <d3d9.h>
+
+/**
+ * A tessellated surface: vertices in the FVF of its control points
+ * and the triangle list joining them.
+ */
+struct Tessellation {
+	std::vector<BYTE> vertices; //packed, VertexStage::size(fvf) bytes each
+	std::vector<uint32_t> indices;
+	UINT count = 0; //vertices
+};
+
+/**
+ * Curved surfaces: rectangular and triangular patches (DrawRectPatch,
+ * DrawTriPatch) and N-patches (SetNPatchMode).
+ *
+ * Every attribute of the control points is unpacked to floats, colors
+ * included, and each patch is turned into power-basis polynomials in
+ * u and v. The grid is then walked by forward differencing: three
+ * additions per step and vertex, eight attributes at a time, rather
+ * than evaluating basis functions at every point. Triangles are grids
+ * whose rows shrink by one vertex each.
+ *
+ * Patches are tessellated in object space, so the result only depends
+ * on the control points and the segment counts: callers cache it and
+ * run the vertex stage on it every draw.
+ */
+class Tessellator {
+	/**
+	 * Segments of an edge at most, for patches and N-patches alike.
+	 */
+	public:static constexpr const UINT MAX_SEGMENTS = 64;
+
+	/**
+	 * Untransformed FVFs whose attributes are all floats or colors.
+	 */
+	public:static bool supports(DWORD fvf);
+
+	/**
+	 * Tessellates "info", whose control points are read from "vertices"
+	 * ("count" of them). "segments" are those of the edges v = 0, u = 1,
+	 * v = 1 and u = 0; u and v use the larger of their two edges. False
+	 * for an invalid patch or one reading past "count".
+	 */
+	public:static bool rectPatch(DWORD fvf, const BYTE* vertices, UINT stride, UINT count, const D3DRECTPATCH_INFO& info, const float* segments, Tessellation& out);
+
+	/**
+	 * Tessellates a triangular Bezier patch. Control points come
+	 * corners first (the u, v and w = 1 - u - v corners), then the
+	 * points along the edges u to v, v to w and w to u, then the center
+	 * of cubic patches. "segments" are per edge; the largest is used.
+	 */
+	public:static bool triPatch(DWORD fvf, const BYTE* vertices, UINT stride, UINT count, const D3DTRIPATCH_INFO& info, const float* segments, Tessellation& out);
+
+	/**
+	 * Replaces each triangle of "triangles" (three vertex indices each)
+	 * with a curved PN triangle of "segments" segments per edge, built
+	 * from its positions and normals. "position" is D3DRS_POSITIONDEGREE
+	 * (cubic or linear), "normal" D3DRS_NORMALDEGREE (quadratic or
+	 * linear); other attributes are linear.
+	 */
+	public:static void nPatches(DWORD fvf, const BYTE* vertices, UINT stride, const uint32_t* triangles, UINT triangleCount, UINT segments, D3DDEGREETYPE position, D3DDEGREETYPE normal, Tessellation& out);
+};
@@ -0,0 +1,70 @@
+#include "texturestreamer.hpp"
+#include "direct3dtexture9.hpp"
+#include <algorithm>
+#include <thread/WorkerPool.hpp>
+
+/**
+ * Never destroyed: worker tasks queued at exit still reach it.
+ */
+TextureStreamer& TextureStreamer::shared() {
+	static TextureStreamer* streamer = new TextureStreamer();
+	return *streamer;
+}
+
+void TextureStreamer::enqueue(Direct3DTexture9* texture, std::function<void()> load) {
+	texture->AddRef();
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->pending.push_back({texture, std::move(load)});
+	}
+
+	//each task runs whichever job is most important when it starts
+	WorkerPool::shared().submit([this]() { this->runNext(); });
+}
+
+void TextureStreamer::runNext() {
+	Job job;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if (this->pending.empty()) return; //taken by finish()
+
+		auto best = std::max_element(this->pending.begin(), this->pending.end(), [](const Job& a, const Job& b) {
+			return a.texture->GetPriority() < b.texture->GetPriority();
+		});
+		job = std::move(*best);
+		this->pending.erase(best);
+		this->running.push_back(job.texture);
+	}
+
+	this->run(job);
+}
+
+void TextureStreamer::run(Job& job) {
+	job.load();
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->running.erase(std::find(this->running.begin(), this->running.end(), job.texture));
+	}
+	this->finished.notify_all();
+	job.texture->Release();
+}
+
+void TextureStreamer::finish(Direct3DTexture9* texture) {
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	auto waiting = std::find_if(this->pending.begin(), this->pending.end(), [texture](const Job& job) { return job.texture == texture; });
+	if (waiting != this->pending.end()) {
+		Job job = std::move(*waiting);
+		this->pending.erase(waiting);
+		this->running.push_back(texture);
+		lock.unlock();
+
+		this->run(job);
+		return;
+	}
+
+	this->finished.wait(lock, [this, texture]() {
+		return std::find(this->running.begin(), this->running.end(), texture) == this->running.end();
+	});
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <windows.h>
+
+class Direct3DTexture9;
+
+/**
+ * Fills MANAGED textures in the background.
+ *
+ * Jobs run on the worker pool, highest resource priority first
+ * (SetPriority may reorder them while they wait), oldest first on
+ * ties. PreLoad() and LockRect() of a texture still being streamed
+ * run its job on the calling thread, or wait for it.
+ */
+class TextureStreamer {
+	private:struct Job {
+		Direct3DTexture9* texture;
+		std::function<void()> load;
+	};
+
+	private:std::mutex mutex;
+	private:std::condition_variable finished;
+	private:std::vector<Job> pending;
+	private:std::vector<Direct3DTexture9*> running;
+
+	public:static TextureStreamer& shared();
+
+	/**
+	 * The texture is kept alive until "load" returns.
+	 */
+	public:void enqueue(Direct3DTexture9* texture, std::function<void()> load);
+
+	/**
+	 * Returns once the texture has no job left.
+	 */
+	public:void finish(Direct3DTexture9* texture);
+
+	private:void runNext();
+	private:void run(Job& job);
+};
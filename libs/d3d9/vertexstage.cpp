@@ -0,0 +1,629 @@
+#include "vertexstage.hpp"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <simd/VectorMath.hpp>
+#include <thread/WorkerPool.hpp>
+
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+using Lanes::f32x8;
+using Lanes::i32x8;
+
+#define ODX_INLINE inline __attribute__((always_inline))
+
+/**
+ * Vertices per worker when a draw is split across the pool
+ */
+static constexpr UINT VERTEX_GRAIN = 2048;
+
+/**
+ * Vertices whose eye-space positions and normals are kept at once
+ */
+static constexpr UINT EYE_BATCH = 256;
+
+/**
+ * Vertices processTo() packs before streaming them out
+ */
+static constexpr UINT OUTPUT_BATCH = 256;
+
+static UINT positionSize(DWORD fvf) {
+	switch (fvf & D3DFVF_POSITION_MASK) {
+		case D3DFVF_XYZ: return 12;
+		case D3DFVF_XYZRHW: return 16;
+		case D3DFVF_XYZW: return 16;
+		case D3DFVF_XYZB1: return 16;
+		case D3DFVF_XYZB2: return 20;
+		case D3DFVF_XYZB3: return 24;
+		case D3DFVF_XYZB4: return 28;
+		case D3DFVF_XYZB5: return 32;
+		default: return 0;
+	}
+}
+
+static UINT textureSize(DWORD fvf, UINT set) {
+	switch ((fvf >> (set * 2 + 16)) & 3) {
+		case D3DFVF_TEXTUREFORMAT1: return 4;
+		case D3DFVF_TEXTUREFORMAT3: return 12;
+		case D3DFVF_TEXTUREFORMAT4: return 16;
+		default: return 8;
+	}
+}
+
+static UINT textureSets(DWORD fvf) {
+	return (fvf & D3DFVF_TEXCOUNT_MASK) >> D3DFVF_TEXCOUNT_SHIFT;
+}
+
+UINT VertexStage::size(DWORD fvf) {
+	UINT size = positionSize(fvf);
+	if (size == 0 || textureSets(fvf) > 8) return 0;
+
+	if (fvf & D3DFVF_NORMAL) size += 12;
+	if (fvf & D3DFVF_PSIZE) size += 4;
+	if (fvf & D3DFVF_DIFFUSE) size += 4;
+	if (fvf & D3DFVF_SPECULAR) size += 4;
+	for (UINT i = 0; i < textureSets(fvf); i++) size += textureSize(fvf, i);
+	return size;
+}
+
+static void unpackColor(float* out, D3DCOLOR color) {
+	constexpr float scale = 1.0f / 255.0f;
+	out[0] = (color >> 16 & 0xFF) * scale;
+	out[1] = (color >> 8 & 0xFF) * scale;
+	out[2] = (color & 0xFF) * scale;
+	out[3] = (color >> 24) * scale;
+}
+
+static uint32_t packColor(const float* color) {
+	uint32_t channels[4];
+	for (int c = 0; c < 4; c++) channels[c] = (uint32_t) (std::clamp(color[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+	return channels[3] << 24 | channels[0] << 16 | channels[1] << 8 | channels[2];
+}
+
+void VertexStage::processRange(const VertexState& state, const BYTE* vertices, UINT stride, UINT count, Vertex* out) {
+	const DWORD fvf = state.fvf;
+	const UINT sets = textureSets(fvf);
+	UINT offset = positionSize(fvf) + (fvf & D3DFVF_NORMAL ? 12 : 0);
+	const UINT psize = offset;
+	offset += fvf & D3DFVF_PSIZE ? 4 : 0;
+	const UINT diffuse = offset;
+	offset += fvf & D3DFVF_DIFFUSE ? 4 : 0;
+	const UINT specular = offset;
+	offset += fvf & D3DFVF_SPECULAR ? 4 : 0;
+
+	UINT texture[8], floats[8];
+	for (UINT i = 0; i < sets; i++) {
+		texture[i] = offset;
+		floats[i] = textureSize(fvf, i) / 4;
+		offset += textureSize(fvf, i);
+	}
+
+	switch (fvf & D3DFVF_POSITION_MASK) {
+		case D3DFVF_XYZRHW:
+			for (UINT i = 0; i < count; i++) memcpy(out[i].position, vertices + i * stride, 16);
+			break;
+		case D3DFVF_XYZW:
+			VectorMath::transform<VectorMath::VECTOR4>(out->position, sizeof(Vertex), vertices, stride, state.worldViewProjection, count);
+			break;
+		default:
+			//blended positions are projected from eye space below
+			if (state.blendMatrices == 0) VectorMath::transform<VectorMath::POINT>(out->position, sizeof(Vertex), vertices, stride, state.worldViewProjection, count);
+			break;
+	}
+
+	for (UINT i = 0; i < count; i++) {
+		const BYTE* in = vertices + i * stride;
+		Vertex& v = out[i];
+		D3DCOLOR color;
+
+		if (fvf & D3DFVF_DIFFUSE) {
+			memcpy(&color, in + diffuse, 4);
+			unpackColor(v.color[0], color);
+		} else {
+			v.color[0][0] = v.color[0][1] = v.color[0][2] = v.color[0][3] = 1.0f;
+		}
+
+		if (fvf & D3DFVF_SPECULAR) {
+			memcpy(&color, in + specular, 4);
+			unpackColor(v.color[1], color);
+		} else {
+			v.color[1][0] = v.color[1][1] = v.color[1][2] = 0.0f;
+			v.color[1][3] = 1.0f;
+		}
+
+		//stage t reads the set its D3DTSS_TEXCOORDINDEX names; generated sets are filled in by shade()
+		for (UINT t = 0; t < state.textureStages; t++) {
+			float* coords = v.texture[t];
+			const UINT set = state.texCoordIndex[t] & 0xFFFF;
+			coords[0] = coords[1] = coords[2] = 0.0f;
+			coords[3] = 1.0f;
+			if ((state.texCoordIndex[t] & 0xFFFF0000) != D3DTSS_TCI_PASSTHRU || set >= sets) continue;
+
+			memcpy(coords, in + texture[set], floats[set] * 4);
+			//a texture matrix sees (u, v) as (u, v, 1, 0): its third row translates
+			if ((state.textureTransform[t] & 0xFF) != D3DTTFF_DISABLE && floats[set] < 4) {
+				coords[3] = 0.0f;
+				coords[floats[set]] = 1.0f;
+			}
+		}
+
+		if (fvf & D3DFVF_PSIZE) memcpy(&v.size, in + psize, 4);
+		else v.size = state.pointSize;
+	}
+
+	//pre-transformed vertices have no eye space
+	const bool eyeSpace = !VertexStage::isTransformed(fvf);
+	bool generate = false;
+	for (UINT t = 0; t < state.textureStages; t++) {
+		generate |= (state.texCoordIndex[t] & 0xFFFF0000) != D3DTSS_TCI_PASSTHRU || (state.textureTransform[t] & 0xFF) != D3DTTFF_DISABLE;
+	}
+
+	const bool shading = eyeSpace && (state.lighting || state.fog || generate);
+	const bool blending = state.blendMatrices > 0;
+	if (blending || shading || (eyeSpace && state.pointScale)) {
+		alignas(32) float eye[EYE_BATCH][4];
+		alignas(32) float normal[EYE_BATCH][4] = {};
+		const bool normals = shading && (fvf & D3DFVF_NORMAL);
+
+		for (UINT begin = 0; begin < count; begin += EYE_BATCH) {
+			const UINT n = std::min(count - begin, EYE_BATCH);
+			const BYTE* in = vertices + begin * stride;
+			if (blending) {
+				VertexStage::skin(state, in, stride, n, eye, normals ? normal : NULL);
+				VectorMath::transform<VectorMath::VECTOR4>(out[begin].position, sizeof(Vertex), eye, sizeof(eye[0]), state.projection, n);
+			} else {
+				VectorMath::transform<VectorMath::POINT>(eye, sizeof(eye[0]), in, stride, state.worldView, n);
+				if (normals) VectorMath::transform<VectorMath::NORMAL>(normal, sizeof(normal[0]), in + positionSize(fvf), stride, state.normal, n);
+			}
+
+			//S = Vh * Si * sqrt(1 / (A + B * De + C * De^2)), De the distance to the eye
+			if (state.pointScale) {
+				for (UINT i = 0; i < n; i++) {
+					float distance = std::sqrt(eye[i][0] * eye[i][0] + eye[i][1] * eye[i][1] + eye[i][2] * eye[i][2]);
+					float attenuation = state.pointScaleA + state.pointScaleB * distance + state.pointScaleC * distance * distance;
+					Vertex& v = out[begin + i];
+					v.size = attenuation > 0.0f ? state.viewportHeight * v.size / std::sqrt(attenuation) : state.pointSizeMax;
+				}
+			}
+
+			if (shading) {
+				for (UINT i = 0; i < n; i += 8) VertexStage::shade(state, eye + i, normal + i, std::min(n - i, 8u), out + begin + i);
+			}
+		}
+	}
+
+	for (UINT i = 0; i < count; i++) out[i].size = std::clamp(out[i].size, state.pointSizeMin, state.pointSizeMax);
+}
+
+//--- vertex blending
+
+/**
+ * Rows 0 to "rows" - 1 (xyz columns) of the matrix each lane picked
+ * from "palette". Skinned meshes are drawn bone by bone, so all eight
+ * lanes mostly pick the same one: it is then read once and broadcast
+ * instead of gathered per lane.
+ */
+ODX_INLINE void fetch(const D3DMATRIX* palette, const i32x8& index, UINT rows, f32x8 (*m)[3]) {
+	if (Lanes::bits(index == index[0]) == 0xFF) {
+		const D3DMATRIX& matrix = palette[index[0]];
+		for (UINT r = 0; r < rows; r++) {
+			for (int c = 0; c < 3; c++) m[r][c] = Lanes::splat(matrix.m[r][c]);
+		}
+		return;
+	}
+
+	for (UINT i = 0; i < 8; i++) {
+		const D3DMATRIX& matrix = palette[index[i]];
+		for (UINT r = 0; r < rows; r++) {
+			for (int c = 0; c < 3; c++) m[r][c][i] = matrix.m[r][c];
+		}
+	}
+}
+
+/**
+ * Eight vertices at a time: the betas after xyz are the weights, the
+ * last one implied (1 minus the others); indexed blending reads four
+ * matrix indices from the last beta instead of using matrices 0 to 3.
+ * World matrices are assumed affine, as fixed-function blending does.
+ */
+ODX_INLINE void skinBody(const VertexState& state, const BYTE* vertices, UINT stride, UINT count, float (*eye)[4], float (*normal)[4]) {
+	const DWORD fvf = state.fvf;
+	const UINT matrices = state.blendMatrices, weights = matrices - 1;
+	const UINT indices = positionSize(fvf) - 4; //the last beta
+	const bool color = (fvf & D3DFVF_LASTBETA_D3DCOLOR) != 0;
+
+	for (UINT first = 0; first < count; first += 8) {
+		const UINT n = std::min(count - first, 8u);
+
+		//lanes past "n" repeat the last vertex
+		f32x8 p[3], nrm[3] = {}, w[4];
+		i32x8 index[4];
+		for (UINT i = 0; i < 8; i++) {
+			const BYTE* in = vertices + (size_t) (first + std::min(i, n - 1)) * stride;
+			float v[8];
+			memcpy(v, in, 12 + weights * 4);
+			for (int c = 0; c < 3; c++) p[c][i] = v[c];
+			for (UINT k = 0; k < weights; k++) w[k][i] = v[3 + k];
+
+			if (normal != NULL) {
+				memcpy(v, in + positionSize(fvf), 12);
+				for (int c = 0; c < 3; c++) nrm[c][i] = v[c];
+			}
+
+			//D3DCOLOR indices are in the order of its r, g, b and a
+			uint32_t packed = 0;
+			if (state.indexedBlend) memcpy(&packed, in + indices, 4);
+			for (UINT k = 0; k < 4; k++) {
+				static constexpr UINT SHIFTS[2][4] = {{0, 8, 16, 24}, {16, 8, 0, 24}};
+				index[k][i] = state.indexedBlend ? packed >> SHIFTS[color][k] & 0xFF : k;
+			}
+		}
+
+		w[weights] = Lanes::splat(1.0f);
+		for (UINT k = 0; k < weights; k++) w[weights] -= w[k];
+
+		f32x8 e[3] = {}, en[3] = {};
+		for (UINT k = 0; k < matrices; k++) {
+			f32x8 m[4][3];
+			fetch(state.blendWorldView, index[k], 4, m);
+			for (int c = 0; c < 3; c++) e[c] += w[k] * (p[0] * m[0][c] + p[1] * m[1][c] + p[2] * m[2][c] + m[3][c]);
+
+			if (normal != NULL) {
+				fetch(state.blendNormal, index[k], 3, m);
+				for (int c = 0; c < 3; c++) en[c] += w[k] * (nrm[0] * m[0][c] + nrm[1] * m[1][c] + nrm[2] * m[2][c]);
+			}
+		}
+
+		for (UINT i = 0; i < n; i++) {
+			for (int c = 0; c < 3; c++) eye[first + i][c] = e[c][i];
+			eye[first + i][3] = 1.0f;
+		}
+		if (normal != NULL) {
+			for (UINT i = 0; i < n; i++) {
+				for (int c = 0; c < 3; c++) normal[first + i][c] = en[c][i];
+				normal[first + i][3] = 0.0f;
+			}
+		}
+	}
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma")))
+#endif
+void VertexStage::skinAVX2(const VertexState& state, const BYTE* vertices, UINT stride, UINT count, float (*eye)[4], float (*normal)[4]) {
+	skinBody(state, vertices, stride, count, eye, normal);
+}
+
+void VertexStage::skinGeneric(const VertexState& state, const BYTE* vertices, UINT stride, UINT count, float (*eye)[4], float (*normal)[4]) {
+	skinBody(state, vertices, stride, count, eye, normal);
+}
+
+void VertexStage::skin(const VertexState& state, const BYTE* vertices, UINT stride, UINT count, float (*eye)[4], float (*normal)[4]) {
+	if (VectorMath::hasAVX2()) VertexStage::skinAVX2(state, vertices, stride, count, eye, normal);
+	else VertexStage::skinGeneric(state, vertices, stride, count, eye, normal);
+}
+
+//--- lighting, fog and texture coordinate generation
+
+ODX_INLINE f32x8 dot(const f32x8* a, const f32x8* b) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+/**
+ * Scales "v" to unit length; zero vectors stay zero.
+ */
+ODX_INLINE void normalize(f32x8* v) {
+	const f32x8 length = Lanes::sqrt(dot(v, v));
+	const f32x8 k = Lanes::select(length > 0.0f, 1.0f / length, Lanes::splat(0.0f));
+	for (int c = 0; c < 3; c++) v[c] *= k;
+}
+
+/**
+ * Material color "source" of eight vertices: r, g, b, a lanes.
+ */
+ODX_INLINE void material(f32x8* out, D3DMATERIALCOLORSOURCE source, const D3DCOLORVALUE& value, const f32x8 (*colors)[4]) {
+	if (source == D3DMCS_COLOR1 || source == D3DMCS_COLOR2) {
+		for (int c = 0; c < 4; c++) out[c] = colors[source - D3DMCS_COLOR1][c];
+	} else {
+		const float rgba[4] = {value.r, value.g, value.b, value.a};
+		for (int c = 0; c < 4; c++) out[c] = Lanes::splat(rgba[c]);
+	}
+}
+
+/**
+ * Adds what "light" contributes at eye positions "p" with normals
+ * "n" to the ambient, diffuse and specular sums. Attenuation and the
+ * spot cone only exist in the code of the types that have them.
+ */
+template<D3DLIGHTTYPE TYPE, bool SPECULAR>
+ODX_INLINE void illuminate(const Light& light, float power, const f32x8* p, const f32x8* n, const f32x8* view, f32x8* ambient, f32x8* diffuse, f32x8* specular) {
+	f32x8 l[3], scale = Lanes::splat(1.0f);
+
+	if constexpr (TYPE == D3DLIGHT_DIRECTIONAL) {
+		for (int c = 0; c < 3; c++) l[c] = Lanes::splat(-light.direction[c]);
+	} else {
+		for (int c = 0; c < 3; c++) l[c] = light.position[c] - p[c];
+		const f32x8 d2 = dot(l, l), d = Lanes::sqrt(d2);
+		const f32x8 k = 1.0f / Lanes::max(d, Lanes::splat(0x1p-64f));
+		for (int c = 0; c < 3; c++) l[c] *= k;
+
+		const f32x8 attenuation = light.attenuation[0] + light.attenuation[1] * d + light.attenuation[2] * d2;
+		scale = Lanes::select(d <= light.range && attenuation > 0.0f, 1.0f / attenuation, Lanes::splat(0.0f));
+
+		if constexpr (TYPE == D3DLIGHT_SPOT) {
+			const f32x8 rho = -(l[0] * light.direction[0] + l[1] * light.direction[1] + l[2] * light.direction[2]);
+			f32x8 spot;
+			if (light.cosTheta > light.cosPhi) spot = Lanes::clamp01((rho - light.cosPhi) * (1.0f / (light.cosTheta - light.cosPhi)));
+			else spot = Lanes::select(rho > light.cosPhi, Lanes::splat(1.0f), Lanes::splat(0.0f));
+			if (light.falloff != 1.0f) spot = Lanes::select(spot < 1.0f, Lanes::pow(spot, light.falloff), spot);
+			scale *= spot;
+		}
+	}
+
+	const f32x8 nl = Lanes::max(dot(n, l), Lanes::splat(0.0f));
+	for (int c = 0; c < 3; c++) {
+		ambient[c] += scale * light.ambient[c];
+		diffuse[c] += scale * nl * light.diffuse[c];
+	}
+
+	if constexpr (SPECULAR) {
+		f32x8 h[3] = {l[0] + view[0], l[1] + view[1], l[2] + view[2]};
+		normalize(h);
+		const f32x8 nh = Lanes::max(dot(n, h), Lanes::splat(0.0f));
+		const f32x8 s = Lanes::select(nl > 0.0f, Lanes::pow(nh, power), Lanes::splat(0.0f)) * scale;
+		for (int c = 0; c < 3; c++) specular[c] += s * light.specular[c];
+	}
+}
+
+template<bool SPECULAR>
+ODX_INLINE void illuminate(const Light& light, float power, const f32x8* p, const f32x8* n, const f32x8* view, f32x8* ambient, f32x8* diffuse, f32x8* specular) {
+	switch (light.type) {
+		case D3DLIGHT_POINT: illuminate<D3DLIGHT_POINT, SPECULAR>(light, power, p, n, view, ambient, diffuse, specular); break;
+		case D3DLIGHT_SPOT: illuminate<D3DLIGHT_SPOT, SPECULAR>(light, power, p, n, view, ambient, diffuse, specular); break;
+		default: illuminate<D3DLIGHT_DIRECTIONAL, SPECULAR>(light, power, p, n, view, ambient, diffuse, specular); break;
+	}
+}
+
+ODX_INLINE void light(const VertexState& state, const f32x8* p, const f32x8* n, UINT count, Vertex* out) {
+	const D3DMATERIAL9& m = state.material;
+	f32x8 colors[2][4];
+	for (int k = 0; k < 2; k++) {
+		for (int c = 0; c < 4; c++) {
+			for (UINT i = 0; i < 8; i++) colors[k][c][i] = out[std::min(i, count - 1)].color[k][c];
+		}
+	}
+
+	f32x8 diffuseMaterial[4], ambientMaterial[4], specularMaterial[4], emissiveMaterial[4];
+	material(diffuseMaterial, state.diffuseSource, m.Diffuse, colors);
+	material(ambientMaterial, state.ambientSource, m.Ambient, colors);
+	material(specularMaterial, state.specularSource, m.Specular, colors);
+	material(emissiveMaterial, state.emissiveSource, m.Emissive, colors);
+
+	//towards the viewer: from the vertex to the eye, or straight down -z
+	f32x8 view[3] = {-p[0], -p[1], -p[2]};
+	if (state.localViewer) normalize(view);
+	else view[0] = view[1] = Lanes::splat(0.0f), view[2] = Lanes::splat(-1.0f);
+
+	f32x8 ambient[3] = {}, diffuse[3] = {}, specular[3] = {};
+	for (UINT l = 0; l < state.lightCount; l++) {
+		if (state.specular) illuminate<true>(state.lights[l], m.Power, p, n, view, ambient, diffuse, specular);
+		else illuminate<false>(state.lights[l], m.Power, p, n, view, ambient, diffuse, specular);
+	}
+
+	f32x8 result[2][4];
+	for (int c = 0; c < 3; c++) {
+		result[0][c] = Lanes::clamp01(emissiveMaterial[c] + ambientMaterial[c] * (state.ambient[c] + ambient[c]) + diffuseMaterial[c] * diffuse[c]);
+		result[1][c] = Lanes::clamp01(specularMaterial[c] * specular[c]);
+	}
+	result[0][3] = Lanes::clamp01(diffuseMaterial[3]);
+
+	for (UINT i = 0; i < count; i++) {
+		for (int c = 0; c < 4; c++) out[i].color[0][c] = result[0][c][i];
+		for (int c = 0; c < 3; c++) out[i].color[1][c] = result[1][c][i];
+	}
+}
+
+/**
+ * D3DTSS_TCI_* coordinates, then the texture matrix, for every stage
+ * that has either.
+ */
+ODX_INLINE void generate(const VertexState& state, const f32x8* p, const f32x8* n, UINT count, Vertex* out) {
+	//reflection of the eye vector about the normal
+	f32x8 r[3] = {};
+	bool reflected = false;
+
+	for (UINT t = 0; t < state.textureStages; t++) {
+		const DWORD mode = state.texCoordIndex[t] & 0xFFFF0000, flags = state.textureTransform[t] & 0xFF;
+		if (mode == D3DTSS_TCI_PASSTHRU && flags == D3DTTFF_DISABLE) continue;
+
+		if ((mode == D3DTSS_TCI_CAMERASPACEREFLECTIONVECTOR || mode == D3DTSS_TCI_SPHEREMAP) && !reflected) {
+			f32x8 e[3] = {p[0], p[1], p[2]};
+			if (state.localViewer) normalize(e);
+			else e[0] = e[1] = Lanes::splat(0.0f), e[2] = Lanes::splat(1.0f);
+
+			const f32x8 ne = 2.0f * dot(n, e);
+			for (int c = 0; c < 3; c++) r[c] = e[c] - ne * n[c];
+			reflected = true;
+		}
+
+		f32x8 coords[4];
+		switch (mode) {
+			case D3DTSS_TCI_CAMERASPACENORMAL:
+				for (int c = 0; c < 3; c++) coords[c] = n[c];
+				coords[3] = Lanes::splat(1.0f);
+				break;
+			case D3DTSS_TCI_CAMERASPACEPOSITION:
+				for (int c = 0; c < 3; c++) coords[c] = p[c];
+				coords[3] = Lanes::splat(1.0f);
+				break;
+			case D3DTSS_TCI_CAMERASPACEREFLECTIONVECTOR:
+				for (int c = 0; c < 3; c++) coords[c] = r[c];
+				coords[3] = Lanes::splat(1.0f);
+				break;
+			case D3DTSS_TCI_SPHEREMAP: {
+				const f32x8 z = r[2] - 1.0f;
+				const f32x8 m = 2.0f * Lanes::sqrt(r[0] * r[0] + r[1] * r[1] + z * z);
+				const f32x8 k = Lanes::select(m > 0.0f, 1.0f / m, Lanes::splat(0.0f));
+				coords[0] = r[0] * k + 0.5f;
+				coords[1] = 0.5f - r[1] * k;
+				coords[2] = Lanes::splat(0.0f);
+				coords[3] = Lanes::splat(1.0f);
+				break;
+			}
+			default:
+				for (int c = 0; c < 4; c++) {
+					for (UINT i = 0; i < 8; i++) coords[c][i] = out[std::min(i, count - 1)].texture[t][c];
+				}
+				break;
+		}
+
+		if (flags != D3DTTFF_DISABLE) {
+			const D3DMATRIX& matrix = state.textureMatrix[t];
+			f32x8 transformed[4];
+			for (int j = 0; j < 4; j++) {
+				transformed[j] = coords[0] * matrix.m[0][j] + coords[1] * matrix.m[1][j] + coords[2] * matrix.m[2][j] + coords[3] * matrix.m[3][j];
+			}
+			for (int c = 0; c < 4; c++) coords[c] = transformed[c];
+		}
+
+		for (UINT i = 0; i < count; i++) {
+			for (int c = 0; c < 4; c++) out[i].texture[t][c] = coords[c][i];
+		}
+	}
+}
+
+ODX_INLINE void shadeBody(const VertexState& state, const float (*eye)[4], const float (*normal)[4], UINT count, Vertex* out) {
+	//lanes past "count" repeat the last vertex
+	f32x8 p[3], n[3];
+	for (int c = 0; c < 3; c++) {
+		for (UINT i = 0; i < 8; i++) {
+			p[c][i] = eye[std::min(i, count - 1)][c];
+			n[c][i] = normal[std::min(i, count - 1)][c];
+		}
+	}
+	if (state.normalizeNormals) normalize(n);
+
+	if (state.lighting) light(state, p, n, count, out);
+
+	//the fog factor goes to the specular alpha; range fog uses the distance rather than depth
+	if (state.fog) {
+		const f32x8 f = state.fogParameters.factor(state.rangeFog ? Lanes::sqrt(dot(p, p)) : p[2]);
+		for (UINT i = 0; i < count; i++) out[i].color[1][3] = f[i];
+	}
+
+	generate(state, p, n, count, out);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma")))
+#endif
+void VertexStage::shadeAVX2(const VertexState& state, const float (*eye)[4], const float (*normal)[4], UINT count, Vertex* out) {
+	shadeBody(state, eye, normal, count, out);
+}
+
+void VertexStage::shadeGeneric(const VertexState& state, const float (*eye)[4], const float (*normal)[4], UINT count, Vertex* out) {
+	shadeBody(state, eye, normal, count, out);
+}
+
+void VertexStage::shade(const VertexState& state, const float (*eye)[4], const float (*normal)[4], UINT count, Vertex* out) {
+	if (VectorMath::hasAVX2()) VertexStage::shadeAVX2(state, eye, normal, count, out);
+	else VertexStage::shadeGeneric(state, eye, normal, count, out);
+}
+
+void VertexStage::process(const VertexState& state, const BYTE* vertices, UINT stride, UINT count, Vertex* out) {
+	WorkerPool::shared().parallelFor(count, VERTEX_GRAIN, [&](size_t begin, size_t end) {
+		VertexStage::processRange(state, vertices + begin * stride, stride, end - begin, out + begin);
+	});
+}
+
+//--- ProcessVertices
+
+/**
+ * Copies "size" bytes with non-temporal stores wherever "out" is
+ * 16-byte aligned, plain ones at the edges.
+ */
+static void stream(BYTE* out, const BYTE* in, size_t size) {
+	#if defined(__x86_64__)
+		const size_t head = std::min(size, (size_t) (-(uintptr_t) out & 15));
+		memcpy(out, in, head);
+		out += head, in += head, size -= head;
+
+		for (; size >= 16; out += 16, in += 16, size -= 16) _mm_stream_si128((__m128i*) out, _mm_loadu_si128((const __m128i*) in));
+	#endif
+	memcpy(out, in, size);
+}
+
+void VertexStage::processTo(const VertexState& state, const BYTE* vertices, UINT stride, UINT count, const VertexOutput& output, BYTE* out) {
+	const DWORD fvf = output.fvf;
+	const UINT sets = textureSets(fvf);
+	UINT offset = positionSize(fvf) + (fvf & D3DFVF_NORMAL ? 12 : 0);
+	const UINT psize = offset;
+	offset += fvf & D3DFVF_PSIZE ? 4 : 0;
+	const UINT diffuse = offset;
+	offset += fvf & D3DFVF_DIFFUSE ? 4 : 0;
+	const UINT specular = offset;
+	offset += fvf & D3DFVF_SPECULAR ? 4 : 0;
+
+	//without copying, only lit colors, fog and generated or transformed coordinates are written
+	UINT texture[8], floats[8];
+	bool computed[8];
+	for (UINT i = 0; i < sets; i++) {
+		texture[i] = offset;
+		floats[i] = textureSize(fvf, i) / 4;
+		offset += textureSize(fvf, i);
+		computed[i] = i < state.textureStages && ((state.texCoordIndex[i] & 0xFFFF0000) != D3DTSS_TCI_PASSTHRU || (state.textureTransform[i] & 0xFF) != D3DTTFF_DISABLE);
+	}
+	const bool writeDiffuse = (fvf & D3DFVF_DIFFUSE) && (output.copyData || state.lighting);
+	const bool writeSpecular = (fvf & D3DFVF_SPECULAR) && (output.copyData || state.lighting || state.fog);
+	const bool writeSize = (fvf & D3DFVF_PSIZE) && output.copyData;
+
+	const D3DVIEWPORT9& viewport = output.viewport;
+	WorkerPool::shared().parallelFor(count, VERTEX_GRAIN, [&](size_t begin, size_t end) {
+		std::vector<Vertex> processed(std::min<size_t>(end - begin, OUTPUT_BATCH));
+		std::vector<BYTE> packed(processed.size() * output.stride);
+
+		for (size_t first = begin; first < end; first += OUTPUT_BATCH) {
+			const UINT n = (UINT) std::min<size_t>(end - first, OUTPUT_BATCH);
+			VertexStage::processRange(state, vertices + first * stride, stride, n, processed.data());
+
+			BYTE* target = out + first * output.stride;
+			if (!output.copyData) memcpy(packed.data(), target, (size_t) n * output.stride);
+
+			for (UINT i = 0; i < n; i++) {
+				const Vertex& v = processed[i];
+				BYTE* p = packed.data() + (size_t) i * output.stride;
+
+				//as the rasterizer projects clip space
+				const float rhw = 1.0f / v.position[3];
+				const float position[4] = {
+					viewport.X + (1.0f + v.position[0] * rhw) * viewport.Width * 0.5f,
+					viewport.Y + (1.0f - v.position[1] * rhw) * viewport.Height * 0.5f,
+					viewport.MinZ + v.position[2] * rhw * (viewport.MaxZ - viewport.MinZ),
+					rhw
+				};
+				memcpy(p, position, sizeof(position));
+
+				if (writeSize) memcpy(p + psize, &v.size, 4);
+				if (writeDiffuse) {
+					const uint32_t color = packColor(v.color[0]);
+					memcpy(p + diffuse, &color, 4);
+				}
+				if (writeSpecular) {
+					const uint32_t color = packColor(v.color[1]);
+					memcpy(p + specular, &color, 4);
+				}
+				for (UINT t = 0; t < sets; t++) {
+					if (output.copyData || computed[t]) memcpy(p + texture[t], v.texture[t], floats[t] * 4);
+				}
+			}
+
+			stream(target, packed.data(), (size_t) n * output.stride);
+		}
+
+		#if defined(__x86_64__)
+			//streamed stores are weakly ordered: publish them before the range counts as done
+			_mm_sfence();
+		#endif
+	});
+}
@@ -0,0 +1,173 @@
+#pragma once
+#include <windows.h>
+#include <d3d9.h>
+#include <simd/Lanes.hpp>
+
+/**
+ * A vertex leaving the vertex stage.
+ *
+ * "position" is in clip space, or in screen space (x, y, z, rhw)
+ * for pre-transformed (D3DFVF_XYZRHW) vertices. Colors are r, g, b, a
+ * in 0..1; missing texture coordinates are (0, 0, 0, 1). The alpha
+ * of the specular color is the fog factor, 1 for no fog.
+ */
+struct Vertex {
+	float position[4];
+	float color[2][4]; //diffuse, specular
+	float texture[8][4];
+	float size; //point size in pixels
+};
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+/**
+ * Fog factor parameters, per vertex or per pixel.
+ */
+struct Fog {
+	D3DFOGMODE mode;
+	float start;
+	float end;
+	float density;
+
+	/**
+	 * Fraction of the fogged color kept at distance "d": 1 no fog, 0 fully fogged.
+	 */
+	inline __attribute__((always_inline)) Lanes::f32x8 factor(Lanes::f32x8 d) const {
+		switch (this->mode) {
+			case D3DFOG_LINEAR: return Lanes::clamp01((this->end - d) * (1.0f / (this->end - this->start)));
+			case D3DFOG_EXP: return Lanes::exp2(Lanes::abs(d) * (-this->density * 1.44269504f));
+			case D3DFOG_EXP2: return Lanes::exp2(d * d * (-this->density * this->density * 1.44269504f));
+			default: return Lanes::splat(1.0f);
+		}
+	}
+};
+
+#pragma GCC diagnostic pop
+
+/**
+ * Enabled light in eye space, as the vertex stage uses it.
+ */
+struct Light {
+	D3DLIGHTTYPE type;
+	float diffuse[3];
+	float specular[3];
+	float ambient[3];
+	float position[3];
+	float direction[3]; //normalized, towards where the light shines
+	float range;
+	float attenuation[3];
+	float falloff;
+	float cosTheta; //cos(Theta / 2)
+	float cosPhi; //cos(Phi / 2)
+};
+
+/**
+ * What the vertex stage reads from the device, captured per draw.
+ */
+struct VertexState {
+	DWORD fvf;
+	D3DMATRIX worldViewProjection;
+	D3DMATRIX worldView;
+	float viewportHeight;
+
+	UINT blendMatrices; //matrices blended per vertex, 0 without vertex blending
+	bool indexedBlend; //matrices are picked by the indices in the last beta, not 0 to 3
+	const D3DMATRIX* blendWorldView; //256 of them: world matrix n times the view
+	const D3DMATRIX* blendNormal; //their inverse transposes
+	D3DMATRIX projection;
+
+	float pointSize;
+	float pointSizeMin;
+	float pointSizeMax;
+	bool pointScale;
+	float pointScaleA;
+	float pointScaleB;
+	float pointScaleC;
+
+	bool lighting;
+	bool specular; //compute the specular color
+	bool normalizeNormals;
+	bool localViewer;
+	D3DMATRIX normal; //inverse transpose of worldView
+	D3DMATERIAL9 material;
+	D3DMATERIALCOLORSOURCE diffuseSource;
+	D3DMATERIALCOLORSOURCE ambientSource;
+	D3DMATERIALCOLORSOURCE specularSource;
+	D3DMATERIALCOLORSOURCE emissiveSource;
+	float ambient[3]; //D3DRS_AMBIENT
+	UINT lightCount;
+	Light lights[8];
+
+	bool fog; //vertex fog into the specular alpha
+	bool rangeFog;
+	Fog fogParameters;
+
+	UINT textureStages; //texture coordinate sets written, one per stage
+	DWORD texCoordIndex[8]; //D3DTSS_TEXCOORDINDEX
+	DWORD textureTransform[8]; //D3DTSS_TEXTURETRANSFORMFLAGS
+	D3DMATRIX textureMatrix[8];
+};
+
+/**
+ * Where ProcessVertices() writes vertices: projected into "viewport"
+ * and packed in the D3DFVF_XYZRHW layout "fvf".
+ */
+struct VertexOutput {
+	DWORD fvf;
+	UINT stride;
+	D3DVIEWPORT9 viewport;
+	bool copyData; //false for D3DPV_DONOTCOPYDATA: only what the stage computed is written
+};
+
+/**
+ * Fixed-function vertex processing of FVF vertices.
+ *
+ * Positions go through VectorMath's batched transforms, or through
+ * the skinning kernel when vertex blending is on; large draws are
+ * split across the worker pool. Lighting, vertex fog and texture
+ * coordinate generation then run on eight vertices at a time in
+ * structure-of-arrays form, each enabled light through the code for
+ * its type alone.
+ */
+class VertexStage {
+	/**
+	 * Bytes per vertex of "fvf", 0 if the FVF is not supported.
+	 */
+	public:static UINT size(DWORD fvf);
+
+	public:static bool isTransformed(DWORD fvf) {
+		return (fvf & D3DFVF_POSITION_MASK) == D3DFVF_XYZRHW;
+	}
+
+	public:static void process(const VertexState& state, const BYTE* vertices, UINT stride, UINT count, Vertex* out);
+
+	/**
+	 * process() for ProcessVertices(): the vertices are projected and
+	 * packed into "out" as "output" says. Each worker packs a batch in
+	 * cache, then streams it out with non-temporal stores, as nothing
+	 * reads the destination back before it is drawn. Texture set i of
+	 * the output is stage i's, so "state" must have a stage per set.
+	 */
+	public:static void processTo(const VertexState& state, const BYTE* vertices, UINT stride, UINT count, const VertexOutput& output, BYTE* out);
+
+	private:static void processRange(const VertexState& state, const BYTE* vertices, UINT stride, UINT count, Vertex* out);
+
+	/**
+	 * Vertex blending: eye-space positions and, unless "normal" is
+	 * NULL, normals of "count" vertices, as the weighted sum of their
+	 * matrices' results.
+	 */
+	private:static void skin(const VertexState& state, const BYTE* vertices, UINT stride, UINT count, float (*eye)[4], float (*normal)[4]);
+	private:static void skinAVX2(const VertexState& state, const BYTE* vertices, UINT stride, UINT count, float (*eye)[4], float (*normal)[4]);
+	private:static void skinGeneric(const VertexState& state, const BYTE* vertices, UINT stride, UINT count, float (*eye)[4], float (*normal)[4]);
+
+	/**
+	 * Lighting, fog and texture coordinate generation of "count" (up
+	 * to 8) vertices. "eye" and "normal" are their eye-space positions
+	 * and normals.
+	 */
+	private:static void shade(const VertexState& state, const float (*eye)[4], const float (*normal)[4], UINT count, Vertex* out);
+	private:static void shadeAVX2(const VertexState& state, const float (*eye)[4], const float (*normal)[4], UINT count, Vertex* out);
+	private:static void shadeGeneric(const VertexState& state, const float (*eye)[4], const float (*normal)[4], UINT count, Vertex* out);
+};
@@ -0,0 +1,378 @@
+#include <windows.h>
+#include <d3dx9math.h>
+#include <simd/VectorMath.hpp>
+#include <cmath>
+
+//--- Vectors
+
+D3DXVECTOR2* D3DXVec2Normalize(D3DXVECTOR2* pOut, const D3DXVECTOR2* pV) {
+	float length = D3DXVec2Length(pV);
+	*pOut = length > 0.0f ? *pV / length : D3DXVECTOR2();
+	return pOut;
+}
+
+D3DXVECTOR3* D3DXVec3Normalize(D3DXVECTOR3* pOut, const D3DXVECTOR3* pV) {
+	float length = D3DXVec3Length(pV);
+	*pOut = length > 0.0f ? *pV / length : D3DXVECTOR3();
+	return pOut;
+}
+
+D3DXVECTOR4* D3DXVec4Normalize(D3DXVECTOR4* pOut, const D3DXVECTOR4* pV) {
+	float length = D3DXVec4Length(pV);
+	*pOut = length > 0.0f ? *pV / length : D3DXVECTOR4();
+	return pOut;
+}
+
+/**
+ * Single vectors go through the scalar kernel (the compiler vectorises
+ * it); dispatching to SSE/AVX2 only pays off for arrays.
+ */
+D3DXVECTOR4* D3DXVec3Transform(D3DXVECTOR4* pOut, const D3DXVECTOR3* pV, const D3DXMATRIX* pM) {
+	D3DXVECTOR4 r;
+	VectorMath::transformOne<VectorMath::POINT>(r, *pV, *pM);
+	*pOut = r;
+	return pOut;
+}
+
+D3DXVECTOR3* D3DXVec3TransformCoord(D3DXVECTOR3* pOut, const D3DXVECTOR3* pV, const D3DXMATRIX* pM) {
+	D3DXVECTOR3 r;
+	VectorMath::transformOne<VectorMath::COORD>(r, *pV, *pM);
+	*pOut = r;
+	return pOut;
+}
+
+D3DXVECTOR3* D3DXVec3TransformNormal(D3DXVECTOR3* pOut, const D3DXVECTOR3* pV, const D3DXMATRIX* pM) {
+	D3DXVECTOR3 r;
+	VectorMath::transformOne<VectorMath::NORMAL>(r, *pV, *pM);
+	*pOut = r;
+	return pOut;
+}
+
+D3DXVECTOR4* D3DXVec4Transform(D3DXVECTOR4* pOut, const D3DXVECTOR4* pV, const D3DXMATRIX* pM) {
+	D3DXVECTOR4 r;
+	VectorMath::transformOne<VectorMath::VECTOR4>(r, *pV, *pM);
+	*pOut = r;
+	return pOut;
+}
+
+D3DXVECTOR4* D3DXVec3TransformArray(D3DXVECTOR4* pOut, UINT OutStride, const D3DXVECTOR3* pV, UINT VStride, const D3DXMATRIX* pM, UINT n) {
+	VectorMath::transform<VectorMath::POINT>(pOut, OutStride, pV, VStride, *pM, n);
+	return pOut;
+}
+
+D3DXVECTOR3* D3DXVec3TransformCoordArray(D3DXVECTOR3* pOut, UINT OutStride, const D3DXVECTOR3* pV, UINT VStride, const D3DXMATRIX* pM, UINT n) {
+	VectorMath::transform<VectorMath::COORD>(pOut, OutStride, pV, VStride, *pM, n);
+	return pOut;
+}
+
+D3DXVECTOR3* D3DXVec3TransformNormalArray(D3DXVECTOR3* pOut, UINT OutStride, const D3DXVECTOR3* pV, UINT VStride, const D3DXMATRIX* pM, UINT n) {
+	VectorMath::transform<VectorMath::NORMAL>(pOut, OutStride, pV, VStride, *pM, n);
+	return pOut;
+}
+
+D3DXVECTOR4* D3DXVec4TransformArray(D3DXVECTOR4* pOut, UINT OutStride, const D3DXVECTOR4* pV, UINT VStride, const D3DXMATRIX* pM, UINT n) {
+	VectorMath::transform<VectorMath::VECTOR4>(pOut, OutStride, pV, VStride, *pM, n);
+	return pOut;
+}
+
+//--- Matrices
+
+float D3DXMatrixDeterminant(const D3DXMATRIX* pM) {
+	return VectorMath::determinant(*pM);
+}
+
+D3DXMATRIX* D3DXMatrixTranspose(D3DXMATRIX* pOut, const D3DXMATRIX* pM) {
+	D3DXMATRIX r;
+
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) r.m[i][j] = pM->m[j][i];
+	}
+
+	*pOut = r;
+	return pOut;
+}
+
+D3DXMATRIX* D3DXMatrixMultiply(D3DXMATRIX* pOut, const D3DXMATRIX* pM1, const D3DXMATRIX* pM2) {
+	VectorMath::multiply(*pOut, *pM1, *pM2);
+	return pOut;
+}
+
+D3DXMATRIX* D3DXMatrixMultiplyTranspose(D3DXMATRIX* pOut, const D3DXMATRIX* pM1, const D3DXMATRIX* pM2) {
+	VectorMath::multiply(*pOut, *pM1, *pM2);
+	return D3DXMatrixTranspose(pOut, pOut);
+}
+
+/**
+ * Returns NULL (pOut untouched) when pM is singular.
+ */
+D3DXMATRIX* D3DXMatrixInverse(D3DXMATRIX* pOut, float* pDeterminant, const D3DXMATRIX* pM) {
+	return VectorMath::inverse(*pOut, pDeterminant, *pM) ? pOut : NULL;
+}
+
+D3DXMATRIX* D3DXMatrixScaling(D3DXMATRIX* pOut, float sx, float sy, float sz) {
+	*pOut = D3DXMATRIX(sx, 0, 0, 0, 0, sy, 0, 0, 0, 0, sz, 0, 0, 0, 0, 1);
+	return pOut;
+}
+
+D3DXMATRIX* D3DXMatrixTranslation(D3DXMATRIX* pOut, float x, float y, float z) {
+	*pOut = D3DXMATRIX(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, y, z, 1);
+	return pOut;
+}
+
+D3DXMATRIX* D3DXMatrixRotationX(D3DXMATRIX* pOut, float Angle) {
+	float s = sinf(Angle), c = cosf(Angle);
+	*pOut = D3DXMATRIX(1, 0, 0, 0, 0, c, s, 0, 0, -s, c, 0, 0, 0, 0, 1);
+	return pOut;
+}
+
+D3DXMATRIX* D3DXMatrixRotationY(D3DXMATRIX* pOut, float Angle) {
+	float s = sinf(Angle), c = cosf(Angle);
+	*pOut = D3DXMATRIX(c, 0, -s, 0, 0, 1, 0, 0, s, 0, c, 0, 0, 0, 0, 1);
+	return pOut;
+}
+
+D3DXMATRIX* D3DXMatrixRotationZ(D3DXMATRIX* pOut, float Angle) {
+	float s = sinf(Angle), c = cosf(Angle);
+	*pOut = D3DXMATRIX(c, s, 0, 0, -s, c, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
+	return pOut;
+}
+
+D3DXMATRIX* D3DXMatrixRotationAxis(D3DXMATRIX* pOut, const D3DXVECTOR3* pV, float Angle) {
+	D3DXVECTOR3 v;
+	D3DXVec3Normalize(&v, pV);
+
+	float s = sinf(Angle), c = cosf(Angle), t = 1.0f - c;
+	*pOut = D3DXMATRIX(
+		t * v.x * v.x + c,       t * v.x * v.y + s * v.z, t * v.x * v.z - s * v.y, 0,
+		t * v.x * v.y - s * v.z, t * v.y * v.y + c,       t * v.y * v.z + s * v.x, 0,
+		t * v.x * v.z + s * v.y, t * v.y * v.z - s * v.x, t * v.z * v.z + c,       0,
+		0, 0, 0, 1
+	);
+	return pOut;
+}
+
+D3DXMATRIX* D3DXMatrixRotationQuaternion(D3DXMATRIX* pOut, const D3DXQUATERNION* pQ) {
+	float x = pQ->x, y = pQ->y, z = pQ->z, w = pQ->w;
+
+	*pOut = D3DXMATRIX(
+		1 - 2 * (y * y + z * z), 2 * (x * y + z * w),     2 * (x * z - y * w),     0,
+		2 * (x * y - z * w),     1 - 2 * (x * x + z * z), 2 * (y * z + x * w),     0,
+		2 * (x * z + y * w),     2 * (y * z - x * w),     1 - 2 * (x * x + y * y), 0,
+		0, 0, 0, 1
+	);
+	return pOut;
+}
+
+/**
+ * Roll (Z), then pitch (X), then yaw (Y).
+ */
+D3DXMATRIX* D3DXMatrixRotationYawPitchRoll(D3DXMATRIX* pOut, float Yaw, float Pitch, float Roll) {
+	D3DXMATRIX x, y, z;
+	D3DXMatrixRotationX(&x, Pitch);
+	D3DXMatrixRotationY(&y, Yaw);
+	D3DXMatrixRotationZ(&z, Roll);
+
+	*pOut = z * x * y;
+	return pOut;
+}
+
+static D3DXMATRIX* lookAt(D3DXMATRIX* pOut, const D3DXVECTOR3& eye, const D3DXVECTOR3& forward, const D3DXVECTOR3& up) {
+	D3DXVECTOR3 zaxis, xaxis, yaxis;
+	D3DXVec3Normalize(&zaxis, &forward);
+	D3DXVec3Cross(&xaxis, &up, &zaxis);
+	D3DXVec3Normalize(&xaxis, &xaxis);
+	D3DXVec3Cross(&yaxis, &zaxis, &xaxis);
+
+	*pOut = D3DXMATRIX(
+		xaxis.x, yaxis.x, zaxis.x, 0,
+		xaxis.y, yaxis.y, zaxis.y, 0,
+		xaxis.z, yaxis.z, zaxis.z, 0,
+		-D3DXVec3Dot(&xaxis, &eye), -D3DXVec3Dot(&yaxis, &eye), -D3DXVec3Dot(&zaxis, &eye), 1
+	);
+	return pOut;
+}
+
+D3DXMATRIX* D3DXMatrixLookAtRH(D3DXMATRIX* pOut, const D3DXVECTOR3* pEye, const D3DXVECTOR3* pAt, const D3DXVECTOR3* pUp) {
+	return lookAt(pOut, *pEye, *pEye - *pAt, *pUp);
+}
+
+D3DXMATRIX* D3DXMatrixLookAtLH(D3DXMATRIX* pOut, const D3DXVECTOR3* pEye, const D3DXVECTOR3* pAt, const D3DXVECTOR3* pUp) {
+	return lookAt(pOut, *pEye, *pAt - *pEye, *pUp);
+}
+
+D3DXMATRIX* D3DXMatrixPerspectiveFovRH(D3DXMATRIX* pOut, float fovy, float Aspect, float zn, float zf) {
+	float yScale = 1.0f / tanf(fovy / 2), xScale = yScale / Aspect;
+	*pOut = D3DXMATRIX(xScale, 0, 0, 0, 0, yScale, 0, 0, 0, 0, zf / (zn - zf), -1, 0, 0, zn * zf / (zn - zf), 0);
+	return pOut;
+}
+
+D3DXMATRIX* D3DXMatrixPerspectiveFovLH(D3DXMATRIX* pOut, float fovy, float Aspect, float zn, float zf) {
+	float yScale = 1.0f / tanf(fovy / 2), xScale = yScale / Aspect;
+	*pOut = D3DXMATRIX(xScale, 0, 0, 0, 0, yScale, 0, 0, 0, 0, zf / (zf - zn), 1, 0, 0, -zn * zf / (zf - zn), 0);
+	return pOut;
+}
+
+D3DXMATRIX* D3DXMatrixOrthoRH(D3DXMATRIX* pOut, float w, float h, float zn, float zf) {
+	*pOut = D3DXMATRIX(2 / w, 0, 0, 0, 0, 2 / h, 0, 0, 0, 0, 1 / (zn - zf), 0, 0, 0, zn / (zn - zf), 1);
+	return pOut;
+}
+
+D3DXMATRIX* D3DXMatrixOrthoLH(D3DXMATRIX* pOut, float w, float h, float zn, float zf) {
+	*pOut = D3DXMATRIX(2 / w, 0, 0, 0, 0, 2 / h, 0, 0, 0, 0, 1 / (zf - zn), 0, 0, 0, zn / (zn - zf), 1);
+	return pOut;
+}
+
+D3DXMATRIX* D3DXMatrixOrthoOffCenterRH(D3DXMATRIX* pOut, float l, float r, float b, float t, float zn, float zf) {
+	*pOut = D3DXMATRIX(
+		2 / (r - l), 0, 0, 0,
+		0, 2 / (t - b), 0, 0,
+		0, 0, 1 / (zn - zf), 0,
+		(l + r) / (l - r), (t + b) / (b - t), zn / (zn - zf), 1
+	);
+	return pOut;
+}
+
+D3DXMATRIX* D3DXMatrixOrthoOffCenterLH(D3DXMATRIX* pOut, float l, float r, float b, float t, float zn, float zf) {
+	*pOut = D3DXMATRIX(
+		2 / (r - l), 0, 0, 0,
+		0, 2 / (t - b), 0, 0,
+		0, 0, 1 / (zf - zn), 0,
+		(l + r) / (l - r), (t + b) / (b - t), zn / (zn - zf), 1
+	);
+	return pOut;
+}
+
+//--- Quaternions
+
+D3DXQUATERNION* D3DXQuaternionNormalize(D3DXQUATERNION* pOut, const D3DXQUATERNION* pQ) {
+	float length = D3DXQuaternionLength(pQ);
+	*pOut = length > 0.0f ? *pQ / length : D3DXQUATERNION();
+	return pOut;
+}
+
+D3DXQUATERNION* D3DXQuaternionInverse(D3DXQUATERNION* pOut, const D3DXQUATERNION* pQ) {
+	float lengthSq = D3DXQuaternionLengthSq(pQ);
+	D3DXQuaternionConjugate(pOut, pQ);
+	*pOut /= lengthSq;
+	return pOut;
+}
+
+D3DXQUATERNION* D3DXQuaternionMultiply(D3DXQUATERNION* pOut, const D3DXQUATERNION* pQ1, const D3DXQUATERNION* pQ2) {
+	*pOut = *pQ1 * *pQ2;
+	return pOut;
+}
+
+D3DXQUATERNION* D3DXQuaternionRotationAxis(D3DXQUATERNION* pOut, const D3DXVECTOR3* pV, float Angle) {
+	D3DXVECTOR3 v;
+	D3DXVec3Normalize(&v, pV);
+
+	float s = sinf(Angle / 2);
+	*pOut = D3DXQUATERNION(v.x * s, v.y * s, v.z * s, cosf(Angle / 2));
+	return pOut;
+}
+
+/**
+ * Inverse of D3DXMatrixRotationQuaternion; the largest diagonal term
+ * picks the component that is solved first, to stay well conditioned.
+ */
+D3DXQUATERNION* D3DXQuaternionRotationMatrix(D3DXQUATERNION* pOut, const D3DXMATRIX* pM) {
+	const D3DXMATRIX& m = *pM;
+	float trace = m._11 + m._22 + m._33;
+
+	if (trace > 0.0f) {
+		float s = 2.0f * sqrtf(trace + 1.0f);
+		*pOut = D3DXQUATERNION((m._23 - m._32) / s, (m._31 - m._13) / s, (m._12 - m._21) / s, s / 4);
+	} else if (m._11 > m._22 && m._11 > m._33) {
+		float s = 2.0f * sqrtf(1.0f + m._11 - m._22 - m._33);
+		*pOut = D3DXQUATERNION(s / 4, (m._12 + m._21) / s, (m._13 + m._31) / s, (m._23 - m._32) / s);
+	} else if (m._22 > m._33) {
+		float s = 2.0f * sqrtf(1.0f + m._22 - m._11 - m._33);
+		*pOut = D3DXQUATERNION((m._12 + m._21) / s, s / 4, (m._23 + m._32) / s, (m._31 - m._13) / s);
+	} else {
+		float s = 2.0f * sqrtf(1.0f + m._33 - m._11 - m._22);
+		*pOut = D3DXQUATERNION((m._13 + m._31) / s, (m._23 + m._32) / s, s / 4, (m._12 - m._21) / s);
+	}
+
+	return pOut;
+}
+
+D3DXQUATERNION* D3DXQuaternionRotationYawPitchRoll(D3DXQUATERNION* pOut, float Yaw, float Pitch, float Roll) {
+	float sy = sinf(Yaw / 2), cy = cosf(Yaw / 2);
+	float sp = sinf(Pitch / 2), cp = cosf(Pitch / 2);
+	float sr = sinf(Roll / 2), cr = cosf(Roll / 2);
+
+	*pOut = D3DXQUATERNION(
+		cy * sp * cr + sy * cp * sr,
+		sy * cp * cr - cy * sp * sr,
+		cy * cp * sr - sy * sp * cr,
+		cy * cp * cr + sy * sp * sr
+	);
+	return pOut;
+}
+
+/**
+ * Takes the shortest arc. Nearly parallel inputs fall back to a
+ * normalised lerp, where sin(theta) would divide by ~0.
+ */
+D3DXQUATERNION* D3DXQuaternionSlerp(D3DXQUATERNION* pOut, const D3DXQUATERNION* pQ1, const D3DXQUATERNION* pQ2, float t) {
+	D3DXQUATERNION q2 = *pQ2;
+	float cosTheta = D3DXQuaternionDot(pQ1, &q2);
+
+	if (cosTheta < 0.0f) {
+		q2 = -q2;
+		cosTheta = -cosTheta;
+	}
+
+	if (cosTheta > 0.9995f) {
+		D3DXQUATERNION r = *pQ1 + (q2 - *pQ1) * t;
+		return D3DXQuaternionNormalize(pOut, &r);
+	}
+
+	float theta = acosf(cosTheta), sinTheta = sinf(theta);
+	*pOut = *pQ1 * (sinf((1.0f - t) * theta) / sinTheta) + q2 * (sinf(t * theta) / sinTheta);
+	return pOut;
+}
+
+//--- Planes
+
+D3DXPLANE* D3DXPlaneNormalize(D3DXPLANE* pOut, const D3DXPLANE* pP) {
+	float length = sqrtf(pP->a * pP->a + pP->b * pP->b + pP->c * pP->c);
+	return length > 0.0f ? D3DXPlaneScale(pOut, pP, 1.0f / length) : D3DXPlaneScale(pOut, pP, 0.0f);
+}
+
+D3DXPLANE* D3DXPlaneFromPointNormal(D3DXPLANE* pOut, const D3DXVECTOR3* pPoint, const D3DXVECTOR3* pNormal) {
+	*pOut = D3DXPLANE(pNormal->x, pNormal->y, pNormal->z, -D3DXVec3Dot(pPoint, pNormal));
+	return pOut;
+}
+
+D3DXPLANE* D3DXPlaneFromPoints(D3DXPLANE* pOut, const D3DXVECTOR3* pV1, const D3DXVECTOR3* pV2, const D3DXVECTOR3* pV3) {
+	D3DXVECTOR3 e1 = *pV2 - *pV1, e2 = *pV3 - *pV1, normal;
+	D3DXVec3Cross(&normal, &e1, &e2);
+	D3DXVec3Normalize(&normal, &normal);
+
+	return D3DXPlaneFromPointNormal(pOut, pV1, &normal);
+}
+
+/**
+ * NULL when the line is parallel to the plane.
+ */
+D3DXVECTOR3* D3DXPlaneIntersectLine(D3DXVECTOR3* pOut, const D3DXPLANE* pP, const D3DXVECTOR3* pV1, const D3DXVECTOR3* pV2) {
+	D3DXVECTOR3 direction = *pV2 - *pV1;
+	float dot = D3DXPlaneDotNormal(pP, &direction);
+	if (dot == 0.0f) return NULL;
+
+	*pOut = *pV1 - direction * (D3DXPlaneDotCoord(pP, pV1) / dot);
+	return pOut;
+}
+
+D3DXPLANE* D3DXPlaneTransform(D3DXPLANE* pOut, const D3DXPLANE* pP, const D3DXMATRIX* pM) {
+	D3DXPLANE r;
+	VectorMath::transformOne<VectorMath::VECTOR4>(r, *pP, *pM);
+	*pOut = r;
+	return pOut;
+}
+
+D3DXPLANE* D3DXPlaneTransformArray(D3DXPLANE* pOut, UINT OutStride, const D3DXPLANE* pP, UINT PStride, const D3DXMATRIX* pM, UINT n) {
+	VectorMath::transform<VectorMath::VECTOR4>(pOut, OutStride, pP, PStride, *pM, n);
+	return pOut;
+}
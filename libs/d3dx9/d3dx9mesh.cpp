@@ -0,0 +1,66 @@
+#include <windows.h>
+#include <d3dx9mesh.h>
+#include <new>
+#include "d3dxmesh.hpp"
+#include "meshoptimizer.hpp"
+
+UINT D3DXGetFVFVertexSize(DWORD FVF) {
+	UINT size = 0;
+
+	switch (FVF & D3DFVF_POSITION_MASK) {
+		case D3DFVF_XYZ: size = 12; break;
+		case D3DFVF_XYZRHW: case D3DFVF_XYZW: size = 16; break;
+		case D3DFVF_XYZB1: size = 16; break;
+		case D3DFVF_XYZB2: size = 20; break;
+		case D3DFVF_XYZB3: size = 24; break;
+		case D3DFVF_XYZB4: size = 28; break;
+		case D3DFVF_XYZB5: size = 32; break;
+	}
+
+	if (FVF & D3DFVF_NORMAL) size += 12;
+	if (FVF & D3DFVF_PSIZE) size += 4;
+	if (FVF & D3DFVF_DIFFUSE) size += 4;
+	if (FVF & D3DFVF_SPECULAR) size += 4;
+
+	//D3DFVF_TEXCOORDSIZEn: 2 bits per set from bit 16 (0 = 2 floats, 1 = 3, 2 = 4, 3 = 1)
+	constexpr const UINT coordinates[4] = {2, 3, 4, 1};
+	UINT sets = (FVF & D3DFVF_TEXCOUNT_MASK) >> D3DFVF_TEXCOUNT_SHIFT;
+	for (UINT i = 0; i < sets; i++) {
+		size += coordinates[(FVF >> (16 + i * 2)) & 3] * 4;
+	}
+
+	return size;
+}
+
+HRESULT D3DXCreateMeshFVF(DWORD NumFaces, DWORD NumVertices, DWORD Options, DWORD FVF, LPDIRECT3DDEVICE9 pD3DDevice, LPD3DXMESH* ppMesh) {
+	if (ppMesh == NULL || pD3DDevice == NULL || NumFaces == 0 || NumVertices == 0) return D3DERR_INVALIDCALL;
+	if (!(Options & D3DXMESH_32BIT) && NumVertices > 0x10000) return D3DERR_INVALIDCALL;
+	if (D3DXGetFVFVertexSize(FVF) == 0) return D3DERR_INVALIDCALL;
+
+	*ppMesh = new (std::nothrow) D3DXMesh(NumFaces, NumVertices, Options, FVF, pD3DDevice);
+	return *ppMesh != NULL ? D3D_OK : E_OUTOFMEMORY;
+}
+
+HRESULT D3DXOptimizeFaces(const void* pIndices, UINT NumFaces, UINT NumVertices, BOOL b32BitIndices, DWORD* pFaceRemap) {
+	std::vector<DWORD> indices;
+	std::vector<UINT> clusters;
+
+	if (pIndices == NULL || pFaceRemap == NULL) return D3DERR_INVALIDCALL;
+	if (!MeshOptimizer::readIndices(pIndices, NumFaces, NumVertices, b32BitIndices, indices)) return D3DERR_INVALIDCALL;
+
+	std::vector<DWORD> order = MeshOptimizer::orderFaces(indices.data(), NumFaces, NumVertices, MeshOptimizer::CACHE_SIZE, clusters);
+	std::copy(order.begin(), order.end(), pFaceRemap);
+	return D3D_OK;
+}
+
+HRESULT D3DXOptimizeVertices(const void* pIndices, UINT NumFaces, UINT NumVertices, BOOL b32BitIndices, DWORD* pVertexRemap) {
+	std::vector<DWORD> indices;
+	UINT used = 0;
+
+	if (pIndices == NULL || pVertexRemap == NULL) return D3DERR_INVALIDCALL;
+	if (!MeshOptimizer::readIndices(pIndices, NumFaces, NumVertices, b32BitIndices, indices)) return D3DERR_INVALIDCALL;
+
+	std::vector<DWORD> order = MeshOptimizer::orderVertices(indices.data(), NumFaces, NumVertices, used);
+	std::copy(order.begin(), order.end(), pVertexRemap);
+	return D3D_OK;
+}
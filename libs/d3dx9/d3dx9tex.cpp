@@ -0,0 +1,379 @@
+#include <windows.h>
+#include <d3dx9tex.h>
+#include <cstring>
+#include <memory>
+#include <format/PixelFormat.hpp>
+#include <simd/ColorConvert.hpp>
+#include <thread/WorkerPool.hpp>
+#include "../d3d9/direct3dtexture9.hpp"
+#include "ddsfile.hpp"
+#include "filemapping.hpp"
+#include "imagedecoder.hpp"
+
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+static bool readInfo(BYTE* data, size_t size, D3DXIMAGE_INFO& info) {
+	DDSFile dds;
+
+	if (!DDSFile::parse(data, size, dds)) return ImageDecoder::info(data, size, info);
+
+	info.Width = dds.width;
+	info.Height = dds.height;
+	info.Depth = 1;
+	info.MipLevels = dds.levels;
+	info.Format = dds.format;
+	info.ResourceType = D3DRTYPE_TEXTURE;
+	info.ImageFileFormat = D3DXIFF_DDS;
+	return true;
+}
+
+/**
+ * Our textures are written through their storage: their LockRect
+ * waits for streaming, which may be what is running here.
+ */
+static bool lockLevel(IDirect3DTexture9* texture, UINT level, D3DLOCKED_RECT& locked) {
+	Direct3DTexture9* storage = dynamic_cast<Direct3DTexture9*>(texture);
+	if (storage == NULL) return SUCCEEDED(texture->LockRect(level, &locked, NULL, 0));
+
+	const Direct3DTexture9::Level* data = storage->level(level);
+	if (data == NULL) return false;
+
+	locked.pBits = data->bits;
+	locked.Pitch = data->pitch;
+	return true;
+}
+
+/**
+ * Texture levels straight from a DDS file, with the file's format,
+ * size and mips. Levels of our own textures take the mapped pages
+ * over ("file" is a private mapping that stays alive with them);
+ * anything else is copied row by row.
+ */
+static HRESULT fillFromDDS(IDirect3DTexture9* texture, const DDSFile& dds, const std::shared_ptr<BYTE>& file) {
+	Direct3DTexture9* storage = file != NULL ? dynamic_cast<Direct3DTexture9*>(texture) : NULL;
+
+	for (UINT level = 0; level < texture->GetLevelCount(); level++) {
+		BYTE* bits = dds.level(level);
+		UINT pitch = dds.pitch(level), rows = PixelFormat::rows(dds.format, PixelFormat::mipSize(dds.height, level));
+
+		if (storage != NULL && storage->adopt(level, file, bits, pitch)) continue;
+
+		D3DLOCKED_RECT locked;
+		if (!lockLevel(texture, level, locked)) return D3DERR_INVALIDCALL;
+
+		for (UINT row = 0; row < rows; row++) {
+			memcpy((BYTE*) locked.pBits + (size_t) row * locked.Pitch, bits + (size_t) row * pitch, pitch);
+		}
+		texture->UnlockRect(level);
+	}
+	return D3D_OK;
+}
+
+/**
+ * The D3DX_FILTER_* type of a Filter or MipFilter argument, without
+ * the mirror, dither and sRGB flags.
+ */
+static DWORD filterType(DWORD filter, DWORD fallback) {
+	return filter == D3DX_DEFAULT ? fallback : filter & 0xFFFF;
+}
+
+/**
+ * NONE copies the overlapping corner and leaves the rest transparent
+ * black, POINT takes the nearest pixel, and the others (LINEAR and
+ * TRIANGLE included) average the source pixels each one covers.
+ */
+static void resize(Image& image, UINT width, UINT height, DWORD filter) {
+	Image resized;
+	resized.width = width;
+	resized.height = height;
+	resized.pixels.resize((size_t) width * height);
+
+	WorkerPool::shared().parallelFor(height, std::max<size_t>(1, 16384 / width), [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; y++) {
+			uint32_t* dst = resized.pixels.data() + y * width;
+
+			if (filter == D3DX_FILTER_NONE) {
+				if (y < image.height) memcpy(dst, image.pixels.data() + y * image.width, std::min(width, image.width) * 4);
+			} else if (filter == D3DX_FILTER_POINT) {
+				const uint32_t* src = image.pixels.data() + (y * image.height / height) * image.width;
+				for (size_t x = 0; x < width; x++) dst[x] = src[x * image.width / width];
+			} else {
+				size_t y0 = y * image.height / height, y1 = std::max(y0 + 1, (y + 1) * image.height / height);
+				for (size_t x = 0; x < width; x++) {
+					size_t x0 = x * image.width / width, x1 = std::max(x0 + 1, (x + 1) * image.width / width);
+					uint32_t sum[4] = {}, count = (y1 - y0) * (x1 - x0), result = 0;
+
+					for (size_t sy = y0; sy < y1; sy++) {
+						for (size_t sx = x0; sx < x1; sx++) {
+							uint32_t p = image.pixels[sy * image.width + sx];
+							for (int c = 0; c < 4; c++) sum[c] += (p >> c * 8) & 0xFF;
+						}
+					}
+					for (int c = 0; c < 4; c++) result |= (sum[c] + count / 2) / count << c * 8;
+					dst[x] = result;
+				}
+			}
+		}
+	});
+
+	image = std::move(resized);
+}
+
+/**
+ * Packs "image" into every level, halving it on the way down: POINT
+ * keeps one pixel of each 2x2 block, the other filters average them,
+ * and NONE leaves the levels below the top as they were created.
+ * Each level is filtered and packed in parallel, row ranges per worker.
+ */
+static HRESULT fillFromImage(IDirect3DTexture9* texture, D3DFORMAT format, Image& image, DWORD mipFilter) {
+	WorkerPool& pool = WorkerPool::shared();
+	std::vector<uint32_t> next;
+	UINT levels = mipFilter == D3DX_FILTER_NONE ? 1 : texture->GetLevelCount();
+
+	for (UINT level = 0; level < levels; level++) {
+		if (level > 0) {
+			UINT width = std::max(image.width / 2, 1u), height = std::max(image.height / 2, 1u);
+			next.resize((size_t) width * height);
+
+			pool.parallelFor(height, std::max<size_t>(1, 8192 / width), [&](size_t begin, size_t end) {
+				if (mipFilter != D3DX_FILTER_POINT) {
+					ColorConvert::halve(next.data(), image.pixels.data(), image.width, image.height, begin, end);
+					return;
+				}
+				for (size_t y = begin; y < end; y++) {
+					const uint32_t* src = image.pixels.data() + std::min<size_t>(y * 2, image.height - 1) * image.width;
+					for (size_t x = 0; x < width; x++) next[y * width + x] = src[std::min<size_t>(x * 2, image.width - 1)];
+				}
+			});
+
+			image.pixels.swap(next);
+			image.width = width;
+			image.height = height;
+		}
+
+		D3DLOCKED_RECT locked;
+		if (!lockLevel(texture, level, locked)) return D3DERR_INVALIDCALL;
+
+		pool.parallelFor(image.height, std::max<size_t>(1, 16384 / image.width), [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++) {
+				ColorConvert::pack((BYTE*) locked.pBits + y * locked.Pitch, format, image.pixels.data() + y * image.width, image.width);
+			}
+		});
+		texture->UnlockRect(level);
+	}
+	return D3D_OK;
+}
+
+/**
+ * Levels up to this size are loaded before the texture is returned;
+ * larger ones are streamed in.
+ */
+#define RESIDENT_LEVEL_SIZE (64 * 1024)
+
+/**
+ * Adopted DDS levels are read from disk when first touched. The small
+ * ones are touched now, the large ones by the streamer, so nothing
+ * faults in while drawing.
+ */
+static void streamDDS(Direct3DTexture9* texture, const DDSFile& dds, const std::shared_ptr<BYTE>& file) {
+	UINT levels = texture->GetLevelCount(), resident = 0;
+	while (resident + 1 < levels && dds.level(resident + 1) - dds.level(resident) > RESIDENT_LEVEL_SIZE) resident++;
+
+	FileMapping::prefault(dds.level(resident), dds.level(levels) - dds.level(resident));
+	if (resident == 0) return;
+
+	BYTE* begin = dds.level(0);
+	size_t size = dds.level(resident) - begin;
+	texture->stream(resident, [file, begin, size]() { FileMapping::prefault(begin, size); });
+}
+
+/**
+ * The top level of an uncompressed DDS as A8R8G8B8, for requests the
+ * file can't be used for as it is. False for formats with no
+ * conversion (block-compressed, float, ...).
+ */
+static bool unpackDDS(const DDSFile& dds, Image& image) {
+	uint32_t gray[256];
+
+	switch (dds.format) {
+		case D3DFMT_A8R8G8B8: case D3DFMT_X8R8G8B8: case D3DFMT_A8B8G8R8: case D3DFMT_X8B8G8R8:
+		case D3DFMT_R8G8B8: case D3DFMT_R5G6B5:
+			break;
+
+		case D3DFMT_L8:
+			for (uint32_t i = 0; i < 256; i++) gray[i] = 0xFF000000 | i * 0x010101;
+			break;
+
+		default:
+			return false;
+	}
+
+	image.width = dds.width;
+	image.height = dds.height;
+	image.pixels.resize((size_t) dds.width * dds.height);
+
+	const BYTE* bits = dds.level(0);
+	UINT pitch = dds.pitch(0);
+
+	WorkerPool::shared().parallelFor(image.height, std::max<size_t>(1, 16384 / image.width), [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; y++) {
+			const BYTE* src = bits + y * pitch;
+			uint32_t* dst = image.pixels.data() + y * image.width;
+
+			switch (dds.format) {
+				case D3DFMT_A8R8G8B8: memcpy(dst, src, image.width * 4); break;
+				case D3DFMT_X8R8G8B8: ColorConvert::swizzle32(dst, (const uint32_t*) src, image.width, false, true); break;
+				case D3DFMT_A8B8G8R8: ColorConvert::swizzle32(dst, (const uint32_t*) src, image.width, true, false); break;
+				case D3DFMT_X8B8G8R8: ColorConvert::swizzle32(dst, (const uint32_t*) src, image.width, true, true); break;
+				case D3DFMT_R8G8B8: ColorConvert::expand24(dst, src, image.width, false); break;
+				case D3DFMT_R5G6B5: ColorConvert::expand565(dst, (const uint16_t*) src, image.width); break;
+				default: ColorConvert::expand8(dst, src, image.width, gray); break;
+			}
+		}
+	});
+	return true;
+}
+
+static HRESULT convertInto(IDirect3DTexture9* texture, D3DFORMAT format, Image& image, D3DCOLOR colorKey, DWORD filter, DWORD mipFilter) {
+	D3DSURFACE_DESC desc;
+
+	texture->GetLevelDesc(0, &desc);
+	if (image.width != desc.Width || image.height != desc.Height) resize(image, desc.Width, desc.Height, filter);
+	if (colorKey != 0) ColorConvert::colorKey(image.pixels.data(), image.pixels.size(), colorKey);
+	return fillFromImage(texture, format, image, mipFilter);
+}
+
+static HRESULT decodeInto(IDirect3DTexture9* texture, D3DFORMAT format, const BYTE* data, size_t size, D3DCOLOR colorKey, DWORD filter,
+	DWORD mipFilter) {
+	Image image;
+
+	if (!ImageDecoder::decode(data, size, image)) return D3DXERR_INVALIDDATA;
+	return convertInto(texture, format, image, colorKey, filter, mipFilter);
+}
+
+/**
+ * Both entry points end here. "file" owns "data" when it is a
+ * mapping DDS levels may be adopted from, NULL for caller memory.
+ */
+static HRESULT createTexture(LPDIRECT3DDEVICE9 pDevice, BYTE* data, size_t size, const std::shared_ptr<BYTE>& file, UINT Width, UINT Height,
+	UINT MipLevels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, DWORD Filter, DWORD MipFilter, D3DCOLOR ColorKey,
+	D3DXIMAGE_INFO* pSrcInfo, LPDIRECT3DTEXTURE9* ppTexture) {
+	D3DXIMAGE_INFO info;
+	DDSFile dds;
+	Image image;
+
+	if (pDevice == NULL || ppTexture == NULL) return D3DERR_INVALIDCALL;
+	if (!readInfo(data, size, info)) return D3DXERR_INVALIDDATA;
+	if (pSrcInfo != NULL) *pSrcInfo = info;
+
+	//the device has no power-of-two restriction, so DEFAULT is the file's size
+	if (Width == 0 || Width == D3DX_DEFAULT || Width == D3DX_DEFAULT_NONPOW2 || Width == D3DX_FROM_FILE) Width = info.Width;
+	if (Height == 0 || Height == D3DX_DEFAULT || Height == D3DX_DEFAULT_NONPOW2 || Height == D3DX_FROM_FILE) Height = info.Height;
+	if (Format == D3DFMT_UNKNOWN || Format == D3DFMT_FROM_FILE) Format = info.Format;
+	Filter = filterType(Filter, D3DX_FILTER_TRIANGLE);
+	MipFilter = filterType(MipFilter, D3DX_FILTER_BOX);
+
+	DDSFile::parse(data, size, dds);
+	if (info.ImageFileFormat == D3DXIFF_DDS && Format == dds.format && Width == dds.width && Height == dds.height) {
+		//DDS files carry their mips and are used as they are when they match: no conversion, scaling or color key
+		UINT levels = MipLevels == 0 || MipLevels == D3DX_DEFAULT || MipLevels == D3DX_FROM_FILE ? dds.levels : std::min(MipLevels, dds.levels);
+		HRESULT result = pDevice->CreateTexture(Width, Height, levels, Usage, Format, Pool, ppTexture, NULL);
+		if (FAILED(result)) return result;
+
+		result = fillFromDDS(*ppTexture, dds, file);
+		if (FAILED(result)) {
+			(*ppTexture)->Release();
+			*ppTexture = NULL;
+		} else if (Pool == D3DPOOL_MANAGED && file != NULL && dynamic_cast<Direct3DTexture9*>(*ppTexture) != NULL) {
+			streamDDS((Direct3DTexture9*) *ppTexture, dds, file);
+		}
+		return result;
+	}
+
+	//otherwise the top level is converted like any other image; there is no block compression or float input
+	if (info.ImageFileFormat == D3DXIFF_DDS && !unpackDDS(dds, image)) return D3DERR_NOTAVAILABLE;
+
+	//keyed images need alpha; formats pack() can't write fall back to A8R8G8B8
+	if (ColorKey != 0 && (Format == D3DFMT_X8R8G8B8 || Format == D3DFMT_R8G8B8)) Format = D3DFMT_A8R8G8B8;
+	if (!ColorConvert::canPack(Format)) Format = D3DFMT_A8R8G8B8;
+
+	UINT levels = MipLevels == D3DX_DEFAULT ? 0 : MipLevels == D3DX_FROM_FILE ? info.MipLevels : MipLevels;
+
+	HRESULT result = pDevice->CreateTexture(Width, Height, levels, Usage, Format, Pool, ppTexture, NULL);
+	if (FAILED(result) && Format != D3DFMT_A8R8G8B8) {
+		Format = D3DFMT_A8R8G8B8;
+		result = pDevice->CreateTexture(Width, Height, levels, Usage, Format, Pool, ppTexture, NULL);
+	}
+	if (FAILED(result)) return result;
+
+	//a whole image has to be decoded before any level exists: MANAGED ones are decoded in the background, unsampled until done,
+	//when nothing can fail by then (errors have to be returned from here)
+	Direct3DTexture9* storage = dynamic_cast<Direct3DTexture9*>(*ppTexture);
+	if (info.ImageFileFormat == D3DXIFF_DDS) {
+		result = convertInto(*ppTexture, Format, image, ColorKey, Filter, MipFilter);
+	} else if (Pool == D3DPOOL_MANAGED && file != NULL && storage != NULL && storage->level(0) != NULL && ImageDecoder::complete(data, size)) {
+		storage->stream(storage->GetLevelCount(), [storage, Format, file, data, size, ColorKey, Filter, MipFilter]() {
+			decodeInto(storage, Format, data, size, ColorKey, Filter, MipFilter);
+		});
+		return D3D_OK;
+	} else {
+		result = decodeInto(*ppTexture, Format, data, size, ColorKey, Filter, MipFilter);
+	}
+
+	if (FAILED(result)) {
+		(*ppTexture)->Release();
+		*ppTexture = NULL;
+	}
+	return result;
+}
+
+HRESULT D3DXGetImageInfoFromFileA(LPCSTR pSrcFile, D3DXIMAGE_INFO* pSrcInfo) {
+	size_t size;
+
+	if (pSrcFile == NULL || pSrcInfo == NULL) return D3DERR_INVALIDCALL;
+
+	std::shared_ptr<BYTE> file = FileMapping::map(pSrcFile, size);
+	if (file == NULL) return D3DERR_NOTAVAILABLE;
+
+	return readInfo(file.get(), size, *pSrcInfo) ? D3D_OK : D3DXERR_INVALIDDATA;
+}
+
+HRESULT D3DXGetImageInfoFromFileInMemory(const void* pSrcData, UINT SrcDataSize, D3DXIMAGE_INFO* pSrcInfo) {
+	if (pSrcData == NULL || pSrcInfo == NULL) return D3DERR_INVALIDCALL;
+
+	return readInfo((BYTE*) pSrcData, SrcDataSize, *pSrcInfo) ? D3D_OK : D3DXERR_INVALIDDATA;
+}
+
+HRESULT D3DXCreateTextureFromFileA(LPDIRECT3DDEVICE9 pDevice, LPCSTR pSrcFile, LPDIRECT3DTEXTURE9* ppTexture) {
+	return D3DXCreateTextureFromFileExA(pDevice, pSrcFile, D3DX_DEFAULT, D3DX_DEFAULT, D3DX_DEFAULT, 0, D3DFMT_UNKNOWN, D3DPOOL_MANAGED,
+		D3DX_DEFAULT, D3DX_DEFAULT, 0, NULL, NULL, ppTexture);
+}
+
+HRESULT D3DXCreateTextureFromFileExA(LPDIRECT3DDEVICE9 pDevice, LPCSTR pSrcFile, UINT Width, UINT Height, UINT MipLevels, DWORD Usage,
+	D3DFORMAT Format, D3DPOOL Pool, DWORD Filter, DWORD MipFilter, D3DCOLOR ColorKey, D3DXIMAGE_INFO* pSrcInfo, PALETTEENTRY* pPalette,
+	LPDIRECT3DTEXTURE9* ppTexture) {
+	size_t size;
+
+	if (pSrcFile == NULL) return D3DERR_INVALIDCALL;
+
+	std::shared_ptr<BYTE> file = FileMapping::map(pSrcFile, size);
+	if (file == NULL) return D3DERR_NOTAVAILABLE;
+
+	return createTexture(pDevice, file.get(), size, file, Width, Height, MipLevels, Usage, Format, Pool, Filter, MipFilter, ColorKey,
+		pSrcInfo, ppTexture);
+}
+
+HRESULT D3DXCreateTextureFromFileInMemory(LPDIRECT3DDEVICE9 pDevice, const void* pSrcData, UINT SrcDataSize, LPDIRECT3DTEXTURE9* ppTexture) {
+	return D3DXCreateTextureFromFileInMemoryEx(pDevice, pSrcData, SrcDataSize, D3DX_DEFAULT, D3DX_DEFAULT, D3DX_DEFAULT, 0, D3DFMT_UNKNOWN,
+		D3DPOOL_MANAGED, D3DX_DEFAULT, D3DX_DEFAULT, 0, NULL, NULL, ppTexture);
+}
+
+HRESULT D3DXCreateTextureFromFileInMemoryEx(LPDIRECT3DDEVICE9 pDevice, const void* pSrcData, UINT SrcDataSize, UINT Width, UINT Height,
+	UINT MipLevels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, DWORD Filter, DWORD MipFilter, D3DCOLOR ColorKey,
+	D3DXIMAGE_INFO* pSrcInfo, PALETTEENTRY* pPalette, LPDIRECT3DTEXTURE9* ppTexture) {
+	if (pSrcData == NULL || SrcDataSize == 0) return D3DERR_INVALIDCALL;
+
+	//caller memory is only read: it is never adopted
+	return createTexture(pDevice, (BYTE*) pSrcData, SrcDataSize, NULL, Width, Height, MipLevels, Usage, Format, Pool, Filter, MipFilter,
+		ColorKey, pSrcInfo, ppTexture);
+}
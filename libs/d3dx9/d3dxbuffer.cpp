@@ -0,0 +1,36 @@
+#include "d3dxbuffer.hpp"
+#include <new>
+
+D3DXBuffer::D3DXBuffer(DWORD size) : data(size) {}
+
+HRESULT D3DXBuffer::QueryInterface(REFIID riid, void** ppvObject) {
+	if (ppvObject == NULL) return E_POINTER;
+
+	*ppvObject = NULL;
+	return E_NOINTERFACE;
+}
+
+ULONG D3DXBuffer::AddRef() {
+	return ++this->references;
+}
+
+ULONG D3DXBuffer::Release() {
+	ULONG references = --this->references;
+	if (references == 0) delete this;
+	return references;
+}
+
+LPVOID D3DXBuffer::GetBufferPointer() {
+	return this->data.data();
+}
+
+DWORD D3DXBuffer::GetBufferSize() {
+	return this->data.size();
+}
+
+HRESULT D3DXCreateBuffer(DWORD NumBytes, LPD3DXBUFFER* ppBuffer) {
+	if (ppBuffer == NULL) return D3DERR_INVALIDCALL;
+
+	*ppBuffer = new (std::nothrow) D3DXBuffer(NumBytes);
+	return *ppBuffer != NULL ? D3D_OK : E_OUTOFMEMORY;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <vector>
+#include <windows.h>
+#include <d3dx9core.h>
+
+class D3DXBuffer final : public ID3DXBuffer {
+	private:std::vector<BYTE> data;
+	private:ULONG references = 1;
+
+	public:D3DXBuffer(DWORD size);
+
+	public:HRESULT QueryInterface(REFIID riid, void** ppvObject) override;
+	public:ULONG AddRef() override;
+	public:ULONG Release() override;
+
+	public:LPVOID GetBufferPointer() override;
+	public:DWORD GetBufferSize() override;
+};
@@ -0,0 +1,256 @@
+#include "d3dxmesh.hpp"
+#include "d3dxbuffer.hpp"
+#include "meshoptimizer.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+
+D3DXMesh::D3DXMesh(DWORD NumFaces, DWORD NumVertices, DWORD Options, DWORD FVF, LPDIRECT3DDEVICE9 pD3DDevice) :
+	options(Options), fvf(FVF), stride(D3DXGetFVFVertexSize(FVF)), faces(NumFaces), vertexCount(NumVertices), device(pD3DDevice),
+	vertices(NumVertices * D3DXGetFVFVertexSize(FVF)), indices(NumFaces * 3 * ((Options & D3DXMESH_32BIT) ? 4 : 2)), attributes(NumFaces, 0) {
+	if (this->device != NULL) this->device->AddRef();
+}
+
+HRESULT D3DXMesh::QueryInterface(REFIID riid, void** ppvObject) {
+	if (ppvObject == NULL) return E_POINTER;
+
+	*ppvObject = NULL;
+	return E_NOINTERFACE;
+}
+
+ULONG D3DXMesh::AddRef() {
+	return ++this->references;
+}
+
+ULONG D3DXMesh::Release() {
+	ULONG references = --this->references;
+
+	if (references == 0) {
+		if (this->device != NULL) this->device->Release();
+		delete this;
+	}
+
+	return references;
+}
+
+DWORD D3DXMesh::GetNumFaces() {
+	return this->faces;
+}
+
+DWORD D3DXMesh::GetNumVertices() {
+	return this->vertexCount;
+}
+
+DWORD D3DXMesh::GetFVF() {
+	return this->fvf;
+}
+
+DWORD D3DXMesh::GetNumBytesPerVertex() {
+	return this->stride;
+}
+
+DWORD D3DXMesh::GetOptions() {
+	return this->options;
+}
+
+HRESULT D3DXMesh::GetDevice(LPDIRECT3DDEVICE9* ppDevice) {
+	if (ppDevice == NULL) return D3DERR_INVALIDCALL;
+
+	*ppDevice = this->device;
+	if (this->device != NULL) this->device->AddRef();
+	return D3D_OK;
+}
+
+//system memory: locking hands out the storage itself
+HRESULT D3DXMesh::LockVertexBuffer(DWORD Flags, LPVOID* ppData) {
+	if (ppData == NULL) return D3DERR_INVALIDCALL;
+
+	*ppData = this->vertices.data();
+	return D3D_OK;
+}
+
+HRESULT D3DXMesh::UnlockVertexBuffer() {
+	return D3D_OK;
+}
+
+HRESULT D3DXMesh::LockIndexBuffer(DWORD Flags, LPVOID* ppData) {
+	if (ppData == NULL) return D3DERR_INVALIDCALL;
+
+	*ppData = this->indices.data();
+	return D3D_OK;
+}
+
+HRESULT D3DXMesh::UnlockIndexBuffer() {
+	return D3D_OK;
+}
+
+HRESULT D3DXMesh::LockAttributeBuffer(DWORD Flags, DWORD** ppData) {
+	if (ppData == NULL) return D3DERR_INVALIDCALL;
+
+	*ppData = this->attributes.data();
+	return D3D_OK;
+}
+
+HRESULT D3DXMesh::UnlockAttributeBuffer() {
+	return D3D_OK;
+}
+
+HRESULT D3DXMesh::GetAttributeTable(D3DXATTRIBUTERANGE* pAttribTable, DWORD* pAttribTableSize) {
+	if (pAttribTableSize == NULL) return D3DERR_INVALIDCALL;
+
+	if (pAttribTable != NULL) std::copy(this->table.begin(), this->table.end(), pAttribTable);
+	*pAttribTableSize = this->table.size();
+	return D3D_OK;
+}
+
+HRESULT D3DXMesh::SetAttributeTable(const D3DXATTRIBUTERANGE* pAttribTable, DWORD cAttribTableSize) {
+	if (pAttribTable == NULL && cAttribTableSize > 0) return D3DERR_INVALIDCALL;
+
+	this->table.assign(pAttribTable, pAttribTable + cAttribTableSize);
+	return D3D_OK;
+}
+
+DWORD D3DXMesh::index(DWORD i) const {
+	if (this->options & D3DXMESH_32BIT) return ((const uint32_t*) this->indices.data())[i];
+	return ((const uint16_t*) this->indices.data())[i];
+}
+
+void D3DXMesh::setIndex(DWORD i, DWORD value) {
+	if (this->options & D3DXMESH_32BIT) ((uint32_t*) this->indices.data())[i] = value;
+	else ((uint16_t*) this->indices.data())[i] = value;
+}
+
+bool D3DXMesh::hasPositions() const {
+	DWORD position = this->fvf & D3DFVF_POSITION_MASK;
+	return position != 0 && position != D3DFVF_XYZRHW;
+}
+
+/**
+ * Attribute sort, then Tipsify + overdraw ordering inside every
+ * attribute range, then vertices in order of first use. Degenerate
+ * faces are kept; COMPACT only drops unreferenced vertices.
+ */
+HRESULT D3DXMesh::OptimizeInplace(DWORD Flags, const DWORD* pAdjacencyIn, DWORD* pAdjacencyOut, DWORD* pFaceRemap, LPD3DXBUFFER* ppVertexRemap) {
+	bool reorder = Flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER);
+	bool sort = reorder || (Flags & D3DXMESHOPT_ATTRSORT);
+	bool compact = sort || (Flags & D3DXMESHOPT_COMPACT);
+
+	if (pAdjacencyOut != NULL && pAdjacencyIn == NULL) return D3DERR_INVALIDCALL;
+
+	std::vector<DWORD> current(this->faces * 3);
+	for (DWORD i = 0; i < this->faces * 3; i++) {
+		current[i] = this->index(i);
+		if (current[i] >= this->vertexCount) return D3DERR_INVALIDCALL;
+	}
+
+	//--- faces
+	std::vector<DWORD> order(this->faces);
+	std::iota(order.begin(), order.end(), 0);
+
+	if (sort) {
+		std::stable_sort(order.begin(), order.end(), [this](DWORD a, DWORD b) {
+			return this->attributes[a] < this->attributes[b];
+		});
+	}
+
+	if (reorder) {
+		std::vector<DWORD> rangeIndices;
+		std::vector<UINT> clusters;
+
+		for (DWORD start = 0; start < this->faces;) {
+			DWORD end = start;
+			while (end < this->faces && this->attributes[order[end]] == this->attributes[order[start]]) end++;
+
+			rangeIndices.resize((end - start) * 3);
+			for (DWORD f = start; f < end; f++) {
+				std::copy_n(&current[order[f] * 3], 3, &rangeIndices[(f - start) * 3]);
+			}
+
+			std::vector<DWORD> local = MeshOptimizer::orderFaces(rangeIndices.data(), end - start, this->vertexCount, MeshOptimizer::CACHE_SIZE, clusters);
+			if (this->hasPositions()) {
+				MeshOptimizer::splitClusters(rangeIndices.data(), local, this->vertexCount, MeshOptimizer::CACHE_SIZE, clusters);
+				MeshOptimizer::sortClusters(rangeIndices.data(), this->vertices.data(), this->stride, local, clusters);
+			}
+
+			std::vector<DWORD> range(order.begin() + start, order.begin() + end);
+			for (DWORD f = start; f < end; f++) order[f] = range[local[f - start]];
+			start = end;
+		}
+	}
+
+	std::vector<DWORD> inverse(this->faces);
+	for (DWORD f = 0; f < this->faces; f++) inverse[order[f]] = f;
+
+	if (pAdjacencyOut != NULL) {
+		std::vector<DWORD> adjacency(this->faces * 3);
+		for (DWORD f = 0; f < this->faces; f++) {
+			for (int k = 0; k < 3; k++) {
+				DWORD neighbour = pAdjacencyIn[order[f] * 3 + k];
+				adjacency[f * 3 + k] = neighbour < this->faces ? inverse[neighbour] : 0xffffffff;
+			}
+		}
+		std::copy(adjacency.begin(), adjacency.end(), pAdjacencyOut);
+	}
+
+	std::vector<DWORD> faceIndices(this->faces * 3);
+	std::vector<DWORD> faceAttributes(this->faces);
+	for (DWORD f = 0; f < this->faces; f++) {
+		std::copy_n(&current[order[f] * 3], 3, &faceIndices[f * 3]);
+		faceAttributes[f] = this->attributes[order[f]];
+	}
+	this->attributes.swap(faceAttributes);
+	if (pFaceRemap != NULL) std::copy(order.begin(), order.end(), pFaceRemap);
+
+	//--- vertices
+	std::vector<DWORD> vertexOrder(this->vertexCount);
+	std::iota(vertexOrder.begin(), vertexOrder.end(), 0);
+
+	if (compact && !(Flags & D3DXMESHOPT_IGNOREVERTS)) {
+		UINT used = 0;
+		vertexOrder = MeshOptimizer::orderVertices(faceIndices.data(), this->faces, this->vertexCount, used);
+		vertexOrder.resize(used);
+
+		std::vector<DWORD> remap(this->vertexCount, 0xffffffff);
+		std::vector<BYTE> data(used * this->stride);
+		for (DWORD v = 0; v < used; v++) {
+			remap[vertexOrder[v]] = v;
+			memcpy(&data[v * this->stride], &this->vertices[vertexOrder[v] * this->stride], this->stride);
+		}
+
+		for (DWORD& i : faceIndices) i = remap[i];
+		this->vertices.swap(data);
+		this->vertexCount = used;
+	}
+
+	for (DWORD i = 0; i < this->faces * 3; i++) this->setIndex(i, faceIndices[i]);
+
+	if (ppVertexRemap != NULL) {
+		HRESULT result = D3DXCreateBuffer(vertexOrder.size() * sizeof(DWORD), ppVertexRemap);
+		if (FAILED(result)) return result;
+		memcpy((*ppVertexRemap)->GetBufferPointer(), vertexOrder.data(), vertexOrder.size() * sizeof(DWORD));
+	}
+
+	//--- attribute table, one range per attribute id
+	if (sort) {
+		this->table.clear();
+
+		for (DWORD start = 0; start < this->faces;) {
+			DWORD end = start;
+			DWORD low = 0xffffffff, high = 0;
+
+			while (end < this->faces && this->attributes[end] == this->attributes[start]) {
+				for (int k = 0; k < 3; k++) {
+					low = std::min(low, faceIndices[end * 3 + k]);
+					high = std::max(high, faceIndices[end * 3 + k]);
+				}
+				end++;
+			}
+
+			this->table.push_back({this->attributes[start], start, end - start, low, high - low + 1});
+			start = end;
+		}
+	}
+
+	return D3D_OK;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <windows.h>
+#include <d3dx9mesh.h>
+
+/**
+ * ID3DXMesh kept in system memory: vertices, indices (16 or 32-bit,
+ * D3DXMESH_32BIT) and one attribute id per face.
+ */
+class D3DXMesh final : public ID3DXMesh {
+	private:ULONG references = 1;
+	private:DWORD options;
+	private:DWORD fvf;
+	private:DWORD stride;
+	private:DWORD faces;
+	private:DWORD vertexCount;
+	private:LPDIRECT3DDEVICE9 device;
+
+	private:std::vector<BYTE> vertices;
+	private:std::vector<BYTE> indices;
+	private:std::vector<DWORD> attributes;
+	private:std::vector<D3DXATTRIBUTERANGE> table;
+
+	public:D3DXMesh(DWORD NumFaces, DWORD NumVertices, DWORD Options, DWORD FVF, LPDIRECT3DDEVICE9 pD3DDevice);
+
+	public:HRESULT QueryInterface(REFIID riid, void** ppvObject) override;
+	public:ULONG AddRef() override;
+	public:ULONG Release() override;
+
+	public:DWORD GetNumFaces() override;
+	public:DWORD GetNumVertices() override;
+	public:DWORD GetFVF() override;
+	public:DWORD GetNumBytesPerVertex() override;
+	public:DWORD GetOptions() override;
+	public:HRESULT GetDevice(LPDIRECT3DDEVICE9* ppDevice) override;
+	public:HRESULT LockVertexBuffer(DWORD Flags, LPVOID* ppData) override;
+	public:HRESULT UnlockVertexBuffer() override;
+	public:HRESULT LockIndexBuffer(DWORD Flags, LPVOID* ppData) override;
+	public:HRESULT UnlockIndexBuffer() override;
+	public:HRESULT GetAttributeTable(D3DXATTRIBUTERANGE* pAttribTable, DWORD* pAttribTableSize) override;
+
+	public:HRESULT LockAttributeBuffer(DWORD Flags, DWORD** ppData) override;
+	public:HRESULT UnlockAttributeBuffer() override;
+	public:HRESULT OptimizeInplace(DWORD Flags, const DWORD* pAdjacencyIn, DWORD* pAdjacencyOut, DWORD* pFaceRemap, LPD3DXBUFFER* ppVertexRemap) override;
+	public:HRESULT SetAttributeTable(const D3DXATTRIBUTERANGE* pAttribTable, DWORD cAttribTableSize) override;
+
+	private:DWORD index(DWORD i) const;
+	private:void setIndex(DWORD i, DWORD value);
+	private:bool hasPositions() const;
+};
@@ -0,0 +1,115 @@
+#include "ddsfile.hpp"
+#include <cstdint>
+#include <cstring>
+#include <format/PixelFormat.hpp>
+
+/**
+ * DDS_HEADER and DDS_PIXELFORMAT (DWORDs are 32-bit in the file).
+ */
+struct DDSPixelFormat {
+	uint32_t size;
+	uint32_t flags;
+	uint32_t fourCC;
+	uint32_t bitCount;
+	uint32_t masks[4]; //R, G, B, A
+};
+
+struct DDSHeader {
+	uint32_t size;
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t pitchOrLinearSize;
+	uint32_t depth;
+	uint32_t mipMapCount;
+	uint32_t reserved1[11];
+	DDSPixelFormat format;
+	uint32_t caps;
+	uint32_t caps2;
+	uint32_t caps3;
+	uint32_t caps4;
+	uint32_t reserved2;
+};
+static_assert(sizeof(DDSHeader) == 124);
+
+#define DDPF_ALPHAPIXELS 0x00001
+#define DDPF_ALPHA       0x00002
+#define DDPF_FOURCC      0x00004
+#define DDPF_RGB         0x00040
+#define DDPF_LUMINANCE   0x20000
+#define DDSD_MIPMAPCOUNT 0x20000
+#define DDSCAPS2_CUBEMAP 0x00200
+#define DDSCAPS2_VOLUME  0x200000
+
+static D3DFORMAT formatOf(const DDSPixelFormat& pf) {
+	if (pf.flags & DDPF_FOURCC) {
+		//D3D9 writes its own D3DFORMAT values (e.g. 113 for A16B16G16R16F) as FourCCs
+		D3DFORMAT format = (D3DFORMAT) pf.fourCC;
+		return PixelFormat::bits(format) != 0 ? format : D3DFMT_UNKNOWN;
+	}
+
+	struct Layout {
+		uint32_t flags;
+		uint32_t bitCount;
+		uint32_t masks[4];
+		D3DFORMAT format;
+	};
+	static constexpr const Layout layouts[] = {
+		{DDPF_RGB | DDPF_ALPHAPIXELS, 32, {0xFF0000, 0xFF00, 0xFF, 0xFF000000}, D3DFMT_A8R8G8B8},
+		{DDPF_RGB, 32, {0xFF0000, 0xFF00, 0xFF, 0}, D3DFMT_X8R8G8B8},
+		{DDPF_RGB | DDPF_ALPHAPIXELS, 32, {0xFF, 0xFF00, 0xFF0000, 0xFF000000}, D3DFMT_A8B8G8R8},
+		{DDPF_RGB, 32, {0xFF, 0xFF00, 0xFF0000, 0}, D3DFMT_X8B8G8R8},
+		{DDPF_RGB, 24, {0xFF0000, 0xFF00, 0xFF, 0}, D3DFMT_R8G8B8},
+		{DDPF_RGB, 16, {0xF800, 0x07E0, 0x1F, 0}, D3DFMT_R5G6B5},
+		{DDPF_RGB | DDPF_ALPHAPIXELS, 16, {0x7C00, 0x03E0, 0x1F, 0x8000}, D3DFMT_A1R5G5B5},
+		{DDPF_RGB, 16, {0x7C00, 0x03E0, 0x1F, 0}, D3DFMT_X1R5G5B5},
+		{DDPF_RGB | DDPF_ALPHAPIXELS, 16, {0x0F00, 0xF0, 0x0F, 0xF000}, D3DFMT_A4R4G4B4},
+		{DDPF_RGB, 16, {0x0F00, 0xF0, 0x0F, 0}, D3DFMT_X4R4G4B4},
+		{DDPF_LUMINANCE, 8, {0xFF, 0, 0, 0}, D3DFMT_L8},
+		{DDPF_LUMINANCE | DDPF_ALPHAPIXELS, 16, {0xFF, 0, 0, 0xFF00}, D3DFMT_A8L8},
+		{DDPF_ALPHA, 8, {0, 0, 0, 0xFF}, D3DFMT_A8}
+	};
+
+	uint32_t flags = pf.flags & (DDPF_RGB | DDPF_ALPHAPIXELS | DDPF_LUMINANCE | DDPF_ALPHA);
+	for (const Layout& layout : layouts) {
+		if (layout.flags == flags && layout.bitCount == pf.bitCount
+			&& memcmp(layout.masks, pf.masks, sizeof(layout.masks)) == 0) {
+			return layout.format;
+		}
+	}
+	return D3DFMT_UNKNOWN;
+}
+
+bool DDSFile::parse(BYTE* file, size_t size, DDSFile& dds) {
+	DDSHeader header;
+
+	if (size < 4 + sizeof(header) || memcmp(file, "DDS ", 4) != 0) return false;
+	memcpy(&header, file + 4, sizeof(header));
+
+	if (header.size != sizeof(header) || header.format.size != sizeof(DDSPixelFormat)) return false;
+	if (header.caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)) return false;
+	if (header.width == 0 || header.height == 0) return false;
+
+	dds.format = formatOf(header.format);
+	dds.width = header.width;
+	dds.height = header.height;
+	dds.levels = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount > 0 ? header.mipMapCount : 1;
+	dds.data = file + 4 + sizeof(header);
+	if (dds.format == D3DFMT_UNKNOWN || dds.levels > PixelFormat::levels(dds.width, dds.height)) return false;
+
+	//every level must be there
+	return dds.level(dds.levels) <= file + size;
+}
+
+BYTE* DDSFile::level(UINT level) const {
+	BYTE* bits = this->data;
+
+	for (UINT i = 0; i < level; i++) {
+		bits += PixelFormat::size(this->format, PixelFormat::mipSize(this->width, i), PixelFormat::mipSize(this->height, i));
+	}
+	return bits;
+}
+
+UINT DDSFile::pitch(UINT level) const {
+	return PixelFormat::pitch(this->format, PixelFormat::mipSize(this->width, level));
+}
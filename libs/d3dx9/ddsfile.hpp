@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <windows.h>
+#include <d3d9types.h>
+
+/**
+ * A DDS file in memory: 2D textures in D3D9 formats. Levels follow
+ * each other without padding, so each one can be used in place.
+ */
+class DDSFile {
+	public:D3DFORMAT format;
+	public:UINT width;
+	public:UINT height;
+	public:UINT levels;
+	public:BYTE* data;
+
+	/**
+	 * False if "file" is not a DDS this loader reads (DX10 headers,
+	 * cube maps, volumes, unknown pixel formats, truncated data).
+	 */
+	public:static bool parse(BYTE* file, size_t size, DDSFile& dds);
+
+	public:BYTE* level(UINT level) const;
+	public:UINT pitch(UINT level) const;
+};
@@ -0,0 +1,40 @@
+#include "filemapping.hpp"
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+std::shared_ptr<BYTE> FileMapping::map(const char* path, size_t& size) {
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return NULL;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+		close(fd);
+		return NULL;
+	}
+
+	size = info.st_size;
+	void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return NULL;
+
+	return std::shared_ptr<BYTE>((BYTE*) data, [size](BYTE* data) { munmap(data, size); });
+}
+
+void FileMapping::prefault(const BYTE* data, size_t size) {
+	if (size == 0) return;
+
+	//page-aligned start, as madvise() wants
+	size_t page = sysconf(_SC_PAGESIZE);
+	uintptr_t begin = (uintptr_t) data & ~(page - 1), end = (uintptr_t) data + size;
+
+	#ifdef MADV_POPULATE_READ
+		if (madvise((void*) begin, end - begin, MADV_POPULATE_READ) == 0) return;
+	#endif
+
+	//older kernels: touch every page
+	volatile BYTE sink = 0;
+	for (uintptr_t address = begin; address < end; address += page) sink = sink + *(const volatile BYTE*) address;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <windows.h>
+
+class FileMapping {
+	/**
+	 * Private writable mapping of a whole file, unmapped when the
+	 * last reference goes away. Writes copy the touched pages and
+	 * never reach the file. Pages are read on first access. NULL if the file can't be mapped.
+	 */
+	public:static std::shared_ptr<BYTE> map(const char* path, size_t& size);
+
+	/**
+	 * Reads a mapped range in now rather than on first access.
+	 */
+	public:static void prefault(const BYTE* data, size_t size);
+};
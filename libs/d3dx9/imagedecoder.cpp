@@ -0,0 +1,302 @@
+#include "imagedecoder.hpp"
+#include <cstring>
+#include <algorithm>
+#include <simd/ColorConvert.hpp>
+#include <thread/WorkerPool.hpp>
+
+static uint16_t u16(const BYTE* p) {
+	return p[0] | p[1] << 8;
+}
+
+static uint32_t u32(const BYTE* p) {
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint32_t be16(const BYTE* p) {
+	return p[0] << 8 | p[1];
+}
+
+static uint32_t be32(const BYTE* p) {
+	return (uint32_t) p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+/**
+ * Rows converted by one worker at a time (~16K pixels)
+ */
+static size_t rowGrain(UINT width) {
+	return std::max<size_t>(1, 16384 / width);
+}
+
+static bool isPNG(const BYTE* data, size_t size) {
+	return size >= 24 && memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0 && memcmp(data + 12, "IHDR", 4) == 0;
+}
+
+static bool isJPG(const BYTE* data, size_t size) {
+	return size >= 4 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
+//--- BMP
+
+struct BMPHeader {
+	UINT width;
+	UINT height;
+	UINT bits;
+	bool topDown;
+	const BYTE* pixels;
+	size_t stride;
+	uint32_t palette[256];
+};
+
+static bool readBMP(const BYTE* data, size_t size, BMPHeader& bmp) {
+	if (size < 54 || data[0] != 'B' || data[1] != 'M') return false;
+
+	uint32_t offset = u32(data + 10), headerSize = u32(data + 14);
+	int32_t width = (int32_t) u32(data + 18), height = (int32_t) u32(data + 22);
+	uint32_t compression = u32(data + 30), colors = u32(data + 46);
+
+	bmp.bits = u16(data + 28);
+	if (headerSize < 40 || width <= 0 || height == 0 || height == INT32_MIN) return false;
+	if (bmp.bits != 8 && bmp.bits != 24 && bmp.bits != 32) return false;
+	//BI_RGB, or BI_BITFIELDS with the usual 32-bit masks
+	if (compression != 0 && !(compression == 3 && bmp.bits == 32)) return false;
+
+	bmp.width = width;
+	bmp.height = height < 0 ? -height : height;
+	bmp.topDown = height < 0;
+	bmp.stride = ((size_t) bmp.width * bmp.bits + 31) / 32 * 4;
+	bmp.pixels = data + offset;
+	if (offset > size || bmp.stride * bmp.height > size - offset) return false;
+
+	if (bmp.bits == 8) {
+		const BYTE* entries = data + 14 + headerSize;
+		colors = colors == 0 || colors > 256 ? 256 : colors;
+		if (14 + headerSize + colors * 4 > size) return false;
+
+		memset(bmp.palette, 0, sizeof(bmp.palette));
+		for (uint32_t i = 0; i < colors; i++) bmp.palette[i] = 0xFF000000 | (u32(entries + i * 4) & 0xFFFFFF);
+	}
+	return true;
+}
+
+bool ImageDecoder::decodeBMP(const BYTE* data, size_t size, Image& image) {
+	BMPHeader bmp;
+	if (!readBMP(data, size, bmp)) return false;
+
+	image.width = bmp.width;
+	image.height = bmp.height;
+	image.pixels.resize((size_t) bmp.width * bmp.height);
+
+	WorkerPool::shared().parallelFor(bmp.height, rowGrain(bmp.width), [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; y++) {
+			const BYTE* src = bmp.pixels + (bmp.topDown ? y : bmp.height - 1 - y) * bmp.stride;
+			uint32_t* dst = image.pixels.data() + y * bmp.width;
+
+			//32-bit BMPs are read as X8R8G8B8, like D3DX does
+			if (bmp.bits == 32) ColorConvert::swizzle32(dst, (const uint32_t*) src, bmp.width, false, true);
+			else if (bmp.bits == 24) ColorConvert::expand24(dst, src, bmp.width, false);
+			else ColorConvert::expand8(dst, src, bmp.width, bmp.palette);
+		}
+	});
+	return true;
+}
+
+//--- TGA
+
+struct TGAHeader {
+	UINT width;
+	UINT height;
+	UINT bits;
+	bool alpha;
+	bool rle;
+	bool topDown;
+	size_t offset;
+};
+
+static bool readTGA(const BYTE* data, size_t size, TGAHeader& tga) {
+	if (size < 18) return false;
+
+	UINT type = data[2], mapType = data[1];
+	if (mapType > 1 || (type != 2 && type != 3 && type != 10 && type != 11)) return false;
+
+	tga.width = u16(data + 12);
+	tga.height = u16(data + 14);
+	tga.bits = data[16];
+	tga.alpha = (data[17] & 0x0F) != 0 && tga.bits == 32;
+	tga.rle = type >= 10;
+	tga.topDown = (data[17] & 0x20) != 0;
+	//skip the image ID and any (unused) color map
+	tga.offset = 18 + data[0] + (mapType == 1 ? u16(data + 5) * ((data[7] + 7) / 8) : 0);
+
+	bool gray = type == 3 || type == 11;
+	if (gray ? tga.bits != 8 : tga.bits != 24 && tga.bits != 32) return false;
+	return tga.width > 0 && tga.height > 0 && tga.offset <= size;
+}
+
+/**
+ * RLE packets into "total" bytes at "out", or only checks that they
+ * are all in the file when "out" is NULL. Packets may cross rows, so
+ * this is sequential.
+ */
+static bool unpackTGA(const BYTE* src, const BYTE* srcEnd, size_t bytes, size_t total, BYTE* out) {
+	for (size_t done = 0; done < total;) {
+		if (src >= srcEnd) return false;
+		size_t count = ((*src & 0x7F) + 1) * bytes;
+		bool repeat = (*src++ & 0x80) != 0;
+
+		if (done + count > total || src + (repeat ? bytes : count) > srcEnd) return false;
+		if (out != NULL && repeat) {
+			for (size_t i = 0; i < count; i += bytes) memcpy(out + done + i, src, bytes);
+		} else if (out != NULL) {
+			memcpy(out + done, src, count);
+		}
+		src += repeat ? bytes : count;
+		done += count;
+	}
+	return true;
+}
+
+bool ImageDecoder::decodeTGA(const BYTE* data, size_t size, Image& image) {
+	TGAHeader tga;
+	if (!readTGA(data, size, tga)) return false;
+
+	size_t bytes = tga.bits / 8, stride = (size_t) tga.width * bytes, total = stride * tga.height;
+	const BYTE* pixels = data + tga.offset;
+	std::vector<BYTE> unpacked;
+
+	if (tga.rle) {
+		unpacked.resize(total);
+		if (!unpackTGA(pixels, data + size, bytes, total, unpacked.data())) return false;
+		pixels = unpacked.data();
+	} else if (total > size - tga.offset) {
+		return false;
+	}
+
+	uint32_t gray[256];
+	for (uint32_t i = 0; i < 256; i++) gray[i] = 0xFF000000 | i * 0x010101;
+
+	image.width = tga.width;
+	image.height = tga.height;
+	image.pixels.resize((size_t) tga.width * tga.height);
+
+	WorkerPool::shared().parallelFor(tga.height, rowGrain(tga.width), [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; y++) {
+			const BYTE* src = pixels + (tga.topDown ? y : tga.height - 1 - y) * stride;
+			uint32_t* dst = image.pixels.data() + y * tga.width;
+
+			if (tga.bits == 32) ColorConvert::swizzle32(dst, (const uint32_t*) src, tga.width, false, !tga.alpha);
+			else if (tga.bits == 24) ColorConvert::expand24(dst, src, tga.width, false);
+			else ColorConvert::expand8(dst, src, tga.width, gray);
+		}
+	});
+	return true;
+}
+
+//--- PNG, JPG
+
+bool ImageDecoder::decodePixbuf(const BYTE* data, size_t size, Image& image) {
+	GdkPixbufLoader* loader = gdk_pixbuf_loader_new();
+	GError* error = NULL;
+
+	bool loaded = gdk_pixbuf_loader_write(loader, data, size, &error);
+	loaded = gdk_pixbuf_loader_close(loader, loaded ? &error : NULL) && loaded;
+	if (error != NULL) g_error_free(error);
+
+	GdkPixbuf* pixbuf = loaded ? gdk_pixbuf_loader_get_pixbuf(loader) : NULL;
+	if (pixbuf == NULL || gdk_pixbuf_get_bits_per_sample(pixbuf) != 8) {
+		g_object_unref(loader);
+		return false;
+	}
+
+	UINT channels = gdk_pixbuf_get_n_channels(pixbuf);
+	size_t stride = gdk_pixbuf_get_rowstride(pixbuf);
+	const guint8* pixels = gdk_pixbuf_read_pixels(pixbuf);
+
+	image.width = gdk_pixbuf_get_width(pixbuf);
+	image.height = gdk_pixbuf_get_height(pixbuf);
+	image.pixels.resize((size_t) image.width * image.height);
+
+	//gdk-pixbuf rows are R, G, B(, A) bytes
+	WorkerPool::shared().parallelFor(image.height, rowGrain(image.width), [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; y++) {
+			uint32_t* dst = image.pixels.data() + y * image.width;
+
+			if (channels == 4) ColorConvert::swizzle32(dst, (const uint32_t*) (pixels + y * stride), image.width, true, false);
+			else ColorConvert::expand24(dst, pixels + y * stride, image.width, true);
+		}
+	});
+
+	g_object_unref(loader);
+	return true;
+}
+
+//---
+
+bool ImageDecoder::decode(const BYTE* data, size_t size, Image& image) {
+	if (size >= 2 && data[0] == 'B' && data[1] == 'M') return ImageDecoder::decodeBMP(data, size, image);
+	if (isPNG(data, size) || isJPG(data, size)) return ImageDecoder::decodePixbuf(data, size, image);
+
+	//TGA has no signature: it is whatever has a valid TGA header
+	return ImageDecoder::decodeTGA(data, size, image);
+}
+
+bool ImageDecoder::complete(const BYTE* data, size_t size) {
+	BMPHeader bmp;
+	if (size >= 2 && data[0] == 'B' && data[1] == 'M') return readBMP(data, size, bmp);
+	if (isPNG(data, size) || isJPG(data, size)) return false;
+
+	TGAHeader tga;
+	if (!readTGA(data, size, tga)) return false;
+
+	size_t bytes = tga.bits / 8, total = (size_t) tga.width * bytes * tga.height;
+	return tga.rle ? unpackTGA(data + tga.offset, data + size, bytes, total, NULL) : total <= size - tga.offset;
+}
+
+bool ImageDecoder::info(const BYTE* data, size_t size, D3DXIMAGE_INFO& info) {
+	info.Depth = 1;
+	info.MipLevels = 1;
+	info.ResourceType = D3DRTYPE_TEXTURE;
+
+	BMPHeader bmp;
+	if (readBMP(data, size, bmp)) {
+		info.Width = bmp.width;
+		info.Height = bmp.height;
+		info.Format = bmp.bits == 32 ? D3DFMT_X8R8G8B8 : bmp.bits == 24 ? D3DFMT_R8G8B8 : D3DFMT_P8;
+		info.ImageFileFormat = D3DXIFF_BMP;
+		return true;
+	}
+
+	if (isPNG(data, size)) {
+		//IHDR: width, height, bit depth, color type
+		UINT colorType = data[25];
+		info.Width = be32(data + 16);
+		info.Height = be32(data + 20);
+		info.Format = colorType == 6 ? D3DFMT_A8R8G8B8 : colorType == 4 ? D3DFMT_A8L8 : colorType == 0 ? D3DFMT_L8 : D3DFMT_X8R8G8B8;
+		info.ImageFileFormat = D3DXIFF_PNG;
+		return info.Width > 0 && info.Height > 0;
+	}
+
+	if (isJPG(data, size)) {
+		//the size is in the first start-of-frame segment (SOF0-SOF15 but DHT, JPG, DAC)
+		for (size_t i = 2; i + 10 <= size && data[i] == 0xFF; i += 2 + be16(data + i + 2)) {
+			BYTE marker = data[i + 1];
+			if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+				info.Height = be16(data + i + 5);
+				info.Width = be16(data + i + 7);
+				info.Format = data[i + 9] == 1 ? D3DFMT_L8 : D3DFMT_X8R8G8B8;
+				info.ImageFileFormat = D3DXIFF_JPG;
+				return info.Width > 0 && info.Height > 0;
+			}
+		}
+		return false;
+	}
+
+	TGAHeader tga;
+	if (readTGA(data, size, tga)) {
+		info.Width = tga.width;
+		info.Height = tga.height;
+		info.Format = tga.bits == 32 ? (tga.alpha ? D3DFMT_A8R8G8B8 : D3DFMT_X8R8G8B8) : tga.bits == 24 ? D3DFMT_R8G8B8 : D3DFMT_L8;
+		info.ImageFileFormat = D3DXIFF_TGA;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <windows.h>
+#include <d3dx9tex.h>
+
+/**
+ * A decoded image: A8R8G8B8 pixels, top row first.
+ */
+struct Image {
+	UINT width = 0;
+	UINT height = 0;
+	std::vector<uint32_t> pixels;
+};
+
+/**
+ * BMP, TGA, PNG and JPG (DDS files are read by DDSFile).
+ *
+ * BMP and TGA are read here; PNG and JPG are decompressed by
+ * gdk-pixbuf. Converting rows to A8R8G8B8 runs on the worker pool.
+ */
+class ImageDecoder {
+	/**
+	 * Size and closest D3DFORMAT from the header only.
+	 */
+	public:static bool info(const BYTE* data, size_t size, D3DXIMAGE_INFO& info);
+
+	public:static bool decode(const BYTE* data, size_t size, Image& image);
+
+	/**
+	 * Whether decode() is sure to succeed, without decoding: BMP and
+	 * TGA whose pixels are all in the file. False for PNG and JPG,
+	 * whose compressed data is only checked by decompressing it.
+	 */
+	public:static bool complete(const BYTE* data, size_t size);
+
+	private:static bool decodeBMP(const BYTE* data, size_t size, Image& image);
+	private:static bool decodeTGA(const BYTE* data, size_t size, Image& image);
+	private:static bool decodePixbuf(const BYTE* data, size_t size, Image& image);
+};
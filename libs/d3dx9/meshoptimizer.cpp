@@ -0,0 +1,200 @@
+#include "meshoptimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <d3dx9math.h>
+
+std::vector<DWORD> MeshOptimizer::orderFaces(const DWORD* indices, UINT faces, UINT vertices, UINT cacheSize, std::vector<UINT>& clusters) {
+	//vertex -> faces, as offsets into one array
+	std::vector<UINT> live(vertices, 0), offsets(vertices + 1, 0), adjacency(faces * 3);
+	for (UINT i = 0; i < faces * 3; i++) live[indices[i]]++;
+	for (UINT v = 0; v < vertices; v++) offsets[v + 1] = offsets[v] + live[v];
+
+	std::vector<UINT> fill(offsets.begin(), offsets.end() - 1);
+	for (UINT i = 0; i < faces * 3; i++) adjacency[fill[indices[i]]++] = i / 3;
+
+	std::vector<UINT> stamp(vertices, 0);
+	std::vector<bool> emitted(faces, false);
+	std::vector<DWORD> order, deadEnd, candidates;
+	order.reserve(faces);
+
+	UINT time = cacheSize + 1;
+	UINT cursor = 0;
+	int64_t fanning = -1;
+
+	clusters.clear();
+	while (cursor < vertices && live[cursor] == 0) cursor++;
+	if (cursor < vertices) {
+		fanning = cursor;
+		clusters.push_back(0);
+	}
+
+	while (fanning >= 0) {
+		candidates.clear();
+
+		//emit every face around the fanning vertex
+		for (UINT a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+			UINT face = adjacency[a];
+			if (emitted[face]) continue;
+
+			for (int k = 0; k < 3; k++) {
+				DWORD v = indices[face * 3 + k];
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+
+				if (time - stamp[v] > cacheSize) stamp[v] = time++;
+			}
+
+			emitted[face] = true;
+			order.push_back(face);
+		}
+
+		//next: the candidate that stays cached longest, if its faces fit
+		fanning = -1;
+		int64_t best = -1;
+		for (DWORD v : candidates) {
+			if (live[v] == 0) continue;
+
+			int64_t priority = 0;
+			if (time - stamp[v] + 2 * live[v] <= cacheSize) priority = time - stamp[v];
+			if (priority > best) {
+				best = priority;
+				fanning = v;
+			}
+		}
+
+		//dead end: a recently used vertex, then the next unfinished one
+		while (fanning < 0 && !deadEnd.empty()) {
+			DWORD v = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[v] > 0) fanning = v;
+		}
+
+		if (fanning < 0) {
+			while (cursor < vertices && live[cursor] == 0) cursor++;
+			if (cursor < vertices) {
+				fanning = cursor;
+				clusters.push_back(order.size());
+			}
+		}
+	}
+
+	return order;
+}
+
+void MeshOptimizer::splitClusters(const DWORD* indices, const std::vector<DWORD>& order, UINT vertices, UINT cacheSize, std::vector<UINT>& clusters) {
+	std::vector<UINT> split;
+	std::vector<UINT> stamp(vertices, 0);
+	UINT time = cacheSize + 1;
+	size_t next = 0;
+	UINT start = 0;
+
+	for (UINT i = 0; i < order.size(); i++) {
+		int misses = 0;
+		for (int k = 0; k < 3; k++) {
+			DWORD v = indices[order[i] * 3 + k];
+			if (time - stamp[v] > cacheSize) {
+				stamp[v] = time++;
+				misses++;
+			}
+		}
+
+		bool hard = next < clusters.size() && clusters[next] == i;
+		if (hard) next++;
+
+		//tiny clusters would only add sorting noise
+		if (hard || (misses == 3 && i - start >= cacheSize)) {
+			split.push_back(i);
+			start = i;
+		}
+	}
+
+	clusters.swap(split);
+}
+
+void MeshOptimizer::sortClusters(const DWORD* indices, const BYTE* positions, UINT stride, std::vector<DWORD>& order, const std::vector<UINT>& clusters) {
+	struct Cluster {
+		UINT start, end;
+		D3DXVECTOR3 centroid, normal;
+		float area, potential;
+	};
+
+	std::vector<Cluster> list(clusters.size());
+	D3DXVECTOR3 center;
+	float area = 0.0f;
+
+	for (size_t c = 0; c < clusters.size(); c++) {
+		Cluster& cluster = list[c];
+		cluster.start = clusters[c];
+		cluster.end = c + 1 < clusters.size() ? clusters[c + 1] : order.size();
+		cluster.area = 0.0f;
+
+		for (UINT i = cluster.start; i < cluster.end; i++) {
+			const DWORD* face = indices + order[i] * 3;
+			D3DXVECTOR3 p0((const float*) (positions + face[0] * stride));
+			D3DXVECTOR3 p1((const float*) (positions + face[1] * stride));
+			D3DXVECTOR3 p2((const float*) (positions + face[2] * stride));
+
+			D3DXVECTOR3 e1 = p1 - p0, e2 = p2 - p0, n;
+			D3DXVec3Cross(&n, &e1, &e2);
+			float a = D3DXVec3Length(&n) / 2;
+
+			cluster.normal += n;
+			cluster.centroid += (p0 + p1 + p2) * (a / 3);
+			cluster.area += a;
+		}
+
+		center += cluster.centroid;
+		area += cluster.area;
+		if (cluster.area > 0.0f) cluster.centroid /= cluster.area;
+	}
+	if (area > 0.0f) center /= area;
+
+	for (Cluster& cluster : list) {
+		D3DXVECTOR3 offset = cluster.centroid - center;
+		D3DXVec3Normalize(&cluster.normal, &cluster.normal);
+		cluster.potential = D3DXVec3Dot(&offset, &cluster.normal);
+	}
+
+	std::stable_sort(list.begin(), list.end(), [](const Cluster& a, const Cluster& b) {
+		return a.potential > b.potential;
+	});
+
+	std::vector<DWORD> sorted;
+	sorted.reserve(order.size());
+	for (const Cluster& cluster : list) {
+		sorted.insert(sorted.end(), order.begin() + cluster.start, order.begin() + cluster.end);
+	}
+	order.swap(sorted);
+}
+
+std::vector<DWORD> MeshOptimizer::orderVertices(const DWORD* indices, UINT faces, UINT vertices, UINT& used) {
+	std::vector<bool> seen(vertices, false);
+	std::vector<DWORD> order;
+	order.reserve(vertices);
+
+	for (UINT i = 0; i < faces * 3; i++) {
+		if (seen[indices[i]]) continue;
+		seen[indices[i]] = true;
+		order.push_back(indices[i]);
+	}
+
+	used = order.size();
+	for (UINT v = 0; v < vertices; v++) {
+		if (!seen[v]) order.push_back(v);
+	}
+
+	return order;
+}
+
+bool MeshOptimizer::readIndices(const void* pIndices, UINT faces, UINT vertices, BOOL b32BitIndices, std::vector<DWORD>& indices) {
+	indices.resize(faces * 3);
+
+	for (UINT i = 0; i < faces * 3; i++) {
+		indices[i] = b32BitIndices ? ((const uint32_t*) pIndices)[i] : ((const uint16_t*) pIndices)[i];
+		if (indices[i] >= vertices) return false;
+	}
+
+	return true;
+}
@@ -1,17 +1,21 @@
 #include "DirectXSetupGetVersion.hpp"
+#include <cache/CapsCache.hpp>
 
 /**
  * @brief Get DirectX version
  * 
- * @todo Implement this function
  * *    @see https://github.com/EduApps-CDG/OpenDX/wiki/dsetup.dll-or-libdsetup.so#int-directxsetupgetversiondword-dword
  * 
- * @param ver 
- * @param rev 
+ * Reports the version libd3d9 implements (4.09.00.0904, DirectX 9.0c).
+ * The same numbers key the caps cache (include/cache/CapsCache.hpp),
+ * so what dsetup reports is what the cached caps were probed for.
+ * 
+ * @param ver receives 0x00040009 (major.minor). May be NULL.
+ * @param rev receives 0x00000384 (904). May be NULL.
  * @return int 1 (always?)
  */
 int DirectXSetupGetVersion(DWORD* ver, DWORD* rev) {
-    *ver = 0;
-    *rev = 0;
+    if (ver != NULL) *ver = ODX_DIRECTX_VERSION;
+    if (rev != NULL) *rev = ODX_DIRECTX_REVISION;
     return 1;
-}
\ No newline at end of file
+}
@@ -4,11 +4,10 @@
 /**
  * @brief Get DirectX version
  * 
- * @todo Implement this function
  * *    @see https://github.com/EduApps-CDG/OpenDX/wiki/dsetup.dll-or-libdsetup.so#int-directxsetupgetversiondword-dword
  * 
- * @param ver 
- * @param rev 
+ * @param ver receives 0x00040009 (major.minor). May be NULL.
+ * @param rev receives 0x00000384 (904). May be NULL.
  * @return int 1 (always?)
  */
 int DirectXSetupGetVersion(DWORD* ver, DWORD* rev);
\ No newline at end of file
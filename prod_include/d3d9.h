@@ -8,8 +8,10 @@
 #include <windows.h>
 #include <winerror.h>
 #include <unknwn.h>
+#include <d3d9types.h>
+#include <d3d9caps.h>
 
-UINT D3D_SDK_VERSION = 0x0900;
+const UINT D3D_SDK_VERSION = 0x0900;
 
 #define D3DADAPTER_DEFAULT 0
 
@@ -30,10 +32,6 @@ UINT D3D_SDK_VERSION = 0x0900;
 #define DXGASSERT(exp) ((void)0)
 #endif
 
-#define MAKEFOURCC(ch0, ch1, ch2, ch3)                              \
-                ((DWORD)(BYTE)(ch0) | ((DWORD)(BYTE)(ch1) << 8) |   \
-                ((DWORD)(BYTE)(ch2) << 16) | ((DWORD)(BYTE)(ch3) << 24 ))
-
 
 typedef enum {
     REF_EXTERNAL  = 0,
@@ -41,175 +39,162 @@ typedef enum {
     REF_INTERNAL = 2
 
 } REF_TYPE;
+
 /**
- * Defines the various types of surface formats.
+ * Direct3D return codes
  */
-typedef enum _D3DFORMAT {
-    D3DFMT_UNKNOWN              =  0,
-
-    D3DFMT_R8G8B8               = 20,
-    D3DFMT_A8R8G8B8             = 21,
-    D3DFMT_X8R8G8B8             = 22,
-    D3DFMT_R5G6B5               = 23,
-    D3DFMT_X1R5G5B5             = 24,
-    D3DFMT_A1R5G5B5             = 25,
-    D3DFMT_A4R4G4B4             = 26,
-    D3DFMT_R3G3B2               = 27,
-    D3DFMT_A8                   = 28,
-    D3DFMT_A8R3G3B2             = 29,
-    D3DFMT_X4R4G4B4             = 30,
-    D3DFMT_A2B10G10R10          = 31,
-    D3DFMT_A8B8G8R8             = 32,
-    D3DFMT_X8B8G8R8             = 33,
-    D3DFMT_G16R16               = 34,
-    D3DFMT_A2R10G10B10          = 35,
-    D3DFMT_A16B16G16R16         = 36,
-
-    D3DFMT_A8P8                 = 40,
-    D3DFMT_P8                   = 41,
-
-    D3DFMT_L8                   = 50,
-    D3DFMT_A8L8                 = 51,
-    D3DFMT_A4L4                 = 52,
-
-    D3DFMT_V8U8                 = 60,
-    D3DFMT_L6V5U5               = 61,
-    D3DFMT_X8L8V8U8             = 62,
-    D3DFMT_Q8W8V8U8             = 63,
-    D3DFMT_V16U16               = 64,
-    D3DFMT_A2W10V10U10          = 67,
-
-    D3DFMT_UYVY                 = MAKEFOURCC('U', 'Y', 'V', 'Y'),
-    D3DFMT_R8G8_B8G8            = MAKEFOURCC('R', 'G', 'B', 'G'),
-    D3DFMT_YUY2                 = MAKEFOURCC('Y', 'U', 'Y', '2'),
-    D3DFMT_G8R8_G8B8            = MAKEFOURCC('G', 'R', 'G', 'B'),
-    D3DFMT_DXT1                 = MAKEFOURCC('D', 'X', 'T', '1'),
-    D3DFMT_DXT2                 = MAKEFOURCC('D', 'X', 'T', '2'),
-    D3DFMT_DXT3                 = MAKEFOURCC('D', 'X', 'T', '3'),
-    D3DFMT_DXT4                 = MAKEFOURCC('D', 'X', 'T', '4'),
-    D3DFMT_DXT5                 = MAKEFOURCC('D', 'X', 'T', '5'),
-
-    D3DFMT_D16_LOCKABLE         = 70,
-    D3DFMT_D32                  = 71,
-    D3DFMT_D15S1                = 73,
-    D3DFMT_D24S8                = 75,
-    D3DFMT_D24X8                = 77,
-    D3DFMT_D24X4S4              = 79,
-    D3DFMT_D16                  = 80,
-
-    D3DFMT_D32F_LOCKABLE        = 82,
-    D3DFMT_D24FS8               = 83,
-
-#if !defined(D3D_DISABLE_9EX)
-    D3DFMT_D32_LOCKABLE         = 84,
-    D3DFMT_S8_LOCKABLE          = 85,
-#endif // !D3D_DISABLE_9EX
-
-    D3DFMT_L16                  = 81,
-
-    D3DFMT_VERTEXDATA           =100,
-    D3DFMT_INDEX16              =101,
-    D3DFMT_INDEX32              =102,
-
-    D3DFMT_Q16W16V16U16         =110,
-
-    D3DFMT_MULTI2_ARGB8         = MAKEFOURCC('M','E','T','1'),
-
-    D3DFMT_R16F                 = 111,
-    D3DFMT_G16R16F              = 112,
-    D3DFMT_A16B16G16R16F        = 113,
-
-    D3DFMT_R32F                 = 114,
-    D3DFMT_G32R32F              = 115,
-    D3DFMT_A32B32G32R32F        = 116,
-
-    D3DFMT_CxV8U8               = 117,
-
-#if !defined(D3D_DISABLE_9EX)
-    D3DFMT_A1                   = 118,
-    D3DFMT_A2B10G10R10_XR_BIAS  = 119,
-    D3DFMT_BINARYBUFFER         = 199,
-#endif // !D3D_DISABLE_9EX
-
-    D3DFMT_FORCE_DWORD          =0x7fffffff
-} D3DFORMAT;
+#define _FACD3D 0x876
+#define MAKE_D3DHRESULT(code) MAKE_HRESULT(1, _FACD3D, code)
+
+#define D3D_OK                    S_OK
+#define D3DOK_NOAUTOGEN           MAKE_HRESULT(0, _FACD3D, 2159)
+#define D3DERR_WRONGTEXTUREFORMAT MAKE_D3DHRESULT(2072)
+#define D3DERR_NOTFOUND           MAKE_D3DHRESULT(2150)
+#define D3DERR_MOREDATA           MAKE_D3DHRESULT(2151)
+#define D3DERR_DEVICELOST         MAKE_D3DHRESULT(2152)
+#define D3DERR_NOTAVAILABLE       MAKE_D3DHRESULT(2154)
+#define D3DERR_OUTOFVIDEOMEMORY   MAKE_D3DHRESULT(380)
+#define D3DERR_INVALIDCALL        MAKE_D3DHRESULT(2156)
+
+struct IDirect3DDevice9;
+struct IDirect3DVertexDeclaration9; //not implemented: vertices are described by FVFs
 
 /**
- * Defines the levels of full-scene multisampling that the device can apply.
+ * Base interface of every Direct3D resource.
  */
-typedef enum D3DMULTISAMPLE_TYPE {
-  D3DMULTISAMPLE_NONE          = 0,
-  D3DMULTISAMPLE_NONMASKABLE   = 1,
-  D3DMULTISAMPLE_2_SAMPLES     = 2,
-  D3DMULTISAMPLE_3_SAMPLES     = 3,
-  D3DMULTISAMPLE_4_SAMPLES     = 4,
-  D3DMULTISAMPLE_5_SAMPLES     = 5,
-  D3DMULTISAMPLE_6_SAMPLES     = 6,
-  D3DMULTISAMPLE_7_SAMPLES     = 7,
-  D3DMULTISAMPLE_8_SAMPLES     = 8,
-  D3DMULTISAMPLE_9_SAMPLES     = 9,
-  D3DMULTISAMPLE_10_SAMPLES    = 10,
-  D3DMULTISAMPLE_11_SAMPLES    = 11,
-  D3DMULTISAMPLE_12_SAMPLES    = 12,
-  D3DMULTISAMPLE_13_SAMPLES    = 13,
-  D3DMULTISAMPLE_14_SAMPLES    = 14,
-  D3DMULTISAMPLE_15_SAMPLES    = 15,
-  D3DMULTISAMPLE_16_SAMPLES    = 16,
-  D3DMULTISAMPLE_FORCE_DWORD   = 0xffffffff
-} D3DMULTISAMPLE_TYPE, *LPD3DMULTISAMPLE_TYPE;
+struct IDirect3DResource9 : public IUnknown {
+    virtual DWORD SetPriority(DWORD PriorityNew) = 0;
+    virtual DWORD GetPriority() = 0;
+    virtual void PreLoad() = 0;
+    virtual D3DRESOURCETYPE GetType() = 0;
+};
 
 /**
- * Defines swap effects
+ * 2D image: a render target, a back buffer or a texture level.
  */
-typedef enum D3DSWAPEFFECT {
-  D3DSWAPEFFECT_DISCARD      = 1,
-  D3DSWAPEFFECT_FLIP         = 2,
-  D3DSWAPEFFECT_COPY         = 3,
-  D3DSWAPEFFECT_OVERLAY      = 4,
-  D3DSWAPEFFECT_FLIPEX       = 5,
-  D3DSWAPEFFECT_FORCE_DWORD  = 0xFFFFFFFF
-} D3DSWAPEFFECT, *LPD3DSWAPEFFECT;
+struct IDirect3DSurface9 : public IDirect3DResource9 {
+    virtual HRESULT GetDesc(D3DSURFACE_DESC* pDesc) = 0;
+    virtual HRESULT LockRect(D3DLOCKED_RECT* pLockedRect, const RECT* pRect, DWORD Flags) = 0;
+    virtual HRESULT UnlockRect() = 0;
+};
+typedef struct IDirect3DSurface9 *LPDIRECT3DSURFACE9, *PDIRECT3DSURFACE9;
 
 /**
- * Describes the presentation parameters.
+ * Base interface of every texture type.
  */
-struct D3DPRESENT_PARAMETERS {
-	UINT                BackBufferWidth;
-	UINT                BackBufferHeight;
-	D3DFORMAT           BackBufferFormat;
-	UINT                BackBufferCount;
-	D3DMULTISAMPLE_TYPE MultiSampleType;
-	DWORD               MultiSampleQuality;
-	D3DSWAPEFFECT       SwapEffect;
-	HWND                hDeviceWindow;
-	BOOL                Windowed;
-	BOOL                EnableAutoDepthStencil;
-	D3DFORMAT           AutoDepthStencilFormat;
-	DWORD               Flags;
-	UINT                FullScreen_RefreshRateInHz;
-	UINT                PresentationInterval;
+struct IDirect3DBaseTexture9 : public IDirect3DResource9 {
+    virtual DWORD SetLOD(DWORD LODNew) = 0;
+    virtual DWORD GetLOD() = 0;
+    virtual DWORD GetLevelCount() = 0;
 };
-typedef struct D3DPRESENT_PARAMETERS D3DPRESENT_PARAMETERS, *LPD3DPRESENT_PARAMETERS;
+typedef struct IDirect3DBaseTexture9 *LPDIRECT3DBASETEXTURE9, *PDIRECT3DBASETEXTURE9;
 
-struct IDirect3DDevice9 : public IUnknown {
-    virtual HRESULT QueryInterface(REFIID riid, void** ppvObj);
-    virtual ULONG AddRef();
-    virtual ULONG Release();
+/**
+ * 2D texture with a mip chain.
+ */
+struct IDirect3DTexture9 : public IDirect3DBaseTexture9 {
+    virtual HRESULT GetLevelDesc(UINT Level, D3DSURFACE_DESC* pDesc) = 0;
+    virtual HRESULT GetSurfaceLevel(UINT Level, IDirect3DSurface9** ppSurfaceLevel) = 0;
+    virtual HRESULT LockRect(UINT Level, D3DLOCKED_RECT* pLockedRect, const RECT* pRect, DWORD Flags) = 0;
+    virtual HRESULT UnlockRect(UINT Level) = 0;
+};
+typedef struct IDirect3DTexture9 *LPDIRECT3DTEXTURE9, *PDIRECT3DTEXTURE9;
 
-    // Define other methods required by IDirect3D9 interface
+/**
+ * Six square 2D faces sharing one mip chain.
+ */
+struct IDirect3DCubeTexture9 : public IDirect3DBaseTexture9 {
+    virtual HRESULT GetLevelDesc(UINT Level, D3DSURFACE_DESC* pDesc) = 0;
+    virtual HRESULT GetCubeMapSurface(D3DCUBEMAP_FACES FaceType, UINT Level, IDirect3DSurface9** ppCubeMapSurface) = 0;
+    virtual HRESULT LockRect(D3DCUBEMAP_FACES FaceType, UINT Level, D3DLOCKED_RECT* pLockedRect, const RECT* pRect, DWORD Flags) = 0;
+    virtual HRESULT UnlockRect(D3DCUBEMAP_FACES FaceType, UINT Level) = 0;
 };
-typedef struct IDirect3DDevice9 *LPDIRECT3DDEVICE9, *PDIRECT3DDEVICE9;
+typedef struct IDirect3DCubeTexture9 *LPDIRECT3DCUBETEXTURE9, *PDIRECT3DCUBETEXTURE9;
+
+/**
+ * 3D texture with a mip chain.
+ */
+struct IDirect3DVolumeTexture9 : public IDirect3DBaseTexture9 {
+    virtual HRESULT GetLevelDesc(UINT Level, D3DVOLUME_DESC* pDesc) = 0;
+    virtual HRESULT LockBox(UINT Level, D3DLOCKED_BOX* pLockedVolume, const D3DBOX* pBox, DWORD Flags) = 0;
+    virtual HRESULT UnlockBox(UINT Level) = 0;
+};
+typedef struct IDirect3DVolumeTexture9 *LPDIRECT3DVOLUMETEXTURE9, *PDIRECT3DVOLUMETEXTURE9;
 
 /**
- * Defines device types
+ * Vertices read by DrawPrimitive and the patch calls through
+ * SetStreamSource.
  */
-typedef enum D3DDEVTYPE {
-  D3DDEVTYPE_HAL          = 1,
-  D3DDEVTYPE_NULLREF      = 4,
-  D3DDEVTYPE_REF          = 2,
-  D3DDEVTYPE_SW           = 3,
-  D3DDEVTYPE_FORCE_DWORD  = 0xffffffff
-} D3DDEVTYPE, *LPD3DDEVTYPE;
+struct IDirect3DVertexBuffer9 : public IDirect3DResource9 {
+    virtual HRESULT Lock(UINT OffsetToLock, UINT SizeToLock, void** ppbData, DWORD Flags) = 0;
+    virtual HRESULT Unlock() = 0;
+    virtual HRESULT GetDesc(D3DVERTEXBUFFER_DESC* pDesc) = 0;
+};
+typedef struct IDirect3DVertexBuffer9 *LPDIRECT3DVERTEXBUFFER9, *PDIRECT3DVERTEXBUFFER9;
+
+/**
+ * ProcessVertices flags
+ */
+#define D3DPV_DONOTCOPYDATA (1 << 0)
+
+/**
+ * SetCursorPosition flags
+ */
+#define D3DCURSOR_IMMEDIATE_UPDATE 0x00000001L
+
+/**
+ * Rendering device.
+ *
+ * Only the methods the runtime implements (or is about to) are
+ * declared. They keep the relative order of the Windows vtable.
+ */
+struct IDirect3DDevice9 : public IUnknown {
+    virtual HRESULT SetCursorProperties(UINT XHotSpot, UINT YHotSpot, IDirect3DSurface9* pCursorBitmap) = 0;
+    virtual void SetCursorPosition(int X, int Y, DWORD Flags) = 0;
+    virtual BOOL ShowCursor(BOOL bShow) = 0;
+    virtual HRESULT Present(const RECT* pSourceRect, const RECT* pDestRect, HWND hDestWindowOverride, const void* pDirtyRegion) = 0;
+    virtual HRESULT GetBackBuffer(UINT iSwapChain, UINT iBackBuffer, D3DBACKBUFFER_TYPE Type, IDirect3DSurface9** ppBackBuffer) = 0;
+    virtual HRESULT CreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle) = 0;
+    virtual HRESULT CreateVolumeTexture(UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DVolumeTexture9** ppVolumeTexture, HANDLE* pSharedHandle) = 0;
+    virtual HRESULT CreateCubeTexture(UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DCubeTexture9** ppCubeTexture, HANDLE* pSharedHandle) = 0;
+    virtual HRESULT CreateVertexBuffer(UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool, IDirect3DVertexBuffer9** ppVertexBuffer, HANDLE* pSharedHandle) = 0;
+    virtual HRESULT CreateRenderTarget(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle) = 0;
+    virtual HRESULT SetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget) = 0;
+    virtual HRESULT GetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9** ppRenderTarget) = 0;
+    virtual HRESULT BeginScene() = 0;
+    virtual HRESULT EndScene() = 0;
+    virtual HRESULT Clear(DWORD Count, const D3DRECT* pRects, DWORD Flags, D3DCOLOR Color, float Z, DWORD Stencil) = 0;
+    virtual HRESULT SetTransform(D3DTRANSFORMSTATETYPE State, const D3DMATRIX* pMatrix) = 0;
+    virtual HRESULT GetTransform(D3DTRANSFORMSTATETYPE State, D3DMATRIX* pMatrix) = 0;
+    virtual HRESULT SetViewport(const D3DVIEWPORT9* pViewport) = 0;
+    virtual HRESULT GetViewport(D3DVIEWPORT9* pViewport) = 0;
+    virtual HRESULT SetMaterial(const D3DMATERIAL9* pMaterial) = 0;
+    virtual HRESULT GetMaterial(D3DMATERIAL9* pMaterial) = 0;
+    virtual HRESULT SetLight(DWORD Index, const D3DLIGHT9* pLight) = 0;
+    virtual HRESULT GetLight(DWORD Index, D3DLIGHT9* pLight) = 0;
+    virtual HRESULT LightEnable(DWORD Index, BOOL Enable) = 0;
+    virtual HRESULT GetLightEnable(DWORD Index, BOOL* pEnable) = 0;
+    virtual HRESULT SetRenderState(D3DRENDERSTATETYPE State, DWORD Value) = 0;
+    virtual HRESULT GetRenderState(D3DRENDERSTATETYPE State, DWORD* pValue) = 0;
+    virtual HRESULT SetTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture) = 0;
+    virtual HRESULT GetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD* pValue) = 0;
+    virtual HRESULT SetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value) = 0;
+    virtual HRESULT SetSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD Value) = 0;
+    virtual HRESULT SetSoftwareVertexProcessing(BOOL bSoftware) = 0;
+    virtual BOOL GetSoftwareVertexProcessing() = 0;
+    virtual HRESULT SetNPatchMode(float nSegments) = 0;
+    virtual float GetNPatchMode() = 0;
+    virtual HRESULT DrawPrimitive(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount) = 0;
+    virtual HRESULT DrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, const void* pVertexStreamZeroData, UINT VertexStreamZeroStride) = 0;
+    virtual HRESULT ProcessVertices(UINT SrcStartIndex, UINT DestIndex, UINT VertexCount, IDirect3DVertexBuffer9* pDestBuffer, IDirect3DVertexDeclaration9* pVertexDecl, DWORD Flags) = 0;
+    virtual HRESULT SetFVF(DWORD FVF) = 0;
+    virtual HRESULT SetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer9* pStreamData, UINT OffsetInBytes, UINT Stride) = 0;
+    virtual HRESULT GetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer9** ppStreamData, UINT* pOffsetInBytes, UINT* pStride) = 0;
+    virtual HRESULT DrawRectPatch(UINT Handle, const float* pNumSegs, const D3DRECTPATCH_INFO* pRectPatchInfo) = 0;
+    virtual HRESULT DrawTriPatch(UINT Handle, const float* pNumSegs, const D3DTRIPATCH_INFO* pTriPatchInfo) = 0;
+    virtual HRESULT DeletePatch(UINT Handle) = 0;
+};
+typedef struct IDirect3DDevice9 *LPDIRECT3DDEVICE9, *PDIRECT3DDEVICE9;
 
 struct IDirect3D9 : public IUnknown {
 	IDirect3D9(UINT SDKVersion);
@@ -218,6 +203,27 @@ struct IDirect3D9 : public IUnknown {
     ULONG AddRef();
     ULONG Release();
 
+	UINT GetAdapterCount();
+	UINT GetAdapterModeCount(UINT Adapter, D3DFORMAT Format);
+	HRESULT EnumAdapterModes(UINT Adapter, D3DFORMAT Format, UINT Mode, D3DDISPLAYMODE* pMode);
+	HRESULT CheckDeviceFormat(
+		UINT            Adapter,
+		D3DDEVTYPE      DeviceType,
+		D3DFORMAT       AdapterFormat,
+		DWORD           Usage,
+		D3DRESOURCETYPE RType,
+		D3DFORMAT       CheckFormat
+	);
+	HRESULT CheckDeviceMultiSampleType(
+		UINT                Adapter,
+		D3DDEVTYPE          DeviceType,
+		D3DFORMAT           SurfaceFormat,
+		BOOL                Windowed,
+		D3DMULTISAMPLE_TYPE MultiSampleType,
+		DWORD*              pQualityLevels
+	);
+	HRESULT GetDeviceCaps(UINT Adapter, D3DDEVTYPE DeviceType, D3DCAPS9* pCaps);
+
 	HRESULT CreateDevice(
 		UINT                  Adapter,
 		D3DDEVTYPE            DeviceType,
@@ -0,0 +1,15 @@
+/**
+ * Production "d3dx9.h" file.
+ *
+ * D3DX utility library (libd3dx9.so).
+ */
+#ifndef _D3DX9_H
+#define _D3DX9_H
+#include <windows.h>
+#include <d3d9.h>
+#include <d3dx9math.h>
+#include <d3dx9core.h>
+#include <d3dx9mesh.h>
+#include <d3dx9tex.h>
+
+#endif
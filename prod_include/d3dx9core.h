@@ -0,0 +1,24 @@
+/**
+ * Production "d3dx9core.h" file.
+ *
+ * Core D3DX interfaces (libd3dx9.so).
+ */
+#ifndef _D3DX9CORE_H
+#define _D3DX9CORE_H
+#include <windows.h>
+#include <unknwn.h>
+#include <d3d9.h>
+
+/**
+ * Block of memory returned by D3DX functions (vertex remaps,
+ * adjacency, compiled data...).
+ */
+struct ID3DXBuffer : public IUnknown {
+    virtual LPVOID GetBufferPointer() = 0;
+    virtual DWORD GetBufferSize() = 0;
+};
+typedef struct ID3DXBuffer *LPD3DXBUFFER;
+
+HRESULT D3DXCreateBuffer(DWORD NumBytes, LPD3DXBUFFER* ppBuffer);
+
+#endif
@@ -0,0 +1,407 @@
+/**
+ * Production "d3dx9math.h" file.
+ *
+ * D3DX math types and functions (libd3dx9.so). Small functions are
+ * inline and constexpr, like d3dx9math.inl on Windows; the rest is
+ * exported by libd3dx9 and runs on the SIMD kernels it shares with
+ * libd3d9's transform stage (include/simd/VectorMath.hpp).
+ */
+#ifndef _D3DX9MATH_H
+#define _D3DX9MATH_H
+#include <windows.h>
+#include <d3d9.h>
+#include <cmath>
+
+#define D3DX_PI    (3.14159265358979323846f)
+#define D3DX_1BYPI (1.0f / D3DX_PI)
+
+#define D3DXToRadian(degree) ((degree) * (D3DX_PI / 180.0f))
+#define D3DXToDegree(radian) ((radian) * (180.0f / D3DX_PI))
+
+struct D3DXMATRIX;
+
+/**
+ * 2D vector
+ */
+typedef struct D3DXVECTOR2 {
+    float x, y;
+
+    constexpr D3DXVECTOR2() : x(0), y(0) {}
+    constexpr D3DXVECTOR2(float fx, float fy) : x(fx), y(fy) {}
+    constexpr D3DXVECTOR2(const float* pf) : x(pf[0]), y(pf[1]) {}
+
+    operator float*() { return &x; }
+    operator const float*() const { return &x; }
+
+    constexpr D3DXVECTOR2& operator+=(const D3DXVECTOR2& v) { x += v.x; y += v.y; return *this; }
+    constexpr D3DXVECTOR2& operator-=(const D3DXVECTOR2& v) { x -= v.x; y -= v.y; return *this; }
+    constexpr D3DXVECTOR2& operator*=(float f) { x *= f; y *= f; return *this; }
+    constexpr D3DXVECTOR2& operator/=(float f) { return *this *= 1.0f / f; }
+
+    constexpr D3DXVECTOR2 operator+() const { return *this; }
+    constexpr D3DXVECTOR2 operator-() const { return D3DXVECTOR2(-x, -y); }
+
+    constexpr D3DXVECTOR2 operator+(const D3DXVECTOR2& v) const { return D3DXVECTOR2(x + v.x, y + v.y); }
+    constexpr D3DXVECTOR2 operator-(const D3DXVECTOR2& v) const { return D3DXVECTOR2(x - v.x, y - v.y); }
+    constexpr D3DXVECTOR2 operator*(float f) const { return D3DXVECTOR2(x * f, y * f); }
+    constexpr D3DXVECTOR2 operator/(float f) const { return *this * (1.0f / f); }
+    friend constexpr D3DXVECTOR2 operator*(float f, const D3DXVECTOR2& v) { return v * f; }
+
+    constexpr bool operator==(const D3DXVECTOR2& v) const { return x == v.x && y == v.y; }
+    constexpr bool operator!=(const D3DXVECTOR2& v) const { return !(*this == v); }
+} D3DXVECTOR2, *LPD3DXVECTOR2;
+
+/**
+ * 3D vector
+ */
+typedef struct D3DXVECTOR3 : public D3DVECTOR {
+    constexpr D3DXVECTOR3() : D3DVECTOR{0, 0, 0} {}
+    constexpr D3DXVECTOR3(float fx, float fy, float fz) : D3DVECTOR{fx, fy, fz} {}
+    constexpr D3DXVECTOR3(const float* pf) : D3DVECTOR{pf[0], pf[1], pf[2]} {}
+    constexpr D3DXVECTOR3(const D3DVECTOR& v) : D3DVECTOR(v) {}
+
+    operator float*() { return &x; }
+    operator const float*() const { return &x; }
+
+    constexpr D3DXVECTOR3& operator+=(const D3DXVECTOR3& v) { x += v.x; y += v.y; z += v.z; return *this; }
+    constexpr D3DXVECTOR3& operator-=(const D3DXVECTOR3& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+    constexpr D3DXVECTOR3& operator*=(float f) { x *= f; y *= f; z *= f; return *this; }
+    constexpr D3DXVECTOR3& operator/=(float f) { return *this *= 1.0f / f; }
+
+    constexpr D3DXVECTOR3 operator+() const { return *this; }
+    constexpr D3DXVECTOR3 operator-() const { return D3DXVECTOR3(-x, -y, -z); }
+
+    constexpr D3DXVECTOR3 operator+(const D3DXVECTOR3& v) const { return D3DXVECTOR3(x + v.x, y + v.y, z + v.z); }
+    constexpr D3DXVECTOR3 operator-(const D3DXVECTOR3& v) const { return D3DXVECTOR3(x - v.x, y - v.y, z - v.z); }
+    constexpr D3DXVECTOR3 operator*(float f) const { return D3DXVECTOR3(x * f, y * f, z * f); }
+    constexpr D3DXVECTOR3 operator/(float f) const { return *this * (1.0f / f); }
+    friend constexpr D3DXVECTOR3 operator*(float f, const D3DXVECTOR3& v) { return v * f; }
+
+    constexpr bool operator==(const D3DXVECTOR3& v) const { return x == v.x && y == v.y && z == v.z; }
+    constexpr bool operator!=(const D3DXVECTOR3& v) const { return !(*this == v); }
+} D3DXVECTOR3, *LPD3DXVECTOR3;
+
+/**
+ * 4D vector
+ */
+typedef struct D3DXVECTOR4 {
+    float x, y, z, w;
+
+    constexpr D3DXVECTOR4() : x(0), y(0), z(0), w(0) {}
+    constexpr D3DXVECTOR4(float fx, float fy, float fz, float fw) : x(fx), y(fy), z(fz), w(fw) {}
+    constexpr D3DXVECTOR4(const float* pf) : x(pf[0]), y(pf[1]), z(pf[2]), w(pf[3]) {}
+    constexpr D3DXVECTOR4(const D3DVECTOR& v, float fw) : x(v.x), y(v.y), z(v.z), w(fw) {}
+
+    operator float*() { return &x; }
+    operator const float*() const { return &x; }
+
+    constexpr D3DXVECTOR4& operator+=(const D3DXVECTOR4& v) { x += v.x; y += v.y; z += v.z; w += v.w; return *this; }
+    constexpr D3DXVECTOR4& operator-=(const D3DXVECTOR4& v) { x -= v.x; y -= v.y; z -= v.z; w -= v.w; return *this; }
+    constexpr D3DXVECTOR4& operator*=(float f) { x *= f; y *= f; z *= f; w *= f; return *this; }
+    constexpr D3DXVECTOR4& operator/=(float f) { return *this *= 1.0f / f; }
+
+    constexpr D3DXVECTOR4 operator+() const { return *this; }
+    constexpr D3DXVECTOR4 operator-() const { return D3DXVECTOR4(-x, -y, -z, -w); }
+
+    constexpr D3DXVECTOR4 operator+(const D3DXVECTOR4& v) const { return D3DXVECTOR4(x + v.x, y + v.y, z + v.z, w + v.w); }
+    constexpr D3DXVECTOR4 operator-(const D3DXVECTOR4& v) const { return D3DXVECTOR4(x - v.x, y - v.y, z - v.z, w - v.w); }
+    constexpr D3DXVECTOR4 operator*(float f) const { return D3DXVECTOR4(x * f, y * f, z * f, w * f); }
+    constexpr D3DXVECTOR4 operator/(float f) const { return *this * (1.0f / f); }
+    friend constexpr D3DXVECTOR4 operator*(float f, const D3DXVECTOR4& v) { return v * f; }
+
+    constexpr bool operator==(const D3DXVECTOR4& v) const { return x == v.x && y == v.y && z == v.z && w == v.w; }
+    constexpr bool operator!=(const D3DXVECTOR4& v) const { return !(*this == v); }
+} D3DXVECTOR4, *LPD3DXVECTOR4;
+
+/**
+ * 4x4 matrix
+ */
+typedef struct D3DXMATRIX : public D3DMATRIX {
+    constexpr D3DXMATRIX() : D3DMATRIX{} {}
+    constexpr D3DXMATRIX(const D3DMATRIX& mat) : D3DMATRIX(mat) {}
+    constexpr D3DXMATRIX(const float* pf) : D3DMATRIX{{{
+        {pf[0], pf[1], pf[2], pf[3]}, {pf[4], pf[5], pf[6], pf[7]},
+        {pf[8], pf[9], pf[10], pf[11]}, {pf[12], pf[13], pf[14], pf[15]}}}} {}
+    constexpr D3DXMATRIX(float f11, float f12, float f13, float f14,
+                         float f21, float f22, float f23, float f24,
+                         float f31, float f32, float f33, float f34,
+                         float f41, float f42, float f43, float f44) : D3DMATRIX{{{
+        {f11, f12, f13, f14}, {f21, f22, f23, f24},
+        {f31, f32, f33, f34}, {f41, f42, f43, f44}}}} {}
+
+    constexpr float& operator()(UINT row, UINT col) { return m[row][col]; }
+    constexpr float operator()(UINT row, UINT col) const { return m[row][col]; }
+
+    operator float*() { return &m[0][0]; }
+    operator const float*() const { return &m[0][0]; }
+
+    constexpr D3DXMATRIX& operator*=(const D3DXMATRIX& mat);
+    constexpr D3DXMATRIX& operator+=(const D3DXMATRIX& mat) { for (int i = 0; i < 16; i++) m[i / 4][i % 4] += mat.m[i / 4][i % 4]; return *this; }
+    constexpr D3DXMATRIX& operator-=(const D3DXMATRIX& mat) { for (int i = 0; i < 16; i++) m[i / 4][i % 4] -= mat.m[i / 4][i % 4]; return *this; }
+    constexpr D3DXMATRIX& operator*=(float f) { for (int i = 0; i < 16; i++) m[i / 4][i % 4] *= f; return *this; }
+    constexpr D3DXMATRIX& operator/=(float f) { return *this *= 1.0f / f; }
+
+    constexpr D3DXMATRIX operator+() const { return *this; }
+    constexpr D3DXMATRIX operator-() const { return D3DXMATRIX(*this) *= -1.0f; }
+
+    constexpr D3DXMATRIX operator*(const D3DXMATRIX& mat) const { return D3DXMATRIX(*this) *= mat; }
+    constexpr D3DXMATRIX operator+(const D3DXMATRIX& mat) const { return D3DXMATRIX(*this) += mat; }
+    constexpr D3DXMATRIX operator-(const D3DXMATRIX& mat) const { return D3DXMATRIX(*this) -= mat; }
+    constexpr D3DXMATRIX operator*(float f) const { return D3DXMATRIX(*this) *= f; }
+    constexpr D3DXMATRIX operator/(float f) const { return D3DXMATRIX(*this) /= f; }
+    friend constexpr D3DXMATRIX operator*(float f, const D3DXMATRIX& mat) { return mat * f; }
+
+    constexpr bool operator==(const D3DXMATRIX& mat) const {
+        for (int i = 0; i < 16; i++) if (m[i / 4][i % 4] != mat.m[i / 4][i % 4]) return false;
+        return true;
+    }
+    constexpr bool operator!=(const D3DXMATRIX& mat) const { return !(*this == mat); }
+} D3DXMATRIX, *LPD3DXMATRIX;
+
+/**
+ * Quaternion (x, y, z) * sin(angle / 2), w = cos(angle / 2)
+ */
+typedef struct D3DXQUATERNION {
+    float x, y, z, w;
+
+    constexpr D3DXQUATERNION() : x(0), y(0), z(0), w(0) {}
+    constexpr D3DXQUATERNION(float fx, float fy, float fz, float fw) : x(fx), y(fy), z(fz), w(fw) {}
+    constexpr D3DXQUATERNION(const float* pf) : x(pf[0]), y(pf[1]), z(pf[2]), w(pf[3]) {}
+
+    operator float*() { return &x; }
+    operator const float*() const { return &x; }
+
+    constexpr D3DXQUATERNION& operator+=(const D3DXQUATERNION& q) { x += q.x; y += q.y; z += q.z; w += q.w; return *this; }
+    constexpr D3DXQUATERNION& operator-=(const D3DXQUATERNION& q) { x -= q.x; y -= q.y; z -= q.z; w -= q.w; return *this; }
+    constexpr D3DXQUATERNION& operator*=(const D3DXQUATERNION& q);
+    constexpr D3DXQUATERNION& operator*=(float f) { x *= f; y *= f; z *= f; w *= f; return *this; }
+    constexpr D3DXQUATERNION& operator/=(float f) { return *this *= 1.0f / f; }
+
+    constexpr D3DXQUATERNION operator+() const { return *this; }
+    constexpr D3DXQUATERNION operator-() const { return D3DXQUATERNION(-x, -y, -z, -w); }
+
+    constexpr D3DXQUATERNION operator+(const D3DXQUATERNION& q) const { return D3DXQUATERNION(x + q.x, y + q.y, z + q.z, w + q.w); }
+    constexpr D3DXQUATERNION operator-(const D3DXQUATERNION& q) const { return D3DXQUATERNION(x - q.x, y - q.y, z - q.z, w - q.w); }
+    constexpr D3DXQUATERNION operator*(const D3DXQUATERNION& q) const { return D3DXQUATERNION(*this) *= q; }
+    constexpr D3DXQUATERNION operator*(float f) const { return D3DXQUATERNION(x * f, y * f, z * f, w * f); }
+    constexpr D3DXQUATERNION operator/(float f) const { return *this * (1.0f / f); }
+    friend constexpr D3DXQUATERNION operator*(float f, const D3DXQUATERNION& q) { return q * f; }
+
+    constexpr bool operator==(const D3DXQUATERNION& q) const { return x == q.x && y == q.y && z == q.z && w == q.w; }
+    constexpr bool operator!=(const D3DXQUATERNION& q) const { return !(*this == q); }
+} D3DXQUATERNION, *LPD3DXQUATERNION;
+
+/**
+ * Plane ax + by + cz + d = 0
+ */
+typedef struct D3DXPLANE {
+    float a, b, c, d;
+
+    constexpr D3DXPLANE() : a(0), b(0), c(0), d(0) {}
+    constexpr D3DXPLANE(float fa, float fb, float fc, float fd) : a(fa), b(fb), c(fc), d(fd) {}
+    constexpr D3DXPLANE(const float* pf) : a(pf[0]), b(pf[1]), c(pf[2]), d(pf[3]) {}
+
+    operator float*() { return &a; }
+    operator const float*() const { return &a; }
+
+    constexpr D3DXPLANE operator+() const { return *this; }
+    constexpr D3DXPLANE operator-() const { return D3DXPLANE(-a, -b, -c, -d); }
+
+    constexpr bool operator==(const D3DXPLANE& p) const { return a == p.a && b == p.b && c == p.c && d == p.d; }
+    constexpr bool operator!=(const D3DXPLANE& p) const { return !(*this == p); }
+} D3DXPLANE, *LPD3DXPLANE;
+
+/**
+ * Floating point RGBA color
+ */
+typedef struct D3DXCOLOR {
+    float r, g, b, a;
+
+    constexpr D3DXCOLOR() : r(0), g(0), b(0), a(0) {}
+    constexpr D3DXCOLOR(float fr, float fg, float fb, float fa) : r(fr), g(fg), b(fb), a(fa) {}
+    constexpr D3DXCOLOR(D3DCOLOR argb) :
+        r(((argb >> 16) & 0xff) / 255.0f), g(((argb >> 8) & 0xff) / 255.0f),
+        b((argb & 0xff) / 255.0f), a((argb >> 24) / 255.0f) {}
+    constexpr D3DXCOLOR(const D3DCOLORVALUE& c) : r(c.r), g(c.g), b(c.b), a(c.a) {}
+
+    constexpr operator D3DCOLOR() const {
+        auto channel = [](float v) -> D3DCOLOR { return v >= 1.0f ? 0xff : v <= 0.0f ? 0 : (D3DCOLOR) (v * 255.0f + 0.5f); };
+        return (channel(a) << 24) | (channel(r) << 16) | (channel(g) << 8) | channel(b);
+    }
+
+    operator float*() { return &r; }
+    operator const float*() const { return &r; }
+
+    constexpr D3DXCOLOR operator+(const D3DXCOLOR& c) const { return D3DXCOLOR(r + c.r, g + c.g, b + c.b, a + c.a); }
+    constexpr D3DXCOLOR operator-(const D3DXCOLOR& c) const { return D3DXCOLOR(r - c.r, g - c.g, b - c.b, a - c.a); }
+    constexpr D3DXCOLOR operator*(float f) const { return D3DXCOLOR(r * f, g * f, b * f, a * f); }
+    friend constexpr D3DXCOLOR operator*(float f, const D3DXCOLOR& c) { return c * f; }
+
+    constexpr bool operator==(const D3DXCOLOR& c) const { return r == c.r && g == c.g && b == c.b && a == c.a; }
+    constexpr bool operator!=(const D3DXCOLOR& c) const { return !(*this == c); }
+} D3DXCOLOR, *LPD3DXCOLOR;
+
+
+//--- Inline functions (d3dx9math.inl)
+
+constexpr float D3DXVec2Length(const D3DXVECTOR2* pV) { return std::sqrt(pV->x * pV->x + pV->y * pV->y); }
+constexpr float D3DXVec2LengthSq(const D3DXVECTOR2* pV) { return pV->x * pV->x + pV->y * pV->y; }
+constexpr float D3DXVec2Dot(const D3DXVECTOR2* pV1, const D3DXVECTOR2* pV2) { return pV1->x * pV2->x + pV1->y * pV2->y; }
+constexpr float D3DXVec2CCW(const D3DXVECTOR2* pV1, const D3DXVECTOR2* pV2) { return pV1->x * pV2->y - pV1->y * pV2->x; }
+constexpr D3DXVECTOR2* D3DXVec2Add(D3DXVECTOR2* pOut, const D3DXVECTOR2* pV1, const D3DXVECTOR2* pV2) { *pOut = *pV1 + *pV2; return pOut; }
+constexpr D3DXVECTOR2* D3DXVec2Subtract(D3DXVECTOR2* pOut, const D3DXVECTOR2* pV1, const D3DXVECTOR2* pV2) { *pOut = *pV1 - *pV2; return pOut; }
+constexpr D3DXVECTOR2* D3DXVec2Scale(D3DXVECTOR2* pOut, const D3DXVECTOR2* pV, float s) { *pOut = *pV * s; return pOut; }
+constexpr D3DXVECTOR2* D3DXVec2Lerp(D3DXVECTOR2* pOut, const D3DXVECTOR2* pV1, const D3DXVECTOR2* pV2, float s) { *pOut = *pV1 + (*pV2 - *pV1) * s; return pOut; }
+constexpr D3DXVECTOR2* D3DXVec2Minimize(D3DXVECTOR2* pOut, const D3DXVECTOR2* pV1, const D3DXVECTOR2* pV2) {
+    *pOut = D3DXVECTOR2(pV1->x < pV2->x ? pV1->x : pV2->x, pV1->y < pV2->y ? pV1->y : pV2->y); return pOut;
+}
+constexpr D3DXVECTOR2* D3DXVec2Maximize(D3DXVECTOR2* pOut, const D3DXVECTOR2* pV1, const D3DXVECTOR2* pV2) {
+    *pOut = D3DXVECTOR2(pV1->x > pV2->x ? pV1->x : pV2->x, pV1->y > pV2->y ? pV1->y : pV2->y); return pOut;
+}
+
+constexpr float D3DXVec3Length(const D3DXVECTOR3* pV) { return std::sqrt(pV->x * pV->x + pV->y * pV->y + pV->z * pV->z); }
+constexpr float D3DXVec3LengthSq(const D3DXVECTOR3* pV) { return pV->x * pV->x + pV->y * pV->y + pV->z * pV->z; }
+constexpr float D3DXVec3Dot(const D3DXVECTOR3* pV1, const D3DXVECTOR3* pV2) { return pV1->x * pV2->x + pV1->y * pV2->y + pV1->z * pV2->z; }
+constexpr D3DXVECTOR3* D3DXVec3Cross(D3DXVECTOR3* pOut, const D3DXVECTOR3* pV1, const D3DXVECTOR3* pV2) {
+    *pOut = D3DXVECTOR3(pV1->y * pV2->z - pV1->z * pV2->y, pV1->z * pV2->x - pV1->x * pV2->z, pV1->x * pV2->y - pV1->y * pV2->x); return pOut;
+}
+constexpr D3DXVECTOR3* D3DXVec3Add(D3DXVECTOR3* pOut, const D3DXVECTOR3* pV1, const D3DXVECTOR3* pV2) { *pOut = *pV1 + *pV2; return pOut; }
+constexpr D3DXVECTOR3* D3DXVec3Subtract(D3DXVECTOR3* pOut, const D3DXVECTOR3* pV1, const D3DXVECTOR3* pV2) { *pOut = *pV1 - *pV2; return pOut; }
+constexpr D3DXVECTOR3* D3DXVec3Scale(D3DXVECTOR3* pOut, const D3DXVECTOR3* pV, float s) { *pOut = *pV * s; return pOut; }
+constexpr D3DXVECTOR3* D3DXVec3Lerp(D3DXVECTOR3* pOut, const D3DXVECTOR3* pV1, const D3DXVECTOR3* pV2, float s) { *pOut = *pV1 + (*pV2 - *pV1) * s; return pOut; }
+constexpr D3DXVECTOR3* D3DXVec3Minimize(D3DXVECTOR3* pOut, const D3DXVECTOR3* pV1, const D3DXVECTOR3* pV2) {
+    *pOut = D3DXVECTOR3(pV1->x < pV2->x ? pV1->x : pV2->x, pV1->y < pV2->y ? pV1->y : pV2->y, pV1->z < pV2->z ? pV1->z : pV2->z); return pOut;
+}
+constexpr D3DXVECTOR3* D3DXVec3Maximize(D3DXVECTOR3* pOut, const D3DXVECTOR3* pV1, const D3DXVECTOR3* pV2) {
+    *pOut = D3DXVECTOR3(pV1->x > pV2->x ? pV1->x : pV2->x, pV1->y > pV2->y ? pV1->y : pV2->y, pV1->z > pV2->z ? pV1->z : pV2->z); return pOut;
+}
+
+constexpr float D3DXVec4Length(const D3DXVECTOR4* pV) { return std::sqrt(pV->x * pV->x + pV->y * pV->y + pV->z * pV->z + pV->w * pV->w); }
+constexpr float D3DXVec4LengthSq(const D3DXVECTOR4* pV) { return pV->x * pV->x + pV->y * pV->y + pV->z * pV->z + pV->w * pV->w; }
+constexpr float D3DXVec4Dot(const D3DXVECTOR4* pV1, const D3DXVECTOR4* pV2) { return pV1->x * pV2->x + pV1->y * pV2->y + pV1->z * pV2->z + pV1->w * pV2->w; }
+constexpr D3DXVECTOR4* D3DXVec4Add(D3DXVECTOR4* pOut, const D3DXVECTOR4* pV1, const D3DXVECTOR4* pV2) { *pOut = *pV1 + *pV2; return pOut; }
+constexpr D3DXVECTOR4* D3DXVec4Subtract(D3DXVECTOR4* pOut, const D3DXVECTOR4* pV1, const D3DXVECTOR4* pV2) { *pOut = *pV1 - *pV2; return pOut; }
+constexpr D3DXVECTOR4* D3DXVec4Scale(D3DXVECTOR4* pOut, const D3DXVECTOR4* pV, float s) { *pOut = *pV * s; return pOut; }
+constexpr D3DXVECTOR4* D3DXVec4Lerp(D3DXVECTOR4* pOut, const D3DXVECTOR4* pV1, const D3DXVECTOR4* pV2, float s) { *pOut = *pV1 + (*pV2 - *pV1) * s; return pOut; }
+
+constexpr D3DXMATRIX* D3DXMatrixIdentity(D3DXMATRIX* pOut) {
+    *pOut = D3DXMATRIX(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1); return pOut;
+}
+constexpr BOOL D3DXMatrixIsIdentity(const D3DXMATRIX* pM) {
+    return *pM == D3DXMATRIX(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
+}
+
+constexpr float D3DXQuaternionLength(const D3DXQUATERNION* pQ) { return std::sqrt(pQ->x * pQ->x + pQ->y * pQ->y + pQ->z * pQ->z + pQ->w * pQ->w); }
+constexpr float D3DXQuaternionLengthSq(const D3DXQUATERNION* pQ) { return pQ->x * pQ->x + pQ->y * pQ->y + pQ->z * pQ->z + pQ->w * pQ->w; }
+constexpr float D3DXQuaternionDot(const D3DXQUATERNION* pQ1, const D3DXQUATERNION* pQ2) { return pQ1->x * pQ2->x + pQ1->y * pQ2->y + pQ1->z * pQ2->z + pQ1->w * pQ2->w; }
+constexpr D3DXQUATERNION* D3DXQuaternionIdentity(D3DXQUATERNION* pOut) { *pOut = D3DXQUATERNION(0, 0, 0, 1); return pOut; }
+constexpr BOOL D3DXQuaternionIsIdentity(const D3DXQUATERNION* pQ) { return *pQ == D3DXQUATERNION(0, 0, 0, 1); }
+constexpr D3DXQUATERNION* D3DXQuaternionConjugate(D3DXQUATERNION* pOut, const D3DXQUATERNION* pQ) { *pOut = D3DXQUATERNION(-pQ->x, -pQ->y, -pQ->z, pQ->w); return pOut; }
+
+constexpr float D3DXPlaneDot(const D3DXPLANE* pP, const D3DXVECTOR4* pV) { return pP->a * pV->x + pP->b * pV->y + pP->c * pV->z + pP->d * pV->w; }
+constexpr float D3DXPlaneDotCoord(const D3DXPLANE* pP, const D3DXVECTOR3* pV) { return pP->a * pV->x + pP->b * pV->y + pP->c * pV->z + pP->d; }
+constexpr float D3DXPlaneDotNormal(const D3DXPLANE* pP, const D3DXVECTOR3* pV) { return pP->a * pV->x + pP->b * pV->y + pP->c * pV->z; }
+constexpr D3DXPLANE* D3DXPlaneScale(D3DXPLANE* pOut, const D3DXPLANE* pP, float s) { *pOut = D3DXPLANE(pP->a * s, pP->b * s, pP->c * s, pP->d * s); return pOut; }
+
+constexpr D3DXCOLOR* D3DXColorNegative(D3DXCOLOR* pOut, const D3DXCOLOR* pC) { *pOut = D3DXCOLOR(1 - pC->r, 1 - pC->g, 1 - pC->b, pC->a); return pOut; }
+constexpr D3DXCOLOR* D3DXColorAdd(D3DXCOLOR* pOut, const D3DXCOLOR* pC1, const D3DXCOLOR* pC2) { *pOut = *pC1 + *pC2; return pOut; }
+constexpr D3DXCOLOR* D3DXColorSubtract(D3DXCOLOR* pOut, const D3DXCOLOR* pC1, const D3DXCOLOR* pC2) { *pOut = *pC1 - *pC2; return pOut; }
+constexpr D3DXCOLOR* D3DXColorScale(D3DXCOLOR* pOut, const D3DXCOLOR* pC, float s) { *pOut = *pC * s; return pOut; }
+constexpr D3DXCOLOR* D3DXColorModulate(D3DXCOLOR* pOut, const D3DXCOLOR* pC1, const D3DXCOLOR* pC2) {
+    *pOut = D3DXCOLOR(pC1->r * pC2->r, pC1->g * pC2->g, pC1->b * pC2->b, pC1->a * pC2->a); return pOut;
+}
+constexpr D3DXCOLOR* D3DXColorLerp(D3DXCOLOR* pOut, const D3DXCOLOR* pC1, const D3DXCOLOR* pC2, float s) { *pOut = *pC1 + (*pC2 - *pC1) * s; return pOut; }
+
+
+//--- libd3dx9.so
+
+D3DXVECTOR2* D3DXVec2Normalize(D3DXVECTOR2* pOut, const D3DXVECTOR2* pV);
+D3DXVECTOR3* D3DXVec3Normalize(D3DXVECTOR3* pOut, const D3DXVECTOR3* pV);
+D3DXVECTOR4* D3DXVec4Normalize(D3DXVECTOR4* pOut, const D3DXVECTOR4* pV);
+
+D3DXVECTOR4* D3DXVec3Transform(D3DXVECTOR4* pOut, const D3DXVECTOR3* pV, const D3DXMATRIX* pM);
+D3DXVECTOR3* D3DXVec3TransformCoord(D3DXVECTOR3* pOut, const D3DXVECTOR3* pV, const D3DXMATRIX* pM);
+D3DXVECTOR3* D3DXVec3TransformNormal(D3DXVECTOR3* pOut, const D3DXVECTOR3* pV, const D3DXMATRIX* pM);
+D3DXVECTOR4* D3DXVec4Transform(D3DXVECTOR4* pOut, const D3DXVECTOR4* pV, const D3DXMATRIX* pM);
+
+//Strided arrays. Strides are in bytes; pOut may be the input array.
+D3DXVECTOR4* D3DXVec3TransformArray(D3DXVECTOR4* pOut, UINT OutStride, const D3DXVECTOR3* pV, UINT VStride, const D3DXMATRIX* pM, UINT n);
+D3DXVECTOR3* D3DXVec3TransformCoordArray(D3DXVECTOR3* pOut, UINT OutStride, const D3DXVECTOR3* pV, UINT VStride, const D3DXMATRIX* pM, UINT n);
+D3DXVECTOR3* D3DXVec3TransformNormalArray(D3DXVECTOR3* pOut, UINT OutStride, const D3DXVECTOR3* pV, UINT VStride, const D3DXMATRIX* pM, UINT n);
+D3DXVECTOR4* D3DXVec4TransformArray(D3DXVECTOR4* pOut, UINT OutStride, const D3DXVECTOR4* pV, UINT VStride, const D3DXMATRIX* pM, UINT n);
+
+float D3DXMatrixDeterminant(const D3DXMATRIX* pM);
+D3DXMATRIX* D3DXMatrixTranspose(D3DXMATRIX* pOut, const D3DXMATRIX* pM);
+D3DXMATRIX* D3DXMatrixMultiply(D3DXMATRIX* pOut, const D3DXMATRIX* pM1, const D3DXMATRIX* pM2);
+D3DXMATRIX* D3DXMatrixMultiplyTranspose(D3DXMATRIX* pOut, const D3DXMATRIX* pM1, const D3DXMATRIX* pM2);
+D3DXMATRIX* D3DXMatrixInverse(D3DXMATRIX* pOut, float* pDeterminant, const D3DXMATRIX* pM);
+D3DXMATRIX* D3DXMatrixScaling(D3DXMATRIX* pOut, float sx, float sy, float sz);
+D3DXMATRIX* D3DXMatrixTranslation(D3DXMATRIX* pOut, float x, float y, float z);
+D3DXMATRIX* D3DXMatrixRotationX(D3DXMATRIX* pOut, float Angle);
+D3DXMATRIX* D3DXMatrixRotationY(D3DXMATRIX* pOut, float Angle);
+D3DXMATRIX* D3DXMatrixRotationZ(D3DXMATRIX* pOut, float Angle);
+D3DXMATRIX* D3DXMatrixRotationAxis(D3DXMATRIX* pOut, const D3DXVECTOR3* pV, float Angle);
+D3DXMATRIX* D3DXMatrixRotationQuaternion(D3DXMATRIX* pOut, const D3DXQUATERNION* pQ);
+D3DXMATRIX* D3DXMatrixRotationYawPitchRoll(D3DXMATRIX* pOut, float Yaw, float Pitch, float Roll);
+D3DXMATRIX* D3DXMatrixLookAtRH(D3DXMATRIX* pOut, const D3DXVECTOR3* pEye, const D3DXVECTOR3* pAt, const D3DXVECTOR3* pUp);
+D3DXMATRIX* D3DXMatrixLookAtLH(D3DXMATRIX* pOut, const D3DXVECTOR3* pEye, const D3DXVECTOR3* pAt, const D3DXVECTOR3* pUp);
+D3DXMATRIX* D3DXMatrixPerspectiveFovRH(D3DXMATRIX* pOut, float fovy, float Aspect, float zn, float zf);
+D3DXMATRIX* D3DXMatrixPerspectiveFovLH(D3DXMATRIX* pOut, float fovy, float Aspect, float zn, float zf);
+D3DXMATRIX* D3DXMatrixOrthoRH(D3DXMATRIX* pOut, float w, float h, float zn, float zf);
+D3DXMATRIX* D3DXMatrixOrthoLH(D3DXMATRIX* pOut, float w, float h, float zn, float zf);
+D3DXMATRIX* D3DXMatrixOrthoOffCenterRH(D3DXMATRIX* pOut, float l, float r, float b, float t, float zn, float zf);
+D3DXMATRIX* D3DXMatrixOrthoOffCenterLH(D3DXMATRIX* pOut, float l, float r, float b, float t, float zn, float zf);
+
+D3DXQUATERNION* D3DXQuaternionNormalize(D3DXQUATERNION* pOut, const D3DXQUATERNION* pQ);
+D3DXQUATERNION* D3DXQuaternionInverse(D3DXQUATERNION* pOut, const D3DXQUATERNION* pQ);
+D3DXQUATERNION* D3DXQuaternionMultiply(D3DXQUATERNION* pOut, const D3DXQUATERNION* pQ1, const D3DXQUATERNION* pQ2);
+D3DXQUATERNION* D3DXQuaternionRotationAxis(D3DXQUATERNION* pOut, const D3DXVECTOR3* pV, float Angle);
+D3DXQUATERNION* D3DXQuaternionRotationMatrix(D3DXQUATERNION* pOut, const D3DXMATRIX* pM);
+D3DXQUATERNION* D3DXQuaternionRotationYawPitchRoll(D3DXQUATERNION* pOut, float Yaw, float Pitch, float Roll);
+D3DXQUATERNION* D3DXQuaternionSlerp(D3DXQUATERNION* pOut, const D3DXQUATERNION* pQ1, const D3DXQUATERNION* pQ2, float t);
+
+D3DXPLANE* D3DXPlaneNormalize(D3DXPLANE* pOut, const D3DXPLANE* pP);
+D3DXPLANE* D3DXPlaneFromPointNormal(D3DXPLANE* pOut, const D3DXVECTOR3* pPoint, const D3DXVECTOR3* pNormal);
+D3DXPLANE* D3DXPlaneFromPoints(D3DXPLANE* pOut, const D3DXVECTOR3* pV1, const D3DXVECTOR3* pV2, const D3DXVECTOR3* pV3);
+D3DXVECTOR3* D3DXPlaneIntersectLine(D3DXVECTOR3* pOut, const D3DXPLANE* pP, const D3DXVECTOR3* pV1, const D3DXVECTOR3* pV2);
+//pM is the inverse transpose of the point transform
+D3DXPLANE* D3DXPlaneTransform(D3DXPLANE* pOut, const D3DXPLANE* pP, const D3DXMATRIX* pM);
+D3DXPLANE* D3DXPlaneTransformArray(D3DXPLANE* pOut, UINT OutStride, const D3DXPLANE* pP, UINT PStride, const D3DXMATRIX* pM, UINT n);
+
+
+//--- Operators needing libd3dx9
+
+/**
+ * Constant evaluation multiplies in place; at run time this is
+ * D3DXMatrixMultiply and its SSE/AVX2 kernels.
+ */
+constexpr D3DXMATRIX& D3DXMATRIX::operator*=(const D3DXMATRIX& mat) {
+    if consteval {
+        D3DXMATRIX r;
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                r.m[i][j] = m[i][0] * mat.m[0][j] + m[i][1] * mat.m[1][j] + m[i][2] * mat.m[2][j] + m[i][3] * mat.m[3][j];
+            }
+        }
+        *this = r;
+    } else {
+        D3DXMatrixMultiply(this, this, &mat);
+    }
+    return *this;
+}
+
+/**
+ * Same order as D3DXQuaternionMultiply: the rotation of *this
+ * followed by the rotation of q.
+ */
+constexpr D3DXQUATERNION& D3DXQUATERNION::operator*=(const D3DXQUATERNION& q) {
+    *this = D3DXQUATERNION(
+        q.w * x + q.x * w + q.y * z - q.z * y,
+        q.w * y - q.x * z + q.y * w + q.z * x,
+        q.w * z + q.x * y - q.y * x + q.z * w,
+        q.w * w - q.x * x - q.y * y - q.z * z
+    );
+    return *this;
+}
+
+#endif
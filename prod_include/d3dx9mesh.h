@@ -0,0 +1,85 @@
+/**
+ * Production "d3dx9mesh.h" file.
+ *
+ * D3DX meshes and mesh optimisation (libd3dx9.so).
+ */
+#ifndef _D3DX9MESH_H
+#define _D3DX9MESH_H
+#include <windows.h>
+#include <unknwn.h>
+#include <d3d9.h>
+#include <d3dx9core.h>
+
+/**
+ * Mesh creation options
+ */
+#define D3DXMESH_32BIT     0x001
+#define D3DXMESH_SYSTEMMEM 0x110
+#define D3DXMESH_MANAGED   0x220
+
+/**
+ * OptimizeInplace() flags. Each ordering implies the ones above it
+ * (VERTEXCACHE sorts by attribute, which compacts).
+ */
+#define D3DXMESHOPT_COMPACT           0x01000000
+#define D3DXMESHOPT_ATTRSORT          0x02000000
+#define D3DXMESHOPT_VERTEXCACHE       0x04000000
+#define D3DXMESHOPT_STRIPREORDER      0x08000000
+#define D3DXMESHOPT_IGNOREVERTS       0x10000000
+#define D3DXMESHOPT_DONOTSPLIT        0x20000000
+#define D3DXMESHOPT_DEVICEINDEPENDENT 0x00400000
+
+/**
+ * Faces (and the vertices they use) drawn by one DrawSubset() call
+ */
+typedef struct _D3DXATTRIBUTERANGE {
+    DWORD AttribId;
+    DWORD FaceStart;
+    DWORD FaceCount;
+    DWORD VertexStart;
+    DWORD VertexCount;
+} D3DXATTRIBUTERANGE, *LPD3DXATTRIBUTERANGE;
+
+/**
+ * Only the methods the runtime implements are declared. They keep
+ * the relative order of the Windows vtable.
+ */
+struct ID3DXBaseMesh : public IUnknown {
+    virtual DWORD GetNumFaces() = 0;
+    virtual DWORD GetNumVertices() = 0;
+    virtual DWORD GetFVF() = 0;
+    virtual DWORD GetNumBytesPerVertex() = 0;
+    virtual DWORD GetOptions() = 0;
+    virtual HRESULT GetDevice(LPDIRECT3DDEVICE9* ppDevice) = 0;
+    virtual HRESULT LockVertexBuffer(DWORD Flags, LPVOID* ppData) = 0;
+    virtual HRESULT UnlockVertexBuffer() = 0;
+    virtual HRESULT LockIndexBuffer(DWORD Flags, LPVOID* ppData) = 0;
+    virtual HRESULT UnlockIndexBuffer() = 0;
+    virtual HRESULT GetAttributeTable(D3DXATTRIBUTERANGE* pAttribTable, DWORD* pAttribTableSize) = 0;
+};
+typedef struct ID3DXBaseMesh *LPD3DXBASEMESH;
+
+struct ID3DXMesh : public ID3DXBaseMesh {
+    virtual HRESULT LockAttributeBuffer(DWORD Flags, DWORD** ppData) = 0;
+    virtual HRESULT UnlockAttributeBuffer() = 0;
+    virtual HRESULT OptimizeInplace(DWORD Flags, const DWORD* pAdjacencyIn, DWORD* pAdjacencyOut, DWORD* pFaceRemap, LPD3DXBUFFER* ppVertexRemap) = 0;
+    virtual HRESULT SetAttributeTable(const D3DXATTRIBUTERANGE* pAttribTable, DWORD cAttribTableSize) = 0;
+};
+typedef struct ID3DXMesh *LPD3DXMESH;
+
+HRESULT D3DXCreateMeshFVF(DWORD NumFaces, DWORD NumVertices, DWORD Options, DWORD FVF, LPDIRECT3DDEVICE9 pD3DDevice, LPD3DXMESH* ppMesh);
+UINT D3DXGetFVFVertexSize(DWORD FVF);
+
+/**
+ * Face order for the device's post-transform vertex cache.
+ * pFaceRemap[new face] = old face.
+ */
+HRESULT D3DXOptimizeFaces(const void* pIndices, UINT NumFaces, UINT NumVertices, BOOL b32BitIndices, DWORD* pFaceRemap);
+
+/**
+ * Vertex order matching the index order (sequential vertex fetch).
+ * pVertexRemap[new vertex] = old vertex.
+ */
+HRESULT D3DXOptimizeVertices(const void* pIndices, UINT NumFaces, UINT NumVertices, BOOL b32BitIndices, DWORD* pVertexRemap);
+
+#endif
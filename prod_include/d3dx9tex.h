@@ -0,0 +1,91 @@
+/**
+ * Production "d3dx9tex.h" file.
+ *
+ * D3DX texture loading (libd3dx9.so).
+ */
+#ifndef _D3DX9TEX_H
+#define _D3DX9TEX_H
+#include <windows.h>
+#include <d3d9.h>
+
+/**
+ * Sizes, level counts and formats taken from the file
+ */
+#define D3DX_DEFAULT         ((UINT) -1)
+#define D3DX_DEFAULT_NONPOW2 ((UINT) -2)
+#define D3DX_FROM_FILE       ((UINT) -3)
+#define D3DFMT_FROM_FILE     ((D3DFORMAT) -3)
+
+#define D3DXERR_INVALIDDATA MAKE_D3DHRESULT(2905)
+
+/**
+ * Image and mip filters. Resizing samples the nearest pixel;
+ * mipmaps are always a 2x2 box.
+ */
+#define D3DX_FILTER_NONE      (1 << 0)
+#define D3DX_FILTER_POINT     (2 << 0)
+#define D3DX_FILTER_LINEAR    (3 << 0)
+#define D3DX_FILTER_TRIANGLE  (4 << 0)
+#define D3DX_FILTER_BOX       (5 << 0)
+#define D3DX_FILTER_MIRROR_U  (1 << 16)
+#define D3DX_FILTER_MIRROR_V  (2 << 16)
+#define D3DX_FILTER_MIRROR_W  (4 << 16)
+#define D3DX_FILTER_MIRROR    (7 << 16)
+#define D3DX_FILTER_DITHER    (1 << 19)
+#define D3DX_FILTER_SRGB_IN   (1 << 21)
+#define D3DX_FILTER_SRGB_OUT  (2 << 21)
+#define D3DX_FILTER_SRGB      (3 << 21)
+
+typedef enum _D3DXIMAGE_FILEFORMAT {
+    D3DXIFF_BMP = 0,
+    D3DXIFF_JPG = 1,
+    D3DXIFF_TGA = 2,
+    D3DXIFF_PNG = 3,
+    D3DXIFF_DDS = 4,
+    D3DXIFF_PPM = 5,
+    D3DXIFF_DIB = 6,
+    D3DXIFF_HDR = 7,
+    D3DXIFF_PFM = 8,
+    D3DXIFF_FORCE_DWORD = 0x7fffffff
+} D3DXIMAGE_FILEFORMAT;
+
+typedef struct _D3DXIMAGE_INFO {
+    UINT Width;
+    UINT Height;
+    UINT Depth;
+    UINT MipLevels;
+    D3DFORMAT Format;
+    D3DRESOURCETYPE ResourceType;
+    D3DXIMAGE_FILEFORMAT ImageFileFormat;
+} D3DXIMAGE_INFO;
+
+typedef struct tagPALETTEENTRY {
+    BYTE peRed;
+    BYTE peGreen;
+    BYTE peBlue;
+    BYTE peFlags;
+} PALETTEENTRY;
+
+/**
+ * DDS, BMP, TGA, PNG and JPG files. DDS files whose format, size
+ * and mip count match the texture are mapped and their levels used
+ * in place, without copying.
+ */
+HRESULT D3DXGetImageInfoFromFileA(LPCSTR pSrcFile, D3DXIMAGE_INFO* pSrcInfo);
+HRESULT D3DXGetImageInfoFromFileInMemory(const void* pSrcData, UINT SrcDataSize, D3DXIMAGE_INFO* pSrcInfo);
+
+HRESULT D3DXCreateTextureFromFileA(LPDIRECT3DDEVICE9 pDevice, LPCSTR pSrcFile, LPDIRECT3DTEXTURE9* ppTexture);
+HRESULT D3DXCreateTextureFromFileExA(LPDIRECT3DDEVICE9 pDevice, LPCSTR pSrcFile, UINT Width, UINT Height, UINT MipLevels, DWORD Usage,
+    D3DFORMAT Format, D3DPOOL Pool, DWORD Filter, DWORD MipFilter, D3DCOLOR ColorKey, D3DXIMAGE_INFO* pSrcInfo, PALETTEENTRY* pPalette,
+    LPDIRECT3DTEXTURE9* ppTexture);
+
+HRESULT D3DXCreateTextureFromFileInMemory(LPDIRECT3DDEVICE9 pDevice, const void* pSrcData, UINT SrcDataSize, LPDIRECT3DTEXTURE9* ppTexture);
+HRESULT D3DXCreateTextureFromFileInMemoryEx(LPDIRECT3DDEVICE9 pDevice, const void* pSrcData, UINT SrcDataSize, UINT Width, UINT Height,
+    UINT MipLevels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, DWORD Filter, DWORD MipFilter, D3DCOLOR ColorKey,
+    D3DXIMAGE_INFO* pSrcInfo, PALETTEENTRY* pPalette, LPDIRECT3DTEXTURE9* ppTexture);
+
+#define D3DXGetImageInfoFromFile D3DXGetImageInfoFromFileA
+#define D3DXCreateTextureFromFile D3DXCreateTextureFromFileA
+#define D3DXCreateTextureFromFileEx D3DXCreateTextureFromFileExA
+
+#endif
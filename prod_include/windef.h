@@ -7,4 +7,14 @@
 typedef struct tagPOINT {
   LONG x;
   LONG y;
-} POINT, *PPOINT, *NPPOINT, *LPPOINT;
\ No newline at end of file
+} POINT, *PPOINT, *NPPOINT, *LPPOINT;
+
+/*
+ * ref: https://learn.microsoft.com/en-us/windows/win32/api/windef/ns-windef-rect
+ */
+typedef struct tagRECT {
+  LONG left;
+  LONG top;
+  LONG right;
+  LONG bottom;
+} RECT, *PRECT, *NPRECT, *LPRECT;
\ No newline at end of file
@@ -21,7 +21,10 @@
 //windows types:
 #define WCHAR wchar_t
 #define TCHAR char
+#define INT int
 #define UINT unsigned int
+#define WORD unsigned short
+#define FLOAT float
 #define ULONG unsigned long
 #define ULONG_PTR unsigned long
 #define LONG long
@@ -41,6 +44,7 @@
 #define HWND GtkWidget*
 #define HMENU void*
 #define HINSTANCE void*
+#define HANDLE void*
 #define LPVOID void*
 
 #define LONG_PTR __int64
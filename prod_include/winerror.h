@@ -2,3 +2,21 @@
 #include <windows.h>
 
 #define HRESULT LONG
+
+/*
+ * ref: https://learn.microsoft.com/en-us/windows/win32/com/structure-of-com-error-codes
+ * The cast through int keeps failure codes negative even though LONG is 64-bit here.
+ */
+#define MAKE_HRESULT(sev, fac, code) \
+    ((HRESULT)(int)(((unsigned int)(sev) << 31) | ((unsigned int)(fac) << 16) | ((unsigned int)(code))))
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+#define S_OK ((HRESULT)0L)
+#define S_FALSE ((HRESULT)1L)
+#define E_NOTIMPL ((HRESULT)(int)0x80004001L)
+#define E_NOINTERFACE ((HRESULT)(int)0x80004002L)
+#define E_POINTER ((HRESULT)(int)0x80004003L)
+#define E_FAIL ((HRESULT)(int)0x80004005L)
+#define E_OUTOFMEMORY ((HRESULT)(int)0x8007000EL)
+#define E_INVALIDARG ((HRESULT)(int)0x80070057L)
@@ -0,0 +1,139 @@
+/**
+ * D3DX pixel conversion kernels against per-pixel reference formulas.
+ * Row lengths are not multiples of the SIMD width, so the vector loops
+ * and their scalar tails are both covered. Returns non-zero when a
+ * check fails.
+ */
+#include <windows.h>
+#include <simd/ColorConvert.hpp>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        std::cout << "FAIL: " << what << "\n";
+        failures++;
+    }
+}
+
+static std::vector<uint32_t> randomPixels(size_t n) {
+    std::mt19937 rng(42);
+    std::vector<uint32_t> pixels(n);
+    for (uint32_t& p : pixels) p = rng();
+    return pixels;
+}
+
+static void testExpand() {
+    const size_t n = 37;
+    std::vector<uint32_t> src = randomPixels(n), dst(n);
+
+    ColorConvert::swizzle32(dst.data(), src.data(), n, true, false);
+    bool swapped = true;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t p = src[i];
+        swapped &= dst[i] == ((p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16));
+    }
+    check(swapped, "swizzle32 exchanges R and B");
+
+    ColorConvert::swizzle32(dst.data(), dst.data(), n, true, true);
+    bool back = true;
+    for (size_t i = 0; i < n; i++) back &= dst[i] == (src[i] | 0xFF000000);
+    check(back, "swizzle32 in place, opaque");
+
+    std::vector<uint8_t> rgb(n * 3 + 16);
+    for (size_t i = 0; i < rgb.size(); i++) rgb[i] = (uint8_t) (i * 7 + 3);
+    ColorConvert::expand24(dst.data(), rgb.data(), n, false);
+    bool expanded = true;
+    for (size_t i = 0; i < n; i++) {
+        expanded &= dst[i] == (0xFF000000 | (uint32_t) rgb[i * 3 + 2] << 16 | (uint32_t) rgb[i * 3 + 1] << 8 | rgb[i * 3]);
+    }
+    check(expanded, "expand24");
+
+    //every 565 value survives expand and pack
+    std::vector<uint16_t> words(65536), packed(65536);
+    std::vector<uint32_t> wide(65536);
+    for (uint32_t i = 0; i < 65536; i++) words[i] = i;
+    ColorConvert::expand565(wide.data(), words.data(), words.size());
+    check(wide[0xFFFF] == 0xFFFFFFFF && wide[0] == 0xFF000000 && wide[0xF800] == 0xFFFF0000, "expand565 extremes");
+    ColorConvert::pack(packed.data(), D3DFMT_R5G6B5, wide.data(), wide.size());
+    check(packed == words, "R5G6B5 round trip");
+
+    std::vector<uint32_t> keyed = {0xFF00FF00, 0x12345678, 0xFF00FF00, 0, 0xFF00FF00};
+    ColorConvert::colorKey(keyed.data(), keyed.size(), 0xFF00FF00);
+    check(keyed == std::vector<uint32_t>({0, 0x12345678, 0, 0, 0}), "colorKey");
+}
+
+static void testPack() {
+    const size_t n = 29;
+    std::vector<uint32_t> src = randomPixels(n);
+    std::vector<uint16_t> words(n);
+
+    ColorConvert::pack(words.data(), D3DFMT_A1R5G5B5, src.data(), n);
+    bool a1 = true;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t p = src[i];
+        a1 &= words[i] == (((p >> 16) & 0x8000) | ((p >> 9) & 0x7C00) | ((p >> 6) & 0x03E0) | ((p >> 3) & 0x001F));
+    }
+    check(a1, "A1R5G5B5");
+
+    ColorConvert::pack(words.data(), D3DFMT_X1R5G5B5, src.data(), n);
+    bool x1 = true;
+    for (size_t i = 0; i < n; i++) x1 &= (words[i] & 0x8000) != 0;
+    check(x1, "X1R5G5B5 sets the unused bit");
+
+    const uint32_t gray[3] = {0xFFFFFFFF, 0xFF000000, 0x80FF0000};
+    uint8_t luma[3];
+    ColorConvert::pack(luma, D3DFMT_L8, gray, 3);
+    check(luma[0] == 255 && luma[1] == 0 && luma[2] == 77, "L8 luma");
+
+    //halves of 0, 1 and 128/255 (0x3804)
+    const uint32_t channels[1] = {0x00FF80FF};
+    uint16_t halves[4];
+    ColorConvert::pack(halves, D3DFMT_A16B16G16R16F, channels, 1);
+    check(halves[0] == 0x3C00 && halves[1] == 0x3804 && halves[2] == 0x3C00 && halves[3] == 0, "A16B16G16R16F");
+
+    float floats[2];
+    ColorConvert::pack(floats, D3DFMT_G32R32F, channels, 1);
+    check(floats[0] == 1.0f && floats[1] == 128 / 255.0f, "G32R32F");
+
+    check(!ColorConvert::pack(words.data(), D3DFMT_DXT1, src.data(), n), "pack refuses DXT1");
+}
+
+static void testHalve() {
+    //odd width: the last column is repeated
+    const UINT width = 19, height = 4;
+    std::vector<uint32_t> src = randomPixels(width * height);
+    const UINT halfWidth = width / 2;
+    std::vector<uint32_t> dst(halfWidth * height / 2);
+
+    ColorConvert::halve(dst.data(), src.data(), width, height, 0, height / 2);
+
+    bool averaged = true;
+    for (UINT y = 0; y < height / 2; y++) {
+        for (UINT x = 0; x < halfWidth; x++) {
+            const uint32_t p[4] = {src[y * 2 * width + x * 2], src[y * 2 * width + x * 2 + 1], src[(y * 2 + 1) * width + x * 2], src[(y * 2 + 1) * width + x * 2 + 1]};
+            uint32_t expected = 0;
+            for (int shift = 0; shift < 32; shift += 8) {
+                uint32_t sum = 2;
+                for (uint32_t q : p) sum += (q >> shift) & 0xFF;
+                expected |= (sum >> 2) << shift;
+            }
+            averaged &= dst[y * halfWidth + x] == expected;
+        }
+    }
+    check(averaged, "halve is a rounded 2x2 box filter");
+}
+
+int main() {
+    testExpand();
+    testPack();
+    testHalve();
+
+    if (failures == 0) std::cout << "colorconvert: all passed\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+/**
+ * D3DX matrix and quaternion math against hand-computed results.
+ * Returns non-zero when a check fails.
+ */
+#include <windows.h>
+#include <d3dx9math.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        std::cout << "FAIL: " << what << "\n";
+        failures++;
+    }
+}
+
+static bool near(const D3DXMATRIX& a, const D3DXMATRIX& b, float eps = 1e-4f) {
+    for (int r = 0; r < 4; r++) {
+        for (int c = 0; c < 4; c++) {
+            if (fabsf(a(r, c) - b(r, c)) > eps) return false;
+        }
+    }
+    return true;
+}
+
+//q and -q are the same rotation
+static bool near(const D3DXQUATERNION& a, const D3DXQUATERNION& b, float eps = 1e-4f) {
+    float same = fabsf(a.x - b.x) + fabsf(a.y - b.y) + fabsf(a.z - b.z) + fabsf(a.w - b.w);
+    float opposite = fabsf(a.x + b.x) + fabsf(a.y + b.y) + fabsf(a.z + b.z) + fabsf(a.w + b.w);
+    return std::min(same, opposite) < eps * 4;
+}
+
+static void testMultiply() {
+    D3DXMATRIX a(
+        1, 2, 3, 4,
+        5, 6, 7, 8,
+        9, 10, 11, 12,
+        13, 14, 15, 16
+    );
+    D3DXMATRIX b(
+        2, 0, 0, 0,
+        0, 3, 0, 0,
+        0, 0, 4, 0,
+        1, 1, 1, 1
+    );
+    D3DXMATRIX expected(
+        6, 10, 16, 4,
+        18, 26, 36, 8,
+        30, 42, 56, 12,
+        42, 58, 76, 16
+    );
+    D3DXMATRIX r;
+
+    D3DXMatrixMultiply(&r, &a, &b);
+    check(near(r, expected), "D3DXMatrixMultiply");
+
+    //out may alias an operand
+    D3DXMatrixMultiply(&a, &a, &b);
+    check(near(a, expected), "D3DXMatrixMultiply in place");
+
+    //row vectors: translate after rotate
+    D3DXMATRIX rotate, translate, world;
+    D3DXMatrixRotationZ(&rotate, (float) M_PI / 2);
+    D3DXMatrixTranslation(&translate, 10, 0, 0);
+    D3DXMatrixMultiply(&world, &rotate, &translate);
+
+    D3DXVECTOR3 p(1, 0, 0), out;
+    D3DXVec3TransformCoord(&out, &p, &world);
+    check(fabsf(out.x - 10) < 1e-5f && fabsf(out.y - 1) < 1e-5f && fabsf(out.z) < 1e-5f, "rotate then translate");
+}
+
+static void testInverse() {
+    D3DXMATRIX identity, r, inverse, product;
+    D3DXMatrixIdentity(&identity);
+
+    D3DXMATRIX world, scale, translate;
+    D3DXMatrixRotationYawPitchRoll(&world, 0.3f, -1.1f, 2.0f);
+    D3DXMatrixScaling(&scale, 2, 0.5f, 3);
+    D3DXMatrixTranslation(&translate, -4, 7, 1.5f);
+    D3DXMatrixMultiply(&world, &scale, &world);
+    D3DXMatrixMultiply(&world, &world, &translate);
+
+    float determinant = 0;
+    check(D3DXMatrixInverse(&inverse, &determinant, &world) == &inverse, "D3DXMatrixInverse returns pOut");
+    check(fabsf(determinant - 3.0f) < 1e-4f, "D3DXMatrixInverse determinant");
+
+    D3DXMatrixMultiply(&product, &world, &inverse);
+    check(near(product, identity), "M * inverse(M) = I");
+    D3DXMatrixMultiply(&product, &inverse, &world);
+    check(near(product, identity), "inverse(M) * M = I");
+
+    D3DXMatrixInverse(&r, NULL, &inverse);
+    check(near(r, world), "inverse(inverse(M)) = M");
+
+    //projection matrices have a zero bottom-right term
+    D3DXMATRIX projection;
+    D3DXMatrixPerspectiveFovLH(&projection, (float) M_PI / 3, 16.0f / 9, 0.1f, 100.0f);
+    D3DXMatrixInverse(&inverse, NULL, &projection);
+    D3DXMatrixMultiply(&product, &projection, &inverse);
+    check(near(product, identity), "inverse of a projection");
+
+    //singular: NULL, pOut untouched
+    D3DXMATRIX singular(
+        1, 2, 3, 4,
+        2, 4, 6, 8,
+        0, 1, 0, 1,
+        1, 0, 1, 0
+    );
+    r = identity;
+    check(D3DXMatrixInverse(&r, &determinant, &singular) == NULL, "D3DXMatrixInverse of a singular matrix");
+    check(determinant == 0.0f, "singular determinant");
+    check(near(r, identity), "singular inverse leaves pOut");
+}
+
+static void testQuaternion() {
+    const D3DXVECTOR3 axes[] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}, {1, 2, 3}, {-0.5f, 0.25f, 1}};
+    const float angles[] = {0.0f, 0.5f, 1.5f, 3.0f, 3.14159f, -2.0f};
+
+    for (const D3DXVECTOR3& axis : axes) {
+        for (float angle : angles) {
+            D3DXQUATERNION q, back;
+            D3DXMATRIX fromQuaternion, fromAxis;
+
+            D3DXQuaternionRotationAxis(&q, &axis, angle);
+            D3DXMatrixRotationQuaternion(&fromQuaternion, &q);
+            D3DXMatrixRotationAxis(&fromAxis, &axis, angle);
+            check(near(fromQuaternion, fromAxis), "D3DXMatrixRotationQuaternion matches D3DXMatrixRotationAxis");
+
+            D3DXQuaternionRotationMatrix(&back, &fromQuaternion);
+            check(near(back, q), "quaternion -> matrix -> quaternion");
+        }
+    }
+
+    //yaw, pitch, roll agree between the quaternion and matrix forms
+    D3DXQUATERNION q, qa, qb, product;
+    D3DXMATRIX m, ma, mb, mq;
+    D3DXQuaternionRotationYawPitchRoll(&q, 0.7f, -0.4f, 2.5f);
+    D3DXMatrixRotationYawPitchRoll(&m, 0.7f, -0.4f, 2.5f);
+    D3DXMatrixRotationQuaternion(&mq, &q);
+    check(near(m, mq), "D3DXQuaternionRotationYawPitchRoll");
+
+    //qa * qb rotates by qa, then qb, like ma * mb
+    const D3DXVECTOR3 x(1, 0, 0), y(0, 1, 0);
+    D3DXQuaternionRotationAxis(&qa, &x, 0.9f);
+    D3DXQuaternionRotationAxis(&qb, &y, -1.3f);
+    D3DXQuaternionMultiply(&product, &qa, &qb);
+    D3DXMatrixRotationQuaternion(&ma, &qa);
+    D3DXMatrixRotationQuaternion(&mb, &qb);
+    D3DXMatrixMultiply(&m, &ma, &mb);
+    D3DXMatrixRotationQuaternion(&mq, &product);
+    check(near(m, mq), "D3DXQuaternionMultiply order");
+
+    //slerp ends and midpoint
+    D3DXQUATERNION r, half;
+    D3DXQuaternionSlerp(&r, &qa, &qb, 0);
+    check(near(r, qa), "slerp t = 0");
+    D3DXQuaternionSlerp(&r, &qa, &qb, 1);
+    check(near(r, qb), "slerp t = 1");
+    D3DXQuaternionRotationAxis(&qb, &x, 1.9f);
+    D3DXQuaternionRotationAxis(&half, &x, 1.4f);
+    D3DXQuaternionSlerp(&r, &qa, &qb, 0.5f);
+    check(near(r, half), "slerp midpoint");
+}
+
+int main() {
+    testMultiply();
+    testInverse();
+    testQuaternion();
+
+    if (failures == 0) std::cout << "d3dx9math: all passed\n";
+    return failures == 0 ? 0 : 1;
+}
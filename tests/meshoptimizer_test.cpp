@@ -0,0 +1,91 @@
+/**
+ * Tipsify face ordering on a shuffled grid, measured with a FIFO
+ * post-transform cache simulation. Returns non-zero when a check fails.
+ */
+#include "../libs/d3dx9/meshoptimizer.hpp"
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <random>
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        std::cout << "FAIL: " << what << "\n";
+        failures++;
+    }
+}
+
+/**
+ * Average cache misses per triangle (ACMR) of "indices" in "order".
+ */
+static double missRate(const std::vector<DWORD>& indices, const std::vector<DWORD>& order, UINT cacheSize) {
+    std::deque<DWORD> fifo;
+    size_t misses = 0;
+
+    for (DWORD face : order) {
+        for (int k = 0; k < 3; k++) {
+            DWORD v = indices[face * 3 + k];
+            if (std::find(fifo.begin(), fifo.end(), v) != fifo.end()) continue;
+
+            misses++;
+            fifo.push_back(v);
+            if (fifo.size() > cacheSize) fifo.pop_front();
+        }
+    }
+
+    return (double) misses / order.size();
+}
+
+int main() {
+    const UINT side = 100; //vertices per row
+    const UINT vertices = side * side;
+    std::vector<DWORD> indices;
+
+    for (UINT y = 0; y + 1 < side; y++) {
+        for (UINT x = 0; x + 1 < side; x++) {
+            DWORD v = y * side + x;
+            indices.insert(indices.end(), {v, v + 1, v + side, v + 1, v + side + 1, v + side});
+        }
+    }
+
+    const UINT faces = indices.size() / 3;
+    std::vector<DWORD> shuffled(faces);
+    for (UINT f = 0; f < faces; f++) shuffled[f] = f;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1234));
+
+    //the shuffled mesh is the input: face i is old face shuffled[i]
+    std::vector<DWORD> input;
+    for (DWORD f : shuffled) input.insert(input.end(), indices.begin() + f * 3, indices.begin() + f * 3 + 3);
+
+    std::vector<DWORD> identity(faces);
+    for (UINT f = 0; f < faces; f++) identity[f] = f;
+    const double before = missRate(input, identity, MeshOptimizer::CACHE_SIZE);
+
+    std::vector<UINT> clusters;
+    std::vector<DWORD> order = MeshOptimizer::orderFaces(input.data(), faces, vertices, MeshOptimizer::CACHE_SIZE, clusters);
+    const double after = missRate(input, order, MeshOptimizer::CACHE_SIZE);
+
+    std::cout << "shuffled " << side << "x" << side << " grid, " << MeshOptimizer::CACHE_SIZE << "-entry FIFO: "
+        << before << " -> " << after << " misses per triangle\n";
+
+    //every face exactly once
+    std::vector<DWORD> sorted = order;
+    std::sort(sorted.begin(), sorted.end());
+    check(sorted == identity, "orderFaces is a permutation");
+    check(!clusters.empty() && clusters[0] == 0, "first cluster starts at face 0");
+
+    //random order misses almost every vertex (~3.0); Tipsify gets this grid to ~0.61
+    check(before > 2.9, "shuffled grid misses almost every vertex");
+    check(after < 0.65, "Tipsify order stays under 0.65 misses per triangle");
+
+    //vertex order follows first use, so a reordered mesh stays consistent
+    UINT used = 0;
+    std::vector<DWORD> remap = MeshOptimizer::orderVertices(input.data(), faces, vertices, used);
+    check(used == vertices, "orderVertices counts every referenced vertex");
+    check(remap.size() == vertices && remap[0] == input[0], "orderVertices starts with the first index");
+
+    if (failures == 0) std::cout << "meshoptimizer: all passed\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+/**
+ * sRGB decode table and encode polynomial against the exact curve.
+ * Returns non-zero when a check fails.
+ */
+#include <simd/Lanes.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        std::cout << "FAIL: " << what << "\n";
+        failures++;
+    }
+}
+
+static double encode(double linear) {
+    return linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1 / 2.4) - 0.055;
+}
+
+int main() {
+    //decode: the table is the exact curve
+    Lanes::u32x8 bytes = {0, 1, 10, 64, 128, 200, 254, 255};
+    Lanes::f32x8 linear = Lanes::fromSrgb8(bytes);
+    bool decoded = true;
+    for (int i = 0; i < 8; i++) {
+        double c = bytes[i] / 255.0;
+        double exact = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+        decoded &= std::fabs(linear[i] - exact) < 1e-6;
+    }
+    check(decoded, "fromSrgb8");
+    check(linear[0] == 0.0f && linear[7] == 1.0f, "fromSrgb8 ends");
+
+    //encode: within a quarter of an 8-bit step everywhere
+    double worst = 0;
+    for (int i = 0; i <= 100000; i += 8) {
+        Lanes::f32x8 v;
+        for (int k = 0; k < 8; k++) v[k] = std::min(i + k, 100000) / 100000.0f;
+        Lanes::f32x8 s = Lanes::toSrgb(v);
+        for (int k = 0; k < 8; k++) worst = std::max(worst, std::fabs(s[k] - encode(v[k])) * 255);
+    }
+    std::cout << "toSrgb: worst error " << worst << " of an 8-bit step\n";
+    check(worst <= 0.25, "toSrgb within a quarter step");
+
+    //every byte survives decode then encode
+    bool roundTrip = true;
+    for (uint32_t b = 0; b < 256; b += 8) {
+        Lanes::u32x8 in;
+        for (int k = 0; k < 8; k++) in[k] = b + k;
+        Lanes::f32x8 s = Lanes::toSrgb(Lanes::fromSrgb8(in));
+        for (int k = 0; k < 8; k++) roundTrip &= (uint32_t) (s[k] * 255 + 0.5f) == in[k];
+    }
+    check(roundTrip, "byte -> linear -> byte");
+
+    Lanes::f32x8 outside = {-1.0f, 2.0f, 0, 0, 0, 0, 0, 0};
+    Lanes::f32x8 clamped = Lanes::toSrgb(outside);
+    check(clamped[0] == 0.0f && clamped[1] == 1.0f, "toSrgb clamps");
+
+    if (failures == 0) std::cout << "srgb: all passed\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+/**
+ * Patch tessellation against closed-form surfaces. Returns non-zero
+ * when a check fails.
+ */
+#include "../libs/d3d9/tessellator.hpp"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        std::cout << "FAIL: " << what << "\n";
+        failures++;
+    }
+}
+
+struct Point {
+    float x, y, z;
+};
+
+static Point vertex(const Tessellation& t, UINT i) {
+    Point p;
+    memcpy(&p, t.vertices.data() + (size_t) i * sizeof(Point), sizeof(Point));
+    return p;
+}
+
+static D3DRECTPATCH_INFO rect(UINT width, UINT height, D3DBASISTYPE basis, D3DDEGREETYPE degree) {
+    D3DRECTPATCH_INFO info = {};
+    info.Width = width;
+    info.Height = height;
+    info.Stride = width;
+    info.Basis = basis;
+    info.Degree = degree;
+    return info;
+}
+
+/**
+ * Bezier control points i, j, i * j reproduce x, y, x * y: every
+ * tessellated vertex must lie on that surface, on a regular u, v grid.
+ */
+static void testBilinearSurface() {
+    std::vector<Point> control;
+    for (int j = 0; j < 4; j++) {
+        for (int i = 0; i < 4; i++) control.push_back({(float) i, (float) j, (float) (i * j)});
+    }
+
+    const float segments[4] = {6, 6, 6, 6};
+    Tessellation t;
+    bool ok = Tessellator::rectPatch(D3DFVF_XYZ, (const BYTE*) control.data(), sizeof(Point), control.size(), rect(4, 4, D3DBASIS_BEZIER, D3DDEGREE_CUBIC), segments, t);
+
+    check(ok, "cubic Bezier patch");
+    check(t.count == 7 * 7, "6 segments: 7x7 vertices");
+    check(t.indices.size() == 6 * 6 * 6, "6x6 quads, two triangles each");
+
+    bool onSurface = true;
+    for (UINT i = 0; i < t.count && ok; i++) {
+        Point p = vertex(t, i);
+        float x = 3.0f * (i % 7) / 6, y = 3.0f * (i / 7) / 6;
+        onSurface &= fabsf(p.x - x) < 1e-4f && fabsf(p.y - y) < 1e-4f && fabsf(p.z - x * y) < 1e-3f;
+    }
+    check(onSurface, "vertices on z = x * y");
+}
+
+/**
+ * Inner control points raised to 1: the centre is at
+ * (B1(0.5) + B2(0.5))^2 = 0.75^2, the corners stay on the plane.
+ */
+static void testBump() {
+    std::vector<Point> control;
+    for (int j = 0; j < 4; j++) {
+        for (int i = 0; i < 4; i++) {
+            bool inner = i > 0 && i < 3 && j > 0 && j < 3;
+            control.push_back({(float) i, (float) j, inner ? 1.0f : 0.0f});
+        }
+    }
+
+    const float segments[4] = {2, 2, 2, 2};
+    Tessellation t;
+    bool ok = Tessellator::rectPatch(D3DFVF_XYZ, (const BYTE*) control.data(), sizeof(Point), control.size(), rect(4, 4, D3DBASIS_BEZIER, D3DDEGREE_CUBIC), segments, t);
+
+    check(ok && t.count == 9, "2 segments: 3x3 vertices");
+    if (!ok || t.count != 9) return;
+
+    check(fabsf(vertex(t, 4).z - 0.5625f) < 1e-4f, "bump centre");
+    check(vertex(t, 0).z == 0 && vertex(t, 2).z == 0 && vertex(t, 6).z == 0 && vertex(t, 8).z == 0, "bump corners");
+}
+
+/**
+ * Seven control points across are two Bezier spans sharing a column.
+ */
+static void testSpans() {
+    std::vector<Point> control;
+    for (int j = 0; j < 4; j++) {
+        for (int i = 0; i < 7; i++) control.push_back({(float) i, (float) j, 0});
+    }
+
+    const float segments[4] = {4, 2, 4, 2};
+    Tessellation t;
+    bool ok = Tessellator::rectPatch(D3DFVF_XYZ, (const BYTE*) control.data(), sizeof(Point), control.size(), rect(7, 4, D3DBASIS_BEZIER, D3DDEGREE_CUBIC), segments, t);
+
+    //4 segments over 2 spans: 2 per span
+    check(ok && t.count == 5 * 3, "two spans: 5x3 vertices");
+    if (ok && t.count == 15) check(fabsf(vertex(t, 2).x - 3) < 1e-4f && fabsf(vertex(t, 4).x - 6) < 1e-4f, "span joint");
+
+    //a cubic Bezier row needs 3n + 1 points
+    check(!Tessellator::rectPatch(D3DFVF_XYZ, (const BYTE*) control.data(), sizeof(Point), control.size(), rect(6, 4, D3DBASIS_BEZIER, D3DDEGREE_CUBIC), segments, t), "6 points across is not a Bezier patch");
+    //reading past the vertex buffer
+    check(!Tessellator::rectPatch(D3DFVF_XYZ, (const BYTE*) control.data(), sizeof(Point), 20, rect(7, 4, D3DBASIS_BEZIER, D3DDEGREE_CUBIC), segments, t), "patch past the vertex count");
+}
+
+/**
+ * A linear triangle patch is its flat triangle.
+ */
+static void testTriangle() {
+    const Point control[3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 0}};
+    const float segments[3] = {4, 4, 4};
+    D3DTRIPATCH_INFO info = {};
+    info.NumVertices = 3;
+    info.Basis = D3DBASIS_BEZIER;
+    info.Degree = D3DDEGREE_LINEAR;
+
+    Tessellation t;
+    bool ok = Tessellator::triPatch(D3DFVF_XYZ, (const BYTE*) control, sizeof(Point), 3, info, segments, t);
+    check(ok && t.count == 5 * 6 / 2, "4 segments: 15 vertices");
+    check(t.indices.size() == 4 * 4 * 3, "16 triangles");
+
+    bool inside = true;
+    for (UINT i = 0; i < t.count && ok; i++) {
+        Point p = vertex(t, i);
+        inside &= p.z == 0 && p.x >= -1e-5f && p.y >= -1e-5f && p.x + p.y <= 1 + 1e-5f;
+    }
+    check(inside, "vertices inside the triangle");
+}
+
+int main() {
+    testBilinearSurface();
+    testBump();
+    testSpans();
+    testTriangle();
+
+    if (failures == 0) std::cout << "tessellator: all passed\n";
+    return failures == 0 ? 0 : 1;
+}
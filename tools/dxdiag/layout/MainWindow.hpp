@@ -1,8 +0,0 @@
-#pragma once
-#include <string>
-
-namespace MainWindow {
-	const std::string ui =
-	#include "MainWindow.ui"
-	;
-}
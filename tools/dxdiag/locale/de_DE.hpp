@@ -19,6 +19,7 @@ Translation_t Translation_deDE() {
 	r.tab_display = (char*) "Anzeige";
 	r.tab_sound = (char*) "Sound";
 	r.tab_input = (char*) "Eingabe";
+	r.tab_files = (char*) "DirectX-Dateien";
 
     //Buttons
     r.btn_help = (char*) "Hilfe";
@@ -65,8 +66,30 @@ Translation_t Translation_deDE() {
 	r.display_features_ddAccel = (char*) "DirectDraw-Beschleunigung";
 	r.display_features_d3dAccel = (char*) "Direct3D-Beschleunigung";
 	r.display_features_agpAccel = (char*) "AGP-Oberflächenbeschleunigung";
+	r.display_features_d3dTest = (char*) "Direct3D testen";
 	r.display_notes_label = (char*) "Hinweise";
 
+    //Tab Input
+    r.input_devices_label = (char*) "Eingabegeräte";
+	r.input_device_name = (char*) "Gerät";
+	r.input_device_path = (char*) "Pfad";
+	r.input_device_bus = (char*) "Bus";
+	r.input_device_pollingRate = (char*) "Abfragerate";
+	r.input_latency_label = (char*) "Eingabelatenz";
+	r.input_latency_start = (char*) "Latenztest starten";
+	r.input_latency_stop = (char*) "Latenztest beenden";
+
+	//Tab DirectX Files
+	r.files_label = (char*) "DirectX-Dateien";
+	r.files_name = (char*) "Name";
+	r.files_version = (char*) "Version";
+	r.files_size = (char*) "Größe";
+	r.files_hash = (char*) "CRC32C";
+	r.files_buildId = (char*) "Build-ID";
+	r.files_path = (char*) "Pfad";
+	r.files_missing = (char*) "Nicht installiert";
+	r.files_saved = (char*) "Informationen gespeichert unter %s";
+
     //Tab Sound
     r.sound_device_label = (char*) "Gerät";
 	r.sound_device_name = (char*) "Name";
@@ -18,6 +18,7 @@ Translation_t Translation_enUS() {
 	r.tab_display = (char*) "Display";
 	r.tab_sound = (char*) "Sound";
 	r.tab_input = (char*) "Input";
+	r.tab_files = (char*) "DirectX Files";
 
 	//Buttons
 	r.btn_help = (char*) "Help";
@@ -41,5 +42,34 @@ Translation_t Translation_enUS() {
 	r.system_info_directxVersion = (char*) "DirectX Version";
 	r.system_info_opendxVersion = (char*) "OpenDX Version";
 
+	//Tab Display
+	r.display_features_label = (char*) "DirectX Features";
+	r.display_features_ddAccel = (char*) "DirectDraw Acceleration";
+	r.display_features_d3dAccel = (char*) "Direct3D Acceleration";
+	r.display_features_agpAccel = (char*) "AGP Texture Acceleration";
+	r.display_features_d3dTest = (char*) "Test Direct3D";
+	r.display_notes_label = (char*) "Notes";
+
+	//Tab Input
+	r.input_devices_label = (char*) "Input Devices";
+	r.input_device_name = (char*) "Device";
+	r.input_device_path = (char*) "Path";
+	r.input_device_bus = (char*) "Bus";
+	r.input_device_pollingRate = (char*) "Polling Rate";
+	r.input_latency_label = (char*) "Input Latency";
+	r.input_latency_start = (char*) "Start Latency Test";
+	r.input_latency_stop = (char*) "Stop Latency Test";
+
+	//Tab DirectX Files
+	r.files_label = (char*) "DirectX Files";
+	r.files_name = (char*) "Name";
+	r.files_version = (char*) "Version";
+	r.files_size = (char*) "Size";
+	r.files_hash = (char*) "CRC32C";
+	r.files_buildId = (char*) "Build ID";
+	r.files_path = (char*) "Path";
+	r.files_missing = (char*) "Not installed";
+	r.files_saved = (char*) "Information saved to %s";
+
 	return r;
 }
@@ -19,6 +19,7 @@ Translation_t Translation_esES() {
 	r.tab_display = (char*) "Pantalla";
 	r.tab_sound = (char*) "Sonido";
 	r.tab_input = (char*) "Entrada";
+	r.tab_files = (char*) "Archivos de DirectX";
 
 	//Buttons
 	r.btn_help = (char*) "Ayuda";
@@ -65,8 +66,30 @@ Translation_t Translation_esES() {
 	r.display_features_ddAccel = (char*) "Aceleración DD de las características de visualización";
 	r.display_features_d3dAccel = (char*) "Aceleración D3D de las características de visualización";
 	r.display_features_agpAccel = (char*) "Aceleración AGP de las características de visualización";
+	r.display_features_d3dTest = (char*) "Probar Direct3D";
 	r.display_notes_label = (char*) "Etiqueta de las notas de visualización";
 
+	//Tab Input
+	r.input_devices_label = (char*) "Dispositivos de entrada";
+	r.input_device_name = (char*) "Dispositivo";
+	r.input_device_path = (char*) "Ruta";
+	r.input_device_bus = (char*) "Bus";
+	r.input_device_pollingRate = (char*) "Frecuencia de sondeo";
+	r.input_latency_label = (char*) "Latencia de entrada";
+	r.input_latency_start = (char*) "Iniciar prueba de latencia";
+	r.input_latency_stop = (char*) "Detener prueba de latencia";
+
+	//Tab DirectX Files
+	r.files_label = (char*) "Archivos de DirectX";
+	r.files_name = (char*) "Nombre";
+	r.files_version = (char*) "Versión";
+	r.files_size = (char*) "Tamaño";
+	r.files_hash = (char*) "CRC32C";
+	r.files_buildId = (char*) "Build ID";
+	r.files_path = (char*) "Ruta";
+	r.files_missing = (char*) "No instalado";
+	r.files_saved = (char*) "Información guardada en %s";
+
 	//Tab Sound
 	r.sound_device_label = (char*) "Etiqueta del dispositivo de sonido";
 	r.sound_device_name = (char*) "Nombre del dispositivo de sonido";
@@ -0,0 +1,28 @@
+#pragma once
+#include <clocale>
+#include <cstring>
+
+#include <types/Translation.hpp>
+#include "en_US.hpp"
+#include "pt_BR.hpp"
+#include "es_ES.hpp"
+
+/**
+ * Pick the translation matching the system locale.
+ * Falls back to en_US.
+ */
+Translation_t Translation_current() {
+	const char* locale = setlocale(LC_CTYPE, NULL);
+
+	//instantiate Translation_{locale}() from tools/dxdiag/locale/{locale}.hpp
+	if (
+		strcmp(locale, "pt_BR.UTF-8") == 0 ||
+		strcmp(locale, "pt_PT.UTF-8") == 0
+	) {
+		return Translation_ptBR(); // >:)
+	} else if (strcmp(locale, "es_ES.UTF-8") == 0) {
+		return Translation_esES();
+	}
+
+	return Translation_enUS();
+}
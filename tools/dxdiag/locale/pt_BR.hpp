@@ -19,6 +19,7 @@ Translation_t Translation_ptBR() {
 	r.tab_display = (char*) "Exibição";
 	r.tab_sound = (char*) "Som";
 	r.tab_input = (char*) "Entrada";
+	r.tab_files = (char*) "Arquivos DirectX";
 
 	//Buttons
 	r.btn_help = (char*) "Ajuda";
@@ -26,5 +27,34 @@ Translation_t Translation_ptBR() {
 	r.btn_save = (char*) "Salvar";
 	r.btn_exit = (char*) "Sair";
 
+	//Tab Display
+	r.display_features_label = (char*) "Recursos do DirectX";
+	r.display_features_ddAccel = (char*) "Aceleração DirectDraw";
+	r.display_features_d3dAccel = (char*) "Aceleração Direct3D";
+	r.display_features_agpAccel = (char*) "Aceleração de Textura AGP";
+	r.display_features_d3dTest = (char*) "Testar Direct3D";
+	r.display_notes_label = (char*) "Observações";
+
+	//Tab Input
+	r.input_devices_label = (char*) "Dispositivos de Entrada";
+	r.input_device_name = (char*) "Dispositivo";
+	r.input_device_path = (char*) "Caminho";
+	r.input_device_bus = (char*) "Barramento";
+	r.input_device_pollingRate = (char*) "Taxa de Atualização";
+	r.input_latency_label = (char*) "Latência de Entrada";
+	r.input_latency_start = (char*) "Iniciar Teste de Latência";
+	r.input_latency_stop = (char*) "Parar Teste de Latência";
+
+	//Tab DirectX Files
+	r.files_label = (char*) "Arquivos DirectX";
+	r.files_name = (char*) "Nome";
+	r.files_version = (char*) "Versão";
+	r.files_size = (char*) "Tamanho";
+	r.files_hash = (char*) "CRC32C";
+	r.files_buildId = (char*) "Build ID";
+	r.files_path = (char*) "Caminho";
+	r.files_missing = (char*) "Não instalado";
+	r.files_saved = (char*) "Informações salvas em %s";
+
 	return r;
 }
@@ -3,8 +3,11 @@
 #include <gtk/gtk.h> //GTK4
 
 #include <config.hpp>
-#include "layout/MainWindow.hpp"
 #include "src/SystemTab.hpp"
+#include "src/DisplayTab.hpp"
+#include "src/InputTab.hpp"
+#include "src/FilesTab.hpp"
+#include "src/Report.hpp"
 
 //DirectX files:
 #include <d3d9.h>
@@ -17,12 +20,16 @@ int main(int argc, char *argv[])
 
     //initializes GTK screen
     gtk_init();
-    const gchar* glade_string = MainWindow::ui.c_str();
-    GtkBuilder* builder = gtk_builder_new_from_string(glade_string, -1);
+    //layout/*.ui are compiled in as a GResource (layout/dxdiag.gresource.xml)
+    GtkBuilder* builder = gtk_builder_new_from_resource("/org/opendx/dxdiag/MainWindow.ui");
     GtkWidget *window = GTK_WIDGET(gtk_builder_get_object(builder, "main_window"));
 
     //setup events and show the screen:
     new SystemTab(builder);
+    DisplayTab::lazy(builder);
+    InputTab::lazy(builder);
+    FilesTab::lazy(builder);
+    Report::setup(builder);
     gtk_widget_show(GTK_WIDGET(window));
 
     while (g_list_model_get_n_items (gtk_window_get_toplevels ()) > 0)
@@ -0,0 +1,488 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <iomanip>
+
+#include <gtk/gtk.h>
+
+//DirectX files:
+#include <d3d9.h>
+
+/**
+ * Vertex used by every test scene: pre-transformed, colored, one texture.
+ */
+struct D3DTestVertex {
+	FLOAT x, y, z, rhw;
+	D3DCOLOR color;
+	FLOAT u, v;
+};
+#define D3DTEST_FVF (D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1)
+
+/**
+ * A fixed benchmark scene. "render" draws one frame and returns
+ * the work it submitted, already expressed in "unit".
+ */
+struct D3DTestScene {
+	const char* key; //used in the results and baseline files
+	const char* name;
+	const char* unit;
+	double (*render)(IDirect3DDevice9* device, IDirect3DTexture9* texture);
+};
+
+struct D3DTestResult {
+	const D3DTestScene* scene;
+	double score;
+};
+
+/**
+ * State of a running test. Frames are rendered from an idle
+ * callback so the test window keeps repainting between them.
+ */
+struct D3DTestRun {
+	GtkWidget* window; //NULL once destroyed, or while release() destroys it
+	guint idle; //step() source, 0 when not running
+	GtkLabel* output;
+	GtkWidget* button;
+
+	IDirect3D9* d3d;
+	IDirect3DDevice9* device;
+	IDirect3DTexture9* texture;
+
+	size_t scene;
+	int frame;
+	gint64 elapsed; //microseconds spent inside the current scene
+	double work;
+	std::vector<D3DTestResult> results;
+};
+
+class D3DTest {
+	public:static constexpr const int width = 640;
+	public:static constexpr const int height = 480;
+	public:static constexpr const int frames = 60; //per scene
+
+	/**
+	 * Write a screen-space quad as a 4 vertex triangle strip.
+	 */
+	private:static void quad(D3DTestVertex* v, float x0, float y0, float x1, float y1, D3DCOLOR color, float uv) {
+		v[0] = {x0, y0, 0.5f, 1.0f, color, 0.0f, 0.0f};
+		v[1] = {x1, y0, 0.5f, 1.0f, color, uv, 0.0f};
+		v[2] = {x0, y1, 0.5f, 1.0f, color, 0.0f, uv};
+		v[3] = {x1, y1, 0.5f, 1.0f, color, uv, uv};
+	}
+
+	/**
+	 * 8 layers of overdraw, untextured and opaque.
+	 */
+	private:static double renderFillRate(IDirect3DDevice9* device, IDirect3DTexture9* texture) {
+		constexpr const int layers = 8;
+		D3DTestVertex v[4];
+
+		device->SetTexture(0, NULL);
+		device->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+
+		for (int i = 0; i < layers; i++) {
+			quad(v, 0, 0, width, height, D3DCOLOR_XRGB(32 * i, 255 - 32 * i, 128), 1.0f);
+			device->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, v, sizeof(D3DTestVertex));
+		}
+
+		return layers * (double) width * height / 1e6;
+	}
+
+	/**
+	 * A dense grid of small triangles.
+	 */
+	private:static double renderGeometry(IDirect3DDevice9* device, IDirect3DTexture9* texture) {
+		constexpr const int cell = 8;
+		constexpr const int cols = width / cell;
+		constexpr const int rows = height / cell;
+		static std::vector<D3DTestVertex> grid;
+
+		if (grid.empty()) {
+			grid.reserve(cols * rows * 6);
+
+			for (int y = 0; y < rows; y++) {
+				for (int x = 0; x < cols; x++) {
+					float x0 = x * cell, y0 = y * cell;
+					float x1 = x0 + cell, y1 = y0 + cell;
+					D3DCOLOR c = D3DCOLOR_XRGB(x * 4, y * 4, 255);
+
+					grid.push_back({x0, y0, 0.5f, 1.0f, c, 0.0f, 0.0f});
+					grid.push_back({x1, y0, 0.5f, 1.0f, c, 1.0f, 0.0f});
+					grid.push_back({x0, y1, 0.5f, 1.0f, c, 0.0f, 1.0f});
+					grid.push_back({x1, y0, 0.5f, 1.0f, c, 1.0f, 0.0f});
+					grid.push_back({x1, y1, 0.5f, 1.0f, c, 1.0f, 1.0f});
+					grid.push_back({x0, y1, 0.5f, 1.0f, c, 0.0f, 1.0f});
+				}
+			}
+		}
+
+		device->SetTexture(0, NULL);
+		device->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+		device->DrawPrimitiveUP(D3DPT_TRIANGLELIST, grid.size() / 3, grid.data(), sizeof(D3DTestVertex));
+
+		return grid.size() / 3 / 1e6;
+	}
+
+	/**
+	 * Full screen quads sampling a repeated, minified checker texture.
+	 */
+	private:static double renderTextureFiltering(IDirect3DDevice9* device, IDirect3DTexture9* texture) {
+		constexpr const int layers = 4;
+		D3DTestVertex v[4];
+
+		device->SetTexture(0, texture);
+		device->SetSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_LINEAR);
+		device->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_LINEAR);
+		device->SetSamplerState(0, D3DSAMP_MIPFILTER, D3DTEXF_LINEAR);
+		device->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+
+		for (int i = 0; i < layers; i++) {
+			quad(v, 0, 0, width, height, D3DCOLOR_XRGB(255, 255, 255), 4.0f + i);
+			device->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, v, sizeof(D3DTestVertex));
+		}
+
+		device->SetTexture(0, NULL);
+		return layers * (double) width * height / 1e6;
+	}
+
+	/**
+	 * 8 layers of classic src-alpha blending.
+	 */
+	private:static double renderAlphaBlending(IDirect3DDevice9* device, IDirect3DTexture9* texture) {
+		constexpr const int layers = 8;
+		D3DTestVertex v[4];
+
+		device->SetTexture(0, NULL);
+		device->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+		device->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+		device->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+
+		for (int i = 0; i < layers; i++) {
+			quad(v, 0, 0, width, height, D3DCOLOR_ARGB(0x80, 255 - 32 * i, 32 * i, 64), 1.0f);
+			device->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, v, sizeof(D3DTestVertex));
+		}
+
+		device->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+		return layers * (double) width * height / 1e6;
+	}
+
+	/**
+	 * Many tiny draws with render, sampler and texture
+	 * changes in between. Measures per-draw overhead.
+	 */
+	private:static double renderStateChurn(IDirect3DDevice9* device, IDirect3DTexture9* texture) {
+		constexpr const int cell = 20;
+		constexpr const int cols = width / cell;
+		constexpr const int rows = height / cell;
+		D3DTestVertex v[4];
+
+		for (int y = 0; y < rows; y++) {
+			for (int x = 0; x < cols; x++) {
+				int i = y * cols + x;
+
+				device->SetRenderState(D3DRS_ALPHABLENDENABLE, i & 1);
+				device->SetRenderState(D3DRS_CULLMODE, (i & 2) ? D3DCULL_NONE : D3DCULL_CCW);
+				device->SetSamplerState(0, D3DSAMP_MINFILTER, (i & 4) ? D3DTEXF_POINT : D3DTEXF_LINEAR);
+				device->SetTexture(0, (i & 8) ? texture : NULL);
+
+				quad(v, x * cell, y * cell, (x + 1) * cell, (y + 1) * cell, D3DCOLOR_ARGB(0xc0, x * 8, y * 8, 128), 1.0f);
+				device->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, v, sizeof(D3DTestVertex));
+			}
+		}
+
+		device->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+		device->SetRenderState(D3DRS_CULLMODE, D3DCULL_CCW);
+		device->SetTexture(0, NULL);
+		return cols * rows / 1e3;
+	}
+
+	/**
+	 * The fixed scene list. Keys must never change, they
+	 * identify scores in saved results and baselines.
+	 */
+	public:static const std::vector<D3DTestScene>& scenes() {
+		static const std::vector<D3DTestScene> list = {
+			{"fill_rate", "Fill rate", "Mpixels/s", D3DTest::renderFillRate},
+			{"geometry", "Geometry throughput", "Mtriangles/s", D3DTest::renderGeometry},
+			{"texture_filtering", "Texture filtering", "Mtexels/s", D3DTest::renderTextureFiltering},
+			{"alpha_blending", "Alpha blending", "Mpixels/s", D3DTest::renderAlphaBlending},
+			{"state_churn", "State changes", "Kdraws/s", D3DTest::renderStateChurn},
+		};
+
+		return list;
+	}
+
+	/**
+	 * Create the device the same way a game would.
+	 * HAL first, then the software device.
+	 */
+	public:static IDirect3DDevice9* createDevice(IDirect3D9* d3d, HWND window) {
+		D3DPRESENT_PARAMETERS pp = {};
+		pp.BackBufferWidth = width;
+		pp.BackBufferHeight = height;
+		pp.BackBufferFormat = D3DFMT_X8R8G8B8;
+		pp.BackBufferCount = 1;
+		pp.SwapEffect = D3DSWAPEFFECT_DISCARD;
+		pp.hDeviceWindow = window;
+		pp.Windowed = TRUE;
+
+		IDirect3DDevice9* device = NULL;
+		const D3DDEVTYPE types[] = {D3DDEVTYPE_HAL, D3DDEVTYPE_SW};
+
+		for (D3DDEVTYPE type : types) {
+			HRESULT hr = d3d->CreateDevice(D3DADAPTER_DEFAULT, type, window, D3DCREATE_HARDWARE_VERTEXPROCESSING, &pp, &device);
+			if (SUCCEEDED(hr) && device != NULL) return device;
+		}
+
+		return NULL;
+	}
+
+	/**
+	 * Whether Direct3DCreate9 and CreateDevice succeed on this host.
+	 */
+	public:static bool isAvailable(HWND window) {
+		IDirect3D9* d3d = Direct3DCreate9(D3D_SDK_VERSION);
+		if (d3d == NULL) return false;
+
+		IDirect3DDevice9* device = D3DTest::createDevice(d3d, window);
+		bool available = device != NULL;
+
+		if (device != NULL) device->Release();
+		d3d->Release();
+
+		return available;
+	}
+
+	/**
+	 * 256x256 checker with a full mip chain.
+	 */
+	private:static IDirect3DTexture9* createTexture(IDirect3DDevice9* device) {
+		IDirect3DTexture9* texture = NULL;
+		if (FAILED(device->CreateTexture(256, 256, 0, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &texture, NULL))) {
+			return NULL;
+		}
+
+		for (DWORD level = 0; level < texture->GetLevelCount(); level++) {
+			D3DLOCKED_RECT rect;
+			if (FAILED(texture->LockRect(level, &rect, NULL, 0))) continue;
+
+			int size = 256 >> level;
+			for (int y = 0; y < size; y++) {
+				D3DCOLOR* row = (D3DCOLOR*) ((BYTE*) rect.pBits + y * rect.Pitch);
+
+				for (int x = 0; x < size; x++) {
+					bool odd = (((x << level) / 16) ^ ((y << level) / 16)) & 1;
+					row[x] = odd ? D3DCOLOR_XRGB(240, 240, 240) : D3DCOLOR_XRGB(32, 64, 160);
+				}
+			}
+
+			texture->UnlockRect(level);
+		}
+
+		return texture;
+	}
+
+	/**
+	 * Results are stored as "key=score" lines.
+	 */
+	public:static std::map<std::string, double> readScores(const std::string& path) {
+		std::map<std::string, double> scores;
+		std::ifstream file(path);
+		std::string line;
+
+		while (std::getline(file, line)) {
+			size_t eq = line.find('=');
+			if (eq == std::string::npos || line[0] == '#') continue;
+
+			try {
+				scores[line.substr(0, eq)] = std::stod(line.substr(eq + 1));
+			} catch (const std::exception&) {
+				//ignore malformed lines
+			}
+		}
+
+		return scores;
+	}
+
+	public:static bool writeScores(const std::string& path, const std::vector<D3DTestResult>& results) {
+		gchar* dir = g_path_get_dirname(path.c_str());
+		g_mkdir_with_parents(dir, 0755);
+		g_free(dir);
+
+		std::ofstream file(path);
+		if (!file.is_open()) return false;
+
+		file << "# OpenDX dxdiag Direct3D test\n";
+		for (const D3DTestResult& r : results) {
+			file << r.scene->key << '=' << std::fixed << std::setprecision(3) << r.score << '\n';
+		}
+
+		return file.good();
+	}
+
+	/**
+	 * Where the last results are saved: $XDG_DATA_HOME/opendx/dxdiag/d3dtest.txt
+	 */
+	public:static std::string resultsPath() {
+		gchar* path = g_build_filename(g_get_user_data_dir(), "opendx", "dxdiag", "d3dtest.txt", NULL);
+		std::string r = path;
+		g_free(path);
+		return r;
+	}
+
+	/**
+	 * Scores to compare against. $OPENDX_D3DTEST_BASELINE lets support ship
+	 * a reference file, otherwise d3dtest_baseline.txt next to the results.
+	 */
+	public:static std::string baselinePath() {
+		const gchar* env = g_getenv("OPENDX_D3DTEST_BASELINE");
+		if (env != NULL && env[0] != '\0') return env;
+
+		gchar* path = g_build_filename(g_get_user_data_dir(), "opendx", "dxdiag", "d3dtest_baseline.txt", NULL);
+		std::string r = path;
+		g_free(path);
+		return r;
+	}
+
+	/**
+	 * Human readable report, one line per scene.
+	 */
+	public:static std::string format(const std::vector<D3DTestResult>& results, const std::map<std::string, double>& baseline) {
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(2);
+
+		for (const D3DTestResult& r : results) {
+			out << r.scene->name << ": " << r.score << ' ' << r.scene->unit;
+
+			auto it = baseline.find(r.scene->key);
+			if (it != baseline.end() && it->second > 0) {
+				double delta = (r.score - it->second) / it->second * 100.0;
+				out << " (baseline " << it->second << ", " << std::showpos << delta << std::noshowpos << "%)";
+			}
+
+			out << '\n';
+		}
+
+		return out.str();
+	}
+
+	private:static void release(D3DTestRun* run) {
+		if (run->texture != NULL) run->texture->Release();
+		if (run->device != NULL) run->device->Release();
+		if (run->d3d != NULL) run->d3d->Release();
+		if (run->window != NULL) {
+			GtkWidget* window = run->window;
+			run->window = NULL;
+			gtk_window_destroy(GTK_WINDOW(window));
+		}
+
+		gtk_widget_set_sensitive(run->button, TRUE);
+		delete run;
+	}
+
+	private:static void finish(D3DTestRun* run) {
+		std::string path = D3DTest::resultsPath();
+		std::map<std::string, double> baseline = D3DTest::readScores(D3DTest::baselinePath());
+		std::string report = "Direct3D test results:\n" + D3DTest::format(run->results, baseline);
+
+		if (D3DTest::writeScores(path, run->results)) {
+			report += "\nSaved to " + path;
+		}
+		if (baseline.empty()) {
+			report += "\nNo baseline found at " + D3DTest::baselinePath();
+		}
+
+		gtk_label_set_text(run->output, report.c_str());
+		D3DTest::release(run);
+	}
+
+	/**
+	 * Render one frame of the current scene.
+	 */
+	private:static gboolean step(D3DTestRun* run) {
+		const std::vector<D3DTestScene>& list = D3DTest::scenes();
+		const D3DTestScene& scene = list[run->scene];
+
+		gint64 start = g_get_monotonic_time();
+		run->device->Clear(0, NULL, D3DCLEAR_TARGET, D3DCOLOR_XRGB(0, 0, 0), 1.0f, 0);
+		run->device->BeginScene();
+		run->work += scene.render(run->device, run->texture);
+		run->device->EndScene();
+		run->device->Present(NULL, NULL, NULL, NULL);
+		run->elapsed += g_get_monotonic_time() - start;
+
+		if (++run->frame < D3DTest::frames) {
+			return G_SOURCE_CONTINUE;
+		}
+
+		double seconds = run->elapsed / 1e6;
+		run->results.push_back({&scene, seconds > 0 ? run->work / seconds : 0});
+
+		#if DEBUG
+			std::cout << "D3DTest: " << scene.name << " done in " << seconds << "s\n";
+		#endif
+
+		run->frame = 0;
+		run->elapsed = 0;
+		run->work = 0;
+
+		if (++run->scene < list.size()) {
+			return G_SOURCE_CONTINUE;
+		}
+
+		run->idle = 0;
+		D3DTest::finish(run);
+		return G_SOURCE_REMOVE;
+	}
+
+	/**
+	 * The test window was closed mid-run: stop rendering to it.
+	 */
+	private:static void onDestroy(GtkWidget* window, D3DTestRun* run) {
+		if (run->window == NULL) return; //release() is destroying it
+
+		run->window = NULL;
+		if (run->idle != 0) g_source_remove(run->idle);
+		run->idle = 0;
+
+		gtk_label_set_text(run->output, "Direct3D test cancelled: the test window was closed.");
+		D3DTest::release(run);
+	}
+
+	/**
+	 * "Test Direct3D" button: open the test window and run every scene.
+	 * Report goes to "output".
+	 */
+	public:static void onClicked(GtkButton* button, GtkLabel* output) {
+		std::cout << "D3DTest::onClicked()\n";
+
+		D3DTestRun* run = new D3DTestRun();
+		run->output = output;
+		run->button = GTK_WIDGET(button);
+		gtk_widget_set_sensitive(run->button, FALSE);
+
+		run->window = gtk_window_new();
+		gtk_window_set_title(GTK_WINDOW(run->window), "Direct3D Test");
+		gtk_window_set_default_size(GTK_WINDOW(run->window), width, height);
+		gtk_window_set_resizable(GTK_WINDOW(run->window), FALSE);
+		g_signal_connect(run->window, "destroy", G_CALLBACK(D3DTest::onDestroy), run);
+		gtk_widget_show(run->window);
+
+		run->d3d = Direct3DCreate9(D3D_SDK_VERSION);
+		if (run->d3d != NULL) {
+			run->device = D3DTest::createDevice(run->d3d, run->window);
+		}
+		if (run->device == NULL) {
+			gtk_label_set_text(output, "Direct3D test failed: could not create a Direct3D device.");
+			D3DTest::release(run);
+			return;
+		}
+
+		run->texture = D3DTest::createTexture(run->device);
+		run->idle = g_idle_add((GSourceFunc) D3DTest::step, run);
+	}
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <iostream>
+
+#include <gtk/gtk.h>
+
+#include <types/Translation.hpp>
+#include "../locale/locale.hpp"
+#include "D3DTest.hpp"
+#include "TabLoader.hpp"
+
+class DisplayTab {
+	/**
+	 * Set the text from "d3daccel_val" to whether a Direct3D device can be created.
+	 */
+	public:static gboolean setD3DAccel(GtkLabel* label, Translation_t* lang) {
+		bool available = D3DTest::isAvailable(GTK_WIDGET(gtk_widget_get_root(GTK_WIDGET(label))));
+
+		gtk_label_set_text(label, available ? lang->enabled : lang->not_available);
+		return FALSE;
+	}
+
+	/**
+	 * Translate the tab title and build the page lazily
+	 * from DisplayTab.ui when it is first shown.
+	 */
+	public:static void lazy(GtkBuilder* builder) {
+		Translation_t lang = Translation_current();
+
+		GtkLabel* tab_display = GTK_LABEL(gtk_builder_get_object(builder, "tab_display_txt"));
+		gtk_label_set_text(tab_display, lang.tab_display);
+
+		TabLoader::add(builder, "display_page", "/org/opendx/dxdiag/DisplayTab.ui", [](GtkBuilder* page) {
+			new DisplayTab(page);
+		});
+	}
+
+	/**
+	 * setup IDs and it's events
+	 */
+	public:DisplayTab(GtkBuilder* builder) {
+		std::cout << "DisplayTab::setup()\n";
+
+		this->lang = Translation_current();
+		this->setupLang(builder);
+		this->setupSignals(builder);
+	}
+
+	private:Translation_t lang;
+
+	private:void setupLang(GtkBuilder* builder) {
+		GtkLabel* display_features_label = GTK_LABEL(gtk_builder_get_object(builder, "display_features_label"));
+		gtk_label_set_text(display_features_label, lang.display_features_label);
+		GtkLabel* display_features_d3dAccel = GTK_LABEL(gtk_builder_get_object(builder, "display_features_d3dAccel"));
+		gtk_label_set_text(display_features_d3dAccel, lang.display_features_d3dAccel);
+		GtkButton* d3dtest_btn = GTK_BUTTON(gtk_builder_get_object(builder, "d3dtest_btn"));
+		gtk_button_set_label(d3dtest_btn, lang.display_features_d3dTest);
+		GtkLabel* display_notes_label = GTK_LABEL(gtk_builder_get_object(builder, "display_notes_label"));
+		gtk_label_set_text(display_notes_label, lang.display_notes_label);
+	}
+
+	private:void setupSignals(GtkBuilder* builder) {
+		GtkLabel* d3daccel_val = GTK_LABEL(gtk_builder_get_object(builder, "d3daccel_val"));
+		g_signal_connect (d3daccel_val, "realize", G_CALLBACK (DisplayTab::setD3DAccel), &this->lang);
+		GtkLabel* display_notes_val = GTK_LABEL(gtk_builder_get_object(builder, "display_notes_val"));
+		GtkButton* d3dtest_btn = GTK_BUTTON(gtk_builder_get_object(builder, "d3dtest_btn"));
+		g_signal_connect (d3dtest_btn, "clicked", G_CALLBACK (D3DTest::onClicked), display_notes_val);
+	}
+};
@@ -0,0 +1,235 @@
+#pragma once
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <link.h>
+
+#include <gtk/gtk.h>
+
+#include <config.hpp>
+#include <types/Translation.hpp>
+#include "../locale/locale.hpp"
+#include "utils/FileHash.hpp"
+#include "Report.hpp"
+#include "TabLoader.hpp"
+
+struct DirectXFile {
+	std::string name;
+	std::string version;
+	FileHash::Info info;
+};
+
+class FilesTab {
+	/**
+	 * Everything OpenDX installs. dxdiag itself is listed last.
+	 */
+	private:static constexpr const char* libraries[] = {"libd3d9.so", "libd3dx9.so", "libdsetup.so", "libopendx.so"};
+
+	private:static int onLoadedObject(struct dl_phdr_info* info, size_t, void* data) {
+		std::pair<std::string, std::string>* search = (std::pair<std::string, std::string>*) data;
+		std::string path = info->dlpi_name;
+
+		if (std::filesystem::path(path).filename().string().rfind(search->first, 0) == 0) {
+			search->second = path;
+			return 1;
+		}
+
+		return 0;
+	}
+
+	/**
+	 * Prefer the copy that is actually loaded, then the usual
+	 * install locations (relative to dxdiag first, for the .deb
+	 * layout and build trees).
+	 */
+	private:static std::string locate(const std::string& library) {
+		std::pair<std::string, std::string> search = {library, ""};
+		dl_iterate_phdr(FilesTab::onLoadedObject, &search);
+		if (!search.second.empty()) return search.second;
+
+		std::error_code ec;
+		std::filesystem::path exe = std::filesystem::read_symlink("/proc/self/exe", ec);
+		std::vector<std::filesystem::path> dirs = {exe.parent_path().parent_path() / "lib", "/usr/lib", "/usr/local/lib", "/usr/lib/x86_64-linux-gnu"};
+
+		for (const std::filesystem::path& dir : dirs) {
+			if (std::filesystem::exists(dir / library, ec)) return dir / library;
+		}
+
+		return "";
+	}
+
+	/**
+	 * "1.0.0" from the libX.so.1.0.0 the symlinks point to.
+	 */
+	private:static std::string version(const std::string& path) {
+		std::error_code ec;
+		std::string real = std::filesystem::canonical(path, ec).filename();
+		size_t so = real.find(".so.");
+
+		return (ec || so == std::string::npos) ? "Unknown" : real.substr(so + 4);
+	}
+
+	/**
+	 * Locate and hash every component. Runs off the main thread.
+	 */
+	public:static std::vector<DirectXFile> collect() {
+		std::vector<DirectXFile> files;
+		std::vector<std::string> paths;
+
+		for (const char* library : libraries) {
+			std::string path = FilesTab::locate(library);
+			files.push_back({library, path.empty() ? "" : FilesTab::version(path), {}});
+			paths.push_back(path);
+		}
+
+		std::error_code ec;
+		std::string exe = std::filesystem::read_symlink("/proc/self/exe", ec);
+		files.push_back({"dxdiag", OPENDX_VERSION, {}});
+		paths.push_back(exe);
+
+		std::vector<FileHash::Info> infos = FileHash::hashAll(paths);
+		for (size_t i = 0; i < files.size(); i++) {
+			files[i].info = infos[i];
+		}
+
+		return files;
+	}
+
+	private:static std::string size(uint64_t bytes) {
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(1);
+
+		if (bytes >= 1024 * 1024) out << bytes / (1024.0 * 1024) << " MB";
+		else out << bytes / 1024.0 << " KB";
+
+		return out.str();
+	}
+
+	private:static std::string crc(uint32_t value) {
+		std::ostringstream out;
+		out << std::hex << std::setw(8) << std::setfill('0') << value;
+		return out.str();
+	}
+
+	/**
+	 * Name, Version, Size, CRC32C, Build ID, Path.
+	 */
+	private:static std::vector<std::string> columns(const DirectXFile& file, const Translation_t& lang) {
+		if (!file.info.found) {
+			return {file.name, lang.files_missing, "", "", "", ""};
+		}
+
+		return {
+			file.name,
+			file.version,
+			FilesTab::size(file.info.size),
+			FilesTab::crc(file.info.crc),
+			file.info.buildId.empty() ? lang.not_available : file.info.buildId,
+			file.info.path
+		};
+	}
+
+	/**
+	 * "DirectX Files" section of DxDiag.txt.
+	 */
+	public:static std::string report() {
+		Translation_t lang = Translation_current();
+		std::ostringstream out;
+
+		for (const DirectXFile& file : FilesTab::collect()) {
+			std::vector<std::string> c = FilesTab::columns(file, lang);
+			out << std::setw(16) << c[0] << ": " << c[1];
+			if (file.info.found) {
+				out << ", " << c[2] << ", crc32c " << c[3] << ", build-id " << c[4] << ", " << c[5];
+			}
+			out << '\n';
+		}
+
+		return out.str();
+	}
+
+	private:static void hash(GTask* task, gpointer, gpointer, GCancellable*) {
+		g_task_return_pointer(task, new std::vector<DirectXFile>(FilesTab::collect()), NULL);
+	}
+
+	/**
+	 * Back on the main thread: one grid row per file.
+	 */
+	private:static void onHashed(GObject*, GAsyncResult* result, gpointer data) {
+		GtkGrid* grid = GTK_GRID(data);
+		std::vector<DirectXFile>* files = (std::vector<DirectXFile>*) g_task_propagate_pointer(G_TASK(result), NULL);
+		Translation_t lang = Translation_current();
+		int row = 1;
+
+		for (const DirectXFile& file : *files) {
+			std::vector<std::string> c = FilesTab::columns(file, lang);
+
+			for (int column = 0; column < (int) c.size(); column++) {
+				GtkWidget* label = gtk_label_new(c[column].c_str());
+				gtk_label_set_xalign(GTK_LABEL(label), 0);
+				gtk_label_set_selectable(GTK_LABEL(label), TRUE);
+				gtk_grid_attach(grid, label, column, row, 1, 1);
+			}
+
+			row++;
+		}
+
+		delete files;
+		g_object_unref(grid);
+	}
+
+	/**
+	 * Translate the tab title, register the report section and
+	 * build the page lazily from FilesTab.ui when it is first shown.
+	 */
+	public:static void lazy(GtkBuilder* builder) {
+		Translation_t lang = Translation_current();
+
+		GtkLabel* tab_files = GTK_LABEL(gtk_builder_get_object(builder, "tab_files_txt"));
+		gtk_label_set_text(tab_files, lang.tab_files);
+
+		Report::add("DirectX Files", FilesTab::report);
+
+		TabLoader::add(builder, "files_page", "/org/opendx/dxdiag/FilesTab.ui", [](GtkBuilder* page) {
+			new FilesTab(page);
+		});
+	}
+
+	/**
+	 * setup IDs and it's events
+	 */
+	public:FilesTab(GtkBuilder* builder) {
+		std::cout << "FilesTab::setup()\n";
+
+		this->lang = Translation_current();
+		this->setupLang(builder);
+
+		//hashing reads whole binaries on a cold cache, keep it off the main loop
+		GtkGrid* grid = GTK_GRID(gtk_builder_get_object(builder, "files_grid"));
+		GTask* task = g_task_new(NULL, NULL, FilesTab::onHashed, g_object_ref(grid));
+		g_task_run_in_thread(task, FilesTab::hash);
+		g_object_unref(task);
+	}
+
+	private:Translation_t lang;
+
+	private:void setupLang(GtkBuilder* builder) {
+		GtkLabel* files_label = GTK_LABEL(gtk_builder_get_object(builder, "files_label"));
+		gtk_label_set_text(files_label, lang.files_label);
+		GtkLabel* files_name = GTK_LABEL(gtk_builder_get_object(builder, "files_name"));
+		gtk_label_set_text(files_name, lang.files_name);
+		GtkLabel* files_version = GTK_LABEL(gtk_builder_get_object(builder, "files_version"));
+		gtk_label_set_text(files_version, lang.files_version);
+		GtkLabel* files_size = GTK_LABEL(gtk_builder_get_object(builder, "files_size"));
+		gtk_label_set_text(files_size, lang.files_size);
+		GtkLabel* files_hash = GTK_LABEL(gtk_builder_get_object(builder, "files_hash"));
+		gtk_label_set_text(files_hash, lang.files_hash);
+		GtkLabel* files_buildId = GTK_LABEL(gtk_builder_get_object(builder, "files_buildId"));
+		gtk_label_set_text(files_buildId, lang.files_buildId);
+		GtkLabel* files_path = GTK_LABEL(gtk_builder_get_object(builder, "files_path"));
+		gtk_label_set_text(files_path, lang.files_path);
+	}
+};
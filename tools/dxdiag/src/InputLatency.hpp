@@ -0,0 +1,291 @@
+#pragma once
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+#include <cstdint>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+
+#include <gtk/gtk.h>
+
+/**
+ * Latency samples of one delivery path, in milliseconds.
+ */
+struct InputLatencyHistogram {
+	static constexpr const int buckets = 9;
+	static constexpr const double limits[buckets - 1] = {0.25, 0.5, 1, 2, 4, 8, 16, 32};
+
+	unsigned int counts[buckets] = {};
+	std::vector<double> samples;
+
+	void add(double ms) {
+		int b = 0;
+		while (b < buckets - 1 && ms >= limits[b]) b++;
+
+		counts[b]++;
+		samples.push_back(ms);
+	}
+
+	double percentile(double p) const {
+		if (samples.empty()) return 0;
+
+		std::vector<double> sorted = samples;
+		size_t n = std::min(sorted.size() - 1, (size_t) (p * sorted.size()));
+		std::nth_element(sorted.begin(), sorted.begin() + n, sorted.end());
+		return sorted[n];
+	}
+};
+
+/**
+ * Input latency tester.
+ *
+ * Two paths are measured from the kernel's event timestamp:
+ * - evdev: a worker thread reading /dev/input/event* directly
+ *   (CLOCK_MONOTONIC timestamps via EVIOCSCLOCKID).
+ * - message: GDK events dispatched by the GLib main loop, which is
+ *   what libopendx's PeekMessage/GetMessage pump. GDK timestamps are
+ *   milliseconds, so this path has 1ms resolution.
+ * The gap between both is pipeline latency; a large evdev number on
+ * its own points at the device.
+ */
+class InputLatency {
+	private:struct Rate {
+		double sum = 0; //ms between SYN_REPORTs
+		unsigned int count = 0;
+		gint64 last = 0; //us
+	};
+
+	private:static inline std::mutex mutex;
+	private:static inline InputLatencyHistogram evdev;
+	private:static inline InputLatencyHistogram message;
+	private:static inline std::map<std::string, Rate> rates; //by event node
+	private:static inline std::atomic<bool> running = false;
+	private:static inline std::thread reader;
+	private:static inline std::atomic<int> readable = -1; //-1 until the worker has opened the nodes
+
+	private:static inline GtkWidget* histogram = NULL;
+	private:static inline GtkLabel* stats = NULL;
+	private:static inline std::vector<GtkEventController*> controllers;
+	private:static inline guint timer = 0;
+
+	private:static double nowMs() {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+	}
+
+	/**
+	 * evdev worker: one SYN_REPORT is one input report.
+	 */
+	private:static void readEvdev() {
+		std::vector<struct pollfd> fds;
+		std::vector<std::string> nodes;
+		int clock = CLOCK_MONOTONIC;
+
+		for (const auto& entry : std::filesystem::directory_iterator("/dev/input")) {
+			std::string name = entry.path().filename();
+			if (name.rfind("event", 0) != 0) continue;
+
+			int fd = open(entry.path().c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+			if (fd < 0) continue;
+
+			ioctl(fd, EVIOCSCLOCKID, &clock);
+			fds.push_back({fd, POLLIN, 0});
+			nodes.push_back(name);
+		}
+
+		readable = fds.size();
+
+		while (running) {
+			if (poll(fds.data(), fds.size(), 100) <= 0) continue;
+
+			for (size_t i = 0; i < fds.size(); i++) {
+				if (!(fds[i].revents & POLLIN)) continue;
+
+				struct input_event events[64];
+				ssize_t n = read(fds[i].fd, events, sizeof(events));
+				double now = InputLatency::nowMs();
+
+				for (ssize_t e = 0; e < n / (ssize_t) sizeof(struct input_event); e++) {
+					const struct input_event& ev = events[e];
+					if (ev.type != EV_SYN || ev.code != SYN_REPORT) continue;
+
+					gint64 stamp = ev.input_event_sec * 1000000LL + ev.input_event_usec;
+					std::lock_guard<std::mutex> lock(mutex);
+					evdev.add(now - stamp / 1e3);
+
+					Rate& rate = rates[nodes[i]];
+					double interval = (stamp - rate.last) / 1e3;
+					if (rate.last != 0 && interval > 0 && interval < 50) {
+						rate.sum += interval;
+						rate.count++;
+					}
+					rate.last = stamp;
+				}
+			}
+		}
+
+		for (struct pollfd& fd : fds) close(fd.fd);
+	}
+
+	/**
+	 * Events dispatched through the main loop.
+	 */
+	private:static void onEvent(GtkEventController* controller) {
+		GdkEvent* event = gtk_event_controller_get_current_event(controller);
+		if (event == NULL) return;
+
+		//event times are 32-bit milliseconds that wrap every ~49.7 days: subtract in 32 bits
+		const double now = InputLatency::nowMs();
+		const uint32_t whole = (uint32_t) (uint64_t) now;
+		const double ms = (uint32_t) (whole - gdk_event_get_time(event)) + (now - (uint64_t) now);
+		if (ms > 1000) return; //timestamp from a different clock
+
+		std::lock_guard<std::mutex> lock(mutex);
+		message.add(ms);
+	}
+
+	private:static void onMotion(GtkEventControllerMotion* controller, double x, double y, gpointer) {
+		InputLatency::onEvent(GTK_EVENT_CONTROLLER(controller));
+	}
+
+	private:static gboolean onKey(GtkEventControllerKey* controller, guint keyval, guint keycode, GdkModifierType state, gpointer) {
+		InputLatency::onEvent(GTK_EVENT_CONTROLLER(controller));
+		return FALSE;
+	}
+
+	private:static std::string describe(const char* name, const InputLatencyHistogram& h) {
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(2) << name << ": ";
+
+		if (h.samples.empty()) {
+			out << "no events";
+		} else {
+			out << h.samples.size() << " events, median " << h.percentile(0.5)
+				<< "ms, p99 " << h.percentile(0.99) << "ms";
+		}
+
+		return out.str();
+	}
+
+	private:static gboolean refresh(gpointer) {
+		std::ostringstream out;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			out << InputLatency::describe("evdev", evdev) << '\n'
+				<< InputLatency::describe("message", message);
+
+			if (readable == 0) {
+				out << "\nNo readable /dev/input devices (is the user in the \"input\" group?)";
+			}
+			for (const auto& [node, rate] : rates) {
+				if (rate.count >= 20) {
+					out << '\n' << node << ": ~" << std::setprecision(0) << 1000.0 / (rate.sum / rate.count) << "Hz measured";
+				}
+			}
+		}
+
+		gtk_label_set_text(stats, out.str().c_str());
+		gtk_widget_queue_draw(histogram);
+		return G_SOURCE_CONTINUE;
+	}
+
+	/**
+	 * Bars per bucket: evdev (blue) and message (orange), each as
+	 * a share of its own sample count.
+	 */
+	public:static void draw(GtkDrawingArea* area, cairo_t* cr, int width, int height, gpointer) {
+		std::lock_guard<std::mutex> lock(mutex);
+		const int b = InputLatencyHistogram::buckets;
+		const double slot = (double) width / b;
+		const double top = height - 14;
+		const char* names[b] = {"<.25", "<.5", "<1", "<2", "<4", "<8", "<16", "<32", "32+"};
+		const InputLatencyHistogram* paths[2] = {&evdev, &message};
+
+		cairo_set_font_size(cr, 10);
+
+		for (int i = 0; i < b; i++) {
+			for (int p = 0; p < 2; p++) {
+				size_t total = paths[p]->samples.size();
+				double share = total ? (double) paths[p]->counts[i] / total : 0;
+
+				if (p == 0) cairo_set_source_rgb(cr, 0.20, 0.45, 0.85);
+				else cairo_set_source_rgb(cr, 0.95, 0.55, 0.15);
+
+				cairo_rectangle(cr, i * slot + 2 + p * (slot - 4) / 2, top * (1 - share), (slot - 4) / 2, top * share);
+				cairo_fill(cr);
+			}
+
+			cairo_set_source_rgb(cr, 0.5, 0.5, 0.5);
+			cairo_move_to(cr, i * slot + 2, height - 2);
+			cairo_show_text(cr, names[i]);
+		}
+	}
+
+	public:static void setup(GtkWidget* area, GtkLabel* label) {
+		histogram = area;
+		stats = label;
+		gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(area), InputLatency::draw, NULL, NULL);
+	}
+
+	public:static bool isRunning() {
+		return running;
+	}
+
+	public:static void start() {
+		if (running) return;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			evdev = InputLatencyHistogram();
+			message = InputLatencyHistogram();
+			rates.clear();
+		}
+
+		readable = -1;
+		running = true;
+		reader = std::thread(InputLatency::readEvdev);
+
+		GtkWidget* window = GTK_WIDGET(gtk_widget_get_root(histogram));
+		GtkEventController* motion = gtk_event_controller_motion_new();
+		g_signal_connect (motion, "motion", G_CALLBACK (InputLatency::onMotion), NULL);
+		GtkEventController* key = gtk_event_controller_key_new();
+		g_signal_connect (key, "key-pressed", G_CALLBACK (InputLatency::onKey), NULL);
+
+		for (GtkEventController* controller : {motion, key}) {
+			gtk_event_controller_set_propagation_phase(controller, GTK_PHASE_CAPTURE);
+			gtk_widget_add_controller(window, controller);
+			controllers.push_back(controller);
+		}
+
+		timer = g_timeout_add(250, InputLatency::refresh, NULL);
+	}
+
+	public:static void stop() {
+		if (!running) return;
+
+		running = false;
+		reader.join();
+
+		for (GtkEventController* controller : controllers) {
+			gtk_widget_remove_controller(gtk_event_controller_get_widget(controller), controller);
+		}
+		controllers.clear();
+
+		g_source_remove(timer);
+		timer = 0;
+		InputLatency::refresh(NULL);
+	}
+};
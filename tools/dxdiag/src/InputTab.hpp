@@ -0,0 +1,220 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+
+#include <gtk/gtk.h>
+
+#include <types/Translation.hpp>
+#include "../locale/locale.hpp"
+#include "InputLatency.hpp"
+#include "TabLoader.hpp"
+
+struct InputDevice {
+	int number; //N in eventN, for sorting
+	std::string path;
+	std::string name;
+	std::string bus;
+	std::string rate;
+};
+
+class InputTab {
+	private:static std::string readLine(const std::filesystem::path& path) {
+		std::ifstream file(path);
+		std::string line;
+
+		if (file.is_open()) {
+			std::getline(file, line);
+		}
+
+		return line;
+	}
+
+	private:static std::string busName(const std::string& hex) {
+		int bus = (int) std::strtol(hex.c_str(), NULL, 16); //0 for garbage, where stoi would throw
+
+		switch (bus) {
+			case BUS_USB: return "USB";
+			case BUS_BLUETOOTH: return "Bluetooth";
+			case BUS_I8042: return "PS/2";
+			case BUS_I2C: return "I2C";
+			case BUS_HOST: return "Host";
+			case BUS_VIRTUAL: return "Virtual";
+			default: return hex.empty() ? "Unknown" : hex;
+		}
+	}
+
+	/**
+	 * USB HID devices expose their configured interrupt endpoint
+	 * interval in sysfs (ep_XX/interval, e.g. "8ms" or "125us"). The
+	 * endpoints sit on the USB interface bound to usbhid, a few levels
+	 * above the input node; the walk only passes input and hid nodes
+	 * on the way, so devices on other buses (bluetooth, i2c, serio)
+	 * are never matched with a USB controller further up.
+	 */
+	private:static std::string pollingRate(const std::filesystem::path& device) {
+		std::error_code ec;
+		std::filesystem::path node = std::filesystem::canonical(device / "device", ec);
+		if (ec) return "Unknown";
+
+		for (; node.has_relative_path() && node != "/sys/devices"; node = node.parent_path()) {
+			std::string subsystem = std::filesystem::canonical(node / "subsystem", ec).filename();
+			if (ec || subsystem == "input" || subsystem == "hid") continue;
+			if (subsystem != "usb" || std::filesystem::canonical(node / "driver", ec).filename() != "usbhid" || ec) break;
+
+			for (const auto& entry : std::filesystem::directory_iterator(node, ec)) {
+				std::string name = entry.path().filename();
+				if (name.rfind("ep_", 0) != 0) continue;
+				if (readLine(entry.path() / "type") != "Interrupt" || readLine(entry.path() / "direction") != "in") continue;
+
+				std::string interval = readLine(entry.path() / "interval");
+				double us = std::atof(interval.c_str());
+				if (interval.find("ms") != std::string::npos) us *= 1000;
+				if (us <= 0) continue;
+
+				return std::to_string((int) (1e6 / us)) + "Hz (" + interval + ")";
+			}
+			break;
+		}
+
+		return "Unknown";
+	}
+
+	/**
+	 * Runs on a GTask worker thread: sysfs reads can block on
+	 * slow buses and must not delay the first paint.
+	 */
+	private:static void enumerate(GTask* task, gpointer, gpointer, GCancellable*) {
+		std::vector<InputDevice>* devices = new std::vector<InputDevice>();
+		std::error_code ec;
+
+		for (const auto& entry : std::filesystem::directory_iterator("/sys/class/input", ec)) {
+			std::string node = entry.path().filename();
+			if (node.rfind("event", 0) != 0) continue;
+
+			std::filesystem::path device = entry.path() / "device";
+			devices->push_back({
+				std::atoi(node.c_str() + 5),
+				"/dev/input/" + node,
+				readLine(device / "name"),
+				busName(readLine(device / "id" / "bustype")),
+				pollingRate(device)
+			});
+		}
+
+		std::sort(devices->begin(), devices->end(), [](const InputDevice& a, const InputDevice& b) {
+			return a.number < b.number;
+		});
+
+		g_task_return_pointer(task, devices, NULL);
+	}
+
+	/**
+	 * Back on the main thread: one grid row per device.
+	 */
+	private:static void onEnumerated(GObject*, GAsyncResult* result, gpointer data) {
+		GtkGrid* grid = GTK_GRID(data);
+		std::vector<InputDevice>* devices = (std::vector<InputDevice>*) g_task_propagate_pointer(G_TASK(result), NULL);
+		int row = 1;
+
+		for (const InputDevice& device : *devices) {
+			const std::string* columns[] = {&device.name, &device.path, &device.bus, &device.rate};
+
+			for (int column = 0; column < 4; column++) {
+				GtkWidget* label = gtk_label_new(columns[column]->c_str());
+				gtk_label_set_xalign(GTK_LABEL(label), 0);
+				gtk_label_set_selectable(GTK_LABEL(label), TRUE);
+				gtk_grid_attach(grid, label, column, row, 1, 1);
+			}
+
+			row++;
+		}
+
+		delete devices;
+		g_object_unref(grid);
+	}
+
+	private:static void onLatencyClicked(GtkButton* button, Translation_t* lang) {
+		if (InputLatency::isRunning()) {
+			InputLatency::stop();
+			gtk_button_set_label(button, lang->input_latency_start);
+		} else {
+			InputLatency::start();
+			gtk_button_set_label(button, lang->input_latency_stop);
+		}
+	}
+
+	/**
+	 * Never keep the reader thread running behind another tab.
+	 */
+	private:static void onUnmap(GtkWidget* widget, GtkButton* button) {
+		if (InputLatency::isRunning()) {
+			gtk_button_clicked(button);
+		}
+	}
+
+	/**
+	 * Translate the tab title and build the page lazily
+	 * from InputTab.ui when it is first shown.
+	 */
+	public:static void lazy(GtkBuilder* builder) {
+		Translation_t lang = Translation_current();
+
+		GtkLabel* tab_input = GTK_LABEL(gtk_builder_get_object(builder, "tab_input_txt"));
+		gtk_label_set_text(tab_input, lang.tab_input);
+
+		TabLoader::add(builder, "input_page", "/org/opendx/dxdiag/InputTab.ui", [](GtkBuilder* page) {
+			new InputTab(page);
+		});
+	}
+
+	/**
+	 * setup IDs and it's events
+	 */
+	public:InputTab(GtkBuilder* builder) {
+		std::cout << "InputTab::setup()\n";
+
+		this->lang = Translation_current();
+		this->setupLang(builder);
+		this->setupSignals(builder);
+
+		GtkGrid* grid = GTK_GRID(gtk_builder_get_object(builder, "input_devices_grid"));
+		GTask* task = g_task_new(NULL, NULL, InputTab::onEnumerated, g_object_ref(grid));
+		g_task_run_in_thread(task, InputTab::enumerate);
+		g_object_unref(task);
+	}
+
+	private:Translation_t lang;
+
+	private:void setupLang(GtkBuilder* builder) {
+		GtkLabel* input_devices_label = GTK_LABEL(gtk_builder_get_object(builder, "input_devices_label"));
+		gtk_label_set_text(input_devices_label, lang.input_devices_label);
+		GtkLabel* input_device_name = GTK_LABEL(gtk_builder_get_object(builder, "input_device_name"));
+		gtk_label_set_text(input_device_name, lang.input_device_name);
+		GtkLabel* input_device_path = GTK_LABEL(gtk_builder_get_object(builder, "input_device_path"));
+		gtk_label_set_text(input_device_path, lang.input_device_path);
+		GtkLabel* input_device_bus = GTK_LABEL(gtk_builder_get_object(builder, "input_device_bus"));
+		gtk_label_set_text(input_device_bus, lang.input_device_bus);
+		GtkLabel* input_device_pollingRate = GTK_LABEL(gtk_builder_get_object(builder, "input_device_pollingRate"));
+		gtk_label_set_text(input_device_pollingRate, lang.input_device_pollingRate);
+		GtkLabel* input_latency_label = GTK_LABEL(gtk_builder_get_object(builder, "input_latency_label"));
+		gtk_label_set_text(input_latency_label, lang.input_latency_label);
+		GtkButton* input_latency_btn = GTK_BUTTON(gtk_builder_get_object(builder, "input_latency_btn"));
+		gtk_button_set_label(input_latency_btn, lang.input_latency_start);
+	}
+
+	private:void setupSignals(GtkBuilder* builder) {
+		GtkWidget* input_latency_histogram = GTK_WIDGET(gtk_builder_get_object(builder, "input_latency_histogram"));
+		GtkLabel* input_latency_stats = GTK_LABEL(gtk_builder_get_object(builder, "input_latency_stats"));
+		InputLatency::setup(input_latency_histogram, input_latency_stats);
+
+		GtkButton* input_latency_btn = GTK_BUTTON(gtk_builder_get_object(builder, "input_latency_btn"));
+		g_signal_connect (input_latency_btn, "clicked", G_CALLBACK (InputTab::onLatencyClicked), &this->lang);
+		GtkWidget* tab_content = GTK_WIDGET(gtk_builder_get_object(builder, "tab_content"));
+		g_signal_connect (tab_content, "unmap", G_CALLBACK (InputTab::onUnmap), input_latency_btn);
+	}
+};
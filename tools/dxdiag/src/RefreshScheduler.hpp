@@ -0,0 +1,142 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+
+#include <gtk/gtk.h>
+
+/**
+ * Single timer for every live field in dxdiag.
+ *
+ * Fields are labels paired with a function returning their current text.
+ * The timer wakes once per second, aligned to the wall clock second, and
+ * only touches labels whose text changed. It is removed entirely while no
+ * field is mapped (window hidden, tab not shown) or the window is minimized,
+ * so an idle dxdiag costs no CPU.
+ */
+class RefreshScheduler {
+	public:typedef std::string (*Getter)();
+
+	private:struct Field {
+		GtkLabel* label;
+		Getter getter;
+		std::string last;
+		bool mapped;
+	};
+
+	private:static inline std::vector<Field> fields;
+	private:static inline guint source = 0;
+	private:static inline bool minimized = false;
+
+	/**
+	 * Register "label" to be refreshed with "getter" while it is on screen.
+	 */
+	public:static void add(GtkLabel* label, Getter getter) {
+		fields.push_back({label, getter, "", false});
+
+		g_signal_connect (label, "map", G_CALLBACK (RefreshScheduler::onMap), NULL);
+		g_signal_connect (label, "unmap", G_CALLBACK (RefreshScheduler::onUnmap), NULL);
+		g_signal_connect (label, "realize", G_CALLBACK (RefreshScheduler::onRealize), NULL);
+	}
+
+	private:static void refresh(Field& field) {
+		std::string value = field.getter();
+		if (value == field.last) return;
+
+		//gtk_label_set_text already queues the resize/redraw it needs
+		gtk_label_set_text(field.label, value.c_str());
+		field.last = value;
+	}
+
+	private:static gboolean tick(gpointer) {
+		for (Field& field : fields) {
+			if (field.mapped) RefreshScheduler::refresh(field);
+		}
+
+		return G_SOURCE_CONTINUE;
+	}
+
+	/**
+	 * First tick lands on the next wall clock second, then
+	 * g_timeout_add_seconds keeps it there with coalesced wakeups.
+	 */
+	private:static gboolean align(gpointer) {
+		RefreshScheduler::tick(NULL);
+		source = g_timeout_add_seconds(1, RefreshScheduler::tick, NULL);
+		return G_SOURCE_REMOVE;
+	}
+
+	private:static bool anyMapped() {
+		for (const Field& field : fields) {
+			if (field.mapped) return true;
+		}
+		return false;
+	}
+
+	/**
+	 * Start or stop the timer to match the current visibility.
+	 */
+	private:static void update() {
+		bool wanted = !minimized && RefreshScheduler::anyMapped();
+
+		if (wanted && source == 0) {
+			struct timeval now;
+			gettimeofday(&now, NULL);
+
+			source = g_timeout_add(1000 - now.tv_usec / 1000, RefreshScheduler::align, NULL);
+
+			#if DEBUG
+				std::cout << "RefreshScheduler: resumed\n";
+			#endif
+		} else if (!wanted && source != 0) {
+			g_source_remove(source);
+			source = 0;
+
+			#if DEBUG
+				std::cout << "RefreshScheduler: paused\n";
+			#endif
+		}
+	}
+
+	private:static Field* find(GtkWidget* widget) {
+		for (Field& field : fields) {
+			if (GTK_WIDGET(field.label) == widget) return &field;
+		}
+		return NULL;
+	}
+
+	private:static void onMap(GtkWidget* widget, gpointer) {
+		Field* field = RefreshScheduler::find(widget);
+		if (field == NULL) return;
+
+		field->mapped = true;
+		RefreshScheduler::refresh(*field); //don't show a stale value until the next tick
+		RefreshScheduler::update();
+	}
+
+	private:static void onUnmap(GtkWidget* widget, gpointer) {
+		Field* field = RefreshScheduler::find(widget);
+		if (field == NULL) return;
+
+		field->mapped = false;
+		RefreshScheduler::update();
+	}
+
+	/**
+	 * Widgets stay mapped while their window is minimized,
+	 * so follow the toplevel state too.
+	 */
+	private:static void onRealize(GtkWidget* widget, gpointer) {
+		GdkSurface* surface = gtk_native_get_surface(gtk_widget_get_native(widget));
+		if (surface == NULL || g_object_get_data(G_OBJECT(surface), "odx-refresh") != NULL) return;
+
+		g_object_set_data(G_OBJECT(surface), "odx-refresh", (gpointer) 1);
+		g_signal_connect (surface, "notify::state", G_CALLBACK (RefreshScheduler::onStateChanged), NULL);
+	}
+
+	private:static void onStateChanged(GdkSurface* surface, GParamSpec*, gpointer) {
+		minimized = (gdk_toplevel_get_state(GDK_TOPLEVEL(surface)) & GDK_TOPLEVEL_STATE_MINIMIZED) != 0;
+		RefreshScheduler::update();
+	}
+};
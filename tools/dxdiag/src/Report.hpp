@@ -0,0 +1,102 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtk/gtk.h>
+
+#include <types/Translation.hpp>
+#include "../locale/locale.hpp"
+
+/**
+ * "Save All Information..." report (DxDiag.txt).
+ *
+ * Tabs register a section with a function returning its body; the
+ * functions run when the report is saved, not when the tab is built,
+ * so a section is complete even if its tab was never opened.
+ */
+class Report {
+	public:typedef std::string (*Section)();
+
+	private:struct Entry {
+		std::string title;
+		Section section;
+	};
+
+	private:static inline std::vector<Entry> sections;
+
+	public:static void add(const std::string& title, Section section) {
+		sections.push_back({title, section});
+	}
+
+	/**
+	 * Same layout as Windows' DxDiag.txt: a dashed rule above and
+	 * below every section title.
+	 */
+	public:static std::string text() {
+		std::string out;
+
+		for (const Entry& entry : sections) {
+			std::string rule(entry.title.size(), '-');
+			out += rule + "\n" + entry.title + "\n" + rule + "\n";
+			out += entry.section() + "\n";
+		}
+
+		return out;
+	}
+
+	/**
+	 * Write the report to "path". Returns false when it can't be written.
+	 */
+	public:static bool save(const std::string& path) {
+		std::ofstream file(path);
+		if (!file.is_open()) return false;
+
+		file << Report::text();
+		return file.good();
+	}
+
+	/**
+	 * Runs on a GTask worker thread: sections hash whole binaries.
+	 */
+	private:static void write(GTask* task, gpointer, gpointer path, GCancellable*) {
+		g_task_return_boolean(task, Report::save((const gchar*) path));
+	}
+
+	/**
+	 * Back on the main thread: tell the user where it went.
+	 */
+	private:static void onSaved(GObject* button, GAsyncResult* result, gpointer) {
+		Translation_t lang = Translation_current();
+		const gchar* path = (const gchar*) g_task_get_task_data(G_TASK(result));
+
+		gtk_widget_set_sensitive(GTK_WIDGET(button), TRUE);
+
+		if (g_task_propagate_boolean(G_TASK(result), NULL)) {
+			GtkWindow* window = GTK_WINDOW(gtk_widget_get_root(GTK_WIDGET(button)));
+			GtkWidget* dialog = gtk_message_dialog_new(window, GTK_DIALOG_MODAL, GTK_MESSAGE_INFO, GTK_BUTTONS_OK, lang.files_saved, path);
+			g_signal_connect (dialog, "response", G_CALLBACK (gtk_window_destroy), NULL);
+			gtk_widget_show(dialog);
+		} else {
+			std::cout << "Report: can't write " << path << "\n";
+		}
+	}
+
+	/**
+	 * Saves to ~/DxDiag.txt off the main loop.
+	 */
+	public:static void onSaveClicked(GtkButton* button, gpointer) {
+		gtk_widget_set_sensitive(GTK_WIDGET(button), FALSE);
+
+		GTask* task = g_task_new(button, NULL, Report::onSaved, NULL);
+		g_task_set_task_data(task, g_build_filename(g_get_home_dir(), "DxDiag.txt", NULL), g_free);
+		g_task_run_in_thread(task, Report::write);
+		g_object_unref(task);
+	}
+
+	public:static void setup(GtkBuilder* builder) {
+		GtkButton* save_btn = GTK_BUTTON(gtk_builder_get_object(builder, "save_btn"));
+		g_signal_connect (save_btn, "clicked", G_CALLBACK (Report::onSaveClicked), NULL);
+	}
+};
@@ -15,37 +15,21 @@
 #include <gtk/gtk.h>
 
 #include <types/Translation.hpp>
-#include "../locale/en_US.hpp"
-#include "../locale/pt_BR.hpp"
-#include "../locale/es_ES.hpp"
+#include "../locale/locale.hpp"
+#include "RefreshScheduler.hpp"
 
 class SystemTab {
 	/**
-	 * Set the text from "date_val"to the actual date/time.
+	 * Text for "date_val": the actual date/time.
+	 * Refreshed by RefreshScheduler.
 	 */
-	public:static gboolean updateTime(GtkLabel* label) {
+	public:static std::string getTime() {
 		time_t t = time(NULL);
 		struct tm* time = localtime(&t);
 		gchar str_time[40];
 
 		strftime(str_time, sizeof(str_time), "%A, %b %d, %Y, %I:%M:%S %p", time);
-		gtk_label_set_text(label, str_time);
-
-		gtk_widget_queue_draw(GTK_WIDGET(label));
-		gtk_widget_queue_draw(gtk_widget_get_parent(GTK_WIDGET(label)));
-		gtk_widget_show(GTK_WIDGET(label));
-
-		return G_SOURCE_CONTINUE;
-	}
-
-	/**
-	 * set a timeout event every 500ms to set the actual date/time
-	 */
-	public:static gboolean onRealizeTime(GtkLabel* label) {
-		std::cout << "SystemTab::onRealizeTime()\n";
-
-		g_timeout_add (500, (GSourceFunc) SystemTab::updateTime, label);
-		return FALSE;
+		return str_time;
 	}
 
 	/**
@@ -269,25 +253,16 @@ class SystemTab {
 		return FALSE;
 	}
 
-	public:static gboolean updateSwap(GtkLabel* label) {
+	/**
+	 * Text for "swap_val". Refreshed by RefreshScheduler.
+	 */
+	public:static std::string getSwap() {
 		struct sysinfo info;
 		sysinfo(&info);
 
 		const int used = (info.totalswap - info.freeswap) / (1024 * 1024);
 		const int available = info.freeswap / (1024 * 1024);
-		std::string swap =  std::to_string(used) + "MB used, " + std::to_string(available) + "MB available";
-
-		const gchar* text = swap.c_str();
-
-		gtk_label_set_text(label, text);
-		gtk_widget_queue_draw(GTK_WIDGET(label));
-		gtk_widget_queue_draw(gtk_widget_get_parent(GTK_WIDGET(label)));
-		gtk_widget_show(GTK_WIDGET(label));
-	}
-
-	public:static gboolean setSwap(GtkLabel* label) {
-		g_timeout_add(500, (GSourceFunc) SystemTab::updateSwap, label);
-		return FALSE;
+		return std::to_string(used) + "MB used, " + std::to_string(available) + "MB available";
 	}
 
 	/**
@@ -301,21 +276,7 @@ class SystemTab {
 	}
 
 	private:void setupLang(GtkBuilder* builder) {
-		//get system locale
-		const char* locale = setlocale(LC_CTYPE, NULL);
-		Translation_t lang;
-
-		//instantiate Translation_{locale}() from tools/dxdiag/locale/{locale}.hpp
-		if (
-			strcmp(locale, "pt_BR.UTF-8") == 0 ||
-			strcmp(locale, "pt_PT.UTF-8") == 0
-		) {
-			lang = Translation_ptBR(); // >:)
-		} else if (strcmp(locale, "es_ES.UTF-8")) {
-			lang = Translation_esES();
-		} else {
-			lang = Translation_enUS();
-		}
+		Translation_t lang = Translation_current();
 
 		//set texts
 		GtkLabel* tab_system = GTK_LABEL(gtk_builder_get_object(builder, "tab_system_txt"));
@@ -352,7 +313,7 @@ class SystemTab {
 
 	private:void setupSignals(GtkBuilder* builder) {
 		GtkLabel* date_val = GTK_LABEL(gtk_builder_get_object(builder, "date_val"));
-		g_signal_connect (date_val, "realize", G_CALLBACK (SystemTab::onRealizeTime), NULL);
+		RefreshScheduler::add(date_val, SystemTab::getTime);
 		GtkLabel* pc_val = GTK_LABEL(gtk_builder_get_object(builder, "pc_val"));
 		g_signal_connect (pc_val, "realize", G_CALLBACK (SystemTab::setHostname), NULL);
 		GtkLabel* os_val = GTK_LABEL(gtk_builder_get_object(builder, "os_val"));
@@ -370,6 +331,6 @@ class SystemTab {
 		GtkLabel* ram_val = GTK_LABEL(gtk_builder_get_object(builder, "ram_val"));
 		g_signal_connect (ram_val, "realize", G_CALLBACK (SystemTab::setRAM), NULL);
 		GtkLabel* swap_val = GTK_LABEL(gtk_builder_get_object(builder, "swap_val"));
-		g_signal_connect (swap_val, "realize", G_CALLBACK (SystemTab::setSwap), NULL);
+		RefreshScheduler::add(swap_val, SystemTab::getSwap);
 	}
 };
@@ -0,0 +1,58 @@
+#pragma once
+#include <iostream>
+#include <vector>
+
+#include <gtk/gtk.h>
+
+/**
+ * Builds notebook pages the first time they are shown.
+ *
+ * MainWindow.ui only holds an empty box per page. When the page is
+ * switched to, its own .ui resource is loaded, the "tab_content"
+ * object is appended to that box and "setup" is called with the
+ * page's builder.
+ */
+class TabLoader {
+	public:typedef void (*Setup)(GtkBuilder* builder);
+
+	private:struct Tab {
+		GtkWidget* page;
+		const char* resource;
+		Setup setup;
+		bool built;
+	};
+
+	private:static inline std::vector<Tab> tabs;
+
+	/**
+	 * Register the page "page" (an id from MainWindow.ui) to be filled
+	 * with "resource" (a GResource path) on first show.
+	 */
+	public:static void add(GtkBuilder* builder, const char* page, const char* resource, Setup setup) {
+		if (tabs.empty()) {
+			GtkNotebook* notebook = GTK_NOTEBOOK(gtk_builder_get_object(builder, "main_notebook"));
+			g_signal_connect (notebook, "switch-page", G_CALLBACK (TabLoader::onSwitchPage), NULL);
+		}
+
+		tabs.push_back({GTK_WIDGET(gtk_builder_get_object(builder, page)), resource, setup, false});
+	}
+
+	private:static void build(Tab& tab) {
+		#if DEBUG
+			std::cout << "TabLoader: building " << tab.resource << '\n';
+		#endif
+
+		GtkBuilder* builder = gtk_builder_new_from_resource(tab.resource);
+		gtk_box_append(GTK_BOX(tab.page), GTK_WIDGET(gtk_builder_get_object(builder, "tab_content")));
+		tab.setup(builder);
+		tab.built = true;
+
+		g_object_unref(builder);
+	}
+
+	private:static void onSwitchPage(GtkNotebook* notebook, GtkWidget* page, guint num, gpointer) {
+		for (Tab& tab : tabs) {
+			if (tab.page == page && !tab.built) TabLoader::build(tab);
+		}
+	}
+};
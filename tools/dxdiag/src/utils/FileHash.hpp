@@ -0,0 +1,346 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <gtk/gtk.h>
+
+#if defined(__x86_64__)
+	#include <nmmintrin.h>
+#endif
+
+/**
+ * Content hashing for the DirectX Files tab.
+ *
+ * Files are mmap'ed and hashed with CRC32C, using the SSE4.2 crc32
+ * instruction when the CPU has it. Results are cached on disk by
+ * (device, inode, mtime, size), so unchanged binaries are never read
+ * again.
+ */
+namespace FileHash {
+	struct Info {
+		std::string path;
+		bool found = false;
+		uint64_t size = 0;
+		uint32_t crc = 0;
+		std::string buildId; //hex, empty when the file has none
+	};
+
+	typedef std::tuple<uint64_t, uint64_t, int64_t, uint64_t> Key; //dev, ino, mtime (ns), size
+
+	/**
+	 * CRC32C (Castagnoli), reflected polynomial 0x82F63B78.
+	 */
+	constexpr std::array<uint32_t, 256> crc32cTable() {
+		std::array<uint32_t, 256> table = {};
+
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++) {
+				c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+			}
+			table[i] = c;
+		}
+
+		return table;
+	}
+
+	inline uint32_t crc32cSoftware(uint32_t crc, const uint8_t* p, size_t n) {
+		static constexpr std::array<uint32_t, 256> table = crc32cTable();
+
+		while (n--) {
+			crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+		}
+
+		return crc;
+	}
+
+	/**
+	 * a * b modulo the CRC32C polynomial, both reflected (bit 31 is x^0).
+	 */
+	constexpr uint32_t crc32cMultiply(uint32_t a, uint32_t b) {
+		uint32_t product = 0;
+
+		for (uint32_t m = 1u << 31; m != 0; m >>= 1) {
+			if (a & m) product ^= b;
+			b = (b & 1) ? (b >> 1) ^ 0x82F63B78u : b >> 1;
+		}
+
+		return product;
+	}
+
+	/**
+	 * x^(8 * bytes) modulo the polynomial: multiplying a CRC by it
+	 * appends "bytes" zeros to the data it covers.
+	 */
+	constexpr uint32_t crc32cShift(size_t bytes) {
+		uint32_t r = 1u << 31; //x^0
+		uint32_t square = 1u << 23; //x^8
+
+		for (; bytes != 0; bytes >>= 1) {
+			if (bytes & 1) r = crc32cMultiply(r, square);
+			square = crc32cMultiply(square, square);
+		}
+
+		return r;
+	}
+
+	#if defined(__x86_64__)
+	__attribute__((target("sse4.2")))
+	inline uint32_t crc32cHardware(uint32_t crc, const uint8_t* p, size_t n) {
+		uint64_t c = crc;
+
+		while (n > 0 && ((uintptr_t) p & 7)) {
+			c = _mm_crc32_u8(c, *p++);
+			n--;
+		}
+		//crc32 has 3 cycles of latency and 1 of throughput: run three
+		//independent streams over consecutive blocks, then join them
+		static constexpr size_t block = 4096;
+		static constexpr uint32_t shift1 = crc32cShift(block);
+		static constexpr uint32_t shift2 = crc32cShift(2 * block);
+		while (n >= 3 * block) {
+			uint64_t c1 = 0, c2 = 0;
+			for (size_t i = 0; i < block; i += 8) {
+				uint64_t v[3];
+				memcpy(&v[0], p + i, 8);
+				memcpy(&v[1], p + block + i, 8);
+				memcpy(&v[2], p + 2 * block + i, 8);
+				c = _mm_crc32_u64(c, v[0]);
+				c1 = _mm_crc32_u64(c1, v[1]);
+				c2 = _mm_crc32_u64(c2, v[2]);
+			}
+			c = crc32cMultiply(shift2, c) ^ crc32cMultiply(shift1, c1) ^ c2;
+			p += 3 * block;
+			n -= 3 * block;
+		}
+		while (n >= 8) {
+			uint64_t v;
+			memcpy(&v, p, sizeof(v));
+			c = _mm_crc32_u64(c, v);
+			p += 8;
+			n -= 8;
+		}
+		while (n--) {
+			c = _mm_crc32_u8(c, *p++);
+		}
+
+		return c;
+	}
+	#endif
+
+	inline uint32_t crc32c(const uint8_t* p, size_t n) {
+		uint32_t crc = 0xffffffffu;
+
+		#if defined(__x86_64__)
+			static const bool hw = __builtin_cpu_supports("sse4.2");
+			crc = hw ? crc32cHardware(crc, p, n) : crc32cSoftware(crc, p, n);
+		#else
+			crc = crc32cSoftware(crc, p, n);
+		#endif
+
+		return ~crc;
+	}
+
+	/**
+	 * NT_GNU_BUILD_ID from the PT_NOTE segments of a mapped ELF64 file.
+	 */
+	inline std::string buildId(const uint8_t* data, size_t size) {
+		if (size < sizeof(Elf64_Ehdr) || memcmp(data, ELFMAG, SELFMAG) != 0 || data[EI_CLASS] != ELFCLASS64) {
+			return "";
+		}
+
+		const Elf64_Ehdr* eh = (const Elf64_Ehdr*) data;
+		if (eh->e_phoff == 0 || eh->e_phoff + (uint64_t) eh->e_phnum * sizeof(Elf64_Phdr) > size) return "";
+
+		const Elf64_Phdr* ph = (const Elf64_Phdr*) (data + eh->e_phoff);
+		for (int i = 0; i < eh->e_phnum; i++) {
+			if (ph[i].p_type != PT_NOTE || ph[i].p_offset + ph[i].p_filesz > size) continue;
+
+			size_t off = ph[i].p_offset;
+			size_t end = off + ph[i].p_filesz;
+
+			while (off + sizeof(Elf64_Nhdr) <= end) {
+				const Elf64_Nhdr* note = (const Elf64_Nhdr*) (data + off);
+				size_t name = off + sizeof(Elf64_Nhdr);
+				size_t desc = name + ((note->n_namesz + 3) & ~3u);
+				off = desc + ((note->n_descsz + 3) & ~3u);
+				if (off > end) break;
+
+				if (note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4 && memcmp(data + name, "GNU", 4) == 0) {
+					std::ostringstream hex;
+					for (size_t b = 0; b < note->n_descsz; b++) {
+						hex << std::hex << std::setw(2) << std::setfill('0') << (int) data[desc + b];
+					}
+					return hex.str();
+				}
+			}
+		}
+
+		return "";
+	}
+
+	/**
+	 * Hash one file through mmap.
+	 */
+	inline Info hash(const std::string& path) {
+		Info info;
+		info.path = path;
+
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) return info;
+
+		struct stat st;
+		if (fstat(fd, &st) == 0) {
+			info.found = true;
+			info.size = st.st_size;
+
+			void* map = st.st_size > 0 ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+			if (map != MAP_FAILED) {
+				madvise(map, st.st_size, MADV_SEQUENTIAL);
+				info.crc = crc32c((const uint8_t*) map, st.st_size);
+				info.buildId = buildId((const uint8_t*) map, st.st_size);
+				munmap(map, st.st_size);
+			}
+		}
+
+		close(fd);
+		return info;
+	}
+
+	/**
+	 * $XDG_CACHE_HOME/opendx/dxdiag/filehash.cache
+	 * One entry per line: dev ino mtime size crc buildid
+	 */
+	inline std::string cachePath() {
+		gchar* path = g_build_filename(g_get_user_cache_dir(), "opendx", "dxdiag", "filehash.cache", NULL);
+		std::string r = path;
+		g_free(path);
+		return r;
+	}
+
+	/**
+	 * Held from readCache() to writeCache() in hashAll(): the Files
+	 * tab and the report can hash at the same time.
+	 */
+	inline std::mutex cacheMutex;
+
+	inline std::map<Key, Info> readCache() {
+		std::map<Key, Info> cache;
+		std::ifstream file(cachePath());
+		uint64_t dev, ino, size;
+		int64_t mtime;
+		std::string crc, id;
+
+		while (file >> dev >> ino >> mtime >> size >> crc >> id) {
+			Info info;
+			info.found = true;
+			info.size = size;
+			try {
+				info.crc = std::stoul(crc, NULL, 16);
+			} catch (const std::logic_error&) {
+				continue; //damaged line, hashed again
+			}
+			info.buildId = id == "-" ? "" : id;
+			cache[{dev, ino, mtime, size}] = info;
+		}
+
+		return cache;
+	}
+
+	/**
+	 * Replaces the cache file through a temporary one, so a reader
+	 * never sees it half written. False if it could not be saved.
+	 */
+	inline bool writeCache(const std::map<Key, Info>& cache) {
+		std::string path = cachePath();
+		gchar* dir = g_path_get_dirname(path.c_str());
+		g_mkdir_with_parents(dir, 0755);
+		g_free(dir);
+
+		std::ostringstream file;
+		for (const auto& [key, info] : cache) {
+			file << std::get<0>(key) << ' ' << std::get<1>(key) << ' ' << std::get<2>(key) << ' ' << std::get<3>(key) << ' '
+				<< std::hex << std::setw(8) << std::setfill('0') << info.crc << std::dec << ' '
+				<< (info.buildId.empty() ? "-" : info.buildId) << '\n';
+		}
+
+		std::string contents = file.str();
+		return g_file_set_contents(path.c_str(), contents.data(), contents.size(), NULL);
+	}
+
+	/**
+	 * Hash "paths" on all cores. Cached entries are only stat'ed.
+	 */
+	inline std::vector<Info> hashAll(const std::vector<std::string>& paths) {
+		std::vector<Info> results(paths.size());
+		std::vector<Key> keys(paths.size());
+		std::vector<bool> pending(paths.size(), false);
+		std::map<Key, Info> cache;
+		bool dirty = false;
+
+		{
+			std::lock_guard<std::mutex> lock(cacheMutex);
+			cache = readCache();
+		}
+
+		for (size_t i = 0; i < paths.size(); i++) {
+			struct stat st;
+			results[i].path = paths[i];
+			if (stat(paths[i].c_str(), &st) != 0) continue;
+
+			keys[i] = {st.st_dev, st.st_ino, st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec, (uint64_t) st.st_size};
+			auto it = cache.find(keys[i]);
+
+			if (it != cache.end()) {
+				results[i] = it->second;
+				results[i].path = paths[i];
+			} else {
+				pending[i] = true;
+				dirty = true;
+			}
+		}
+
+		std::atomic<size_t> next = 0;
+		auto worker = [&]() {
+			for (size_t i = next++; i < paths.size(); i = next++) {
+				if (pending[i]) results[i] = hash(paths[i]);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		size_t count = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), paths.size());
+		for (size_t t = 1; t < count; t++) threads.emplace_back(worker);
+		worker();
+		for (std::thread& t : threads) t.join();
+
+		if (dirty) {
+			//read again: entries another hashAll() saved meanwhile are kept
+			std::lock_guard<std::mutex> lock(cacheMutex);
+			cache = readCache();
+			for (size_t i = 0; i < paths.size(); i++) {
+				if (pending[i] && results[i].found) cache[keys[i]] = results[i];
+			}
+			if (!writeCache(cache)) g_warning("dxdiag: could not save %s", cachePath().c_str());
+		}
+
+		return results;
+	}
+}